@@ -0,0 +1,341 @@
+/**
+ * @file bench.c
+ * @brief 热点解析与序列化路径的微基准 (主机编译: make bench)
+ *
+ * 输入来自 bench/fixtures/ 下按设备原始格式保存的样本 (AT+SPENGMD 返回、ifconfig 输出、
+ * uevent 消息、短信 hex、Webhook 请求体、HTTP 请求行)，替换为新抓取的设备输出即可复测。
+ *
+ * 每个用例自动加倍迭代次数直到运行时间超过下限，结果以 JSON 输出到标准输出
+ * (每个用例一行)，用 bench/compare.sh 对比两次提交的结果。
+ *
+ * requests.txt 中只放不访问主机的请求 (内存快照、认证拒绝、路由未命中)，结果与运行环境无关；
+ * 会执行命令或访问 D-Bus/数据库的请求放在 requests_host.txt，仅在 -H 时作为 http_host 用例运行，
+ * 其结果取决于主机状态，不参与提交间对比。
+ *
+ * 用法: bench [-d fixtures目录] [-t 每个用例最短毫秒数] [-H] [名称前缀过滤]
+ */
+
+#include "advanced.h"
+#include "arena.h"
+#include "charge.h"
+#include "http_server.h"
+#include "http_utils.h"
+#include "json_builder.h"
+#include "mongoose.h"
+#include "netif.h"
+#include "sha256.h"
+#include "sms.h"
+#include "startup.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_MAX_REQUESTS 16
+
+typedef struct {
+    const char *name;
+    void (*fn)(long iters, void *arg);
+    void *arg;
+    size_t bytes;               /* 每次操作处理的输入字节数 (0 表示不统计吞吐) */
+} BenchCase;
+
+/* 防止结果被优化掉 */
+static volatile long g_sink;
+
+static const char *g_fixture_dir = "bench/fixtures";
+static uint64_t g_min_ns = 200 * 1000000ULL;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* 读取样本文件，失败直接退出 */
+static char *load_fixture(const char *name, size_t *len) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", g_fixture_dir, name);
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "bench: 无法打开样本 %s\n", path);
+        exit(1);
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *buf = malloc((size_t)size + 1);
+    if (!buf || fread(buf, 1, (size_t)size, fp) != (size_t)size) {
+        fprintf(stderr, "bench: 读取样本失败 %s\n", path);
+        exit(1);
+    }
+    fclose(fp);
+    buf[size] = '\0';
+    if (len) *len = (size_t)size;
+    return buf;
+}
+
+/* ==================== 用例 ==================== */
+
+static char g_cell_grid[64][16][32];
+
+static void bench_parse_cell(long iters, void *arg) {
+    for (long i = 0; i < iters; i++) {
+        g_sink += parse_cell_to_vec((const char *)arg, g_cell_grid);
+    }
+}
+
+static void bench_hex_decode(long iters, void *arg) {
+    char out[1024];
+    for (long i = 0; i < iters; i++) {
+        hex_decode((const char *)arg, out, sizeof(out));
+        g_sink += out[0];
+    }
+}
+
+static NetInterface g_ifaces[16];
+
+static void bench_parse_ifconfig(long iters, void *arg) {
+    for (long i = 0; i < iters; i++) {
+        g_sink += parse_ifconfig_output((const char *)arg, g_ifaces, 16);
+    }
+}
+
+/* uevent 消息: 样本按行保存，运行前把换行替换为 '\0' */
+typedef struct {
+    char *buf;
+    int len;
+} UeventFixture;
+
+static void bench_battery_event(long iters, void *arg) {
+    UeventFixture *u = (UeventFixture *)arg;
+    for (long i = 0; i < iters; i++) {
+        g_sink += is_battery_event(u->buf, u->len);
+    }
+}
+
+static void bench_sha256(long iters, void *arg) {
+    char hex[65];
+    for (long i = 0; i < iters; i++) {
+        sha256_hash_string((const char *)arg, hex);
+        g_sink += hex[0];
+    }
+}
+
+/* 按 Webhook 配置保存接口的方式解析请求体 */
+static void bench_json_parse(long iters, void *arg) {
+    struct mg_str body = mg_str((const char *)arg);
+    char url[512], tmpl[1024], headers[512], platform[32];
+    for (long i = 0; i < iters; i++) {
+        bool enabled = false;
+        mg_json_get_bool(body, "$.enabled", &enabled);
+        http_json_get_str(body, "$.platform", platform, sizeof(platform));
+        http_json_get_str(body, "$.url", url, sizeof(url));
+        http_json_get_str(body, "$.body", tmpl, sizeof(tmpl));
+        http_json_get_str(body, "$.headers", headers, sizeof(headers));
+        long retry = mg_json_get_long(body, "$.retry", 0);
+        long timeout = mg_json_get_long(body, "$.timeout", 0);
+        g_sink += enabled + retry + timeout + url[0];
+    }
+}
+
+/* 按 /api/sms 的方式输出短信列表 (50 条，含需要转义的内容)，在请求内存池中进行 */
+static void bench_json_sms_list(long iters, void *arg) {
+    (void)arg;
+    static Arena arena;
+    const char *content = "【中国移动】您本月已使用流量12.36GB，\"剩余\"87.64GB。\n详情请登录APP查询。";
+    for (long i = 0; i < iters; i++) {
+        arena_begin(&arena);
+        JsonBuilder *j = json_new();
+        json_arr_open(j, NULL);
+        for (int k = 0; k < 50; k++) {
+            json_arr_obj_open(j);
+            json_add_int(j, "id", k + 1);
+            json_add_str(j, "sender", "10086");
+            json_add_str(j, "content", content);
+            json_add_str(j, "timestamp", "2026-10-18T19:12:00");
+            json_add_bool(j, "read", k & 1);
+            json_obj_close(j);
+        }
+        json_arr_close(j);
+        char *out = json_finish(j);
+        g_sink += out ? out[0] : 0;
+        arena_free(out);
+        arena_end(&arena);
+    }
+}
+
+/* 按 /api/cells 的方式输出 16 个小区 (以浮点字段为主) */
+static void bench_json_cells(long iters, void *arg) {
+    (void)arg;
+    static Arena arena;
+    for (long i = 0; i < iters; i++) {
+        arena_begin(&arena);
+        JsonBuilder *j = json_new();
+        json_obj_open(j);
+        json_add_int(j, "Code", 0);
+        json_add_str(j, "Error", "");
+        json_arr_open(j, "Data");
+        for (int k = 0; k < 16; k++) {
+            json_arr_obj_open(j);
+            json_add_str(j, "rat", "4G");
+            json_add_str(j, "band", "B3");
+            json_add_int(j, "arfcn", 1650 + k);
+            json_add_int(j, "pci", 100 + k);
+            json_add_double(j, "rsrp", -98.5 - k);
+            json_add_double(j, "rsrq", -11.25);
+            json_add_double(j, "sinr", 12.75 - k);
+            json_add_bool(j, "isServing", k == 0);
+            json_obj_close(j);
+        }
+        json_arr_close(j);
+        json_obj_close(j);
+        char *out = json_finish(j);
+        g_sink += out ? out[0] : 0;
+        arena_free(out);
+        arena_end(&arena);
+    }
+}
+
+/* 完整的请求处理路径 (追踪、内存池、认证、路由查找、处理函数、指标) */
+typedef struct {
+    struct mg_connection *c;
+    struct mg_http_message hm;
+    char raw[256];
+} DispatchFixture;
+
+static void bench_dispatch(long iters, void *arg) {
+    DispatchFixture *d = (DispatchFixture *)arg;
+    for (long i = 0; i < iters; i++) {
+        http_server_handle(d->c, &d->hm);
+        g_sink += (long)d->c->send.len;
+        d->c->send.len = 0;
+    }
+}
+
+/* 按行加载请求样本为分发用例 (名称为 前缀/方法 URI) */
+static void add_dispatch_cases(struct mg_mgr *mgr, const char *fixture, const char *prefix,
+                               DispatchFixture *dispatch, char (*names)[160], int *nreq,
+                               BenchCase *cases, int *count) {
+    char *requests = load_fixture(fixture, NULL);
+    for (char *line = strtok(requests, "\n"); line && *nreq < BENCH_MAX_REQUESTS; line = strtok(NULL, "\n")) {
+        DispatchFixture *d = &dispatch[*nreq];
+        int len = snprintf(d->raw, sizeof(d->raw), "%s\r\nHost: 127.0.0.1\r\n\r\n", line);
+        if (mg_http_parse(d->raw, (size_t)len, &d->hm) <= 0) continue;
+        d->c = mg_alloc_conn(mgr);
+        if (!d->c) break;
+        snprintf(names[*nreq], 160, "%s/%.*s %.*s", prefix,
+                 (int)d->hm.method.len, d->hm.method.buf, (int)d->hm.uri.len, d->hm.uri.buf);
+        cases[(*count)++] = (BenchCase){names[*nreq], bench_dispatch, d, (size_t)len};
+        (*nreq)++;
+    }
+}
+
+/* ==================== 运行 ==================== */
+
+static void run_case(const BenchCase *bc, int *first) {
+    long iters = 1;
+    uint64_t elapsed;
+
+    bc->fn(1, bc->arg); /* 预热 */
+    for (;;) {
+        uint64_t t0 = now_ns();
+        bc->fn(iters, bc->arg);
+        elapsed = now_ns() - t0;
+        if (elapsed >= g_min_ns || iters >= (1L << 40)) break;
+        /* 按已测速度估算达到下限所需次数，至少加倍 */
+        long next = elapsed > 0 ? (long)((double)iters * g_min_ns / elapsed * 1.2) : iters * 100;
+        iters = next > iters * 2 ? next : iters * 2;
+    }
+
+    double ns_per_op = (double)elapsed / (double)iters;
+    double mb_per_s = bc->bytes ? (double)bc->bytes * 1000.0 / ns_per_op : 0.0;
+    fprintf(stdout, "%s    {\"name\":\"%s\",\"iterations\":%ld,\"ns_per_op\":%.1f,\"mb_per_s\":%.2f}",
+            *first ? "" : ",\n", bc->name, iters, ns_per_op, mb_per_s);
+    fflush(stdout);
+    *first = 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *filter = NULL;
+    int host_requests = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            g_fixture_dir = argv[++i];
+        } else if (strcmp(argv[i], "-H") == 0) {
+            host_requests = 1;
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            g_min_ns = strtoull(argv[++i], NULL, 10) * 1000000ULL;
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    mg_log_set(MG_LL_NONE);
+
+    /* 样本 */
+    char *nr_serving = load_fixture("spengmd_nr_serving.txt", NULL);
+    char *nr_neighbor = load_fixture("spengmd_nr_neighbor.txt", NULL);
+    char *lte_neighbor = load_fixture("spengmd_lte_neighbor.txt", NULL);
+    char *sms_hex = load_fixture("sms_hex.txt", NULL);
+    char *ifconfig = load_fixture("ifconfig.txt", NULL);
+    char *webhook = load_fixture("body_webhook.json", NULL);
+    sms_hex[strcspn(sms_hex, "\r\n")] = '\0';
+
+    UeventFixture battery, usb;
+    size_t n;
+    battery.buf = load_fixture("uevent_battery.txt", &n);
+    battery.len = (int)n;
+    usb.buf = load_fixture("uevent_usb.txt", &n);
+    usb.len = (int)n;
+    for (int i = 0; i < battery.len; i++) if (battery.buf[i] == '\n') battery.buf[i] = '\0';
+    for (int i = 0; i < usb.len; i++) if (usb.buf[i] == '\n') usb.buf[i] = '\0';
+
+    BenchCase cases[32 + BENCH_MAX_REQUESTS];
+    int count = 0;
+    cases[count++] = (BenchCase){"parse_cell_to_vec/nr_serving", bench_parse_cell, nr_serving, strlen(nr_serving)};
+    cases[count++] = (BenchCase){"parse_cell_to_vec/nr_neighbor", bench_parse_cell, nr_neighbor, strlen(nr_neighbor)};
+    cases[count++] = (BenchCase){"parse_cell_to_vec/lte_neighbor", bench_parse_cell, lte_neighbor, strlen(lte_neighbor)};
+    cases[count++] = (BenchCase){"json_builder/sms_list_50", bench_json_sms_list, NULL, 0};
+    cases[count++] = (BenchCase){"json_builder/cells_16", bench_json_cells, NULL, 0};
+    cases[count++] = (BenchCase){"mg_json/webhook_body", bench_json_parse, webhook, strlen(webhook)};
+    cases[count++] = (BenchCase){"hex_decode/sms", bench_hex_decode, sms_hex, strlen(sms_hex)};
+    cases[count++] = (BenchCase){"parse_ifconfig_output/4_ifaces", bench_parse_ifconfig, ifconfig, strlen(ifconfig)};
+    cases[count++] = (BenchCase){"is_battery_event/battery", bench_battery_event, &battery, (size_t)battery.len};
+    cases[count++] = (BenchCase){"is_battery_event/usb", bench_battery_event, &usb, (size_t)usb.len};
+    cases[count++] = (BenchCase){"sha256_hash_string/password", bench_sha256, "admin123456", 11};
+
+    /* 请求分发: 每行一个请求行，使用未连接的 mongoose 连接承接响应 */
+    struct mg_mgr mgr;
+    mg_mgr_init(&mgr);
+    startup_init();
+    startup_run_groups(NULL, 0);
+    http_server_routes_init();
+
+    static DispatchFixture dispatch[BENCH_MAX_REQUESTS];
+    static char names[BENCH_MAX_REQUESTS][160];
+    int nreq = 0;
+    add_dispatch_cases(&mgr, "requests.txt", "http_dispatch", dispatch, names, &nreq, cases, &count);
+    if (host_requests)
+        add_dispatch_cases(&mgr, "requests_host.txt", "http_host", dispatch, names, &nreq, cases, &count);
+
+    const char *commit = getenv("BENCH_COMMIT");
+    fprintf(stdout, "{\n  \"commit\": \"%s\",\n  \"min_ms\": %llu,\n  \"results\": [\n",
+            commit ? commit : "", (unsigned long long)(g_min_ns / 1000000ULL));
+    int first = 1;
+    for (int i = 0; i < count; i++) {
+        if (filter && strncmp(cases[i].name, filter, strlen(filter)) != 0) continue;
+        run_case(&cases[i], &first);
+    }
+    fprintf(stdout, "\n  ]\n}\n");
+
+    for (int i = 0; i < nreq; i++) {
+        free(dispatch[i].c->send.buf);
+        free(dispatch[i].c->recv.buf);
+        free(dispatch[i].c);
+    }
+    mg_mgr_free(&mgr);
+    return 0;
+}
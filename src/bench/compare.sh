@@ -0,0 +1,30 @@
+#!/bin/sh
+# 对比两次 make bench 的结果
+# 用法: bench/compare.sh 旧结果.json 新结果.json
+# 输出每个用例的 ns/op 及变化百分比 (负数表示变快)
+
+if [ $# -ne 2 ]; then
+    echo "用法: $0 旧结果.json 新结果.json" >&2
+    exit 1
+fi
+
+extract() {
+    sed -n 's/.*"name":"\([^"]*\)".*"ns_per_op":\([0-9.]*\).*/\1\t\2/p' "$1"
+}
+
+extract "$1" > /tmp/bench-old.$$
+extract "$2" > /tmp/bench-new.$$
+
+awk -F '\t' '
+    NR == FNR { old[$1] = $2; next }
+    {
+        if ($1 in old && old[$1] > 0) {
+            printf "%-44s %12.1f %12.1f %+8.1f%%\n", $1, old[$1], $2, ($2 - old[$1]) * 100 / old[$1]
+        } else {
+            printf "%-44s %12s %12.1f %9s\n", $1, "-", $2, "new"
+        }
+    }
+    BEGIN { printf "%-44s %12s %12s %9s\n", "case", "old ns/op", "new ns/op", "delta" }
+' /tmp/bench-old.$$ /tmp/bench-new.$$
+
+rm -f /tmp/bench-old.$$ /tmp/bench-new.$$
@@ -2,20 +2,26 @@
  * @file debug.h
  * @brief 调试输出控制
  * 
- * 编译时添加 -DDISABLE_PRINTF 禁用所有printf输出
- * 移除该选项可恢复printf输出
+ * 默认将 printf 映射到日志模块 (log.h)，按 INFO 级别记录并受运行期级别控制，
+ * 由刷写线程输出到 stdout；编译时添加 -DDISABLE_PRINTF 可彻底移除所有 printf 调用
  */
 
 #ifndef DEBUG_H
 #define DEBUG_H
 
+#include <stdio.h>
+#include "log.h"
+
+#ifdef printf
+    #undef printf
+#endif
+
 #ifdef DISABLE_PRINTF
     /* 禁用printf - 使用内联函数避免宏展开问题 */
-    #include <stdio.h>
-    #ifdef printf
-        #undef printf
-    #endif
     #define printf(fmt, ...) do { (void)(fmt); } while(0)
+#else
+    /* printf 写入日志环形缓冲区 */
+    #define printf(...) LOG_PRINTF(__VA_ARGS__)
 #endif
 
 #endif /* DEBUG_H */
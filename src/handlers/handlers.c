@@ -4,10 +4,12 @@
  */
 
 #include "handlers.h"
+#include "advanced.h"
 #include "airplane.h"
 #include "apn.h"
 #include "dbus_core.h"
 #include "exec_utils.h"
+#include "feature.h"
 #include "http_utils.h"
 #include "json_builder.h"
 #include "modem.h"
@@ -76,11 +78,7 @@ void handle_execute_at(struct mg_connection *c, struct mg_http_message *hm) {
   char *result = NULL;
 
   /* 使用mongoose内置JSON解析 */
-  char *cmd_str = mg_json_get_str(hm->body, "$.command");
-  if (cmd_str) {
-    strncpy(cmd, cmd_str, sizeof(cmd) - 1);
-    free(cmd_str);
-  }
+  http_json_get_str(hm->body, "$.command", cmd, sizeof(cmd));
 
   if (strlen(cmd) == 0) {
     HTTP_OK(c, "{\"Code\":0,\"Error\":\"命令不能为空\",\"Data\":null}");
@@ -125,16 +123,8 @@ void handle_set_network(struct mg_connection *c, struct mg_http_message *hm) {
   char slot[16] = {0};
 
   /* 使用mongoose内置JSON解析 */
-  char *mode_str = mg_json_get_str(hm->body, "$.mode");
-  char *slot_str = mg_json_get_str(hm->body, "$.slot");
-  if (mode_str) {
-    strncpy(mode, mode_str, sizeof(mode) - 1);
-    free(mode_str);
-  }
-  if (slot_str) {
-    strncpy(slot, slot_str, sizeof(slot) - 1);
-    free(slot_str);
-  }
+  http_json_get_str(hm->body, "$.mode", mode, sizeof(mode));
+  http_json_get_str(hm->body, "$.slot", slot, sizeof(slot));
 
   if (strlen(mode) == 0) {
     HTTP_ERROR(c, 400, "Mode parameter is required");
@@ -165,11 +155,7 @@ void handle_switch(struct mg_connection *c, struct mg_http_message *hm) {
   HTTP_CHECK_POST(c, hm);
 
   char slot[16] = {0};
-  char *slot_str = mg_json_get_str(hm->body, "$.slot");
-  if (slot_str) {
-    strncpy(slot, slot_str, sizeof(slot) - 1);
-    free(slot_str);
-  }
+  http_json_get_str(hm->body, "$.slot", slot, sizeof(slot));
 
   if (strlen(slot) == 0) {
     HTTP_ERROR(c, 400, "Slot parameter is required");
@@ -226,11 +212,7 @@ void handle_device_control(struct mg_connection *c,
   HTTP_CHECK_POST(c, hm);
 
   char action[32] = {0};
-  char *action_str = mg_json_get_str(hm->body, "$.action");
-  if (action_str) {
-    strncpy(action, action_str, sizeof(action) - 1);
-    free(action_str);
-  }
+  http_json_get_str(hm->body, "$.action", action, sizeof(action));
 
   if (strlen(action) == 0) {
     HTTP_ERROR(c, 400, "Action parameter is required");
@@ -360,130 +342,26 @@ int parse_cell_to_vec(const char *input, char data[64][16][32]) {
   return row;
 }
 
-/**
- * 判断当前网络是否为 5G
- * 通过 D-Bus 查询 oFono NetworkMonitor 获取网络类型
- * @return 1=5G, 0=4G/其他
- */
-static int is_5g_network(void) {
-  char tech[32] = {0};
-  int band = 0;
-
-  /* 使用C语言D-Bus API获取网络信息 */
-  if (ofono_get_serving_cell_info(tech, sizeof(tech), &band) != 0) {
-    printf("D-Bus 查询网络类型失败，默认使用 4G\n");
-    return 0;
-  }
-
-  /* 判断网络类型 - 检查是否为 "nr" */
-  if (strcmp(tech, "nr") == 0) {
-    return 1; /* 5G */
-  }
-
-  return 0; /* 4G 或其他 */
-}
-
 /* GET /api/current_band - 获取当前连接频段 */
 void handle_get_current_band(struct mg_connection *c,
                              struct mg_http_message *hm) {
   HTTP_CHECK_GET(c, hm);
 
-  char net_type[32] = "N/A";
-  char band[32] = "N/A";
-  int arfcn = 0, pci = 0;
-  double rsrp = 0, rsrq = 0, sinr = 0;
-  char response[512];
-
-  /* 通过 D-Bus 判断网络类型 (与 Go 版本一致) */
-  int is_5g = is_5g_network();
-  char *result = NULL;
-
-  if (is_5g) {
-    /* 5G 网络: AT+SPENGMD=0,14,1 */
-    if (execute_at("AT+SPENGMD=0,14,1", &result) == 0 && result &&
-        strlen(result) > 100) {
-      char data[64][16][32] = {{{0}}};
-      int rows = parse_cell_to_vec(result, data);
-
-      if (rows > 15) {
-        strcpy(net_type, "5G NR");
-        if (strlen(data[0][0]) > 0) {
-          snprintf(band, sizeof(band), "N%s", data[0][0]);
-        }
-        if (strlen(data[1][0]) > 0) {
-          arfcn = atoi(data[1][0]);
-        }
-        if (strlen(data[2][0]) > 0) {
-          pci = atoi(data[2][0]);
-        }
-        if (strlen(data[3][0]) > 0) {
-          rsrp = atof(data[3][0]) / 100.0;
-        }
-        if (strlen(data[4][0]) > 0) {
-          rsrq = atof(data[4][0]) / 100.0;
-        }
-        if (strlen(data[15][0]) > 0) {
-          sinr = atof(data[15][0]) / 100.0;
-        }
-        printf("当前连接5G频段: Band=%s, ARFCN=%d, PCI=%d, RSRP=%.2f, "
-               "RSRQ=%.2f, SINR=%.2f\n",
-               band, arfcn, pci, rsrp, rsrq, sinr);
-      }
-    }
-    if (result) {
-      g_free(result);
-      result = NULL;
-    }
-  } else {
-    /* 4G 网络: AT+SPENGMD=0,6,0 */
-    if (execute_at("AT+SPENGMD=0,6,0", &result) == 0 && result &&
-        strlen(result) > 100) {
-      char data[64][16][32] = {{{0}}};
-      int rows = parse_cell_to_vec(result, data);
-
-      if (rows > 33) {
-        strcpy(net_type, "4G LTE");
-        if (strlen(data[0][0]) > 0) {
-          snprintf(band, sizeof(band), "B%s", data[0][0]);
-        }
-        if (strlen(data[1][0]) > 0) {
-          arfcn = atoi(data[1][0]);
-        }
-        if (strlen(data[2][0]) > 0) {
-          pci = atoi(data[2][0]);
-        }
-        if (strlen(data[3][0]) > 0) {
-          rsrp = atof(data[3][0]) / 100.0;
-        }
-        if (strlen(data[4][0]) > 0) {
-          rsrq = atof(data[4][0]) / 100.0;
-        }
-        if (strlen(data[33][0]) > 0) {
-          sinr = atof(data[33][0]) / 100.0;
-        }
-        printf("当前连接4G频段: Band=%s, ARFCN=%d, PCI=%d, RSRP=%.2f, "
-               "RSRQ=%.2f, SINR=%.2f\n",
-               band, arfcn, pci, rsrp, rsrq, sinr);
-      }
-    }
-    if (result) {
-      g_free(result);
-      result = NULL;
-    }
-  }
+  ServingCell cell;
+  advanced_get_serving_cell(&cell);
 
   JsonBuilder *j = json_new();
   json_obj_open(j);
   json_add_int(j, "Code", 0);
   json_add_str(j, "Error", "");
   json_key_obj_open(j, "Data");
-  json_add_str(j, "network_type", net_type);
-  json_add_str(j, "band", band);
-  json_add_int(j, "arfcn", arfcn);
-  json_add_int(j, "pci", pci);
-  json_add_double(j, "rsrp", rsrp);
-  json_add_double(j, "rsrq", rsrq);
-  json_add_double(j, "sinr", sinr);
+  json_add_str(j, "network_type", cell.net_type);
+  json_add_str(j, "band", cell.band);
+  json_add_int(j, "arfcn", cell.arfcn);
+  json_add_int(j, "pci", cell.pci);
+  json_add_double(j, "rsrp", cell.rsrp);
+  json_add_double(j, "rsrq", cell.rsrq);
+  json_add_double(j, "sinr", cell.sinr);
   json_obj_close(j);
   json_obj_close(j);
 
@@ -493,34 +371,34 @@ void handle_get_current_band(struct mg_connection *c,
 /* ==================== 短信 API ==================== */
 #include "sms.h"
 
+/* 短信逐条写入JSON数组 */
+static void sms_list_to_json(const SmsMessage *msg, void *ctx) {
+  JsonBuilder *j = (JsonBuilder *)ctx;
+  char time_str[32];
+  struct tm *tm_info = localtime(&msg->timestamp);
+  strftime(time_str, sizeof(time_str), "%Y-%m-%dT%H:%M:%S", tm_info);
+
+  json_arr_obj_open(j);
+  json_add_int(j, "id", msg->id);
+  json_add_str(j, "sender", msg->sender);
+  json_add_str(j, "content", msg->content);
+  json_add_str(j, "timestamp", time_str);
+  json_add_bool(j, "read", msg->is_read);
+  json_obj_close(j);
+}
+
 /* GET /api/sms - 获取短信列表 */
 void handle_sms_list(struct mg_connection *c, struct mg_http_message *hm) {
   HTTP_CHECK_GET(c, hm);
 
-  SmsMessage messages[100];
-  int count = sms_get_list(messages, 100);
-
-  if (count < 0) {
-    HTTP_ERROR(c, 500, "获取短信列表失败");
-    return;
-  }
-
-  /* 使用JSON Builder构建数组 */
+  /* 使用JSON Builder构建数组 (逐条写入，不在栈上保存整个列表) */
   JsonBuilder *j = json_new();
   json_arr_open(j, NULL);
 
-  for (int i = 0; i < count; i++) {
-    char time_str[32];
-    struct tm *tm_info = localtime(&messages[i].timestamp);
-    strftime(time_str, sizeof(time_str), "%Y-%m-%dT%H:%M:%S", tm_info);
-
-    json_arr_obj_open(j);
-    json_add_int(j, "id", messages[i].id);
-    json_add_str(j, "sender", messages[i].sender);
-    json_add_str(j, "content", messages[i].content);
-    json_add_str(j, "timestamp", time_str);
-    json_add_bool(j, "read", messages[i].is_read);
-    json_obj_close(j);
+  if (sms_foreach(100, sms_list_to_json, j) < 0) {
+    json_free(j);
+    HTTP_ERROR(c, 500, "获取短信列表失败");
+    return;
   }
 
   json_arr_close(j);
@@ -535,16 +413,8 @@ void handle_sms_send(struct mg_connection *c, struct mg_http_message *hm) {
   char content[1024] = {0};
 
   /* 使用mongoose内置JSON解析 */
-  char *r = mg_json_get_str(hm->body, "$.recipient");
-  char *ct = mg_json_get_str(hm->body, "$.content");
-  if (r) {
-    strncpy(recipient, r, sizeof(recipient) - 1);
-    free(r);
-  }
-  if (ct) {
-    strncpy(content, ct, sizeof(content) - 1);
-    free(ct);
-  }
+  http_json_get_str(hm->body, "$.recipient", recipient, sizeof(recipient));
+  http_json_get_str(hm->body, "$.content", content, sizeof(content));
 
   if (strlen(recipient) == 0 || strlen(content) == 0) {
     HTTP_ERROR(c, 400, "收件人和内容不能为空");
@@ -612,17 +482,6 @@ void handle_sms_webhook_get(struct mg_connection *c,
   HTTP_OK_FREE(c, json_finish(j));
 }
 
-/* 辅助函数：使用mongoose解析JSON字符串并复制到目标缓冲区 */
-static void mg_json_get_str_to_buf(struct mg_str json, const char *path,
-                                   char *out, size_t out_size) {
-  char *str = mg_json_get_str(json, path);
-  if (str) {
-    strncpy(out, str, out_size - 1);
-    out[out_size - 1] = '\0';
-    free(str);
-  }
-}
-
 /* POST /api/sms/webhook - 保存Webhook配置 */
 void handle_sms_webhook_save(struct mg_connection *c,
                              struct mg_http_message *hm) {
@@ -636,12 +495,12 @@ void handle_sms_webhook_save(struct mg_connection *c,
   config.enabled = enabled ? 1 : 0;
 
   /* 使用mongoose解析字符串字段 */
-  mg_json_get_str_to_buf(hm->body, "$.platform", config.platform,
-                         sizeof(config.platform));
-  mg_json_get_str_to_buf(hm->body, "$.url", config.url, sizeof(config.url));
-  mg_json_get_str_to_buf(hm->body, "$.body", config.body, sizeof(config.body));
-  mg_json_get_str_to_buf(hm->body, "$.headers", config.headers,
-                         sizeof(config.headers));
+  http_json_get_str(hm->body, "$.platform", config.platform,
+                    sizeof(config.platform));
+  http_json_get_str(hm->body, "$.url", config.url, sizeof(config.url));
+  http_json_get_str(hm->body, "$.body", config.body, sizeof(config.body));
+  http_json_get_str(hm->body, "$.headers", config.headers,
+                    sizeof(config.headers));
 
   if (sms_save_webhook_config(&config) == 0) {
     HTTP_SUCCESS(c, "配置已保存");
@@ -662,29 +521,29 @@ void handle_sms_webhook_test(struct mg_connection *c,
   }
 }
 
+/* 发送记录逐条写入JSON数组 */
+static void sms_sent_to_json(const SentSmsMessage *msg, void *ctx) {
+  JsonBuilder *j = (JsonBuilder *)ctx;
+  json_arr_obj_open(j);
+  json_add_int(j, "id", msg->id);
+  json_add_str(j, "recipient", msg->recipient);
+  json_add_str(j, "content", msg->content);
+  json_add_long(j, "timestamp", (long long)msg->timestamp);
+  json_add_str(j, "status", msg->status);
+  json_obj_close(j);
+}
+
 /* GET /api/sms/sent - 获取发送记录列表 */
 void handle_sms_sent_list(struct mg_connection *c, struct mg_http_message *hm) {
   HTTP_CHECK_GET(c, hm);
 
-  SentSmsMessage messages[150];
-  int count = sms_get_sent_list(messages, 150);
-
-  if (count < 0) {
-    HTTP_ERROR(c, 500, "获取发送记录失败");
-    return;
-  }
-
   JsonBuilder *j = json_new();
   json_arr_open(j, NULL);
 
-  for (int i = 0; i < count; i++) {
-    json_arr_obj_open(j);
-    json_add_int(j, "id", messages[i].id);
-    json_add_str(j, "recipient", messages[i].recipient);
-    json_add_str(j, "content", messages[i].content);
-    json_add_long(j, "timestamp", (long long)messages[i].timestamp);
-    json_add_str(j, "status", messages[i].status);
-    json_obj_close(j);
+  if (sms_foreach_sent(150, sms_sent_to_json, j) < 0) {
+    json_free(j);
+    HTTP_ERROR(c, 500, "获取发送记录失败");
+    return;
   }
 
   json_arr_close(j);
@@ -805,6 +664,7 @@ void handle_sms_fix_set(struct mg_connection *c, struct mg_http_message *hm) {
   }
 }
 
+#if FEATURE_UPDATE
 /* ==================== OTA更新 API ==================== */
 #include "update.h"
 
@@ -861,11 +721,7 @@ void handle_update_download(struct mg_connection *c,
   HTTP_CHECK_POST(c, hm);
 
   char url[512] = {0};
-  char *url_str = mg_json_get_str(hm->body, "$.url");
-  if (url_str) {
-    strncpy(url, url_str, sizeof(url) - 1);
-    free(url_str);
-  }
+  http_json_get_str(hm->body, "$.url", url, sizeof(url));
 
   if (strlen(url) == 0) {
     HTTP_ERROR(c, 400, "URL参数不能为空");
@@ -948,6 +804,8 @@ void handle_update_check(struct mg_connection *c, struct mg_http_message *hm) {
 
 /* 已删除 /api/update/config - 版本检查URL已嵌入程序 */
 
+#endif /* FEATURE_UPDATE */
+
 /* GET /api/get/time - 获取系统时间 */
 void handle_get_system_time(struct mg_connection *c,
                             struct mg_http_message *hm) {
@@ -1262,6 +1120,7 @@ void handle_roaming_status(struct mg_connection *c,
 //     }
 // }
 
+#if FEATURE_PLUGIN
 /* ==================== 插件管理 API ==================== */
 #include "plugin.h"
 
@@ -1270,11 +1129,7 @@ void handle_shell_execute(struct mg_connection *c, struct mg_http_message *hm) {
   HTTP_CHECK_POST(c, hm);
 
   char cmd[1024] = {0};
-  char *cmd_str = mg_json_get_str(hm->body, "$.command");
-  if (cmd_str) {
-    strncpy(cmd, cmd_str, sizeof(cmd) - 1);
-    free(cmd_str);
-  }
+  http_json_get_str(hm->body, "$.command", cmd, sizeof(cmd));
 
   if (strlen(cmd) == 0) {
     HTTP_OK(c, "{\"Code\":1,\"Error\":\"命令不能为空\",\"Data\":null}");
@@ -1328,13 +1183,9 @@ void handle_plugin_upload(struct mg_connection *c, struct mg_http_message *hm) {
   HTTP_CHECK_POST(c, hm);
 
   char name[256] = {0};
-  char *name_str = mg_json_get_str(hm->body, "$.name");
-  if (name_str) {
-    strncpy(name, name_str, sizeof(name) - 1);
-    free(name_str);
-  }
+  http_json_get_str(hm->body, "$.name", name, sizeof(name));
 
-  char *content_str = mg_json_get_str(hm->body, "$.content");
+  char *content_str = http_json_dup(hm->body, "$.content");
   if (!content_str) {
     JsonBuilder *j = json_new();
     json_obj_open(j);
@@ -1365,7 +1216,7 @@ void handle_plugin_upload(struct mg_connection *c, struct mg_http_message *hm) {
   json_obj_close(j);
   HTTP_OK_FREE(c, json_finish(j));
 
-  free(content_str);
+  arena_free(content_str);
 }
 
 /* DELETE /api/plugins/:name - 删除指定插件 */
@@ -1439,18 +1290,13 @@ void handle_plugin_delete_all(struct mg_connection *c,
 
 #define SCRIPTS_DIR "/home/root/6677/Plugins/scripts"
 
+/* 脚本列表中单个脚本内容的最大长度 */
+#define SCRIPT_LIST_MAX_CONTENT 32767
+
 /* GET /api/scripts - 获取脚本列表 */
 void handle_script_list(struct mg_connection *c, struct mg_http_message *hm) {
   HTTP_CHECK_GET(c, hm);
 
-  char *json = malloc(256 * 1024);
-  if (!json) {
-    HTTP_ERROR(c, 500, "内存分配失败");
-    return;
-  }
-
-  strcpy(json, "[");
-  int first = 1;
   int count = 0;
 
   /* 确保目录存在 */
@@ -1458,6 +1304,13 @@ void handle_script_list(struct mg_connection *c, struct mg_http_message *hm) {
   snprintf(mkdir_cmd, sizeof(mkdir_cmd), "mkdir -p %s", SCRIPTS_DIR);
   system(mkdir_cmd);
 
+  /* 逐个脚本直接写入JSON Builder，内容缓冲按文件大小从请求内存池分配 */
+  JsonBuilder *j = json_new();
+  json_obj_open(j);
+  json_add_int(j, "Code", 0);
+  json_add_str(j, "Error", "");
+  json_arr_open(j, "Data");
+
   DIR *dir = opendir(SCRIPTS_DIR);
   if (dir) {
     struct dirent *entry;
@@ -1470,25 +1323,27 @@ void handle_script_list(struct mg_connection *c, struct mg_http_message *hm) {
         struct stat st;
         if (stat(filepath, &st) == 0) {
           /* 读取脚本内容 */
+          size_t cap = st.st_size < SCRIPT_LIST_MAX_CONTENT
+                           ? (size_t)st.st_size
+                           : SCRIPT_LIST_MAX_CONTENT;
+          char *content = (char *)arena_alloc(cap + 1);
+          size_t n = 0;
           FILE *f = fopen(filepath, "r");
-          char content[32768] = {0};
-          if (f) {
-            fread(content, 1, sizeof(content) - 1, f);
-            fclose(f);
+          if (f && content) {
+            n = fread(content, 1, cap, f);
           }
-
-          /* 使用mongoose MG_ESC进行JSON转义 */
-          char escaped[65536];
-          mg_snprintf(escaped, sizeof(escaped), "%m", MG_ESC(content));
-
-          char item[70000];
-          snprintf(item, sizeof(item),
-                   "%s{\"name\":\"%s\",\"size\":%ld,\"mtime\":%ld,\"content\":"
-                   "%s}",
-                   first ? "" : ",", entry->d_name, st.st_size, st.st_mtime,
-                   escaped);
-          strcat(json, item);
-          first = 0;
+          if (f)
+            fclose(f);
+          if (content)
+            content[n] = '\0';
+
+          json_arr_obj_open(j);
+          json_add_str(j, "name", entry->d_name);
+          json_add_long(j, "size", (long long)st.st_size);
+          json_add_long(j, "mtime", (long long)st.st_mtime);
+          json_add_str(j, "content", content);
+          json_obj_close(j);
+          arena_free(content);
           count++;
         }
       }
@@ -1496,19 +1351,11 @@ void handle_script_list(struct mg_connection *c, struct mg_http_message *hm) {
     closedir(dir);
   }
 
-  strcat(json, "]");
-
-  /* 使用JSON Builder构建外层响应 */
-  JsonBuilder *j = json_new();
-  json_obj_open(j);
-  json_add_int(j, "Code", 0);
-  json_add_str(j, "Error", "");
-  json_add_raw(j, "Data", json);
+  json_arr_close(j);
   json_add_int(j, "Count", count);
   json_obj_close(j);
 
   HTTP_OK_FREE(c, json_finish(j));
-  free(json);
 }
 
 /* POST /api/scripts - 上传脚本 */
@@ -1516,13 +1363,9 @@ void handle_script_upload(struct mg_connection *c, struct mg_http_message *hm) {
   HTTP_CHECK_POST(c, hm);
 
   char name[256] = {0};
-  char *name_str = mg_json_get_str(hm->body, "$.name");
-  if (name_str) {
-    strncpy(name, name_str, sizeof(name) - 1);
-    free(name_str);
-  }
+  http_json_get_str(hm->body, "$.name", name, sizeof(name));
 
-  char *content_str = mg_json_get_str(hm->body, "$.content");
+  char *content_str = http_json_dup(hm->body, "$.content");
   if (!content_str) {
     JsonBuilder *j = json_new();
     json_obj_open(j);
@@ -1542,7 +1385,7 @@ void handle_script_upload(struct mg_connection *c, struct mg_http_message *hm) {
     json_add_null(j, "Data");
     json_obj_close(j);
     HTTP_OK_FREE(c, json_finish(j));
-    free(content_str);
+    arena_free(content_str);
     return;
   }
 
@@ -1576,7 +1419,7 @@ void handle_script_upload(struct mg_connection *c, struct mg_http_message *hm) {
   json_obj_close(j);
   HTTP_OK_FREE(c, json_finish(j));
 
-  free(content_str);
+  arena_free(content_str);
 }
 
 /* PUT /api/scripts/:name - 更新脚本 */
@@ -1606,7 +1449,7 @@ void handle_script_update(struct mg_connection *c, struct mg_http_message *hm) {
     return;
   }
 
-  char *content_str = mg_json_get_str(hm->body, "$.content");
+  char *content_str = http_json_dup(hm->body, "$.content");
   if (!content_str) {
     JsonBuilder *j = json_new();
     json_obj_open(j);
@@ -1638,7 +1481,7 @@ void handle_script_update(struct mg_connection *c, struct mg_http_message *hm) {
   json_obj_close(j);
   HTTP_OK_FREE(c, json_finish(j));
 
-  free(content_str);
+  arena_free(content_str);
 }
 
 /* DELETE /api/scripts/:name - 删除脚本 */
@@ -1730,12 +1573,16 @@ void handle_plugin_storage_get(struct mg_connection *c,
     return;
   }
 
-  char storage_content[PLUGIN_STORAGE_MAX_SIZE];
+  char *storage_content = arena_alloc(PLUGIN_STORAGE_MAX_SIZE);
+  if (!storage_content) {
+    HTTP_ERROR(c, 500, "内存分配失败");
+    return;
+  }
 
   JsonBuilder *j = json_new();
   json_obj_open(j);
   if (plugin_storage_read(plugin_name, storage_content,
-                          sizeof(storage_content)) == 0) {
+                          PLUGIN_STORAGE_MAX_SIZE) == 0) {
     json_add_int(j, "Code", 0);
     json_add_str(j, "Error", "");
     json_add_raw(j, "Data", storage_content);
@@ -1745,6 +1592,7 @@ void handle_plugin_storage_get(struct mg_connection *c,
     json_add_null(j, "Data");
   }
   json_obj_close(j);
+  arena_free(storage_content);
   HTTP_OK_FREE(c, json_finish(j));
 }
 
@@ -1761,11 +1609,14 @@ void handle_plugin_storage_set(struct mg_connection *c,
   }
 
   /* 直接使用请求体作为JSON数据存储 */
-  char json_data[PLUGIN_STORAGE_MAX_SIZE];
-  size_t len = hm->body.len < sizeof(json_data) - 1 ? hm->body.len
-                                                    : sizeof(json_data) - 1;
-  memcpy(json_data, hm->body.buf, len);
-  json_data[len] = '\0';
+  size_t len = hm->body.len < PLUGIN_STORAGE_MAX_SIZE - 1
+                   ? hm->body.len
+                   : PLUGIN_STORAGE_MAX_SIZE - 1;
+  char *json_data = arena_strndup(hm->body.buf, len);
+  if (!json_data) {
+    HTTP_ERROR(c, 500, "内存分配失败");
+    return;
+  }
 
   JsonBuilder *j = json_new();
   json_obj_open(j);
@@ -1779,6 +1630,7 @@ void handle_plugin_storage_set(struct mg_connection *c,
     json_add_null(j, "Data");
   }
   json_obj_close(j);
+  arena_free(json_data);
   HTTP_OK_FREE(c, json_finish(j));
 }
 
@@ -1809,6 +1661,8 @@ void handle_plugin_storage_delete(struct mg_connection *c,
   HTTP_OK_FREE(c, json_finish(j));
 }
 
+#endif /* FEATURE_PLUGIN */
+
 /* ==================== 认证 API ==================== */
 #include "auth.h"
 
@@ -1820,11 +1674,7 @@ void handle_auth_login(struct mg_connection *c, struct mg_http_message *hm) {
   char token[AUTH_TOKEN_SIZE] = {0};
 
   /* 解析密码 */
-  char *pwd_str = mg_json_get_str(hm->body, "$.password");
-  if (pwd_str) {
-    strncpy(password, pwd_str, sizeof(password) - 1);
-    free(pwd_str);
-  }
+  http_json_get_str(hm->body, "$.password", password, sizeof(password));
 
   if (strlen(password) == 0) {
     HTTP_ERROR(c, 400, "密码不能为空");
@@ -1888,17 +1738,11 @@ void handle_auth_password(struct mg_connection *c, struct mg_http_message *hm) {
   char new_password[128] = {0};
 
   /* 解析参数 */
-  char *old_str = mg_json_get_str(hm->body, "$.old_password");
-  char *new_str = mg_json_get_str(hm->body, "$.new_password");
+  http_json_get_str(hm->body, "$.old_password", old_password,
+                    sizeof(old_password));
+  http_json_get_str(hm->body, "$.new_password", new_password,
+                    sizeof(new_password));
 
-  if (old_str) {
-    strncpy(old_password, old_str, sizeof(old_password) - 1);
-    free(old_str);
-  }
-  if (new_str) {
-    strncpy(new_password, new_str, sizeof(new_password) - 1);
-    free(new_str);
-  }
 
   if (strlen(old_password) == 0 || strlen(new_password) == 0) {
     HTTP_ERROR(c, 400, "旧密码和新密码不能为空");
@@ -1950,6 +1794,53 @@ void handle_auth_status(struct mg_connection *c, struct mg_http_message *hm) {
   HTTP_OK_FREE(c, json_finish(j));
 }
 
+/* GET /api/auth/scrape-token - 获取 /metrics 抓取令牌 */
+void handle_auth_scrape_token_get(struct mg_connection *c,
+                                  struct mg_http_message *hm) {
+  HTTP_CHECK_GET(c, hm);
+
+  char token[AUTH_TOKEN_SIZE] = {0};
+  int enabled = auth_scrape_token_get(token, sizeof(token)) == 0;
+
+  JsonBuilder *j = json_new();
+  json_obj_open(j);
+  json_add_bool(j, "enabled", enabled);
+  json_add_str(j, "token", token);
+  json_obj_close(j);
+  HTTP_OK_FREE(c, json_finish(j));
+}
+
+/*
+ * POST /api/auth/scrape-token - 生成新的抓取令牌 (旧令牌失效)
+ * {"enabled":false} 停用
+ */
+void handle_auth_scrape_token_set(struct mg_connection *c,
+                                  struct mg_http_message *hm) {
+  HTTP_CHECK_POST(c, hm);
+
+  bool enabled = true;
+  mg_json_get_bool(hm->body, "$.enabled", &enabled);
+
+  char token[AUTH_TOKEN_SIZE] = {0};
+  if (!enabled) {
+    if (auth_scrape_token_clear() != 0) {
+      HTTP_ERROR(c, 500, "停用抓取令牌失败");
+      return;
+    }
+  } else if (auth_scrape_token_rotate(token, sizeof(token)) != 0) {
+    HTTP_ERROR(c, 500, "生成抓取令牌失败");
+    return;
+  }
+
+  JsonBuilder *j = json_new();
+  json_obj_open(j);
+  json_add_str(j, "status", "success");
+  json_add_bool(j, "enabled", enabled);
+  json_add_str(j, "token", token);
+  json_obj_close(j);
+  HTTP_OK_FREE(c, json_finish(j));
+}
+
 /* ==================== APN 配置管理 ==================== */
 
 /* GET /api/apn/config - 获取APN配置 */
@@ -2032,10 +1923,13 @@ void handle_apn_templates_list(struct mg_connection *c,
                                struct mg_http_message *hm) {
   HTTP_CHECK_GET(c, hm);
 
-  ApnTemplate templates[MAX_APN_TEMPLATES];
-  int count = apn_template_list(templates, MAX_APN_TEMPLATES);
+  ApnTemplate *templates =
+      arena_alloc(sizeof(ApnTemplate) * MAX_APN_TEMPLATES);
+  int count =
+      templates ? apn_template_list(templates, MAX_APN_TEMPLATES) : -1;
 
   if (count < 0) {
+    arena_free(templates);
     HTTP_ERROR(c, 500, "获取模板列表失败");
     return;
   }
@@ -2061,6 +1955,7 @@ void handle_apn_templates_list(struct mg_connection *c,
 
   json_arr_close(j);
   json_obj_close(j);
+  arena_free(templates);
   HTTP_OK_FREE(c, json_finish(j));
 }
 
@@ -2072,38 +1967,22 @@ void handle_apn_templates_create(struct mg_connection *c,
   ApnTemplate tpl = {0};
 
   /* 解析JSON参数 */
-  char *name = mg_json_get_str(hm->body, "$.name");
-  char *apn = mg_json_get_str(hm->body, "$.apn");
-  char *protocol = mg_json_get_str(hm->body, "$.protocol");
-  char *username = mg_json_get_str(hm->body, "$.username");
-  char *password = mg_json_get_str(hm->body, "$.password");
-  char *auth_method = mg_json_get_str(hm->body, "$.auth_method");
+  http_json_get_str(hm->body, "$.name", tpl.name, sizeof(tpl.name));
+  http_json_get_str(hm->body, "$.apn", tpl.apn, sizeof(tpl.apn));
+  char *protocol = http_json_dup(hm->body, "$.protocol");
+  http_json_get_str(hm->body, "$.username", tpl.username, sizeof(tpl.username));
+  http_json_get_str(hm->body, "$.password", tpl.password, sizeof(tpl.password));
+  char *auth_method = http_json_dup(hm->body, "$.auth_method");
 
-  if (name) {
-    strncpy(tpl.name, name, sizeof(tpl.name) - 1);
-    free(name);
-  }
-  if (apn) {
-    strncpy(tpl.apn, apn, sizeof(tpl.apn) - 1);
-    free(apn);
-  }
   if (protocol) {
     strncpy(tpl.protocol, protocol, sizeof(tpl.protocol) - 1);
-    free(protocol);
+    arena_free(protocol);
   } else {
     strcpy(tpl.protocol, "dual");
   }
-  if (username) {
-    strncpy(tpl.username, username, sizeof(tpl.username) - 1);
-    free(username);
-  }
-  if (password) {
-    strncpy(tpl.password, password, sizeof(tpl.password) - 1);
-    free(password);
-  }
   if (auth_method) {
     strncpy(tpl.auth_method, auth_method, sizeof(tpl.auth_method) - 1);
-    free(auth_method);
+    arena_free(auth_method);
   } else {
     strcpy(tpl.auth_method, "chap");
   }
@@ -2138,38 +2017,22 @@ void handle_apn_templates_update(struct mg_connection *c,
   tpl.id = atoi(id_str);
 
   /* 解析JSON参数 */
-  char *name = mg_json_get_str(hm->body, "$.name");
-  char *apn = mg_json_get_str(hm->body, "$.apn");
-  char *protocol = mg_json_get_str(hm->body, "$.protocol");
-  char *username = mg_json_get_str(hm->body, "$.username");
-  char *password = mg_json_get_str(hm->body, "$.password");
-  char *auth_method = mg_json_get_str(hm->body, "$.auth_method");
+  http_json_get_str(hm->body, "$.name", tpl.name, sizeof(tpl.name));
+  http_json_get_str(hm->body, "$.apn", tpl.apn, sizeof(tpl.apn));
+  char *protocol = http_json_dup(hm->body, "$.protocol");
+  http_json_get_str(hm->body, "$.username", tpl.username, sizeof(tpl.username));
+  http_json_get_str(hm->body, "$.password", tpl.password, sizeof(tpl.password));
+  char *auth_method = http_json_dup(hm->body, "$.auth_method");
 
-  if (name) {
-    strncpy(tpl.name, name, sizeof(tpl.name) - 1);
-    free(name);
-  }
-  if (apn) {
-    strncpy(tpl.apn, apn, sizeof(tpl.apn) - 1);
-    free(apn);
-  }
   if (protocol) {
     strncpy(tpl.protocol, protocol, sizeof(tpl.protocol) - 1);
-    free(protocol);
+    arena_free(protocol);
   } else {
     strcpy(tpl.protocol, "dual");
   }
-  if (username) {
-    strncpy(tpl.username, username, sizeof(tpl.username) - 1);
-    free(username);
-  }
-  if (password) {
-    strncpy(tpl.password, password, sizeof(tpl.password) - 1);
-    free(password);
-  }
   if (auth_method) {
     strncpy(tpl.auth_method, auth_method, sizeof(tpl.auth_method) - 1);
-    free(auth_method);
+    arena_free(auth_method);
   } else {
     strcpy(tpl.auth_method, "chap");
   }
@@ -2233,6 +2096,7 @@ void handle_apn_clear(struct mg_connection *c, struct mg_http_message *hm) {
   }
 }
 
+#if FEATURE_RATHOLE
 /* ==================== Rathole 内网穿透 API ==================== */
 #include "system/rathole.h"
 
@@ -2266,13 +2130,13 @@ void handle_rathole_config_set(struct mg_connection *c,
                                struct mg_http_message *hm) {
   HTTP_CHECK_POST(c, hm);
 
-  char *server_addr = mg_json_get_str(hm->body, "$.server_addr");
+  char *server_addr = http_json_dup(hm->body, "$.server_addr");
   long auto_start = mg_json_get_long(hm->body, "$.auto_start", 0);
   long enabled = mg_json_get_long(hm->body, "$.enabled", 0);
 
   if (!server_addr || strlen(server_addr) == 0) {
     if (server_addr)
-      free(server_addr);
+      arena_free(server_addr);
     HTTP_ERROR(c, 400, "服务器地址不能为空");
     return;
   }
@@ -2283,7 +2147,7 @@ void handle_rathole_config_set(struct mg_connection *c,
     HTTP_ERROR(c, 500, "配置保存失败");
   }
 
-  free(server_addr);
+  arena_free(server_addr);
 }
 
 /* POST /api/rathole/autostart - 单独设置开机自启动 */
@@ -2356,18 +2220,18 @@ void handle_rathole_service_add(struct mg_connection *c,
                                 struct mg_http_message *hm) {
   HTTP_CHECK_POST(c, hm);
 
-  char *name = mg_json_get_str(hm->body, "$.name");
-  char *token = mg_json_get_str(hm->body, "$.token");
-  char *local_addr = mg_json_get_str(hm->body, "$.local_addr");
+  char *name = http_json_dup(hm->body, "$.name");
+  char *token = http_json_dup(hm->body, "$.token");
+  char *local_addr = http_json_dup(hm->body, "$.local_addr");
 
   if (!name || strlen(name) == 0 || !token || strlen(token) == 0 ||
       !local_addr || strlen(local_addr) == 0) {
     if (name)
-      free(name);
+      arena_free(name);
     if (token)
-      free(token);
+      arena_free(token);
     if (local_addr)
-      free(local_addr);
+      arena_free(local_addr);
     HTTP_ERROR(c, 400, "服务名称、Token和本地地址不能为空");
     return;
   }
@@ -2382,9 +2246,9 @@ void handle_rathole_service_add(struct mg_connection *c,
     HTTP_ERROR(c, 500, "服务添加失败，名称可能已存在");
   }
 
-  free(name);
-  free(token);
-  free(local_addr);
+  arena_free(name);
+  arena_free(token);
+  arena_free(local_addr);
 }
 
 /* PUT /api/rathole/services/:id - 更新服务 */
@@ -2407,19 +2271,19 @@ void handle_rathole_service_update(struct mg_connection *c,
 
   int id = atoi(id_str);
 
-  char *name = mg_json_get_str(hm->body, "$.name");
-  char *token = mg_json_get_str(hm->body, "$.token");
-  char *local_addr = mg_json_get_str(hm->body, "$.local_addr");
+  char *name = http_json_dup(hm->body, "$.name");
+  char *token = http_json_dup(hm->body, "$.token");
+  char *local_addr = http_json_dup(hm->body, "$.local_addr");
   long enabled = mg_json_get_long(hm->body, "$.enabled", 1);
 
   if (!name || strlen(name) == 0 || !token || strlen(token) == 0 ||
       !local_addr || strlen(local_addr) == 0) {
     if (name)
-      free(name);
+      arena_free(name);
     if (token)
-      free(token);
+      arena_free(token);
     if (local_addr)
-      free(local_addr);
+      arena_free(local_addr);
     HTTP_ERROR(c, 400, "服务名称、Token和本地地址不能为空");
     return;
   }
@@ -2434,9 +2298,9 @@ void handle_rathole_service_update(struct mg_connection *c,
     HTTP_ERROR(c, 500, "服务更新失败");
   }
 
-  free(name);
-  free(token);
-  free(local_addr);
+  arena_free(name);
+  arena_free(token);
+  arena_free(local_addr);
 }
 
 /* DELETE /api/rathole/services/:id - 删除服务 */
@@ -2642,6 +2506,9 @@ void handle_rathole_server_config(struct mg_connection *c,
   free(escaped);
 }
 
+#endif /* FEATURE_RATHOLE */
+
+#if FEATURE_IPV6_PROXY
 /* ==================== IPv6 Proxy 端口转发 API ==================== */
 #include "system/ipv6_proxy.h"
 
@@ -2686,22 +2553,19 @@ void handle_ipv6_proxy_config_set(struct mg_connection *c,
   config.send_enabled = (int)mg_json_get_long(hm->body, "$.send_enabled", 0);
   config.send_interval = (int)mg_json_get_long(hm->body, "$.send_interval", 60);
 
-  char *url = mg_json_get_str(hm->body, "$.webhook_url");
-  char *body = mg_json_get_str(hm->body, "$.webhook_body");
-  char *headers = mg_json_get_str(hm->body, "$.webhook_headers");
+  http_json_get_str(hm->body, "$.webhook_url", config.webhook_url,
+                    sizeof(config.webhook_url));
+  char *body = http_json_dup(hm->body, "$.webhook_body");
+  char *headers = http_json_dup(hm->body, "$.webhook_headers");
 
-  if (url) {
-    strncpy(config.webhook_url, url, sizeof(config.webhook_url) - 1);
-    free(url);
-  }
   if (body) {
     strncpy(config.webhook_body, body, sizeof(config.webhook_body) - 1);
-    free(body);
+    arena_free(body);
   }
   if (headers) {
     strncpy(config.webhook_headers, headers,
             sizeof(config.webhook_headers) - 1);
-    free(headers);
+    arena_free(headers);
   }
 
   if (ipv6_proxy_set_config(&config) == 0) {
@@ -2965,6 +2829,20 @@ void handle_ipv6_proxy_send_logs(struct mg_connection *c,
 
   free(logs_json);
 }
+#endif /* FEATURE_IPV6_PROXY */
+
+/* Webhook日志逐条写入JSON数组 (直接转义到输出缓冲区) */
+static void sms_webhook_log_to_json(const SmsWebhookLog *log, void *ctx) {
+  JsonBuilder *j = (JsonBuilder *)ctx;
+  json_arr_obj_open(j);
+  json_add_int(j, "id", log->id);
+  json_add_str(j, "sender", log->sender);
+  json_add_str(j, "request", log->request);
+  json_add_str(j, "response", log->response);
+  json_add_int(j, "result", log->result);
+  json_add_long(j, "created_at", (long long)log->created_at);
+  json_obj_close(j);
+}
 
 /* 处理短信Webhook发送日志请求 */
 void handle_sms_webhook_logs(struct mg_connection *c,
@@ -2980,27 +2858,19 @@ void handle_sms_webhook_logs(struct mg_connection *c,
       max_lines = 100;
   }
 
-  char *logs_json = malloc(512 * 1024);
-  if (!logs_json) {
-    HTTP_ERROR(c, 500, "内存分配失败");
-    return;
-  }
-
-  if (sms_get_webhook_logs(logs_json, 512 * 1024, max_lines) != 0) {
-    free(logs_json);
-    HTTP_ERROR(c, 500, "获取日志失败");
-    return;
-  }
-
   JsonBuilder *j = json_new();
   json_obj_open(j);
   json_add_str(j, "status", "ok");
   json_add_str(j, "message", "");
-  json_add_raw(j, "data", logs_json);
+  json_arr_open(j, "data");
+  if (sms_foreach_webhook_log(max_lines, sms_webhook_log_to_json, j) != 0) {
+    json_free(j);
+    HTTP_ERROR(c, 500, "获取日志失败");
+    return;
+  }
+  json_arr_close(j);
   json_obj_close(j);
   HTTP_OK_FREE(c, json_finish(j));
-
-  free(logs_json);
 }
 
 /* ==================== 密保 API ==================== */
@@ -3035,27 +2905,13 @@ void handle_security_setup(struct mg_connection *c,
 
   SecuritySetupRequest req = {0};
 
-  char *q1 = mg_json_get_str(hm->body, "$.question1");
-  char *a1 = mg_json_get_str(hm->body, "$.answer1");
-  char *q2 = mg_json_get_str(hm->body, "$.question2");
-  char *a2 = mg_json_get_str(hm->body, "$.answer2");
+  http_json_get_str(hm->body, "$.question1", req.question1,
+                    sizeof(req.question1));
+  http_json_get_str(hm->body, "$.answer1", req.answer1, sizeof(req.answer1));
+  http_json_get_str(hm->body, "$.question2", req.question2,
+                    sizeof(req.question2));
+  http_json_get_str(hm->body, "$.answer2", req.answer2, sizeof(req.answer2));
 
-  if (q1) {
-    strncpy(req.question1, q1, sizeof(req.question1) - 1);
-    free(q1);
-  }
-  if (a1) {
-    strncpy(req.answer1, a1, sizeof(req.answer1) - 1);
-    free(a1);
-  }
-  if (q2) {
-    strncpy(req.question2, q2, sizeof(req.question2) - 1);
-    free(q2);
-  }
-  if (a2) {
-    strncpy(req.answer2, a2, sizeof(req.answer2) - 1);
-    free(a2);
-  }
 
   /* 验证必填字段 */
   if (strlen(req.question1) == 0 || strlen(req.answer1) == 0 ||
@@ -3103,22 +2959,10 @@ void handle_security_verify(struct mg_connection *c,
 
   SecurityVerifyRequest req = {0};
 
-  char *a1 = mg_json_get_str(hm->body, "$.answer1");
-  char *a2 = mg_json_get_str(hm->body, "$.answer2");
-  char *confirm = mg_json_get_str(hm->body, "$.confirm");
+  http_json_get_str(hm->body, "$.answer1", req.answer1, sizeof(req.answer1));
+  http_json_get_str(hm->body, "$.answer2", req.answer2, sizeof(req.answer2));
+  http_json_get_str(hm->body, "$.confirm", req.confirm, sizeof(req.confirm));
 
-  if (a1) {
-    strncpy(req.answer1, a1, sizeof(req.answer1) - 1);
-    free(a1);
-  }
-  if (a2) {
-    strncpy(req.answer2, a2, sizeof(req.answer2) - 1);
-    free(a2);
-  }
-  if (confirm) {
-    strncpy(req.confirm, confirm, sizeof(req.confirm) - 1);
-    free(confirm);
-  }
 
   int ret = security_verify(&req);
   if (ret == 0) {
@@ -3138,22 +2982,10 @@ void handle_security_reset_password(struct mg_connection *c,
 
   SecurityVerifyRequest req = {0};
 
-  char *a1 = mg_json_get_str(hm->body, "$.answer1");
-  char *a2 = mg_json_get_str(hm->body, "$.answer2");
-  char *confirm = mg_json_get_str(hm->body, "$.confirm");
+  http_json_get_str(hm->body, "$.answer1", req.answer1, sizeof(req.answer1));
+  http_json_get_str(hm->body, "$.answer2", req.answer2, sizeof(req.answer2));
+  http_json_get_str(hm->body, "$.confirm", req.confirm, sizeof(req.confirm));
 
-  if (a1) {
-    strncpy(req.answer1, a1, sizeof(req.answer1) - 1);
-    free(a1);
-  }
-  if (a2) {
-    strncpy(req.answer2, a2, sizeof(req.answer2) - 1);
-    free(a2);
-  }
-  if (confirm) {
-    strncpy(req.confirm, confirm, sizeof(req.confirm) - 1);
-    free(confirm);
-  }
 
   int ret = security_reset_password(&req);
   if (ret == 0) {
@@ -3172,22 +3004,10 @@ void handle_security_factory_reset(struct mg_connection *c,
 
   SecurityVerifyRequest req = {0};
 
-  char *a1 = mg_json_get_str(hm->body, "$.answer1");
-  char *a2 = mg_json_get_str(hm->body, "$.answer2");
-  char *confirm = mg_json_get_str(hm->body, "$.confirm");
+  http_json_get_str(hm->body, "$.answer1", req.answer1, sizeof(req.answer1));
+  http_json_get_str(hm->body, "$.answer2", req.answer2, sizeof(req.answer2));
+  http_json_get_str(hm->body, "$.confirm", req.confirm, sizeof(req.confirm));
 
-  if (a1) {
-    strncpy(req.answer1, a1, sizeof(req.answer1) - 1);
-    free(a1);
-  }
-  if (a2) {
-    strncpy(req.answer2, a2, sizeof(req.answer2) - 1);
-    free(a2);
-  }
-  if (confirm) {
-    strncpy(req.confirm, confirm, sizeof(req.confirm) - 1);
-    free(confirm);
-  }
 
   int ret = security_factory_reset(&req);
   if (ret == 0) {
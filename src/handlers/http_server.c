@@ -6,27 +6,52 @@
 #include "http_server.h"
 #include "advanced.h"
 #include "apn.h"
+#include "arena.h"
 #include "auth.h"
+#include "bandscan.h"
+#include "cellsel.h"
+#include "dualsim.h"
 #include "charge.h"
+#include "conntrack.h"
+#include "database.h"
 #include "dbus_core.h"
+#include "exec_utils.h"
+#include "feature.h"
+#include "handoff.h"
 #include "handlers.h"
 #include "http_utils.h"
+#include "json_builder.h"
+#include "log.h"
+#include "metrics.h"
 #include "mongoose.h"
 #include "netif.h"
+#include "ofono.h"
+#include "push.h"
+#include "qos.h"
+#include "radiocfg.h"
 #include "reboot.h"
 #include "sms.h"
+#include "speedtest.h"
+#include "startup.h"
 #include "system/ipv6_proxy.h"
 #include "system/phone_case.h"
 #include "system/rathole.h"
 #include "system/security.h"
+#include "telemetry.h"
+#include "tls.h"
+#include "trace.h"
 #include "traffic.h"
 #include "usb_mode.h"
+#include "wanprobe.h"
+#include <fcntl.h>
 #include <glib.h>
 #include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 /* 嵌入式文件系统声明 (packed_fs.c) */
 extern int serve_packed_file(struct mg_connection *c,
@@ -36,12 +61,34 @@ extern int serve_packed_file(struct mg_connection *c,
 static struct mg_mgr g_mgr;
 static volatile int g_running = 0;
 
+/* 监听套接字交接 (见 handoff.h) */
+static struct mg_connection *g_listener = NULL; /* 当前监听连接 */
+static int g_inherited_fd = -1; /* 交接启动: 就绪后接管的监听 fd */
+static volatile sig_atomic_t g_handoff_requested = 0;
+static int g_handoff_fds[2] = {-1, -1}; /* 排空期间保持打开的 HTTP/HTTPS 监听 fd */
+static int g_handoff_exec = 0; /* 排空完成，事件循环退出后重新执行 */
+static uint64_t g_drain_deadline_us = 0; /* 排空截止时间 */
+
+#if FEATURE_TLS
+/* HTTPS 监听 (见 tls.h): 证书就绪后在事件循环中创建，失败每秒重试 */
+static char g_tls_port[16] = "";
+static struct mg_connection *g_tls_listener = NULL;
+static int g_tls_inherited_fd = -1; /* 交接启动: 就绪后接管的 HTTPS 监听 fd */
+static uint64_t g_tls_retry_us = 0;
+#endif
+
 /* 信号处理 */
 static void signal_handler(int sig) {
   (void)sig;
   g_running = 0;
 }
 
+/* SIGUSR2: 排空连接后原地重新执行并交接监听套接字 */
+static void handoff_signal_handler(int sig) {
+  (void)sig;
+  g_handoff_requested = 1;
+}
+
 /**
  * 检查API是否在白名单中（无需认证）
  * @param uri 请求URI
@@ -118,392 +165,656 @@ static int verify_request_token(struct mg_http_message *hm) {
   return auth_verify_token(token);
 }
 
-/* HTTP 事件处理函数 */
-static void http_handler(struct mg_connection *c, int ev, void *ev_data) {
-  if (ev == MG_EV_HTTP_MSG) {
-    struct mg_http_message *hm = (struct mg_http_message *)ev_data;
-    char uri[256] = {0};
-    size_t uri_len =
-        hm->uri.len < sizeof(uri) - 1 ? hm->uri.len : sizeof(uri) - 1;
-    memcpy(uri, hm->uri.buf, uri_len);
-
-    /* 静态文件处理 */
-    if (hm->uri.len < 5 || memcmp(hm->uri.buf, "/api/", 5) != 0) {
-      if (serve_packed_file(c, hm)) {
-        return; /* 静态文件已处理 */
-      }
-    }
+#if FEATURE_PLUGIN
+/* 插件存储 API: 按方法分发 GET/POST/DELETE */
+static void route_plugin_storage(struct mg_connection *c,
+                                 struct mg_http_message *hm) {
+  if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
+    handle_plugin_storage_get(c, hm);
+  } else if (hm->method.len == 4 && memcmp(hm->method.buf, "POST", 4) == 0) {
+    handle_plugin_storage_set(c, hm);
+  } else if (hm->method.len == 6 && memcmp(hm->method.buf, "DELETE", 6) == 0) {
+    handle_plugin_storage_delete(c, hm);
+  } else {
+    HTTP_ERROR(c, 405, "Method not allowed");
+  }
+}
+#endif
 
-    /* 认证 API - 优先处理，无需Token验证 */
-    if (mg_match(hm->uri, mg_str("/api/auth/login"), NULL)) {
-      handle_auth_login(c, hm);
-      return;
-    } else if (mg_match(hm->uri, mg_str("/api/auth/status"), NULL)) {
-      handle_auth_status(c, hm);
-      return;
-    } else if (mg_match(hm->uri, mg_str("/api/auth/logout"), NULL)) {
-      handle_auth_logout(c, hm);
-      return;
-    } else if (mg_match(hm->uri, mg_str("/api/auth/password"), NULL)) {
-      handle_auth_password(c, hm);
-      return;
-    }
+/* 路由处理函数类型 */
+typedef void (*http_route_fn)(struct mg_connection *c,
+                              struct mg_http_message *hm);
 
-    /* 认证中间件 - 检查Token */
-    if (!is_auth_whitelist(uri, hm->method.buf, hm->method.len)) {
-      if (verify_request_token(hm) != 0) {
-        HTTP_JSON(c, 401,
-                  "{\"status\":\"error\",\"message\":\"未授权，请先登录\"}");
-        return;
-      }
-    }
+/* 路由表项 */
+typedef struct {
+  const char *pattern;   /* URI 匹配模式 (mg_match 语法) */
+  http_route_fn handler; /* 默认处理函数 */
+  http_route_fn on_get;  /* GET 请求处理函数 (NULL 表示使用默认) */
+  http_route_fn on_put;  /* PUT 请求处理函数 (NULL 表示使用默认) */
+  int is_public;         /* 1=跳过认证中间件 */
+  int early;             /* 1=模块初始化完成前即可访问 */
+} HttpRoute;
+
+#define ROUTE(p, h) {(p), (h), NULL, NULL, 0, 0}
+#define ROUTE_GET(p, get, other) {(p), (other), (get), NULL, 0, 0}
+#define ROUTE_PUT(p, put, other) {(p), (other), NULL, (put), 0, 0}
+#define ROUTE_PUBLIC(p, h) {(p), (h), NULL, NULL, 1, 0}
+#define ROUTE_EARLY(p, h) {(p), (h), NULL, NULL, 1, 1}
+
+static void handle_batch(struct mg_connection *c, struct mg_http_message *hm);
+
+/* 路由表 - 按顺序匹配，更具体的模式必须排在通配模式之前 */
+static const HttpRoute g_routes[] = {
+    /* 认证 API - 无需Token验证 */
+    ROUTE_PUBLIC("/api/auth/login", handle_auth_login),
+    ROUTE_PUBLIC("/api/auth/status", handle_auth_status),
+    ROUTE_PUBLIC("/api/auth/logout", handle_auth_logout),
+    ROUTE_PUBLIC("/api/auth/password", handle_auth_password),
+    ROUTE_GET("/api/auth/scrape-token", handle_auth_scrape_token_get,
+              handle_auth_scrape_token_set),
+
+    /* 批量 GET (页面加载时一次取回多个资源) */
+    ROUTE("/api/batch", handle_batch),
+
+    /* 基础 API */
+    ROUTE("/api/info", handle_info),
+    ROUTE("/api/at", handle_execute_at),
+    ROUTE("/api/set_network", handle_set_network),
+    ROUTE_GET("/api/switch", handle_dualsim_status, handle_switch),
+    ROUTE("/api/airplane_mode", handle_airplane_mode),
+    ROUTE("/api/device_control", handle_device_control),
+    ROUTE("/api/clear_cache", handle_clear_cache),
+    ROUTE("/api/current_band", handle_get_current_band),
+    ROUTE("/api/dashboard", handle_telemetry_dashboard),
+    ROUTE_PUBLIC("/api/ws", handle_push_ws), /* 票据或 Authorization 头自行校验 */
+    ROUTE("/api/ws/ticket", handle_push_ticket),
+    ROUTE("/api/push", handle_push_stats),
 
-    /* API 路由 */
-    if (mg_match(hm->uri, mg_str("/api/info"), NULL)) {
-      handle_info(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/at"), NULL)) {
-      handle_execute_at(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/set_network"), NULL)) {
-      handle_set_network(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/switch"), NULL)) {
-      handle_switch(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/airplane_mode"), NULL)) {
-      handle_airplane_mode(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/device_control"), NULL)) {
-      handle_device_control(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/clear_cache"), NULL)) {
-      handle_clear_cache(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/current_band"), NULL)) {
-      handle_get_current_band(c, hm);
-    }
     /* 高级网络 API */
-    else if (mg_match(hm->uri, mg_str("/api/bands"), NULL)) {
-      handle_get_bands(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/lock_bands"), NULL)) {
-      handle_lock_bands(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/unlock_bands"), NULL)) {
-      handle_unlock_bands(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/cells"), NULL)) {
-      handle_get_cells(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/lock_cell"), NULL)) {
-      handle_lock_cell(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/unlock_cell"), NULL)) {
-      handle_unlock_cell(c, hm);
-    }
+    ROUTE("/api/bands", handle_get_bands),
+    ROUTE("/api/lock_bands", handle_lock_bands),
+    ROUTE("/api/unlock_bands", handle_unlock_bands),
+    ROUTE("/api/bandscan/start", handle_bandscan_start),
+    ROUTE("/api/bandscan/cancel", handle_bandscan_cancel),
+    ROUTE("/api/bandscan", handle_bandscan_status),
+    ROUTE("/api/cells", handle_get_cells),
+    ROUTE("/api/lock_cell", handle_lock_cell),
+    ROUTE("/api/unlock_cell", handle_unlock_cell),
+    ROUTE_GET("/api/cellsel", handle_cellsel_status, handle_cellsel_config),
+    ROUTE_GET("/api/wanprobe", handle_wanprobe_status, handle_wanprobe_config),
+    ROUTE_GET("/api/speedtest", handle_speedtest_status, handle_speedtest_start),
+    ROUTE_GET("/api/qos", handle_qos_status, handle_qos_config),
+    ROUTE_GET("/api/conntrack", handle_conntrack_summary, handle_conntrack_config),
+    ROUTE("/api/conntrack/flows", handle_conntrack_flows),
+    ROUTE_GET("/api/radio/apply", handle_radio_apply_status, handle_radio_apply),
+
     /* 流量统计 API */
-    else if (mg_match(hm->uri, mg_str("/api/get/Total"), NULL)) {
-      handle_get_traffic_total(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/get/set"), NULL)) {
-      handle_get_traffic_config(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/set/total"), NULL)) {
-      handle_set_traffic_limit(c, hm);
-    }
+    ROUTE("/api/get/Total", handle_get_traffic_total),
+    ROUTE("/api/get/set", handle_get_traffic_config),
+    ROUTE("/api/set/total", handle_set_traffic_limit),
+
     /* 系统时间 API */
-    else if (mg_match(hm->uri, mg_str("/api/get/time"), NULL)) {
-      handle_get_system_time(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/set/time"), NULL)) {
-      handle_set_system_time(c, hm);
-    }
+    ROUTE("/api/get/time", handle_get_system_time),
+    ROUTE("/api/set/time", handle_set_system_time),
+
     /* 定时重启 API */
-    else if (mg_match(hm->uri, mg_str("/api/get/first-reboot"), NULL)) {
-      handle_get_first_reboot(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/set/reboot"), NULL)) {
-      handle_set_reboot(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/claen/cron"), NULL)) {
-      handle_clear_cron(c, hm);
-    }
+    ROUTE("/api/get/first-reboot", handle_get_first_reboot),
+    ROUTE("/api/set/reboot", handle_set_reboot),
+    ROUTE("/api/claen/cron", handle_clear_cron),
+
     /* 充电控制 API */
-    else if (mg_match(hm->uri, mg_str("/api/charge/config"), NULL)) {
-      handle_charge_config(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/charge/on"), NULL)) {
-      handle_charge_on(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/charge/off"), NULL)) {
-      handle_charge_off(c, hm);
-    }
+    ROUTE("/api/charge/config", handle_charge_config),
+    ROUTE("/api/charge/on", handle_charge_on),
+    ROUTE("/api/charge/off", handle_charge_off),
+
     /* 短信 API */
-    else if (mg_match(hm->uri, mg_str("/api/sms"), NULL)) {
-      handle_sms_list(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/sms/send"), NULL)) {
-      handle_sms_send(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/sms/sent"), NULL)) {
-      handle_sms_sent_list(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/sms/sent/*"), NULL)) {
-      handle_sms_sent_delete(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/sms/config"), NULL)) {
-      if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-        handle_sms_config_get(c, hm);
-      } else {
-        handle_sms_config_save(c, hm);
-      }
-    } else if (mg_match(hm->uri, mg_str("/api/sms/webhook"), NULL)) {
-      if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-        handle_sms_webhook_get(c, hm);
-      } else {
-        handle_sms_webhook_save(c, hm);
-      }
-    } else if (mg_match(hm->uri, mg_str("/api/sms/webhook/test"), NULL)) {
-      handle_sms_webhook_test(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/sms/webhook/logs"), NULL)) {
-      handle_sms_webhook_logs(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/sms/fix"), NULL)) {
-      if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-        handle_sms_fix_get(c, hm);
-      } else {
-        handle_sms_fix_set(c, hm);
-      }
-    } else if (mg_match(hm->uri, mg_str("/api/sms/*"), NULL)) {
-      handle_sms_delete(c, hm);
-    }
+    ROUTE("/api/sms", handle_sms_list),
+    ROUTE("/api/sms/send", handle_sms_send),
+    ROUTE("/api/sms/sent", handle_sms_sent_list),
+    ROUTE("/api/sms/sent/*", handle_sms_sent_delete),
+    ROUTE_GET("/api/sms/config", handle_sms_config_get, handle_sms_config_save),
+    ROUTE_GET("/api/sms/webhook", handle_sms_webhook_get,
+              handle_sms_webhook_save),
+    ROUTE("/api/sms/webhook/test", handle_sms_webhook_test),
+    ROUTE("/api/sms/webhook/logs", handle_sms_webhook_logs),
+    ROUTE_GET("/api/sms/fix", handle_sms_fix_get, handle_sms_fix_set),
+    ROUTE("/api/sms/*", handle_sms_delete),
+
+#if FEATURE_UPDATE
     /* OTA更新 API */
-    else if (mg_match(hm->uri, mg_str("/api/update/version"), NULL)) {
-      handle_update_version(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/update/upload"), NULL)) {
-      handle_update_upload(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/update/download"), NULL)) {
-      handle_update_download(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/update/extract"), NULL)) {
-      handle_update_extract(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/update/install"), NULL)) {
-      handle_update_install(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/update/check"), NULL)) {
-      handle_update_check(c, hm);
-    }
+    ROUTE("/api/update/version", handle_update_version),
+    ROUTE("/api/update/upload", handle_update_upload),
+    ROUTE("/api/update/download", handle_update_download),
+    ROUTE("/api/update/extract", handle_update_extract),
+    ROUTE("/api/update/install", handle_update_install),
+    ROUTE("/api/update/check", handle_update_check),
+#endif
+
+#if FEATURE_USB_MODE
     /* USB模式切换 API */
-    else if (mg_match(hm->uri, mg_str("/api/usb/mode"), NULL)) {
-      if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-        handle_usb_mode_get(c, hm);
-      } else {
-        handle_usb_mode_set(c, hm);
-      }
-    } else if (mg_match(hm->uri, mg_str("/api/usb-advance"), NULL)) {
-      handle_usb_advance(c, hm);
-    }
+    ROUTE_GET("/api/usb/mode", handle_usb_mode_get, handle_usb_mode_set),
+    ROUTE_GET("/api/usb-advance", handle_usb_advance_status, handle_usb_advance),
+#endif
+
     /* 数据连接和漫游 API */
-    else if (mg_match(hm->uri, mg_str("/api/data"), NULL)) {
-      handle_data_status(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/roaming"), NULL)) {
-      handle_roaming_status(c, hm);
-    }
+    ROUTE("/api/data", handle_data_status),
+    ROUTE("/api/roaming", handle_roaming_status),
+
     /* 网络接口监控 API */
-    else if (mg_match(hm->uri, mg_str("/api/netif/list"), NULL)) {
-      handle_netif_list(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/netif/stats"), NULL)) {
-      handle_netif_stats(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/netif/monitor"), NULL)) {
-      handle_netif_monitor(c, hm);
-    }
-    // /* APN 管理 API */
-    // else if (mg_match(hm->uri, mg_str("/api/apn"), NULL)) {
-    //     if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-    //         handle_apn_list(c, hm);
-    //     } else {
-    //         handle_apn_set(c, hm);
-    //     }
-    // }
+    ROUTE("/api/netif/list", handle_netif_list),
+    ROUTE("/api/netif/stats", handle_netif_stats),
+    ROUTE("/api/netif/monitor", handle_netif_monitor),
+
     /* APN 配置管理 API */
-    else if (mg_match(hm->uri, mg_str("/api/apn/config"), NULL)) {
-      if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-        handle_apn_config_get(c, hm);
-      } else {
-        handle_apn_config_set(c, hm);
-      }
-    } else if (mg_match(hm->uri, mg_str("/api/apn/templates"), NULL)) {
-      if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-        handle_apn_templates_list(c, hm);
-      } else {
-        handle_apn_templates_create(c, hm);
-      }
-    } else if (mg_match(hm->uri, mg_str("/api/apn/templates/*"), NULL)) {
-      if (hm->method.len == 3 && memcmp(hm->method.buf, "PUT", 3) == 0) {
-        handle_apn_templates_update(c, hm);
-      } else {
-        handle_apn_templates_delete(c, hm);
-      }
-    } else if (mg_match(hm->uri, mg_str("/api/apn/apply"), NULL)) {
-      handle_apn_apply(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/apn/clear"), NULL)) {
-      handle_apn_clear(c, hm);
-    }
+    ROUTE_GET("/api/apn/config", handle_apn_config_get, handle_apn_config_set),
+    ROUTE_GET("/api/apn/templates", handle_apn_templates_list,
+              handle_apn_templates_create),
+    ROUTE_PUT("/api/apn/templates/*", handle_apn_templates_update,
+              handle_apn_templates_delete),
+    ROUTE("/api/apn/apply", handle_apn_apply),
+    ROUTE("/api/apn/clear", handle_apn_clear),
+
+#if FEATURE_PLUGIN
     /* 插件管理 API */
-    else if (mg_match(hm->uri, mg_str("/api/shell"), NULL)) {
-      handle_shell_execute(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/plugins/all"), NULL)) {
-      handle_plugin_delete_all(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/plugins"), NULL)) {
-      if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-        handle_plugin_list(c, hm);
-      } else {
-        handle_plugin_upload(c, hm);
-      }
-    } else if (mg_match(hm->uri, mg_str("/api/plugins/*"), NULL)) {
-      handle_plugin_delete(c, hm);
-    }
+    ROUTE("/api/shell", handle_shell_execute),
+    ROUTE("/api/plugins/all", handle_plugin_delete_all),
+    ROUTE_GET("/api/plugins", handle_plugin_list, handle_plugin_upload),
+    ROUTE("/api/plugins/*", handle_plugin_delete),
+
     /* 脚本管理 API */
-    else if (mg_match(hm->uri, mg_str("/api/scripts"), NULL)) {
-      if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-        handle_script_list(c, hm);
-      } else {
-        handle_script_upload(c, hm);
-      }
-    } else if (mg_match(hm->uri, mg_str("/api/scripts/*"), NULL)) {
-      if (hm->method.len == 3 && memcmp(hm->method.buf, "PUT", 3) == 0) {
-        handle_script_update(c, hm);
-      } else {
-        handle_script_delete(c, hm);
-      }
-    }
+    ROUTE_GET("/api/scripts", handle_script_list, handle_script_upload),
+    ROUTE_PUT("/api/scripts/*", handle_script_update, handle_script_delete),
+
     /* 插件存储 API */
-    else if (mg_match(hm->uri, mg_str("/api/plugins/storage/*"), NULL)) {
-      if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-        handle_plugin_storage_get(c, hm);
-      } else if (hm->method.len == 4 &&
-                 memcmp(hm->method.buf, "POST", 4) == 0) {
-        handle_plugin_storage_set(c, hm);
-      } else if (hm->method.len == 6 &&
-                 memcmp(hm->method.buf, "DELETE", 6) == 0) {
-        handle_plugin_storage_delete(c, hm);
-      } else {
-        HTTP_ERROR(c, 405, "Method not allowed");
-      }
-    }
+    ROUTE("/api/plugins/storage/*", route_plugin_storage),
+#endif
+
+#if FEATURE_RATHOLE
     /* Rathole 内网穿透 API */
-    else if (mg_match(hm->uri, mg_str("/api/rathole/config"), NULL)) {
-      if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-        handle_rathole_config_get(c, hm);
-      } else {
-        handle_rathole_config_set(c, hm);
-      }
-    } else if (mg_match(hm->uri, mg_str("/api/rathole/services"), NULL)) {
-      if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-        handle_rathole_services_list(c, hm);
-      } else {
-        handle_rathole_service_add(c, hm);
-      }
-    } else if (mg_match(hm->uri, mg_str("/api/rathole/services/*"), NULL)) {
-      if (hm->method.len == 3 && memcmp(hm->method.buf, "PUT", 3) == 0) {
-        handle_rathole_service_update(c, hm);
-      } else {
-        handle_rathole_service_delete(c, hm);
-      }
-    } else if (mg_match(hm->uri, mg_str("/api/rathole/start"), NULL)) {
-      handle_rathole_start(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/rathole/stop"), NULL)) {
-      handle_rathole_stop(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/rathole/status"), NULL)) {
-      handle_rathole_status(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/rathole/logs"), NULL)) {
-      handle_rathole_logs(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/rathole/server-config"), NULL)) {
-      handle_rathole_server_config(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/rathole/autostart"), NULL)) {
-      handle_rathole_autostart(c, hm);
-    }
+    ROUTE_GET("/api/rathole/config", handle_rathole_config_get,
+              handle_rathole_config_set),
+    ROUTE_GET("/api/rathole/services", handle_rathole_services_list,
+              handle_rathole_service_add),
+    ROUTE_PUT("/api/rathole/services/*", handle_rathole_service_update,
+              handle_rathole_service_delete),
+    ROUTE("/api/rathole/start", handle_rathole_start),
+    ROUTE("/api/rathole/stop", handle_rathole_stop),
+    ROUTE("/api/rathole/status", handle_rathole_status),
+    ROUTE("/api/rathole/logs", handle_rathole_logs),
+    ROUTE("/api/rathole/server-config", handle_rathole_server_config),
+    ROUTE("/api/rathole/autostart", handle_rathole_autostart),
+#endif
+
+#if FEATURE_IPV6_PROXY
     /* IPv6 Proxy 端口转发 API */
-    else if (mg_match(hm->uri, mg_str("/api/ipv6-proxy/config"), NULL)) {
-      if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-        handle_ipv6_proxy_config_get(c, hm);
-      } else {
-        handle_ipv6_proxy_config_set(c, hm);
-      }
-    } else if (mg_match(hm->uri, mg_str("/api/ipv6-proxy/rules"), NULL)) {
-      if (hm->method.len == 3 && memcmp(hm->method.buf, "GET", 3) == 0) {
-        handle_ipv6_proxy_rules_list(c, hm);
-      } else {
-        handle_ipv6_proxy_rules_add(c, hm);
-      }
-    } else if (mg_match(hm->uri, mg_str("/api/ipv6-proxy/rules/*"), NULL)) {
-      if (hm->method.len == 3 && memcmp(hm->method.buf, "PUT", 3) == 0) {
-        handle_ipv6_proxy_rules_update(c, hm);
-      } else {
-        handle_ipv6_proxy_rules_delete(c, hm);
-      }
-    } else if (mg_match(hm->uri, mg_str("/api/ipv6-proxy/start"), NULL)) {
-      handle_ipv6_proxy_start(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/ipv6-proxy/stop"), NULL)) {
-      handle_ipv6_proxy_stop(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/ipv6-proxy/restart"), NULL)) {
-      handle_ipv6_proxy_restart(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/ipv6-proxy/status"), NULL)) {
-      handle_ipv6_proxy_status(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/ipv6-proxy/send"), NULL)) {
-      handle_ipv6_proxy_send(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/ipv6-proxy/test"), NULL)) {
-      handle_ipv6_proxy_test(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/ipv6-proxy/send-logs"), NULL)) {
-      handle_ipv6_proxy_send_logs(c, hm);
-    }
+    ROUTE_GET("/api/ipv6-proxy/config", handle_ipv6_proxy_config_get,
+              handle_ipv6_proxy_config_set),
+    ROUTE_GET("/api/ipv6-proxy/rules", handle_ipv6_proxy_rules_list,
+              handle_ipv6_proxy_rules_add),
+    ROUTE_PUT("/api/ipv6-proxy/rules/*", handle_ipv6_proxy_rules_update,
+              handle_ipv6_proxy_rules_delete),
+    ROUTE("/api/ipv6-proxy/start", handle_ipv6_proxy_start),
+    ROUTE("/api/ipv6-proxy/stop", handle_ipv6_proxy_stop),
+    ROUTE("/api/ipv6-proxy/restart", handle_ipv6_proxy_restart),
+    ROUTE("/api/ipv6-proxy/status", handle_ipv6_proxy_status),
+    ROUTE("/api/ipv6-proxy/send", handle_ipv6_proxy_send),
+    ROUTE("/api/ipv6-proxy/test", handle_ipv6_proxy_test),
+    ROUTE("/api/ipv6-proxy/send-logs", handle_ipv6_proxy_send_logs),
+#endif
+
+#if FEATURE_PHONE_CASE
     /* 手机壳模式 API */
-    else if (mg_match(hm->uri, mg_str("/api/phone-case"), NULL)) {
-      handle_phone_case(c, hm);
-    }
+    ROUTE("/api/phone-case", handle_phone_case),
+#endif
+
     /* 密保 API */
-    else if (mg_match(hm->uri, mg_str("/api/security/status"), NULL)) {
-      handle_security_status(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/security/setup"), NULL)) {
-      handle_security_setup(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/security/questions"), NULL)) {
-      handle_security_questions(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/security/verify"), NULL)) {
-      handle_security_verify(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/security/reset-password"),
-                        NULL)) {
-      handle_security_reset_password(c, hm);
-    } else if (mg_match(hm->uri, mg_str("/api/security/factory-reset"), NULL)) {
-      handle_security_factory_reset(c, hm);
-    }
-    /* 未知 API 路由 */
-    else {
-      HTTP_ERROR(c, 404, "Endpoint not found");
+    ROUTE("/api/security/status", handle_security_status),
+    ROUTE("/api/security/setup", handle_security_setup),
+    ROUTE("/api/security/questions", handle_security_questions),
+    ROUTE("/api/security/verify", handle_security_verify),
+    ROUTE("/api/security/reset-password", handle_security_reset_password),
+    ROUTE("/api/security/factory-reset", handle_security_factory_reset),
+
+    /* 服务指标 API */
+    ROUTE("/api/metrics", handle_metrics),
+    ROUTE("/api/debug/traces", handle_debug_traces),
+    ROUTE("/api/logs", handle_logs),
+#if FEATURE_TLS
+    ROUTE("/api/tls", handle_tls_stats),
+#endif
+
+    /* 启动状态 (前端轮询就绪状态) */
+    ROUTE_EARLY("/api/startup", handle_startup),
+
+    /* 设备遥测导出 (只读内存缓存，监控系统携带抓取令牌拉取，令牌自行校验) */
+    ROUTE_PUBLIC("/metrics", handle_telemetry_metrics),
+};
+
+#define ROUTE_COUNT (sizeof(g_routes) / sizeof(g_routes[0]))
+
+/* 每条路由对应的指标槽位，以及静态文件/未匹配请求的槽位 */
+static int g_route_slots[ROUTE_COUNT];
+static int g_slot_static = -1;
+static int g_slot_unmatched = -1;
+
+/* 注册所有路由的指标槽位 */
+void http_server_routes_init(void) {
+  for (size_t i = 0; i < ROUTE_COUNT; i++) {
+    g_route_slots[i] = metrics_register_route(g_routes[i].pattern);
+  }
+  g_slot_static = metrics_register_route("static");
+  g_slot_unmatched = metrics_register_route("unmatched");
+}
+
+/* 查找匹配的路由，未找到返回NULL */
+static const HttpRoute *http_route_find(struct mg_str uri) {
+  for (size_t i = 0; i < ROUTE_COUNT; i++) {
+    if (mg_match(uri, mg_str(g_routes[i].pattern), NULL)) {
+      return &g_routes[i];
     }
   }
+  return NULL;
 }
 
-int http_server_start(const char *port) {
-  char listen_addr[64];
+/* 按请求方法调用路由的处理函数 */
+static void http_route_call(const HttpRoute *route, struct mg_connection *c,
+                            struct mg_http_message *hm) {
+  if (route->on_get && hm->method.len == 3 &&
+      memcmp(hm->method.buf, "GET", 3) == 0) {
+    route->on_get(c, hm);
+  } else if (route->on_put && hm->method.len == 3 &&
+             memcmp(hm->method.buf, "PUT", 3) == 0) {
+    route->on_put(c, hm);
+  } else {
+    route->handler(c, hm);
+  }
+}
 
-  /* 初始化 D-Bus */
-  if (init_dbus() != 0) {
-    printf("警告: D-Bus 初始化失败 (高级网络功能将不可用)\n");
+/**
+ * 分发HTTP请求
+ * @return 本次请求对应的指标槽位
+ */
+static int http_dispatch(struct mg_connection *c, struct mg_http_message *hm) {
+  char uri[256] = {0};
+  size_t uri_len =
+      hm->uri.len < sizeof(uri) - 1 ? hm->uri.len : sizeof(uri) - 1;
+  memcpy(uri, hm->uri.buf, uri_len);
+
+  const HttpRoute *route = http_route_find(hm->uri);
+
+  /* 静态文件处理 (路由表之外的非 /api/ 路径) */
+  if (!route && (hm->uri.len < 5 || memcmp(hm->uri.buf, "/api/", 5) != 0)) {
+    if (serve_packed_file(c, hm)) {
+      return g_slot_static; /* 静态文件已处理 */
+    }
   }
 
-  /* 初始化流量统计 */
-  init_traffic();
+  int slot = route ? g_route_slots[route - g_routes] : g_slot_unmatched;
 
-  /* 初始化充电控制 */
-  init_charge();
+  /* 模块初始化完成前只开放启动状态等路由 */
+  if (!(route && route->early) && !startup_ready()) {
+    mg_http_reply(c, 503, HTTP_CORS_HEADERS "Retry-After: 1\r\n",
+                  "{\"status\":\"warming_up\",\"message\":\"服务正在启动，"
+                  "请稍候\"}");
+    return slot;
+  }
 
-  /* 初始化短信模块（必须在auth_init之前，因为auth依赖数据库） */
-  if (sms_init("6677.db") != 0) {
-    printf("警告: 短信模块初始化失败\n");
+  /* 认证中间件 - 检查Token (认证API自行处理) */
+  if (!(route && route->is_public) &&
+      !is_auth_whitelist(uri, hm->method.buf, hm->method.len)) {
+    int auth_span = trace_span_begin("auth", NULL);
+    int auth_ret = verify_request_token(hm);
+    trace_span_end(auth_span);
+    if (auth_ret != 0) {
+      HTTP_JSON(c, 401,
+                "{\"status\":\"error\",\"message\":\"未授权，请先登录\"}");
+      return slot;
+    }
   }
 
-  /* 初始化认证模块 */
-  if (auth_init() != 0) {
-    printf("警告: 认证模块初始化失败\n");
+  /* 未知 API 路由 */
+  if (!route) {
+    HTTP_ERROR(c, 404, "Endpoint not found");
+    return slot;
   }
 
-  /* 初始化APN模块 */
-  if (apn_init("6677.db") != 0) {
-    printf("警告: APN模块初始化失败\n");
+  int span = trace_span_begin("handler", route->pattern);
+  http_route_call(route, c, hm);
+  trace_span_end(span);
+  return slot;
+}
+
+/* ==================== 批量请求 ==================== */
+
+/*
+ * POST /api/batch
+ * 请求体: {"requests":["/api/info","/api/current_band",...]}
+ * 响应:   {"results":[{"path":...,"status":200,"body":{...}},...]}
+ *
+ * 批量请求本身经过一次认证，子请求不再重复校验 Token，直接按路由表分发。
+ * 子请求只允许 GET，在事件循环线程上按顺序执行，各自写入一个伪连接的发送缓冲区。
+ * 处理函数并非线程安全 (共享模块状态、D-Bus 代理、内存池)，不在其他线程上执行；
+ * 节省的是多次 HTTP 往返和认证，而不是子请求之间的重叠。
+ * 页面加载的子请求主要耗时在 AT 命令上，execute_at 由 g_at_mutex 串行化，
+ * 即使并发分发也无法重叠这部分后端 I/O，因此不做并发。
+ */
+
+#define BATCH_MAX_ITEMS 16 /* 单次批量请求的子请求上限 */
+
+/* 批量子请求 */
+typedef struct {
+  char req[512];              /* 合成的 GET 请求 */
+  struct mg_http_message hm;  /* req 的解析结果 */
+  const HttpRoute *route;     /* NULL 表示无效路径，不执行 */
+  struct mg_connection conn;  /* 伪连接: 处理函数只写入其发送缓冲区 */
+  uint64_t elapsed_us;
+} BatchItem;
+
+/* 解析子请求路径，构造请求和伪连接；路径无效时 route 置 NULL */
+static void batch_item_init(BatchItem *it, struct mg_str path,
+                            struct mg_connection *parent,
+                            struct mg_http_message *parent_hm) {
+  struct mg_str *auth = mg_http_get_header(parent_hm, "Authorization");
+  int n = snprintf(it->req, sizeof(it->req),
+                   "GET %.*s HTTP/1.1\r\nAuthorization: %.*s\r\n\r\n",
+                   (int)path.len, path.buf, auth ? (int)auth->len : 0,
+                   auth ? auth->buf : "");
+
+  it->route = NULL;
+  memset(&it->conn, 0, sizeof(it->conn));
+  it->conn.mgr = parent->mgr;
+  it->conn.id = parent->id;
+  it->conn.loc = parent->loc;
+  it->conn.rem = parent->rem;
+
+  if (n <= 0 || (size_t)n >= sizeof(it->req) ||
+      mg_http_parse(it->req, (size_t)n, &it->hm) <= 0)
+    return;
+  if (it->hm.uri.len < 5 || memcmp(it->hm.uri.buf, "/api/", 5) != 0 ||
+      mg_match(it->hm.uri, mg_str("/api/batch"), NULL))
+    return;
+  /* 认证、启动状态、WebSocket 等公开路由不是资源读取，不参与批量 */
+  const HttpRoute *route = http_route_find(it->hm.uri);
+  if (route && !route->is_public)
+    it->route = route;
+}
+
+static void handle_batch(struct mg_connection *c, struct mg_http_message *hm) {
+  HTTP_CHECK_POST(c, hm);
+
+  int arr_len = 0;
+  int arr_ofs = mg_json_get(hm->body, "$.requests", &arr_len);
+  if (arr_ofs < 0 || hm->body.buf[arr_ofs] != '[') {
+    HTTP_ERROR(c, 400, "requests 必须是路径数组");
+    return;
   }
+  struct mg_str arr = mg_str_n(hm->body.buf + arr_ofs, (size_t)arr_len);
 
-  /* 初始化Rathole模块 */
-  if (rathole_init("6677.db") != 0) {
-    printf("警告: Rathole模块初始化失败\n");
+  /* 收集路径 (JSON 字符串，不含转义) */
+  struct mg_str paths[BATCH_MAX_ITEMS];
+  int count = 0;
+  size_t ofs = 0;
+  struct mg_str key, val;
+  while ((ofs = mg_json_next(arr, ofs, &key, &val)) > 0) {
+    if (count >= BATCH_MAX_ITEMS) {
+      HTTP_ERROR(c, 400, "子请求过多");
+      return;
+    }
+    if (val.len < 2 || val.buf[0] != '"' ||
+        memchr(val.buf, '\\', val.len) != NULL) {
+      HTTP_ERROR(c, 400, "子请求路径必须是字符串");
+      return;
+    }
+    paths[count++] = mg_str_n(val.buf + 1, val.len - 2);
   }
 
-  /* 初始化手机壳模式模块 */
-  phone_case_init();
+  BatchItem *items = calloc((size_t)(count ? count : 1), sizeof(BatchItem));
+  if (!items) {
+    HTTP_ERROR(c, 500, "内存不足");
+    return;
+  }
+  for (int i = 0; i < count; i++) {
+    batch_item_init(&items[i], paths[i], c, hm);
+  }
 
-  /* 初始化IPv6代理模块 */
-  if (ipv6_proxy_init("6677.db") != 0) {
-    printf("警告: IPv6代理模块初始化失败\n");
+  int span = trace_span_begin("batch", NULL);
+  for (int i = 0; i < count; i++) {
+    BatchItem *it = &items[i];
+    if (!it->route)
+      continue;
+    uint64_t start_us = metrics_now_us();
+    http_route_call(it->route, &it->conn, &it->hm);
+    it->elapsed_us = metrics_now_us() - start_us;
   }
+  trace_span_end(span);
 
-  /* 初始化密保模块 */
-  if (security_init() != 0) {
-    printf("警告: 密保模块初始化失败\n");
+  JsonBuilder *j = json_new();
+  json_obj_open(j);
+  json_arr_open(j, "results");
+  for (int i = 0; i < count; i++) {
+    BatchItem *it = &items[i];
+    char path[256];
+    snprintf(path, sizeof(path), "%.*s", (int)paths[i].len, paths[i].buf);
+
+    json_arr_obj_open(j);
+    json_add_str(j, "path", path);
+    if (!it->route) {
+      json_add_int(j, "status", 404);
+      json_add_str(j, "error", "Endpoint not found");
+    } else {
+      const char *resp = (const char *)it->conn.send.buf;
+      size_t len = it->conn.send.len;
+      int status = metrics_parse_status(resp, len);
+      metrics_record(g_route_slots[it->route - g_routes], status,
+                     it->hm.message.len, len, it->elapsed_us);
+
+      /* 去掉响应头，JSON 响应体原样嵌入，其余按字符串返回 */
+      int hlen = len ? mg_http_get_request_len((const unsigned char *)resp,
+                                               len)
+                     : 0;
+      char *text = hlen > 0 ? arena_strndup(resp + hlen, len - (size_t)hlen)
+                            : NULL;
+      const char *p = text ? text : "";
+      while (*p == ' ' || *p == '\r' || *p == '\n' || *p == '\t')
+        p++;
+      json_add_int(j, "status", status);
+      if ((*p == '{' || *p == '[') && mg_json_get(mg_str(p), "$", NULL) >= 0)
+        json_add_raw(j, "body", p);
+      else
+        json_add_str(j, "body", p);
+      arena_free(text);
+    }
+    json_obj_close(j);
+    mg_iobuf_free(&it->conn.send);
+    mg_iobuf_free(&it->conn.recv);
   }
+  json_arr_close(j);
+  json_obj_close(j);
+  free(items);
+
+  HTTP_OK_FREE(c, json_finish(j));
+}
+
+/* 处理一个完整的 HTTP 请求: 追踪、内存池、分发和指标 */
+void http_server_handle(struct mg_connection *c, struct mg_http_message *hm) {
+  static Trace trace; /* 事件循环单线程，请求间复用 */
+  static Arena arena; /* 请求内存池，回复写入发送缓冲区后重置 */
+  uint64_t start_us = metrics_now_us();
+  size_t send_before = c->send.len;
+
+  trace_begin(&trace, hm->method, hm->uri);
+  arena_begin(&arena);
+  int slot = http_dispatch(c, hm);
+  metrics_record_arena(slot, arena.count, arena.used);
+  arena_end(&arena);
+
+  /* 处理函数同步写入发送缓冲区，增量即为本次响应 */
+  size_t sent = c->send.len > send_before ? c->send.len - send_before : 0;
+  int status =
+      metrics_parse_status((const char *)c->send.buf + send_before, sent);
+  metrics_record(slot, status, hm->message.len, sent,
+                 metrics_now_us() - start_us);
+  trace_end(&trace, status);
+}
+
+/* HTTP 事件处理函数 */
+static void http_handler(struct mg_connection *c, int ev, void *ev_data) {
+  if (ev == MG_EV_HTTP_MSG) {
+    http_server_handle(c, (struct mg_http_message *)ev_data);
+  } else if (ev == MG_EV_WS_MSG || ev == MG_EV_CLOSE) {
+    push_on_event(c, ev, ev_data);
+  }
+}
+
+#if FEATURE_TLS
+/* HTTPS 事件处理: 握手和统计交给 tls 模块，请求与 HTTP 走同一处理路径 */
+static void http_tls_handler(struct mg_connection *c, int ev, void *ev_data) {
+  tls_on_event(c, ev);
+  if (ev == MG_EV_HTTP_MSG) {
+    http_server_handle(c, (struct mg_http_message *)ev_data);
+  } else if (ev == MG_EV_WS_MSG || ev == MG_EV_CLOSE) {
+    push_on_event(c, ev, ev_data);
+  }
+}
+#endif
+
+/* ==================== 模块初始化 ==================== */
+
+static int init_step_ofono(void) { return ofono_init() ? 0 : -1; }
+static int init_step_dbus(void) { return init_dbus(); }
+static int init_step_data_monitor(void) { return ofono_start_data_monitor(); }
+static int init_step_dualsim(void) { return dualsim_init(); }
+
+static int init_step_traffic(void) {
+  init_traffic();
+  return 0;
+}
+
+static int init_step_charge(void) {
+  init_charge();
+  return 0;
+}
+
+static int init_step_netif(void) {
+  /* 自动恢复之前启用的网络接口监听 */
+  init_netif();
+  return 0;
+}
+
+static int init_step_db(void) { return db_init("6677.db"); }
+static int init_step_sms(void) { return sms_init("6677.db"); }
+static int init_step_auth(void) { return auth_init(); }
+static int init_step_apn(void) { return apn_init("6677.db"); }
+static int init_step_security(void) { return security_init(); }
+static int init_step_cellsel(void) { return cellsel_init(); }
+static int init_step_wanprobe(void) { return wanprobe_init(); }
+static int init_step_speedtest(void) { return speedtest_init(); }
+static int init_step_qos(void) { return qos_init(); }
+static int init_step_conntrack(void) { return conntrack_init(); }
+
+#if FEATURE_RATHOLE
+static int init_step_rathole(void) { return rathole_init("6677.db"); }
+#endif
+
+#if FEATURE_IPV6_PROXY
+static int init_step_ipv6_proxy(void) { return ipv6_proxy_init("6677.db"); }
+#endif
+
+#if FEATURE_PHONE_CASE
+static int init_step_phone_case(void) {
+  phone_case_init();
+  return 0;
+}
+#endif
+
+static int init_step_observability(void) {
+  log_init();
+  trace_init();
+  telemetry_init();
+  return 0;
+}
+
+#if FEATURE_TLS
+static int init_step_tls(void) { return tls_init(); }
+#endif
+
+static int init_step_ntp(void) {
+  char output[256];
+  return run_command_timeout(30, output, sizeof(output), "ntpdate",
+                             "ntp.aliyun.com", NULL);
+}
+
+/* 在所有组之前同步执行: 建表，并让日志级别/输出、追踪和遥测覆盖整个并行初始化过程 */
+static const StartupStep g_steps_pre[] = {
+    {"db", init_step_db},
+    {"observability", init_step_observability},
+};
+
+/*
+ * ofono D-Bus 连接及数据连接监听，以及依赖 D-Bus 的模块
+ * (短信信号订阅、APN 下发、自动选网的 AT 查询)，组内顺序执行保证连接先就绪
+ */
+static const StartupStep g_steps_dbus[] = {
+    {"ofono", init_step_ofono},
+    {"dbus", init_step_dbus},
+    {"data_monitor", init_step_data_monitor},
+    {"dualsim", init_step_dualsim},
+    {"sms", init_step_sms},
+    {"apn", init_step_apn},
+    {"cellsel", init_step_cellsel},
+};
+
+/* 仅依赖数据库的模块 (数据库访问本身是串行的) */
+static const StartupStep g_steps_storage[] = {
+    {"auth", init_step_auth},
+    {"wanprobe", init_step_wanprobe},
+    {"speedtest", init_step_speedtest},
+    {"qos", init_step_qos},
+    {"conntrack", init_step_conntrack},
+#if FEATURE_RATHOLE
+    {"rathole", init_step_rathole},
+#endif
+#if FEATURE_PHONE_CASE
+    {"phone_case", init_step_phone_case},
+#endif
+#if FEATURE_IPV6_PROXY
+    {"ipv6_proxy", init_step_ipv6_proxy},
+#endif
+    {"security", init_step_security},
+};
+
+static const StartupStep g_steps_traffic[] = {{"traffic", init_step_traffic}};
+static const StartupStep g_steps_charge[] = {{"charge", init_step_charge}};
+static const StartupStep g_steps_netif[] = {{"netif", init_step_netif}};
+static const StartupStep g_steps_ntp[] = {{"ntpdate", init_step_ntp}};
+#if FEATURE_TLS
+static const StartupStep g_steps_tls[] = {{"tls", init_step_tls}};
+#endif
+
+#define STARTUP_STEPS(a) (a), (int)(sizeof(a) / sizeof((a)[0]))
+
+/* 各组只依赖 g_steps_pre，彼此并行执行；时间同步不影响就绪状态 */
+static const StartupGroup g_startup_groups[] = {
+    {"dbus", STARTUP_STEPS(g_steps_dbus), 0},
+    {"storage", STARTUP_STEPS(g_steps_storage), 0},
+    {"traffic", STARTUP_STEPS(g_steps_traffic), 0},
+    {"charge", STARTUP_STEPS(g_steps_charge), 0},
+    {"netif", STARTUP_STEPS(g_steps_netif), 0},
+    {"ntp", STARTUP_STEPS(g_steps_ntp), 1},
+#if FEATURE_TLS
+    /* 首次启动可能需要生成证书，不阻塞 HTTP 就绪 */
+    {"tls", STARTUP_STEPS(g_steps_tls), 1},
+#endif
+};
+
+#define STARTUP_GROUP_COUNT \
+  (int)(sizeof(g_startup_groups) / sizeof(g_startup_groups[0]))
+
+int http_server_start(const char *port) {
+  char listen_addr[64];
+
+  /* 初始化路由指标 */
+  http_server_routes_init();
 
   /* 初始化 mongoose */
   mg_mgr_init(&g_mgr);
@@ -511,29 +822,226 @@ int http_server_start(const char *port) {
   /* 构建监听地址 - 使用 0.0.0.0 监听所有IPv4地址 */
   snprintf(listen_addr, sizeof(listen_addr), "http://0.0.0.0:%s", port);
 
-  /* 创建 HTTP 监听器 */
-  if (mg_http_listen(&g_mgr, listen_addr, http_handler, NULL) == NULL) {
-    printf("无法监听端口 %s\n", port);
-    mg_mgr_free(&g_mgr);
-    return -1;
+  /* 交接启动时沿用旧映像的监听套接字，模块就绪后再开始 accept */
+  handoff_init();
+  g_inherited_fd = handoff_take_listen_fd(HANDOFF_ENV_HTTP_FD);
+#if FEATURE_TLS
+  g_tls_inherited_fd = handoff_take_listen_fd(HANDOFF_ENV_HTTPS_FD);
+#else
+  int tls_fd = handoff_take_listen_fd(HANDOFF_ENV_HTTPS_FD);
+  if (tls_fd >= 0)
+    close(tls_fd);
+#endif
+  if (g_inherited_fd < 0) {
+    /* 创建 HTTP 监听器 */
+    g_listener = mg_http_listen(&g_mgr, listen_addr, http_handler, NULL);
+    if (g_listener == NULL) {
+      printf("无法监听端口 %s\n", port);
+      mg_mgr_free(&g_mgr);
+      return -1;
+    }
   }
 
   printf("Server starting on :%s\n", port);
+  startup_mark("listen");
+
+  /* 监听就绪后先同步完成建表与日志初始化，再并行初始化各模块，完成前 API 返回 503 */
+  for (size_t i = 0; i < sizeof(g_steps_pre) / sizeof(g_steps_pre[0]); i++) {
+    startup_run_step("pre", &g_steps_pre[i]);
+  }
+  startup_run_groups(g_startup_groups, STARTUP_GROUP_COUNT);
   g_running = 1;
 
   /* 设置信号处理 */
   signal(SIGINT, signal_handler);
   signal(SIGTERM, signal_handler);
+  signal(SIGUSR2, handoff_signal_handler);
 
   return 0;
 }
 
+/**
+ * 交接启动: 接管继承的监听 fd
+ * 先创建一个临时监听连接获得协议处理 (HTTP/HTTPS 由 url 决定)，
+ * 再用 dup2 把继承的套接字换到它的 fd 上
+ * @return 监听连接，失败返回NULL (继承的 fd 保留，稍后重试)
+ */
+static struct mg_connection *http_adopt_listener(int inherited_fd,
+                                                 const char *url,
+                                                 mg_event_handler_t fn) {
+  struct mg_connection *lc = mg_http_listen(&g_mgr, url, fn, NULL);
+  if (lc == NULL) {
+    LOG_E("创建监听连接失败，稍后重试");
+    return NULL;
+  }
+
+  int fd = (int)(size_t)lc->fd;
+  if (dup2(inherited_fd, fd) < 0) {
+    LOG_E("接管监听 fd 失败: %s", strerror(errno));
+    lc->is_closing = 1;
+    return NULL;
+  }
+  close(inherited_fd);
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  /* dup2 关闭了原套接字，epoll 中的注册随之失效，需重新登记 */
+  MG_EPOLL_ADD(lc);
+  return lc;
+}
+
+/*
+ * 开始交接: 复制监听 fd 后关闭监听连接。套接字保持打开，
+ * 新连接在内核队列中等待重新执行后的映像 accept
+ */
+static void http_handoff_begin(void) {
+  int fd = fcntl((int)(size_t)g_listener->fd, F_DUPFD_CLOEXEC, 3);
+  if (fd < 0) {
+    LOG_E("复制监听 fd 失败: %s", strerror(errno));
+    return;
+  }
+  g_handoff_fds[0] = fd;
+  g_listener->is_closing = 1;
+  g_listener = NULL;
+#if FEATURE_TLS
+  if (g_tls_listener != NULL) {
+    g_handoff_fds[1] = fcntl((int)(size_t)g_tls_listener->fd, F_DUPFD_CLOEXEC, 3);
+    g_tls_listener->is_closing = 1;
+    g_tls_listener = NULL;
+    tls_set_listening(NULL);
+  } else if (g_tls_inherited_fd >= 0) {
+    g_handoff_fds[1] = g_tls_inherited_fd;
+    g_tls_inherited_fd = -1;
+  }
+#endif
+  g_drain_deadline_us =
+      metrics_now_us() + (uint64_t)HANDOFF_DRAIN_TIMEOUT_MS * 1000;
+  LOG_I("开始交接，排空已接受的连接后重新执行");
+}
+
+/* 排空阶段: 等待已接受的连接处理完后退出事件循环 (随后在 http_server_stop 中重新执行) */
+static void http_drain_poll(void) {
+  int active = 0;
+  for (struct mg_connection *c = g_mgr.conns; c != NULL; c = c->next) {
+    if (!c->is_accepted || c->is_closing) continue;
+    /* 没有未处理的请求数据: 发送完缓冲区后关闭 */
+    if (c->recv.len == 0) c->is_draining = 1;
+    active++;
+  }
+
+  if (active == 0 || metrics_now_us() >= g_drain_deadline_us) {
+    LOG_I("排空完成，剩余连接 %d", active);
+    g_handoff_exec = 1;
+    g_running = 0;
+  }
+}
+
+/* 监听套接字交接状态机 (事件循环中调用) */
+static void http_handoff_poll(void) {
+  if (g_inherited_fd >= 0 && startup_ready()) {
+    g_listener =
+        http_adopt_listener(g_inherited_fd, "http://127.0.0.1:0", http_handler);
+    if (g_listener != NULL) {
+      g_inherited_fd = -1;
+      startup_mark("handoff");
+    }
+  }
+
+  if (g_handoff_requested) {
+    g_handoff_requested = 0;
+    if (g_listener == NULL || g_drain_deadline_us != 0) {
+      LOG_W("交接进行中或监听未就绪，忽略 SIGUSR2");
+    } else {
+      http_handoff_begin();
+    }
+  }
+
+  if (g_drain_deadline_us != 0) {
+    http_drain_poll();
+  }
+}
+
+/* 把监听 fd 与 IPv6 代理子进程写入环境变量后原地重新执行，仅在失败时返回 */
+static void http_handoff_exec(void) {
+  char env_fds[2][48];
+  char *env[HANDOFF_MAX_VARS];
+  int keep[2];
+  int n = 0, k = 0;
+  static const char *const names[2] = {HANDOFF_ENV_HTTP_FD, HANDOFF_ENV_HTTPS_FD};
+
+  for (int i = 0; i < 2; i++) {
+    if (g_handoff_fds[i] < 0) continue;
+    snprintf(env_fds[i], sizeof(env_fds[i]), "%s=%d", names[i], g_handoff_fds[i]);
+    env[n++] = env_fds[i];
+    keep[k++] = g_handoff_fds[i];
+  }
+#if FEATURE_IPV6_PROXY
+  char env_proxy[256];
+  size_t plen = snprintf(env_proxy, sizeof(env_proxy), "%s=", HANDOFF_ENV_IPV6_PROXY);
+  if (ipv6_proxy_handoff_state(env_proxy + plen, sizeof(env_proxy) - plen) > 0) {
+    env[n++] = env_proxy;
+  }
+#endif
+  env[n] = NULL;
+
+  handoff_exec(keep, k, env);
+  for (int i = 0; i < 2; i++) {
+    if (g_handoff_fds[i] >= 0) close(g_handoff_fds[i]);
+    g_handoff_fds[i] = -1;
+  }
+}
+
+#if FEATURE_TLS
+void http_server_enable_tls(const char *port) {
+  snprintf(g_tls_port, sizeof(g_tls_port), "%s", port ? port : "");
+}
+
+/* 证书就绪后创建 HTTPS 监听 (交接启动时接管继承的套接字，绑定失败每秒重试) */
+static void http_tls_poll(void) {
+  if (g_tls_listener != NULL || g_drain_deadline_us != 0) return;
+
+  if (g_tls_inherited_fd >= 0) {
+    if (!startup_ready() || !tls_available()) return;
+    g_tls_listener = http_adopt_listener(g_tls_inherited_fd,
+                                         "https://127.0.0.1:0", http_tls_handler);
+    if (g_tls_listener != NULL) {
+      g_tls_inherited_fd = -1;
+      tls_set_listening(g_tls_port);
+      LOG_I("HTTPS 沿用继承的监听套接字");
+    }
+    return;
+  }
+
+  if (g_tls_port[0] == '\0' || strcmp(g_tls_port, "0") == 0 ||
+      !tls_available()) {
+    return;
+  }
+
+  uint64_t now = metrics_now_us();
+  if (now < g_tls_retry_us) return;
+
+  char addr[64];
+  snprintf(addr, sizeof(addr), "https://0.0.0.0:%s", g_tls_port);
+  g_tls_listener = mg_http_listen(&g_mgr, addr, http_tls_handler, NULL);
+  if (g_tls_listener == NULL) {
+    if (g_tls_retry_us == 0) LOG_W("无法监听 HTTPS 端口 %s，稍后重试", g_tls_port);
+    g_tls_retry_us = now + 1000000;
+    return;
+  }
+  g_tls_retry_us = 0;
+  tls_set_listening(g_tls_port);
+  LOG_I("HTTPS listening on :%s", g_tls_port);
+}
+#endif
+
 void http_server_stop(void) {
   g_running = 0;
+  /* 交接: 原地重新执行 (成功时不返回)，失败则按正常流程退出，由监管进程重启 */
+  if (g_handoff_exec) http_handoff_exec();
   mg_mgr_free(&g_mgr);
   sms_deinit();
   close_dbus();
   printf("服务器已停止\n");
+  log_shutdown();
 }
 
 void http_server_run(void) {
@@ -549,6 +1057,19 @@ void http_server_run(void) {
     /* 处理mongoose事件 - 减少超时时间以更快响应D-Bus信号 */
     mg_mgr_poll(&g_mgr, 10); /* 10ms超时 */
 
+    /* 平滑升级: 接管/交接监听套接字 */
+    http_handoff_poll();
+
+#if FEATURE_TLS
+    http_tls_poll();
+#endif
+
+    /* 仪表盘状态增量推送 */
+    push_poll();
+
+    /* 测速阶段切换、采样及断线重连 */
+    speedtest_poll(&g_mgr);
+
     /* 每30秒执行一次短信模块维护（检查D-Bus连接） */
     if (++maintenance_counter >= 3000) { /* 3000 * 10ms = 30秒 */
       maintenance_counter = 0;
@@ -0,0 +1,60 @@
+/**
+ * @file feature.h
+ * @brief 编译期功能开关
+ *
+ * 每个可选模块对应一个 FEATURE_* 宏 (1=编译, 0=移除)，默认全部启用。
+ * Makefile 的 PROFILE 变量按设备型号选择一组开关，并同时排除对应的源文件、
+ * 调整 mongoose 的 MG_ENABLE_* 选项:
+ *
+ *   make                  完整功能 (PROFILE=full)
+ *   make PROFILE=sms      仅短信与监控: 去掉内网穿透、IPv6 代理、手机壳模式、插件/脚本、USB 模式、HTTPS
+ *   make PROFILE=minimal  在 sms 基础上再去掉 OTA 在线更新
+ *   make profile-report   分别构建各 profile 并输出二进制大小
+ *
+ * 运行时的 profile 名称、已启用模块和进程 RSS 见 /api/startup。
+ * 新增 profile 时在 Makefile 中同时设置 FEATURE_FLAGS 和 FEATURE_OUT (被移除的源文件)。
+ */
+
+#ifndef FEATURE_H
+#define FEATURE_H
+
+#ifndef FEATURE_PROFILE
+#define FEATURE_PROFILE "full"
+#endif
+
+/* Rathole 内网穿透 */
+#ifndef FEATURE_RATHOLE
+#define FEATURE_RATHOLE 1
+#endif
+
+/* IPv6 端口转发代理 */
+#ifndef FEATURE_IPV6_PROXY
+#define FEATURE_IPV6_PROXY 1
+#endif
+
+/* 手机壳模式 */
+#ifndef FEATURE_PHONE_CASE
+#define FEATURE_PHONE_CASE 1
+#endif
+
+/* 插件、脚本及插件存储 */
+#ifndef FEATURE_PLUGIN
+#define FEATURE_PLUGIN 1
+#endif
+
+/* USB 模式切换 */
+#ifndef FEATURE_USB_MODE
+#define FEATURE_USB_MODE 1
+#endif
+
+/* OTA 在线更新 */
+#ifndef FEATURE_UPDATE
+#define FEATURE_UPDATE 1
+#endif
+
+/* HTTPS 监听 (mongoose 内置 TLS，需同时定义 MG_TLS=MG_TLS_BUILTIN) */
+#ifndef FEATURE_TLS
+#define FEATURE_TLS 1
+#endif
+
+#endif /* FEATURE_H */
@@ -106,6 +106,10 @@ void handle_auth_login(struct mg_connection *c, struct mg_http_message *hm);
 void handle_auth_logout(struct mg_connection *c, struct mg_http_message *hm);
 void handle_auth_password(struct mg_connection *c, struct mg_http_message *hm);
 void handle_auth_status(struct mg_connection *c, struct mg_http_message *hm);
+void handle_auth_scrape_token_get(struct mg_connection *c,
+                                  struct mg_http_message *hm);
+void handle_auth_scrape_token_set(struct mg_connection *c,
+                                  struct mg_http_message *hm);
 
 /* Rathole 内网穿透 API */
 void handle_rathole_config_get(struct mg_connection *c,
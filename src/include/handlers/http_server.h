@@ -6,6 +6,8 @@
 #ifndef HTTP_SERVER_H
 #define HTTP_SERVER_H
 
+#include "mongoose.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -17,6 +19,13 @@ extern "C" {
  */
 int http_server_start(const char *port);
 
+/**
+ * @brief 设置 HTTPS 端口 (证书就绪后在事件循环中开始监听)
+ * @param port 端口号，"0" 或 NULL 表示不启用
+ * 仅 FEATURE_TLS 构建中可用
+ */
+void http_server_enable_tls(const char *port);
+
 /**
  * @brief 停止 HTTP 服务器
  */
@@ -27,6 +36,19 @@ void http_server_stop(void);
  */
 void http_server_run(void);
 
+/**
+ * @brief 注册路由表的指标槽位 (http_server_start 中调用)
+ */
+void http_server_routes_init(void);
+
+/**
+ * @brief 处理一个已解析的 HTTP 请求，响应同步写入 c->send
+ * 与事件循环中的处理路径相同 (追踪、内存池、认证、分发、指标)
+ * @param c 连接
+ * @param hm HTTP 消息
+ */
+void http_server_handle(struct mg_connection *c, struct mg_http_message *hm);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,113 @@
+/**
+ * @file arena.h
+ * @brief 请求级内存池 (bump allocator)
+ *
+ * HTTP 事件循环在分发请求前把内存池绑定到当前线程，回复写入发送缓冲区后整体重置。
+ * 处理期间 JsonBuilder、请求体解析和处理函数的临时缓冲都从池中顺序分配，
+ * 不再产生大量小块 malloc/free，避免长期运行后 libc 堆碎片化。
+ *
+ * 未绑定内存池的线程 (短信、看门狗等后台线程) 调用时自动回退到 malloc/free，
+ * 因此同一段代码在两种上下文中都能使用。池中分配的内存不能在请求结束后保留。
+ *
+ * 使用示例:
+ *   char *buf = arena_alloc(1024);
+ *   ...
+ *   arena_free(buf);   // 池内内存为空操作，回退分配时调用 free
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 默认块大小 (覆盖绝大多数请求) */
+#define ARENA_BLOCK_SIZE (32 * 1024)
+
+/* 重置时最多保留的块容量，超出部分归还给系统 */
+#define ARENA_RETAIN_MAX (256 * 1024)
+
+/* 分配对齐 */
+#define ARENA_ALIGN 16
+
+/* 内存块 */
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;                /* 可用容量 */
+    size_t used;                /* 已分配字节 */
+    unsigned char *data;        /* 紧跟在块头之后 */
+} ArenaBlock;
+
+/* 内存池 */
+typedef struct {
+    ArenaBlock *head;           /* 当前块 (链表头，旧块在后) */
+    void *last;                 /* 最近一次分配 (用于原地扩容) */
+    /* 本次请求的统计 */
+    size_t count;               /* 分配次数 */
+    size_t used;                /* 已分配字节 (含对齐) */
+    size_t capacity;            /* 块总容量 */
+} Arena;
+
+/**
+ * 绑定内存池到当前线程并清零统计
+ * @param a 内存池 (调用者持有，零初始化即可使用)
+ */
+void arena_begin(Arena *a);
+
+/**
+ * 解除绑定并重置内存池 (本次请求中分配的内存全部失效)
+ * 多块时合并为一个足够大的块，稳态下每个请求不再调用 malloc
+ * @param a 内存池
+ */
+void arena_end(Arena *a);
+
+/**
+ * 释放内存池的所有块
+ * @param a 内存池
+ */
+void arena_release(Arena *a);
+
+/**
+ * 从当前线程的内存池分配 (未绑定时回退到 malloc)
+ * @param size 字节数
+ * @return 指针，失败返回NULL
+ */
+void *arena_alloc(size_t size);
+
+/**
+ * 分配并清零
+ */
+void *arena_calloc(size_t size);
+
+/**
+ * 扩容 (最近一次分配且块内有余量时原地扩展)
+ * @param ptr 原指针 (可为NULL)
+ * @param old_size 原大小
+ * @param new_size 新大小
+ * @return 新指针，失败返回NULL (原指针仍有效)
+ */
+void *arena_realloc(void *ptr, size_t old_size, size_t new_size);
+
+/**
+ * 复制字符串 (最多 len 字节，结果以 '\0' 结尾)
+ */
+char *arena_strndup(const char *s, size_t len);
+
+/**
+ * 释放 (池内指针为空操作，其余调用 free)
+ */
+void arena_free(void *ptr);
+
+/**
+ * 获取当前线程绑定的内存池 (未绑定返回NULL)
+ */
+Arena *arena_current(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARENA_H */
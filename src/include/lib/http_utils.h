@@ -6,6 +6,7 @@
 #ifndef HTTP_UTILS_H
 #define HTTP_UTILS_H
 
+#include "arena.h"
 #include "mongoose.h"
 #include <string.h>
 
@@ -100,20 +101,53 @@ static inline void http_method_error(struct mg_connection *c) {
 #define HTTP_OK_FREE(c, json) do { \
     char *_json = (json); \
     mg_http_reply((c), 200, HTTP_CORS_HEADERS, "%s", _json); \
-    free(_json); \
+    arena_free(_json); \
 } while(0)
 
 /* 带状态码的JSON响应并释放 */
 #define HTTP_JSON_FREE(c, code, json) do { \
     char *_json = (json); \
     mg_http_reply((c), (code), HTTP_CORS_HEADERS, "%s", _json); \
-    free(_json); \
+    arena_free(_json); \
 } while(0)
 
-/* ==================== JSON解析辅助宏 ==================== */
+/* ==================== JSON解析辅助函数 ==================== */
+
+/**
+ * 获取JSON字符串字段 (临时缓冲从请求内存池分配)
+ * @return 字符串 (用 arena_free 释放)，不存在或不是字符串返回NULL
+ */
+static inline char *http_json_dup(struct mg_str json, const char *path) {
+    int len = 0, off = mg_json_get(json, path, &len);
+    if (off < 0 || len < 2 || json.buf[off] != '"') return NULL;
+    char *s = (char *)arena_alloc((size_t)len);
+    if (s && !mg_json_unescape(mg_str_n(json.buf + off + 1, (size_t)(len - 2)), s, (size_t)len)) {
+        arena_free(s);
+        s = NULL;
+    }
+    return s;
+}
+
+/**
+ * 获取JSON字符串字段并复制到 dst (超长截断，始终以'\0'结尾)
+ * @return 1找到，0不存在 (dst 保持不变)
+ */
+static inline int http_json_get_str(struct mg_str json, const char *path, char *dst, size_t size) {
+    char *s = http_json_dup(json, path);
+    if (!s) return 0;
+    if (size > 0) {
+        size_t n = strlen(s);
+        if (n >= size) n = size - 1;
+        memcpy(dst, s, n);
+        dst[n] = '\0';
+    }
+    arena_free(s);
+    return 1;
+}
 
 /* 
  * 使用mongoose内置JSON函数:
+ * - http_json_get_str(body, "$.key", buf, sizeof(buf)) 获取字符串到缓冲区
  * - mg_json_get_str(body, "$.key")     获取字符串(需free)
  * - mg_json_get_num(body, "$.key", &v) 获取数值
  * - mg_json_get_bool(body, "$.key", &v) 获取布尔值
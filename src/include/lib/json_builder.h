@@ -26,7 +26,7 @@ extern "C" {
 
 /* JSON Builder结构体 */
 typedef struct {
-    struct mg_iobuf buf;    /* mongoose动态缓冲区 */
+    struct mg_iobuf buf;    /* 输出缓冲区 (经 arena.h 分配，请求内来自内存池) */
     int depth;              /* 当前嵌套深度 */
     int first[JSON_MAX_DEPTH]; /* 每层是否是第一个元素 */
 } JsonBuilder;
@@ -42,7 +42,7 @@ JsonBuilder *json_new(void);
 /**
  * 获取JSON字符串并释放JsonBuilder
  * @param j JsonBuilder指针
- * @return JSON字符串（调用者需要free），失败返回NULL
+ * @return JSON字符串（调用者用 arena_free 或 HTTP_OK_FREE 释放），失败返回NULL
  */
 char *json_finish(JsonBuilder *j);
 
@@ -12,6 +12,147 @@
 extern "C" {
 #endif
 
+/* 服务小区信息 */
+typedef struct {
+    char net_type[32];  /* 网络类型: "5G NR" / "4G LTE"，未知为 "N/A" */
+    char band[32];      /* 频段: "N78" / "B3"，未知为 "N/A" */
+    int arfcn;          /* 频点号 */
+    int pci;            /* 物理小区ID */
+    double rsrp;        /* 参考信号接收功率 (dBm) */
+    double rsrq;        /* 参考信号接收质量 (dB) */
+    double sinr;        /* 信噪比 (dB) */
+} ServingCell;
+
+/**
+ * 查询当前服务小区 (AT+SPENGMD)，成功时同步更新遥测缓存
+ * @param cell 输出服务小区信息 (失败时各字段为默认值)
+ * @return 0成功，-1失败
+ */
+int advanced_get_serving_cell(ServingCell *cell);
+
+/**
+ * 解析 AT+SPENGMD 返回的小区数据 (实现在 handlers.c)
+ * @param input AT 命令返回文本
+ * @param data 输出表 [行][列]
+ * @return 解析出的行数
+ */
+int parse_cell_to_vec(const char *input, char data[64][16][32]);
+
+/* 频段锁定位掩码 (AT+SPLBAND 参数，全 0 表示不锁定) */
+typedef struct {
+    int tdd4g;
+    int fdd4g;
+    int fdd5g;
+    int tdd5g;
+} BandLockMask;
+
+/**
+ * 查询当前频段锁定 (AT+SPLBAND=0 / AT+SPLBAND=3)
+ * @param mask 输出位掩码
+ * @return 0成功，-1查询失败
+ */
+int advanced_get_band_lock(BandLockMask *mask);
+
+/**
+ * 关闭射频 (AT+SFUN=5)
+ * @return 0成功，-1失败
+ */
+int advanced_radio_off(void);
+
+/**
+ * 开启射频 (AT+SFUN=4) 并激活数据连接 (AT+CGACT=0,1)
+ */
+void advanced_radio_on(void);
+
+/**
+ * 写入 4G/5G 频段位掩码 (不关开射频，需在 advanced_radio_off 之后调用)
+ * @param mask 位掩码，全 0 的制式为解锁
+ * @return 0成功，-1任一 AT 命令失败
+ */
+int advanced_write_band_lock(const BandLockMask *mask);
+
+/**
+ * 写入小区锁定 (不关开射频): 先清除 4G/5G 锁定，lock 为 1 时再锁定指定小区
+ * @param lock 1=锁定，0=仅解锁
+ * @param is_5g 1=5G，0=4G
+ * @param arfcn 频点号
+ * @param pci 物理小区ID
+ * @return 0成功，-1任一 AT 命令失败 (此时记录的锁定状态置为未知)
+ */
+int advanced_write_cell_lock(int lock, int is_5g, int arfcn, int pci);
+
+/**
+ * 读取本进程最近一次写入的小区锁定 (模块不支持查询)
+ * @param lock 输出: 1=已锁定，0=未锁定
+ * @param is_5g 输出: 1=5G，0=4G
+ * @param arfcn 输出: 频点号
+ * @param pci 输出: 物理小区ID
+ * @return 0成功，-1本进程尚未写入过 (状态未知)
+ */
+int advanced_get_cell_lock(int *lock, int *is_5g, int *arfcn, int *pci);
+
+/**
+ * 设置频段锁定: 关闭射频、写入 4G/5G 位掩码、开启射频并激活数据连接
+ * 4G 和 5G 均按 mask 显式写入，全 0 的制式为解锁
+ * @param mask 位掩码
+ * @return 0成功，-1关闭射频或写入失败
+ */
+int advanced_set_band_lock(const BandLockMask *mask);
+
+/**
+ * 频段名称 ("TDD_34"、"N78" 等，见 /api/bands) 转换为位掩码
+ * @param names 频段名称数组
+ * @param count 数量
+ * @param mask 输出位掩码
+ * @return 识别的频段数量
+ */
+int advanced_band_mask_from_names(const char names[][32], int count, BandLockMask *mask);
+
+/**
+ * 按序号获取支持的频段名称
+ * @param index 序号 (从 0 开始)
+ * @return 频段名称，越界返回NULL
+ */
+const char *advanced_band_name(int index);
+
+/* 小区测量结果 (服务小区及邻区) */
+typedef struct {
+    char rat[8];        /* "5G" / "4G" */
+    char band[16];      /* "N78" / "B3" */
+    int arfcn;
+    int pci;
+    double rsrp;        /* dBm */
+    double rsrq;        /* dB */
+    double sinr;        /* dB */
+    int is_serving;     /* 1=服务小区 */
+} CellInfo;
+
+/* 单次查询返回的小区上限 */
+#define ADVANCED_MAX_CELLS 32
+
+/**
+ * 查询服务小区和邻区 (AT+SPENGMD，按当前制式选择 5G 或 4G 命令)
+ * @param cells 输出数组
+ * @param max 数组容量
+ * @return 小区数量，内存不足返回-1
+ */
+int advanced_get_cells(CellInfo *cells, int max);
+
+/**
+ * 锁定小区: 关闭射频、清除原锁定、写入 AT+SPFORCEFRQ、开启射频并激活数据连接
+ * @param is_5g 1=5G，0=4G
+ * @param arfcn 频点号
+ * @param pci 物理小区ID
+ * @return 0成功，-1写入锁定失败
+ */
+int advanced_lock_cell(int is_5g, int arfcn, int pci);
+
+/**
+ * 解除 4G/5G 小区锁定 (流程同上，不写入新锁定)
+ * @return 0成功，-1写入失败
+ */
+int advanced_unlock_cell(void);
+
 /* 频段管理 */
 void handle_get_bands(struct mg_connection *c, struct mg_http_message *hm);
 void handle_lock_bands(struct mg_connection *c, struct mg_http_message *hm);
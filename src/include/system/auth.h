@@ -24,6 +24,12 @@ extern "C" {
 /* 最大同时登录Token数量 */
 #define AUTH_MAX_TOKENS 5
 
+/* 一次性连接票据有效期（秒） */
+#define AUTH_TICKET_EXPIRE_SECONDS 30
+
+/* 同时有效的连接票据数量上限 */
+#define AUTH_MAX_TICKETS 8
+
 /**
  * 初始化认证模块
  * 如果数据库中没有密码，则设置默认密码
@@ -75,6 +81,62 @@ int auth_get_status(int *logged_in);
  */
 int auth_is_required(void);
 
+/*
+ * 抓取令牌: 供 Prometheus 等监控系统拉取 /metrics 的长期令牌，
+ * 与登录会话无关 (不过期，登出/改密码不影响)，只能访问 /metrics。
+ * 保存在数据库中，启动时载入内存，校验时不访问数据库。
+ */
+
+/**
+ * 获取当前抓取令牌
+ * @param token 输出缓冲区（至少65字节），未启用时为空字符串
+ * @param size 缓冲区大小
+ * @return 0已启用，-1未启用
+ */
+int auth_scrape_token_get(char *token, size_t size);
+
+/**
+ * 生成新的抓取令牌 (旧令牌立即失效)
+ * @param token 输出新令牌（至少65字节）
+ * @param size 缓冲区大小
+ * @return 0成功，-2系统错误
+ */
+int auth_scrape_token_rotate(char *token, size_t size);
+
+/**
+ * 停用抓取令牌
+ * @return 0成功，-1失败
+ */
+int auth_scrape_token_clear(void);
+
+/**
+ * 校验抓取令牌 (只比较内存副本)
+ * @param token 要验证的token
+ * @return 0有效，-1无效或未启用
+ */
+int auth_verify_scrape_token(const char *token);
+
+/*
+ * 一次性连接票据: 浏览器的 WebSocket 无法设置 Authorization 头，
+ * 已登录的页面先换取票据再放入连接地址，避免会话令牌出现在 URL 和访问日志中。
+ * 票据只保存在内存，使用一次或超过有效期即失效。
+ */
+
+/**
+ * 签发连接票据 (票据满时覆盖最早签发的一张)
+ * @param ticket 输出票据（至少65字节）
+ * @param size 缓冲区大小
+ * @return 0成功，-1失败
+ */
+int auth_ticket_issue(char *ticket, size_t size);
+
+/**
+ * 校验并作废连接票据
+ * @param ticket 要验证的票据
+ * @return 0有效，-1无效、已使用或已过期
+ */
+int auth_ticket_consume(const char *ticket);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,60 @@
+/**
+ * @file bandscan.h
+ * @brief 频段扫描与自动选择
+ *
+ * 后台任务依次锁定候选频段组合 (与 /api/lock_bands 相同的 AT+SPLBAND 流程)，
+ * 等待模块重新驻留后多次采样服务小区 RSRP/SINR，可选下行测速 (与 /api/speedtest 同一引擎)，
+ * 最后按评分排序并锁定最佳组合；取消、失败或无可用组合时恢复扫描前的锁定。
+ *
+ * 评分: 测速时按下载速率排序；否则 score = SINR + (RSRP + 140) / 4，
+ * 即 SINR 优先，RSRP 每差 4 dB 折合 1 dB SINR。
+ * 未驻留到候选频段 (回落到其他频段或无服务) 的组合不参与排名。
+ * 取消时正在测量的组合保留已采集的样本并标记 cancelled，同样不参与排名。
+ *
+ * 扫描期间整个模块反复关开射频，数据连接会多次中断；
+ * 同一时间只允许一个扫描任务，手动锁频接口在扫描期间返回 409。
+ */
+
+#ifndef BANDSCAN_H
+#define BANDSCAN_H
+
+#include "mongoose.h"
+
+/* 候选组合上限 */
+#define BANDSCAN_MAX_CANDIDATES 16
+
+/* 默认参数 */
+#define BANDSCAN_SETTLE_SEC_DEFAULT 10      /* 锁频后等待重新驻留 (秒) */
+#define BANDSCAN_SAMPLES_DEFAULT 3          /* 每个组合的采样次数 */
+#define BANDSCAN_INTERVAL_MS_DEFAULT 2000   /* 采样间隔 (毫秒) */
+#define BANDSCAN_THROUGHPUT_SEC_MAX 30      /* 测速时长上限 (秒) */
+
+/**
+ * 扫描任务是否正在运行
+ * @return 1 运行中, 0 空闲
+ */
+int bandscan_running(void);
+
+/**
+ * POST /api/bandscan/start
+ * 请求体 (均可省略):
+ *   {"candidates":[["N78"],["N41"],["FDD_03","TDD_40"]],  默认每个支持的频段单独一组
+ *    "settle_sec":10, "samples":3, "interval_ms":2000,
+ *    "probe_url":"http://...", "probe_sec":10,             提供 probe_url 时测速
+ *    "apply":true}                                         false 时扫描后恢复原锁定
+ */
+void handle_bandscan_start(struct mg_connection *c, struct mg_http_message *hm);
+
+/**
+ * POST /api/bandscan/cancel
+ * 请求取消 (当前步骤结束后恢复原锁定)
+ */
+void handle_bandscan_cancel(struct mg_connection *c, struct mg_http_message *hm);
+
+/**
+ * GET /api/bandscan
+ * 任务状态、进度及每个候选组合的测量结果和排名
+ */
+void handle_bandscan_status(struct mg_connection *c, struct mg_http_message *hm);
+
+#endif /* BANDSCAN_H */
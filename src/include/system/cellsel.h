@@ -0,0 +1,60 @@
+/**
+ * @file cellsel.h
+ * @brief 小区选择: 邻区测量汇总、排名及自动锁小区
+ *
+ * 后台线程每 interval_sec 秒查询一次服务小区和邻区 (与 /api/cells 同源)，
+ * 每个小区 (制式 + ARFCN + PCI) 保留最近 window 轮的测量，按以下评分排名:
+ *
+ *   score = w_sinr × SINR均值 + w_rsrp × (RSRP均值 + 140) - w_stability × SINR标准差
+ *
+ * 采样数不足 min_samples 的小区不参与排名。
+ * 开启 auto_lock 后锁定排名第一的小区；已锁定小区的 SINR/RSRP 低于所在制式的门限
+ * (degrade_*_4g / degrade_*_5g，NR SS-RSRP 通常比 LTE RSRP 低) 或丢失服务
+ * 连续 degrade_count 轮时解锁，
+ * 该小区在 holdoff_sec 秒内不再被选中，随后按新的排名重新选择。
+ * 引擎只解除自己设置的锁定；自动锁定期间手动锁/解锁小区接口返回 409。
+ */
+
+#ifndef CELLSEL_H
+#define CELLSEL_H
+
+#include "mongoose.h"
+
+/* 跟踪的小区数量上限 */
+#define CELLSEL_MAX_TRACKED 32
+
+/* 测量窗口上限 (轮) */
+#define CELLSEL_WINDOW_MAX 60
+
+/* 解锁后暂不选择的小区数量上限 */
+#define CELLSEL_MAX_HOLDOFF 8
+
+/**
+ * 初始化: 从数据库加载配置，已启用时启动采样线程
+ * @return 0成功
+ */
+int cellsel_init(void);
+
+/**
+ * 是否由引擎自动锁小区 (手动锁/解锁接口据此拒绝请求)
+ * @return 1 是, 0 否
+ */
+int cellsel_auto_lock_enabled(void);
+
+/**
+ * GET /api/cellsel
+ * 配置、锁定状态及小区排名
+ */
+void handle_cellsel_status(struct mg_connection *c, struct mg_http_message *hm);
+
+/**
+ * POST /api/cellsel
+ * 修改配置 (字段均可省略):
+ *   {"enabled":true, "auto_lock":false, "interval_sec":10, "window":12, "min_samples":6,
+ *    "w_sinr":1.0, "w_rsrp":0.25, "w_stability":0.5,
+ *    "degrade_sinr_4g":0, "degrade_rsrp_4g":-115, "degrade_sinr_5g":0, "degrade_rsrp_5g":-110,
+ *    "degrade_count":3, "holdoff_sec":600}
+ */
+void handle_cellsel_config(struct mg_connection *c, struct mg_http_message *hm);
+
+#endif /* CELLSEL_H */
@@ -31,6 +31,14 @@ void charge_get_battery_status(int *capacity, int *charging);
 typedef void (*battery_change_callback_t)(int capacity, int charging);
 void charge_register_callback(battery_change_callback_t callback);
 
+/**
+ * @brief 判断 uevent 消息是否为电池事件 (内部使用，导出供基准测试)
+ * @param buf uevent 消息 ('\0' 分隔的 KEY=VALUE 序列)
+ * @param len 消息长度
+ * @return 1 是, 0 否
+ */
+int is_battery_event(const char *buf, int len);
+
 #ifdef __cplusplus
 }
 #endif
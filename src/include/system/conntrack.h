@@ -0,0 +1,64 @@
+/**
+ * @file conntrack.h
+ * @brief 连接跟踪表查看: 通过 ctnetlink 维护按客户端/协议的连接汇总，并分页查询连接
+ *
+ * 默认关闭。后台线程订阅 ctnetlink 的 NEW/DESTROY 事件，实时增减各客户端
+ * (原方向源地址) 和各协议的连接数 (销毁只减连接数)；每 resync_sec 秒做一次
+ * 完整 dump 重建汇总，刷新字节计数，事件套接字溢出时立即重建。
+ * dump 期间的事件在套接字中排队，重建后按内核连接 ID 与 dump 结果去重再应用。
+ * UPDATE 事件只在状态变化时发送、不随流量发送，
+ * 因此字节计数是上次 dump 时的值，最多滞后 resync_sec 秒。
+ * 字节计数需要内核 nf_conntrack_acct，只有配置 accounting 时才会修改该 sysctl。
+ * 汇总存放在固定大小的表中，超出 CONNTRACK_MAX_CLIENTS 的客户端计入 others。
+ *
+ * 同一次 dump 同时保存连接快照 (最多 CONNTRACK_MAX_FLOWS 条，双缓冲交换)，
+ * 分页查询只在快照中过滤，不在 HTTP 事件循环中访问 netlink；
+ * 快照反映上次 dump 时的连接表 (updated)，超出上限的连接不在快照中 (truncated)。
+ */
+
+#ifndef CONNTRACK_H
+#define CONNTRACK_H
+
+#include "mongoose.h"
+
+/* 汇总表中单独统计的客户端数量上限 */
+#define CONNTRACK_MAX_CLIENTS 128
+
+/* 单次查询返回的连接数上限 (按字节排序时为 offset+limit 的上限) */
+#define CONNTRACK_MAX_PAGE 200
+
+/* 连接快照保存的连接数上限 */
+#define CONNTRACK_MAX_FLOWS 4096
+
+/* netlink 接收缓冲区大小 */
+#define CONNTRACK_RECV_SIZE (32 * 1024)
+
+/**
+ * 初始化: 从数据库加载配置，已启用时启动汇总线程
+ * @return 0成功
+ */
+int conntrack_init(void);
+
+/**
+ * GET /api/conntrack?top=N
+ * 内核连接数/上限、按协议的连接数和字节、按字节排序的前 N 个客户端
+ * 连接数实时更新；字节为 state.last_resync 时的计数 (最多滞后 resync_sec 秒)
+ */
+void handle_conntrack_summary(struct mg_connection *c, struct mg_http_message *hm);
+
+/**
+ * POST /api/conntrack
+ * {"enabled":true, "accounting":false, "resync_sec":30}
+ * accounting 为 true 时允许打开内核 nf_conntrack_acct (全局设置，关闭后不恢复)
+ */
+void handle_conntrack_config(struct mg_connection *c, struct mg_http_message *hm);
+
+/**
+ * GET /api/conntrack/flows?client=IP&proto=tcp&port=443&sort=bytes&offset=0&limit=50
+ * 条件均可选: client 匹配原方向源地址，port 匹配原方向源或目的端口，
+ * sort=bytes 按双向字节降序，否则按内核顺序；total 为快照中匹配的连接总数，
+ * updated 为快照时间；未启用时返回 400
+ */
+void handle_conntrack_flows(struct mg_connection *c, struct mg_http_message *hm);
+
+#endif /* CONNTRACK_H */
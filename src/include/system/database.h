@@ -120,6 +120,24 @@ int config_get(const char *key, char *value, size_t value_size);
  */
 int config_set(const char *key, const char *value);
 
+/**
+ * 获取可为空的配置值（字符串），与 config_set_optional 配对使用
+ * @param key 配置键名
+ * @param value 输出值缓冲区
+ * @param value_size 缓冲区大小
+ * @param default_val 未配置时的默认值
+ * @return 0
+ */
+int config_get_optional(const char *key, char *value, size_t value_size, const char *default_val);
+
+/**
+ * 设置可为空的配置值（数据库不保存空值，空字符串存为 none）
+ * @param key 配置键名
+ * @param value 配置值，可为空字符串
+ * @return 0成功, -1失败
+ */
+int config_set_optional(const char *key, const char *value);
+
 /**
  * 获取配置值（整数）
  * @param key 配置键名
@@ -0,0 +1,96 @@
+/**
+ * @file dualsim.h
+ * @brief 双卡槽状态常驻缓存: modem 代理、属性镜像、SIM 身份及切卡计时
+ *
+ * 启动时为 /ril_0 和 /ril_1 各建立一个 org.ofono.Modem 代理，并通过
+ * PropertyChanged 信号持续镜像两个卡槽的 Modem / SimManager /
+ * NetworkRegistration / RadioSettings 属性及数据连接状态，
+ * IMSI、ICCID、运营商按卡槽缓存。当前数据卡由 Manager.DataCard 信号维护，
+ * 切卡时只切换活动卡槽，不再重建代理或重新订阅信号。
+ *
+ * 每次切卡记录切卡本身的耗时 (switch_ms) 以及从开始切卡到新卡槽
+ * 数据连接激活的时间 (data_up_ms)。
+ */
+
+#ifndef DUALSIM_H
+#define DUALSIM_H
+
+#include <gio/gio.h>
+#include "mongoose.h"
+
+/* 卡槽数量 */
+#define DUALSIM_SLOTS 2
+
+/* 保留的切卡记录数 */
+#define DUALSIM_HISTORY 8
+
+/* 切卡后等待数据连接激活的上限 (秒)，超时记为 timeout */
+#define DUALSIM_DATA_UP_TIMEOUT_SEC 120
+
+/* 单个卡槽的镜像状态 */
+typedef struct {
+    char slot[8];               /* slot1 / slot2 */
+    char path[16];              /* /ril_0 / /ril_1 */
+    int available;              /* modem 对象存在 */
+    int online;
+    int sim_present;
+    char iccid[24];
+    char imsi[20];
+    char carrier[32];           /* 由 IMSI 推断 */
+    char spn[48];               /* SIM 卡中的运营商名称 */
+    char reg_status[24];        /* NetworkRegistration.Status */
+    char technology[16];        /* NetworkRegistration.Technology */
+    char operator_name[48];     /* NetworkRegistration.Name */
+    char mode[32];              /* RadioSettings.TechnologyPreference */
+    int data_active;            /* internet 上下文 Active */
+    char context_path[64];      /* internet 上下文路径 */
+} DualSimSlot;
+
+/**
+ * 初始化: 创建两个卡槽的代理，加载属性并订阅信号
+ * @return 0 成功, -1 失败
+ */
+int dualsim_init(void);
+
+/**
+ * 当前数据卡槽 (缓存)
+ * @param slot 输出 slot1/slot2 (至少 16 字节)
+ * @param ril_path 输出 /ril_0 或 /ril_1 (至少 32 字节)
+ * @return 0 成功, -1 缓存尚未就绪
+ */
+int dualsim_get_active(char *slot, char *ril_path);
+
+/**
+ * 按 modem 路径取常驻的 org.ofono.Modem 代理
+ * @return 增加了引用计数的代理 (调用方 g_object_unref)，无可用代理时返回 NULL
+ */
+GDBusProxy *dualsim_modem_proxy(const char *modem_path);
+
+/**
+ * 复制卡槽镜像
+ * @param modem_path 卡槽路径
+ * @param out 输出
+ * @return 0 成功, -1 路径无效或缓存未就绪
+ */
+int dualsim_get_slot(const char *modem_path, DualSimSlot *out);
+
+/**
+ * 切卡开始: 记录起始时间
+ * @param target_path 目标卡槽路径
+ */
+void dualsim_switch_begin(const char *target_path);
+
+/**
+ * 切卡结束: 成功时把活动卡槽切换到目标卡槽，并记录切卡耗时
+ * @param ok 1 成功, 0 失败
+ * @return 本次切卡耗时 (毫秒)
+ */
+long dualsim_switch_end(int ok);
+
+/**
+ * GET /api/switch
+ * 当前卡槽、两个卡槽的镜像状态及最近的切卡耗时
+ */
+void handle_dualsim_status(struct mg_connection *c, struct mg_http_message *hm);
+
+#endif /* DUALSIM_H */
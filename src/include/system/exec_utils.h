@@ -45,6 +45,13 @@ void device_reboot(void);
  */
 void device_poweroff(void);
 
+/**
+ * @brief 检查网络接口名是否只含字母、数字和 ._- (可安全拼入命令参数)
+ * @param name 接口名 (空字符串视为有效，长度由调用方检查)
+ * @return 1 有效, 0 无效
+ */
+int valid_ifname(const char *name);
+
 /**
  * @brief 清除系统缓存
  * @return 0 成功, -1 失败
@@ -0,0 +1,67 @@
+/**
+ * @file handoff.h
+ * @brief 监听套接字交接 (平滑升级/重启)
+ *
+ * 运行中的进程收到 SIGUSR2 后原地重新执行自身的可执行文件 (OTA 替换后即为新版本)，
+ * PID 不变，仍由原来的监管进程 (procd/init 脚本) 管理:
+ *
+ *   1. 复制各监听 fd 后关闭监听连接: 套接字保持打开，新连接留在内核队列中
+ *   2. 等待已接受的连接处理完成 (最多 HANDOFF_DRAIN_TIMEOUT_MS)
+ *   3. 把监听 fd 和需要延续的模块状态写入环境变量，execve 自身
+ *   4. 新映像按正常流程初始化各模块 (此时旧映像的线程、D-Bus 订阅均已随 exec 消失)，
+ *      就绪后接管继承的监听 fd 开始 accept
+ *
+ * 监听套接字始终处于打开状态，整个过程中不会出现连接被拒绝，只是排队直到新映像就绪。
+ * HTTP、HTTPS 监听均交接；IPv6 代理的规则子进程不受 exec 影响，新映像按 PID 接管。
+ * execve 失败时进程正常退出，由监管进程重启。
+ */
+
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+/* 传递给新映像的环境变量 (均以 HANDOFF_ENV_PREFIX 开头) */
+#define HANDOFF_ENV_PREFIX "OFONO_HANDOFF_"
+#define HANDOFF_ENV_HTTP_FD "OFONO_HANDOFF_HTTP_FD"
+#define HANDOFF_ENV_HTTPS_FD "OFONO_HANDOFF_HTTPS_FD"
+#define HANDOFF_ENV_IPV6_PROXY "OFONO_HANDOFF_IPV6_PROXY"
+
+/* 最多传递的交接变量数 */
+#define HANDOFF_MAX_VARS 8
+
+/* 排空已接受连接的最长时间 */
+#define HANDOFF_DRAIN_TIMEOUT_MS 10000
+
+/**
+ * 读取并清除交接环境变量 (进程启动时在创建任何线程之前调用)
+ */
+void handoff_init(void);
+
+/**
+ * 本进程是否由交接重新执行启动
+ */
+int handoff_resumed(void);
+
+/**
+ * 取出继承的交接变量值
+ * @param name 变量名 (如 HANDOFF_ENV_IPV6_PROXY)
+ * @return 值，不存在返回NULL
+ */
+const char *handoff_get(const char *name);
+
+/**
+ * 取出继承的监听 fd (每个变量只能取出一次)
+ * @param name 变量名 (HANDOFF_ENV_HTTP_FD / HANDOFF_ENV_HTTPS_FD)
+ * @return 监听 fd，不存在或不是监听套接字返回-1
+ */
+int handoff_take_listen_fd(const char *name);
+
+/**
+ * 原地重新执行当前可执行文件
+ * @param keep_fds 需跨越 exec 保留的 fd
+ * @param keep_count fd 数量
+ * @param env 追加的环境变量 ("NAME=value"，NULL 结尾)
+ * @return 仅在失败时返回-1
+ */
+int handoff_exec(const int *keep_fds, int keep_count, char *const env[]);
+
+#endif /* HANDOFF_H */
@@ -155,6 +155,14 @@ int ipv6_proxy_stop(void);
  */
 int ipv6_proxy_restart(void);
 
+/**
+ * 导出运行中的规则子进程，供原地重新执行后的新映像接管 (见 handoff.h)
+ * @param buf 输出 "规则ID:PID,规则ID:PID"
+ * @param size 缓冲区大小
+ * @return 导出的子进程数
+ */
+int ipv6_proxy_handoff_state(char *buf, size_t size);
+
 /**
  * 获取服务状态
  * @param status 输出状态结构
@@ -0,0 +1,112 @@
+/**
+ * @file log.h
+ * @brief 分级日志模块头文件
+ *
+ * - 编译期级别: LOG_COMPILE_LEVEL (全局) / LOG_FILE_LEVEL (单个源文件可重定义)，
+ *   高于该级别的调用在编译期被消除
+ * - 运行期级别: 按模块 (源文件名，如 "ofono"、"sms") 设置，未启用时不求值参数、不格式化
+ * - 输出: 无锁环形缓冲区，时间戳/级别/模块前缀在读取时才拼接；
+ *   后台线程异步刷写到 stdout (默认)、文件或 syslog，配置为 none 时只保留在缓冲区
+ *
+ * 旧代码中的 printf 经 debug.h 映射到本模块，固定为 INFO 级别。
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+
+/* debug.h 强制包含本头文件，这里不依赖 mongoose.h */
+struct mg_connection;
+struct mg_http_message;
+
+/* 日志级别 (数值越大越详细) */
+#define LOGLVL_ERROR 0
+#define LOGLVL_WARN  1
+#define LOGLVL_INFO  2
+#define LOGLVL_DEBUG 3
+
+/* 编译期全局级别，高于此级别的日志调用被编译消除 */
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOGLVL_DEBUG
+#endif
+
+/* 编译期文件级别，源文件可 #undef 后重定义 */
+#define LOG_FILE_LEVEL LOG_COMPILE_LEVEL
+
+/* 运行期默认级别 (配置项 log_level) */
+#define LOG_RUNTIME_DEFAULT LOGLVL_INFO
+
+/* 环形缓冲区条目数 (必须是2的幂) 与单条消息最大长度 */
+#define LOG_RING_SIZE 512
+#define LOG_MSG_LEN 200
+
+/* 最大模块数 */
+#define LOG_MAX_MODULES 64
+
+/* 调用点信息 (每个日志调用点一个静态实例) */
+typedef struct {
+    const char *file;   /* __FILE__ */
+    int module;         /* 模块ID，-1 表示尚未解析 */
+} LogSite;
+
+/**
+ * 初始化日志模块：读取运行期级别与输出配置，按需启动异步刷写线程
+ * (数据库就绪后调用；此前使用默认级别，日志仍进入环形缓冲区)
+ */
+void log_init(void);
+
+/**
+ * 停止异步刷写线程并刷写剩余日志
+ */
+void log_shutdown(void);
+
+/**
+ * 判断调用点在运行期是否启用该级别 (首次调用时解析模块)
+ */
+int log_enabled(LogSite *site, int level);
+
+/**
+ * 写入一条日志 (级别未启用时直接返回，不格式化)
+ */
+void log_write(LogSite *site, int level, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/**
+ * 设置模块运行期级别
+ * @param module 模块名 (NULL 或 "*" 表示所有模块及默认级别)
+ * @param level 级别
+ * @return 0成功，-1失败
+ */
+int log_set_level(const char *module, int level);
+
+/**
+ * 级别名称转换
+ * @return 级别值，无法识别返回-1
+ */
+int log_level_from_name(const char *name);
+const char *log_level_name(int level);
+
+/* ==================== 日志宏 ==================== */
+
+#define LOG_AT(level, ...)                                                   \
+    do {                                                                     \
+        if ((level) <= LOG_FILE_LEVEL) {                                     \
+            static LogSite _log_site = {__FILE__, -1};                       \
+            if (log_enabled(&_log_site, (level)))                            \
+                log_write(&_log_site, (level), __VA_ARGS__);                 \
+        }                                                                    \
+    } while (0)
+
+#define LOG_E(...) LOG_AT(LOGLVL_ERROR, __VA_ARGS__)
+#define LOG_W(...) LOG_AT(LOGLVL_WARN, __VA_ARGS__)
+#define LOG_I(...) LOG_AT(LOGLVL_INFO, __VA_ARGS__)
+#define LOG_D(...) LOG_AT(LOGLVL_DEBUG, __VA_ARGS__)
+
+/* 旧 printf 调用点 (由 debug.h 映射)，按 INFO 级别记录 */
+#define LOG_PRINTF(...) LOG_AT(LOGLVL_INFO, __VA_ARGS__)
+
+/* HTTP API处理函数 */
+void handle_logs(struct mg_connection *c, struct mg_http_message *hm);
+
+#endif /* LOG_H */
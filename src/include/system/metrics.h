@@ -0,0 +1,122 @@
+/**
+ * @file metrics.h
+ * @brief HTTP 路由级延迟/吞吐量指标模块头文件
+ *
+ * 每条路由一个固定大小的槽位，记录请求数、状态码分类、请求/响应字节数
+ * 以及 HDR 风格的对数-线性延迟直方图。记录路径只做整数累加，
+ * 所有格式化工作都推迟到 /api/metrics 被拉取时进行。
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "mongoose.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* 最大路由槽位数量 */
+#define METRICS_MAX_ROUTES 160
+
+/* 直方图每个 2 的幂区间细分的子桶数 (2^METRICS_HIST_SUB_BITS) */
+#define METRICS_HIST_SUB_BITS 4
+#define METRICS_HIST_SUB (1 << METRICS_HIST_SUB_BITS)
+
+/* 直方图桶数量: 覆盖 0 ~ 2^32 微秒 (约71分钟)，超出部分计入最后一个桶 */
+#define METRICS_HIST_BUCKETS ((32 - METRICS_HIST_SUB_BITS + 1) * METRICS_HIST_SUB)
+
+/* 对数-线性延迟直方图 (单位: 微秒，相对误差 < 6.25%) */
+typedef struct {
+    uint32_t buckets[METRICS_HIST_BUCKETS];
+    uint64_t count;         /* 样本数 */
+    uint64_t sum;           /* 样本总和 */
+    uint64_t max;           /* 最大样本 */
+} LatencyHist;
+
+/* 单条路由的指标 */
+typedef struct {
+    const char *name;       /* 路由名称 (指向静态字符串) */
+    uint64_t status[6];     /* 按状态码分类计数: [1]=1xx ... [5]=5xx, [0]=其他 */
+    uint64_t req_bytes;     /* 请求字节数 (含请求头) */
+    uint64_t resp_bytes;    /* 响应字节数 (含响应头) */
+    LatencyHist latency;    /* 处理耗时直方图 */
+    uint64_t arena_allocs;  /* 请求内存池分配次数 */
+    uint64_t arena_bytes;   /* 请求内存池分配字节数 */
+    uint32_t arena_peak;    /* 单个请求最大内存池用量 (字节) */
+} RouteMetrics;
+
+/* ==================== 直方图 ==================== */
+
+/**
+ * 记录一个样本
+ * @param h 直方图
+ * @param value 样本值 (微秒)
+ */
+void metrics_hist_record(LatencyHist *h, uint64_t value);
+
+/**
+ * 计算分位数 (返回所在桶的上界，不超过最大样本)
+ * @param h 直方图
+ * @param q 分位数 (0.0 ~ 1.0)
+ * @return 分位数值 (微秒)，无样本返回0
+ */
+uint64_t metrics_hist_percentile(const LatencyHist *h, double q);
+
+/**
+ * 获取桶的上界 (不含)
+ * @param idx 桶索引
+ * @return 上界值 (微秒)
+ */
+uint64_t metrics_hist_bucket_upper(int idx);
+
+/* ==================== 路由指标 ==================== */
+
+/**
+ * 获取单调时钟 (微秒)
+ */
+uint64_t metrics_now_us(void);
+
+/**
+ * 注册路由槽位 (启动时调用，同名路由返回同一槽位)
+ * @param name 路由名称 (必须是静态字符串)
+ * @return 槽位索引，槽位已满返回-1
+ */
+int metrics_register_route(const char *name);
+
+/**
+ * 记录一次请求
+ * @param slot 槽位索引 (metrics_register_route 返回值)
+ * @param status HTTP 状态码
+ * @param req_bytes 请求字节数
+ * @param resp_bytes 响应字节数
+ * @param elapsed_us 处理耗时 (微秒)
+ */
+void metrics_record(int slot, int status, size_t req_bytes, size_t resp_bytes,
+                    uint64_t elapsed_us);
+
+/**
+ * 记录一次请求的内存池用量
+ * @param slot 槽位索引
+ * @param allocs 分配次数
+ * @param bytes 分配字节数 (即本次请求峰值，内存池只增不减)
+ */
+void metrics_record_arena(int slot, size_t allocs, size_t bytes);
+
+/**
+ * 从发送缓冲区解析响应状态码
+ * @param buf 响应起始位置 ("HTTP/1.1 200 OK...")
+ * @param len 可用长度
+ * @return 状态码，无法解析返回0
+ */
+int metrics_parse_status(const char *buf, size_t len);
+
+/**
+ * 追加格式化文本到缓冲区 (Prometheus 文本导出共用，单行超过 511 字节时截断)
+ * @param io 输出缓冲区
+ * @param fmt printf 格式
+ */
+void metrics_appendf(struct mg_iobuf *io, const char *fmt, ...);
+
+/* HTTP API处理函数 */
+void handle_metrics(struct mg_connection *c, struct mg_http_message *hm);
+
+#endif /* METRICS_H */
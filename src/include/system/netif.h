@@ -74,6 +74,16 @@ void init_netif(void);
  */
 int netif_get_list(NetInterface *interfaces, int max_count);
 
+/**
+ * 解析 ifconfig 输出 (内部使用，导出供基准测试)
+ * @param output ifconfig 输出文本
+ * @param interfaces 接口数组
+ * @param max_count 最大数量
+ * @return 解析出的接口数量
+ */
+int parse_ifconfig_output(const char *output, NetInterface *interfaces,
+                          int max_count);
+
 /**
  * 获取指定接口的实时流量统计
  * @param ifname 接口名称
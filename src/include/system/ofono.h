@@ -148,6 +148,8 @@ typedef struct {
 
 /**
  * 获取所有 APN Context 列表
+ * 列表按 modem 缓存，由 ContextAdded/ContextRemoved/PropertyChanged 信号维护，
+ * 仅首次访问某个 modem 时查询 oFono
  * @param contexts 输出 context 数组
  * @param max_count 数组最大容量
  * @return 成功返回 context 数量，失败返回负数错误码
@@ -163,8 +165,21 @@ int ofono_get_all_apn_contexts(ApnContext *contexts, int max_count);
  */
 int ofono_set_apn_property(const char *context_path, const char *property, const char *value);
 
+/**
+ * 并发设置 context 的多个字符串属性
+ * 已是目标值的属性不发送；其余同时发出，全部应答后返回
+ * @param context_path context 的 D-Bus 路径
+ * @param names 属性名数组
+ * @param values 属性值数组
+ * @param count 属性数量 (不超过 8)
+ * @return 全部成功返回0，否则返回错误码
+ */
+int ofono_set_context_properties(const char *context_path, const char *const *names,
+                                 const char *const *values, int count);
+
 /**
  * 批量设置 APN 属性
+ * 属性均已是目标值时直接返回，否则断开数据连接后并发写入有变化的属性再重新连接
  * @param context_path context 的 D-Bus 路径
  * @param apn APN 名称 (NULL 表示不修改)
  * @param protocol 协议 (NULL 表示不修改)
@@ -218,6 +233,14 @@ int ofono_get_network_status(char *status, int size);
  */
 int ofono_check_and_restore_data(char *result, int size);
 
+/**
+ * 暂停/恢复数据连接自动恢复 (可嵌套，每次暂停需对应一次恢复)
+ * 暂停期间 ofono_check_and_restore_data 不做任何操作，
+ * 供需要先断开数据连接再统一恢复的调用方使用
+ * @param hold 1=暂停，0=恢复
+ */
+void ofono_hold_data_restore(int hold);
+
 /**
  * 启动数据连接 Watchdog 线程
  * 后台定时检查数据连接状态，断开时自动重连
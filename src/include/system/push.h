@@ -0,0 +1,65 @@
+/**
+ * @file push.h
+ * @brief 仪表盘状态 WebSocket 推送 (增量编码)
+ *
+ * 前端先以 POST /api/ws/ticket 换取一次性票据，连接 /api/ws?ticket=<票据> 后，服务端每秒检查一次遥测缓存 (与 /api/dashboard 同源)，
+ * 只推送相对该订阅者上次已发送内容发生变化的字段:
+ *
+ *   {"type":"full","v":1,"data":{"system":{...},"radio":{...},...}}   连接建立/重新同步
+ *   {"type":"patch","v":2,"data":{"system":{"cpu_usage":12.50}}}      仅变化字段，删除的字段为 null
+ *
+ * 每个订阅者保存自己最后一次发送的完整状态，发送缓冲区积压时跳过本轮，
+ * 下一轮的增量自然包含期间的全部变化。断线重连即获得完整快照；
+ * 客户端也可发送文本 "resync" 主动请求完整快照。
+ * 相比每秒重发完整状态节省的字节数见 /api/push。
+ */
+
+#ifndef PUSH_H
+#define PUSH_H
+
+#include "mongoose.h"
+
+/* 推送检查间隔 (毫秒) */
+#define PUSH_INTERVAL_MS 1000
+
+/* 最大订阅者数量 */
+#define PUSH_MAX_SUBSCRIBERS 8
+
+/* 订阅者发送缓冲区积压超过该值时跳过本轮推送 */
+#define PUSH_MAX_BACKLOG (64 * 1024)
+
+/**
+ * 推送定时检查 (在事件循环中每轮调用)
+ */
+void push_poll(void);
+
+/**
+ * WebSocket 连接事件处理 (HTTP/HTTPS 监听器的事件函数中调用)
+ * 处理 MG_EV_WS_MSG (客户端请求重新同步) 和 MG_EV_CLOSE (移除订阅者)
+ * @param c 连接
+ * @param ev 事件
+ * @param ev_data 事件数据
+ */
+void push_on_event(struct mg_connection *c, int ev, void *ev_data);
+
+/**
+ * GET /api/ws
+ * 校验一次性票据 (查询参数 ticket) 或 Authorization 头中的会话令牌，
+ * 通过后升级为 WebSocket 并发送完整快照
+ */
+void handle_push_ws(struct mg_connection *c, struct mg_http_message *hm);
+
+/**
+ * POST /api/ws/ticket
+ * 签发 WebSocket 连接票据，响应 {"ticket":"...","expires_in":30}；
+ * 票据只能使用一次，会话令牌不出现在连接地址中
+ */
+void handle_push_ticket(struct mg_connection *c, struct mg_http_message *hm);
+
+/**
+ * GET /api/push
+ * 推送统计: 订阅者数、消息数、实际发送字节与完整重发相比节省的字节
+ */
+void handle_push_stats(struct mg_connection *c, struct mg_http_message *hm);
+
+#endif /* PUSH_H */
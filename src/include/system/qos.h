@@ -0,0 +1,63 @@
+/**
+ * @file qos.h
+ * @brief 热点客户端带宽整形: HTB 按客户端限速 + 叶子队列公平排队
+ *
+ * 下行在 LAN 接口出方向整形，上行把 LAN 入方向重定向到 IFB 设备后在其出方向整形
+ * (NAT 之后 WAN 口已无法区分客户端)，WAN 接口出方向再按总上行速率做一层整形，
+ * 把排队留在本机的公平队列中而不是 modem 的缓冲区里:
+ *
+ *   LAN/IFB:  1: htb default fff
+ *             └─ 1:1      总速率 (down_kbit / up_kbit)
+ *                ├─ 1:10+i  客户端 i，ceil=客户端限速，叶子 fq_codel，u32 按目的/源 IP 分类
+ *                └─ 1:fff   未列出的客户端
+ *   WAN:      1: htb default 1 ─ 1:1 总上行速率，叶子 fq_codel
+ *
+ * 所有类的保证速率和 quantum 相同，空闲带宽在有积压的客户端之间平分。
+ *
+ * 修改按差异增量下发: 只对新增/变化/删除的客户端执行 class/filter 的
+ * replace/del，整棵树只在首次启用、接口变化或根队列丢失 (接口被重建) 时创建，
+ * 一次应用的全部命令写入 mkstemp 创建的临时批处理文件，由一次 tc -batch 执行。
+ * 接口名均可配置，可在网络命名空间中用 veth/ifb 设备测试。
+ */
+
+#ifndef QOS_H
+#define QOS_H
+
+#include "mongoose.h"
+
+/* 单独限速的客户端数量上限 */
+#define QOS_MAX_CLIENTS 32
+
+/* 每个类的保证速率 (kbit)，超出部分按 quantum 平分 */
+#define QOS_GUARANTEE_KBIT 128
+
+/* 未设置总速率时使用的上限 (kbit)，此时只有客户端限速生效 */
+#define QOS_UNLIMITED_KBIT 10000000
+
+/* tc 批处理文件模板 (mkstemp)，执行后删除 */
+#define QOS_BATCH_TEMPLATE "/tmp/qos.tc.XXXXXX"
+
+/**
+ * 初始化: 从数据库加载配置，已启用时下发整形规则
+ * @return 0成功
+ */
+int qos_init(void);
+
+/**
+ * GET /api/qos
+ * 配置、最近一次下发的结果 (命令数、耗时、错误) 以及每个客户端的下行/上行字节和丢包
+ */
+void handle_qos_status(struct mg_connection *c, struct mg_http_message *hm);
+
+/**
+ * POST /api/qos
+ * 请求体 (均可选，clients 给出时替换整个列表):
+ *   {"enabled":true, "lan_iface":"br0", "wan_iface":"sipa_eth0", "ifb_iface":"ifb0",
+ *    "down_kbit":100000, "up_kbit":20000, "leaf":"fq_codel",
+ *    "clients":[{"ip":"192.168.0.10","down_kbit":5000,"up_kbit":1000}]}
+ * leaf 可选 fq_codel / cake / sfq / pfifo；ifb_iface 为空时不做按客户端的上行整形；
+ * 客户端限速为 0 表示不限速 (仍参与公平分配)
+ */
+void handle_qos_config(struct mg_connection *c, struct mg_http_message *hm);
+
+#endif /* QOS_H */
@@ -0,0 +1,59 @@
+/**
+ * @file radiocfg.h
+ * @brief 射频配置事务: 网络模式、频段锁定、小区锁定、APN 一次性应用
+ *
+ * 单独调用 /api/set_network、/api/lock_bands、/api/lock_cell、APN 接口时，
+ * 每个接口各自断开重连，三项修改就是三次掉线。本接口接收期望的最终状态，
+ * 与当前状态比较后只执行有变化的步骤，并按以下顺序合并为至多一次射频关开:
+ *
+ *   data_down  断开数据连接 (APN 或射频需要变化且连接已激活时)
+ *   radio_off  AT+SFUN=5 (频段或小区锁定变化时)
+ *   bands      AT+SPLBAND 写入 4G/5G 位掩码
+ *   cell       AT+SPFORCEFRQ 清除/锁定小区
+ *   apn        仅写入有变化的 ConnectionContext 属性
+ *   mode       RadioSettings.TechnologyPreference (射频关闭期间写入，重新注册与本次关开合并)
+ *   radio_on   AT+SFUN=4 + AT+CGACT=0,1
+ *   data_up    重新激活数据连接并等待 Active=true
+ *
+ * 从第一个中断连接的步骤开始到数据连接恢复的时间记为 downtime_ms。
+ * 事务执行期间暂停数据连接自动恢复，避免在 APN 写入前被提前激活。
+ * 模块不支持查询小区锁定，cell 与本进程最近一次写入的锁定比较；
+ * 进程启动后尚未写入过时无法判断，请求中给出 cell 时总是执行。
+ */
+
+#ifndef RADIOCFG_H
+#define RADIOCFG_H
+
+#include "mongoose.h"
+
+/* 单个事务的最大步骤数 */
+#define RADIOCFG_MAX_OPS 8
+
+/* 等待数据连接恢复的超时 (秒) */
+#define RADIOCFG_RECONNECT_TIMEOUT_SEC 60
+
+/**
+ * 事务是否正在执行
+ * @return 1 执行中, 0 空闲
+ */
+int radiocfg_running(void);
+
+/**
+ * POST /api/radio/apply
+ * 请求体 (除 dry_run 外至少给出一项):
+ *   {"mode":"nr_5g_lte_auto",
+ *    "bands":["N78","FDD_03"],                      空数组=解除频段锁定
+ *    "cell":{"technology":"5G","arfcn":627264,"pci":356},   null=解除小区锁定
+ *    "apn":{"template_id":2} 或 {"apn":"cmnet","protocol":"dual",...},
+ *    "dry_run":false}                               true 时只返回执行计划
+ * 返回执行计划，事务在后台执行，结果见 GET /api/radio/apply
+ */
+void handle_radio_apply(struct mg_connection *c, struct mg_http_message *hm);
+
+/**
+ * GET /api/radio/apply
+ * 最近一次事务的状态、每个步骤的结果和耗时、射频关开次数及掉线时长
+ */
+void handle_radio_apply_status(struct mg_connection *c, struct mg_http_message *hm);
+
+#endif /* RADIOCFG_H */
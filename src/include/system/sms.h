@@ -52,13 +52,17 @@ void sms_deinit(void);
  */
 int sms_send(const char *recipient, const char *content, char *result_path, size_t path_size);
 
+/* 短信遍历回调 (msg 仅在回调期间有效) */
+typedef void (*SmsListCallback)(const SmsMessage *msg, void *ctx);
+
 /**
- * 获取短信列表
- * @param messages 输出数组
+ * 遍历短信列表 (按ID倒序，逐条回调，不保留整个列表)
  * @param max_count 最大数量
- * @return 实际获取的数量, -1失败
+ * @param cb 回调函数
+ * @param ctx 回调上下文
+ * @return 实际遍历的数量, -1失败
  */
-int sms_get_list(SmsMessage *messages, int max_count);
+int sms_foreach(int max_count, SmsListCallback cb, void *ctx);
 
 /**
  * 获取短信总数
@@ -108,13 +112,17 @@ typedef struct {
     char status[32];
 } SentSmsMessage;
 
+/* 发送记录遍历回调 (msg 仅在回调期间有效) */
+typedef void (*SentSmsListCallback)(const SentSmsMessage *msg, void *ctx);
+
 /**
- * 获取发送记录列表
- * @param messages 输出数组
+ * 遍历发送记录列表 (按ID倒序，逐条回调)
  * @param max_count 最大数量
- * @return 实际获取的数量, -1失败
+ * @param cb 回调函数
+ * @param ctx 回调上下文
+ * @return 实际遍历的数量, -1失败
  */
-int sms_get_sent_list(SentSmsMessage *messages, int max_count);
+int sms_foreach_sent(int max_count, SentSmsListCallback cb, void *ctx);
 
 /**
  * 获取最大存储数量配置
@@ -184,14 +192,25 @@ typedef struct {
     time_t created_at;
 } SmsWebhookLog;
 
+/* Webhook日志遍历回调 (在日志锁内调用，log 仅在回调期间有效) */
+typedef void (*SmsWebhookLogCallback)(const SmsWebhookLog *log, void *ctx);
+
 /**
- * 获取Webhook发送日志
- * @param json_output 输出JSON字符串
- * @param size 缓冲区大小
+ * 遍历Webhook发送日志 (从最新的开始)
  * @param max_count 最大返回条数
+ * @param cb 回调函数
+ * @param ctx 回调上下文
  * @return 0成功, -1失败
  */
-int sms_get_webhook_logs(char *json_output, size_t size, int max_count);
+int sms_foreach_webhook_log(int max_count, SmsWebhookLogCallback cb, void *ctx);
+
+/**
+ * Hex 解码短信内容 (内部使用，导出供基准测试)
+ * @param hex hex 字符串
+ * @param out 输出缓冲区 (结果以 '\0' 结尾)
+ * @param out_size 输出缓冲区大小
+ */
+void hex_decode(const char *hex, char *out, size_t out_size);
 
 #ifdef __cplusplus
 }
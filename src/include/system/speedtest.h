@@ -0,0 +1,100 @@
+/**
+ * @file speedtest.h
+ * @brief 设备端吞吐量测速: 多条并行 HTTP 流测量蜂窝链路的下行/上行有效吞吐
+ *
+ * 测速在设备上直接发起 (不经过热点 Wi-Fi)，用 mongoose 客户端连接在事件循环中完成:
+ *
+ *   下行  streams 条连接并行 GET download_url，只统计响应体字节
+ *   上行  streams 条连接并行 POST upload_url (octet-stream)，统计写入套接字的请求体字节
+ *
+ * 每个方向先预热 warmup_sec 秒 (TCP 慢启动、套接字缓冲区填充)，
+ * 随后 duration_sec 秒为稳态窗口，吞吐 = 窗口内字节 / 窗口时长，
+ * 并按 SPEEDTEST_SAMPLE_MS 记录窗口内的逐段速率。服务器提前结束响应的流立即重连。
+ * 接收数据读出后直接丢弃、上传数据来自固定的随机缓冲区，不保留响应内容，
+ * 窗口内进程 CPU 占用一并记录，用于评估测速本身在设备上的开销。
+ *
+ * 兼容 LibreSpeed 一类的测速服务器 (如 garbage.php?ckSize=100 / empty.php)，
+ * loadtest/speed_server.c 为本地替身服务器。
+ * 除 speedtest_probe_download 外，所有函数在事件循环线程调用。
+ */
+
+#ifndef SPEEDTEST_H
+#define SPEEDTEST_H
+
+#include "mongoose.h"
+
+/* 并行流数量上限 */
+#define SPEEDTEST_MAX_STREAMS 16
+
+/* 稳态窗口内的采样间隔 (毫秒) */
+#define SPEEDTEST_SAMPLE_MS 500
+
+/* 稳态窗口上限 (秒) */
+#define SPEEDTEST_MAX_DURATION 60
+
+/* 逐段速率的最大采样数 */
+#define SPEEDTEST_MAX_SAMPLES (SPEEDTEST_MAX_DURATION * 1000 / SPEEDTEST_SAMPLE_MS)
+
+/* 每条流单次读取/发送缓冲区大小 */
+#define SPEEDTEST_IO_SIZE (64 * 1024)
+
+/* 单条上传请求的请求体大小 (发送完后重连) */
+#define SPEEDTEST_UPLOAD_BYTES (256ULL * 1024 * 1024)
+
+/* 后台下行测速等待事件循环接手和收尾的余量 (秒) */
+#define SPEEDTEST_PROBE_SLACK_SEC 30
+
+/**
+ * 初始化: 从数据库加载测速服务器等配置
+ * @return 0成功
+ */
+int speedtest_init(void);
+
+/**
+ * 测速状态机 (在事件循环中每轮调用): 预热/窗口切换、采样、断线重连、结束，
+ * 空闲时接手 speedtest_probe_download 的请求
+ * @param mgr 事件循环的连接管理器
+ */
+void speedtest_poll(struct mg_mgr *mgr);
+
+/**
+ * 是否正在测速
+ * @return 1 是, 0 否
+ */
+int speedtest_running(void);
+
+/**
+ * 检查测速地址: 必须为 http:// 或 https:// 且包含主机名，拒绝引号、shell 展开字符和控制字符
+ * @param url 地址
+ * @return 错误信息，地址合法或为空时返回NULL (由调用方判断是否需要)
+ */
+const char *speedtest_check_url(const char *url);
+
+/**
+ * 下行测速 (供后台线程调用，如频段扫描): 请求交给事件循环，用同一引擎执行并阻塞至结束
+ * 流数和预热时长沿用已保存的配置，稳态窗口为 seconds 秒，结束后恢复原配置；
+ * 手动测速进行中时等待其结束，超时未开始则放弃
+ * @param url 下载地址 (调用前已经 speedtest_check_url 检查)
+ * @param seconds 稳态窗口时长 (秒)
+ * @return 下行吞吐 (kbps)，失败、取消或超时返回 -1
+ */
+double speedtest_probe_download(const char *url, int seconds);
+
+/**
+ * GET /api/speedtest
+ * 配置、运行状态，以及最近一次下行/上行结果 (Mbps、窗口字节、CPU 占用、逐段速率)
+ */
+void handle_speedtest_status(struct mg_connection *c, struct mg_http_message *hm);
+
+/**
+ * POST /api/speedtest
+ * 请求体 (均可选，未给出的沿用上次配置):
+ *   {"download_url":"http://host/garbage.php?ckSize=100",
+ *    "upload_url":"http://host/empty.php",
+ *    "streams":4, "warmup_sec":2, "duration_sec":10,
+ *    "direction":"both"}           both / download / upload
+ * 或 {"cancel":true} 取消正在进行的测速
+ */
+void handle_speedtest_start(struct mg_connection *c, struct mg_http_message *hm);
+
+#endif /* SPEEDTEST_H */
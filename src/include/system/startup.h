@@ -0,0 +1,70 @@
+/**
+ * @file startup.h
+ * @brief 启动阶段计时与并行模块初始化
+ *
+ * HTTP 监听器先启动，各模块按依赖关系分组，每组在独立线程中顺序执行，
+ * 组与组之间并行。所有非后台组完成前服务处于 "warming up" 状态，
+ * 每个初始化步骤的耗时记录在内存中并写入日志，可通过 /api/startup 查看。
+ */
+
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include "mongoose.h"
+#include <stdint.h>
+
+/* 最多记录的启动步骤数 */
+#define STARTUP_MAX_PHASES 48
+
+/* 初始化步骤 (返回0成功，非0失败；失败不影响后续步骤) */
+typedef int (*StartupFn)(void);
+
+typedef struct {
+    const char *name;           /* 步骤名称 (静态字符串) */
+    StartupFn fn;
+} StartupStep;
+
+/* 初始化组: 组内步骤按顺序执行 */
+typedef struct {
+    const char *name;           /* 组名称 (静态字符串) */
+    const StartupStep *steps;
+    int count;
+    int background;             /* 1: 不计入就绪状态 (如时间同步) */
+} StartupGroup;
+
+/**
+ * 记录进程启动时间 (main 入口处调用)
+ */
+void startup_init(void);
+
+/**
+ * 同步执行一个步骤并记录耗时 (用于监听前必须完成的步骤)
+ * @param group 组名称
+ * @param step 步骤
+ * @return 步骤返回值
+ */
+int startup_run_step(const char *group, const StartupStep *step);
+
+/**
+ * 记录一个时间点 (如 "listen")，耗时为自进程启动以来的时间
+ * @param name 名称 (静态字符串)
+ */
+void startup_mark(const char *name);
+
+/**
+ * 在后台线程中并行执行各组 (groups 数组须在整个进程生命周期内有效)
+ * @param groups 组数组
+ * @param count 组数量
+ * @return 0成功，-1创建线程失败 (失败的组在当前线程中同步执行)
+ */
+int startup_run_groups(const StartupGroup *groups, int count);
+
+/**
+ * 所有非后台组是否已完成
+ */
+int startup_ready(void);
+
+/* HTTP API处理函数 */
+void handle_startup(struct mg_connection *c, struct mg_http_message *hm);
+
+#endif /* STARTUP_H */
@@ -0,0 +1,85 @@
+/**
+ * @file telemetry.h
+ * @brief 设备遥测缓存与 Prometheus/OpenMetrics 导出
+ *
+ * 各模块在正常工作路径上把最新的无线/数据连接状态写入缓存，
+ * 后台定时器只读取 /proc、/sys 等廉价来源，并按较低频率在独立线程中刷新无线参数；
+ * /metrics 拉取时只读内存，不触发任何 AT 或 D-Bus 调用。
+ * 导出的标签含卡槽与服务小区标识，/metrics 需要携带抓取令牌
+ * (Authorization: Bearer，见 auth.h)，校验只比较内存副本，不访问数据库。
+ *
+ * /api/dashboard 以 JSON 返回同一份缓存，供系统监控页一次请求渲染整页。
+ * 每个数据段带 age (秒) 和 source (timer/event/refresh) 标签，
+ * 请求带 max_age 时只对早于该值的数据段重新采样。
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "advanced.h"
+#include "mongoose.h"
+
+/* 后台采样周期 (秒): CPU、流量、温度、电池 */
+#define TELEMETRY_TICK_SEC 5
+
+/* 无线参数后台刷新间隔默认值 (秒)，配置项 telemetry_radio_interval，0=仅被动更新 */
+#define TELEMETRY_RADIO_INTERVAL_DEFAULT 60
+
+/* 导出的网络接口最大数量 */
+#define TELEMETRY_MAX_IFACES 16
+
+/**
+ * 初始化遥测模块 (启动后台采样定时器，需在 GLib 主循环线程调用)
+ */
+void telemetry_init(void);
+
+/**
+ * 更新服务小区参数
+ * @param cell 服务小区信息
+ */
+void telemetry_update_radio(const ServingCell *cell);
+
+/**
+ * 更新数据连接状态
+ * @param active 1=已连接, 0=断开
+ */
+void telemetry_update_data_state(int active);
+
+/**
+ * 更新当前卡槽与 modem 路径
+ * @param slot 卡槽 ("slot1"/"slot2")，可为NULL表示按路径推断
+ * @param modem_path modem 路径 (如 "/ril_0")
+ */
+void telemetry_update_modem(const char *slot, const char *modem_path);
+
+/**
+ * 更新累计流量 (vnstat 查询成功时由 traffic 模块发布)
+ * @param rx 累计接收字节
+ * @param tx 累计发送字节
+ */
+void telemetry_update_traffic(long long rx, long long tx);
+
+/**
+ * 更新 WAN 探测汇总 (每轮探测结束时由 wanprobe 模块发布)
+ * @param targets 目标数
+ * @param reachable 最近一轮有应答的目标数
+ * @param rtt_ms 有应答目标的平均 RTT
+ * @param jitter_ms 有应答目标的平均抖动
+ * @param loss_pct 最近一轮全部探测的丢包率
+ */
+void telemetry_update_wan(int targets, int reachable, double rtt_ms, double jitter_ms,
+                          double loss_pct);
+
+/**
+ * 生成仪表盘快照 JSON (推送格式: 各数据段带 updated 时间戳而非 age)
+ * @return JSON 字符串 (调用者用 arena_free 释放)，失败返回NULL
+ */
+char *telemetry_dashboard_json(void);
+
+/* HTTP API处理函数: GET /metrics (需抓取令牌) */
+void handle_telemetry_metrics(struct mg_connection *c, struct mg_http_message *hm);
+
+/* HTTP API处理函数: GET /api/dashboard */
+void handle_telemetry_dashboard(struct mg_connection *c, struct mg_http_message *hm);
+
+#endif /* TELEMETRY_H */
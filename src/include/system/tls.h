@@ -0,0 +1,61 @@
+/**
+ * @file tls.h
+ * @brief HTTPS 监听 (mongoose 内置 TLS)
+ *
+ * 经 rathole 或 IPv6 转发远程访问时，HTTP 明文会暴露登录令牌。
+ * 在 HTTP 端口之外再开一个 HTTPS 端口 (默认 6678)，使用 mongoose 内置 TLS 1.3 栈:
+ *
+ *   - 仅支持 ECDSA P-256 (prime256v1) 证书，私钥为 SEC1 "EC PRIVATE KEY" 格式
+ *   - 证书和私钥放在工作目录 (与 6677.db 同目录)，缺失时调用 openssl 生成自签名证书
+ *   - 证书在启动时解码为 DER 并常驻内存，每个连接不再重复解析 PEM
+ *
+ * 内置 TLS 栈不支持会话票据/会话缓存，每条新连接都要完整握手 (ECDHE + ECDSA 签名)。
+ * 服务端不主动关闭空闲连接，前端轮询复用同一条 keep-alive 连接，
+ * 握手只发生在浏览器建立连接时；握手次数、耗时及每次握手承载的请求数见 /api/tls。
+ */
+
+#ifndef TLS_H
+#define TLS_H
+
+#include "mongoose.h"
+
+/* 证书与私钥文件 (相对工作目录) */
+#define TLS_CERT_FILE "6677.crt"
+#define TLS_KEY_FILE "6677.key"
+
+/* 默认 HTTPS 端口 */
+#define TLS_DEFAULT_PORT "6678"
+
+/**
+ * 加载证书和私钥，缺失时生成自签名证书 (启动线程中调用)
+ * @return 0 成功, -1 失败 (HTTPS 不可用)
+ */
+int tls_init(void);
+
+/**
+ * 证书是否已加载
+ * @return 1 可用, 0 不可用
+ */
+int tls_available(void);
+
+/**
+ * 记录 HTTPS 监听状态 (用于 /api/tls)
+ * @param port 监听端口，NULL 表示未监听
+ */
+void tls_set_listening(const char *port);
+
+/**
+ * HTTPS 连接事件处理 (在 HTTPS 监听器的事件函数中对每个事件调用)
+ * MG_EV_ACCEPT 时开始 TLS 握手，其余事件只做统计
+ * @param c 连接
+ * @param ev 事件
+ */
+void tls_on_event(struct mg_connection *c, int ev);
+
+/**
+ * GET /api/tls
+ * HTTPS 状态及握手统计
+ */
+void handle_tls_stats(struct mg_connection *c, struct mg_http_message *hm);
+
+#endif /* TLS_H */
@@ -0,0 +1,91 @@
+/**
+ * @file trace.h
+ * @brief 轻量级请求追踪 (HTTP / D-Bus / AT / 子进程)
+ *
+ * 请求开始时绑定一个固定大小的追踪缓冲区到当前线程，
+ * 各层通过 trace_span_begin/trace_span_end 记录耗时片段。
+ * 未绑定追踪的线程 (如看门狗、后台采样) 调用时直接返回，开销仅为一次线程局部变量读取。
+ * 耗时超过阈值的请求被复制到最近慢请求环形缓冲区，通过 /api/debug/traces 查看。
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "mongoose.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/* 单个请求最多记录的片段数 */
+#define TRACE_MAX_SPANS 48
+
+/* 片段附加信息长度 (AT 命令、D-Bus 方法名、命令行等，超出截断) */
+#define TRACE_DETAIL_LEN 48
+
+/* 慢请求环形缓冲区大小 */
+#define TRACE_RING_SIZE 16
+
+/* 慢请求阈值默认值 (毫秒)，配置项 trace_slow_ms */
+#define TRACE_SLOW_MS_DEFAULT 500
+
+/* 追踪片段 */
+typedef struct {
+    const char *name;               /* 片段类型 (静态字符串，如 "dbus.call") */
+    char detail[TRACE_DETAIL_LEN];  /* 附加信息 */
+    uint32_t start_us;              /* 相对请求开始的偏移 (微秒) */
+    uint32_t dur_us;                /* 持续时间 (微秒)，未结束为0 */
+    uint8_t depth;                  /* 嵌套深度 */
+} TraceSpan;
+
+/* 单个请求的追踪记录 */
+typedef struct {
+    char method[8];
+    char uri[64];
+    time_t wall_time;               /* 请求开始的墙钟时间 */
+    uint64_t start_us;              /* 请求开始 (单调时钟，微秒) */
+    uint32_t total_us;              /* 请求总耗时 (微秒) */
+    int status;                     /* HTTP 状态码 */
+    int span_count;
+    int dropped;                    /* 超出容量被丢弃的片段数 */
+    int depth;                      /* 当前嵌套深度 */
+    TraceSpan spans[TRACE_MAX_SPANS];
+} Trace;
+
+/**
+ * 初始化追踪模块 (读取慢请求阈值配置)
+ */
+void trace_init(void);
+
+/**
+ * 开始追踪一个请求，并绑定到当前线程
+ * @param t 追踪缓冲区 (调用者持有，直到 trace_end)
+ * @param method 请求方法
+ * @param uri 请求路径
+ */
+void trace_begin(Trace *t, struct mg_str method, struct mg_str uri);
+
+/**
+ * 结束追踪并解除线程绑定；总耗时超过阈值时保存到慢请求环形缓冲区
+ * @param t 追踪缓冲区
+ * @param status HTTP 状态码
+ */
+void trace_end(Trace *t, int status);
+
+/**
+ * 开始一个片段
+ * @param name 片段类型 (必须是静态字符串)
+ * @param detail 附加信息 (可为NULL，会被复制)
+ * @return 片段句柄，当前线程无追踪或缓冲区已满时返回-1
+ */
+int trace_span_begin(const char *name, const char *detail);
+
+/**
+ * 结束一个片段
+ * @param span trace_span_begin 返回的句柄 (-1 时忽略)
+ */
+void trace_span_end(int span);
+
+/* HTTP API处理函数 */
+void handle_debug_traces(struct mg_connection *c, struct mg_http_message *hm);
+
+#endif /* TRACE_H */
@@ -13,6 +13,15 @@ extern "C" {
 #endif
 
 void init_traffic(void);
+
+/**
+ * 查询 vnstat 累计流量 (启动外部进程，成功时同时发布到遥测缓存)
+ * @param rx 接收字节输出
+ * @param tx 发送字节输出
+ * @return 0 成功, -1 失败 (rx/tx 置 0)
+ */
+int traffic_get_total(long long *rx, long long *tx);
+
 void handle_get_traffic_total(struct mg_connection *c, struct mg_http_message *hm);
 void handle_get_traffic_config(struct mg_connection *c, struct mg_http_message *hm);
 void handle_set_traffic_limit(struct mg_connection *c, struct mg_http_message *hm);
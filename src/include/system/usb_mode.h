@@ -29,6 +29,20 @@ extern "C" {
 
 /* IPA 硬件加速路径 */
 #define PAMU3_PROTOCOL_PATH   "/sys/devices/platform/soc/soc:ipa/2b300000.pamu3/pamu3_protocol"
+#define PAMU3_MAX_DL_PKTS_PATH "/sys/devices/platform/soc/soc:ipa/2b300000.pamu3/max_dl_pkts"
+
+/* adbd 写入描述符后 functionfs 才出现端点文件，此时 UDC 才能绑定 */
+#define USB_FFS_READY_PATH    "/dev/usb-ffs/adb/ep1"
+
+/* 环境变量: 热切换使用的根目录前缀，指向假的 configfs/sysfs 目录树时可在主机上测试
+ * (此时不执行 adbd、connmanctl 等外部命令) */
+#define USB_MODE_ROOT_ENV     "USB_MODE_ROOT"
+
+/* 热切换计划的最大步数 */
+#define USB_PLAN_MAX_STEPS    96
+
+/* 等待 functionfs/网络接口出现的轮询间隔 (毫秒) */
+#define USB_WAIT_POLL_MS      20
 
 /* USB 网络接口配置 */
 #define USB_INTERFACE_IP      "192.168.66.1"
@@ -58,6 +72,9 @@ const char* usb_mode_name(int mode);
 
 /**
  * @brief USB模式热切换（立即生效，无需重启）
+ *
+ * 读取 configfs 当前状态，只对与目标模式不同的属性、链接和功能目录生成操作，
+ * 仅在有变更时解绑 UDC；每步耗时和链路中断时长写入日志
  * @param mode 模式值 (1=CDC-NCM, 2=CDC-ECM, 3=RNDIS)
  * @return 0成功, 负数失败
  */
@@ -73,6 +90,7 @@ int usb_mode_get_current_hardware(void);
 void handle_usb_mode_get(struct mg_connection *c, struct mg_http_message *hm);
 void handle_usb_mode_set(struct mg_connection *c, struct mg_http_message *hm);
 void handle_usb_advance(struct mg_connection *c, struct mg_http_message *hm);
+void handle_usb_advance_status(struct mg_connection *c, struct mg_http_message *hm);
 
 #ifdef __cplusplus
 }
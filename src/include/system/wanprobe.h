@@ -0,0 +1,55 @@
+/**
+ * @file wanprobe.h
+ * @brief WAN 链路探测: 经蜂窝接口周期性测量时延、抖动和丢包
+ *
+ * 后台线程每 interval_sec 秒对每个目标发送 count 个探测:
+ *
+ *   icmp:HOST        ICMP Echo (优先使用非特权 ICMP 数据报套接字，不可用时退回原始套接字)
+ *   tcp:HOST:PORT    TCP 连接建立耗时 (收到 RST 同样说明链路可达，记为应答)
+ *
+ * 探测套接字通过 SO_BINDTODEVICE 绑定到 iface (默认蜂窝接口)，
+ * iface 为空时走默认路由，可用于对本机或局域网的替身目标测试。
+ * 超过 timeout_ms 未应答记为丢包。
+ *
+ * 每个目标保留 RTT 直方图 (与路由指标相同的对数-线性桶)、累计收发计数、
+ * 按 RFC 3550 平滑的抖动，以及最近 WANPROBE_HISTORY 轮的逐轮汇总。
+ * 每轮结束后把汇总发布到遥测缓存，经 /api/dashboard、推送通道和 /metrics 输出。
+ */
+
+#ifndef WANPROBE_H
+#define WANPROBE_H
+
+#include "mongoose.h"
+
+/* 探测目标数量上限 */
+#define WANPROBE_MAX_TARGETS 8
+
+/* 每个目标保留的逐轮汇总数 */
+#define WANPROBE_HISTORY 60
+
+/* 每轮每个目标的探测数上限 */
+#define WANPROBE_MAX_COUNT 20
+
+/**
+ * 初始化: 从数据库加载配置，已启用时启动探测线程
+ * @return 0成功
+ */
+int wanprobe_init(void);
+
+/**
+ * GET /api/wanprobe
+ * 配置、运行状态，以及每个目标的 RTT 分位数、抖动、丢包率和逐轮历史
+ */
+void handle_wanprobe_status(struct mg_connection *c, struct mg_http_message *hm);
+
+/**
+ * POST /api/wanprobe
+ * 请求体 (均可选):
+ *   {"enabled":true, "interval_sec":10, "count":3, "timeout_ms":1000,
+ *    "iface":"sipa_eth0",
+ *    "targets":["icmp:223.5.5.5","tcp:114.114.114.114:53"],
+ *    "reset":true}                 true 时清空统计和历史
+ */
+void handle_wanprobe_config(struct mg_connection *c, struct mg_http_message *hm);
+
+#endif /* WANPROBE_H */
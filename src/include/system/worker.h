@@ -0,0 +1,36 @@
+/**
+ * @file worker.h
+ * @brief 按配置启停的后台线程
+ *
+ * 模块用自己的状态锁保护配置和 Worker；是否需要运行由模块的 wanted 回调判断。
+ * 配置变化后调用 worker_start_locked 按需启动，停用时不主动结束线程，
+ * 线程在下一次检查时通过 worker_exit_locked 在锁内确认退出并清除运行标记，
+ * 这样重新启用与线程退出不会同时发生，也不会出现两个线程。
+ */
+
+#ifndef WORKER_H
+#define WORKER_H
+
+typedef struct {
+    const char *name;               /* 日志中的模块名 */
+    void *(*fn)(void *);            /* 线程函数 */
+    int (*wanted)(void);            /* 是否需要运行 (调用方持有模块锁) */
+    int running;                    /* 线程是否存在 (受模块锁保护) */
+} Worker;
+
+#define WORKER_INIT(name, fn, wanted) {(name), (fn), (wanted), 0}
+
+/**
+ * 需要运行且线程不存在时创建分离线程 (调用方持有模块锁)
+ * @return 0 已在运行、无需运行或创建成功，-1 创建失败
+ */
+int worker_start_locked(Worker *w);
+
+/**
+ * 线程内调用 (调用方持有模块锁): 不再需要运行或 force 非 0 时清除运行标记
+ * @param force 1=无论配置如何都退出 (如资源分配失败)
+ * @return 1 线程应释放锁后退出，0 继续运行
+ */
+int worker_exit_locked(Worker *w, int force);
+
+#endif /* WORKER_H */
@@ -0,0 +1,109 @@
+# 场景测试公共部分 (由 loadtest/test_*.sh 引用，不单独执行)
+# 私有 D-Bus 总线 + oFono 模拟服务 + 临时目录中的主机版 ofono-server，
+# 提供 API 调用和断言辅助函数，退出时清理全部进程和临时目录。
+# 环境变量: LOADTEST_PORT (默认 18080)
+# 引用前设置 NEED_NETNS=1 时在私有网络命名空间 (unshare -rn) 中重新执行脚本，
+# 可自由创建接口和 tc 规则而不影响主机；不支持时跳过该场景。
+
+if [ -z "$BIN" ]; then
+    echo "env.sh: 未设置 BIN (构建目录)" >&2
+    exit 1
+fi
+command -v jq >/dev/null 2>&1 || { echo "需要 jq" >&2; exit 1; }
+command -v dbus-daemon >/dev/null 2>&1 || { echo "需要 dbus-daemon" >&2; exit 1; }
+
+if [ "${NEED_NETNS:-0}" = 1 ] && [ -z "$SCENARIO_IN_NETNS" ]; then
+    if ! unshare -rn true 2>/dev/null; then
+        echo "SKIP $(basename "$0"): 需要 unshare -rn (用户/网络命名空间)"
+        exit 0
+    fi
+    SCENARIO_IN_NETNS=1 exec unshare -rn sh "$0" "$BIN"
+fi
+[ -n "$SCENARIO_IN_NETNS" ] && ip link set lo up
+
+FIXTURES=$(cd "$(dirname "$0")/../bench/fixtures" && pwd)
+PORT=${LOADTEST_PORT:-18080}
+URL="http://127.0.0.1:$PORT"
+WORK=$(mktemp -d /tmp/scenario.XXXXXX)
+PIDS=""
+FAILED=0
+TOKEN=""
+
+stack_cleanup() {
+    for p in $PIDS; do kill "$p" 2>/dev/null; done
+    wait 2>/dev/null
+    rm -rf "$WORK"
+}
+trap stack_cleanup EXIT INT TERM
+
+# 启动总线、模拟服务和服务端，等待就绪并登录 (默认密码)
+stack_start() {
+    cat > "$WORK/bus.conf" <<EOF
+<busconfig>
+  <type>system</type>
+  <listen>unix:path=$WORK/bus</listen>
+  <auth>EXTERNAL</auth>
+  <policy context="default">
+    <allow own="*"/>
+    <allow send_destination="*" eavesdrop="true"/>
+    <allow eavesdrop="true"/>
+  </policy>
+</busconfig>
+EOF
+    dbus-daemon --config-file="$WORK/bus.conf" --nofork --nopidfile >"$WORK/dbus.log" 2>&1 &
+    PIDS="$PIDS $!"
+    for i in $(seq 1 50); do [ -S "$WORK/bus" ] && break; sleep 0.1; done
+    export DBUS_SYSTEM_BUS_ADDRESS="unix:path=$WORK/bus"
+
+    "$BIN/mock_ofono" -d "$FIXTURES" >"$WORK/mock.log" 2>&1 &
+    PIDS="$PIDS $!"
+    for i in $(seq 1 50); do grep -q org.ofono "$WORK/mock.log" && break; sleep 0.1; done
+
+    (cd "$WORK" && exec "$BIN/ofono-server" "$PORT" 0) >"$WORK/server.log" 2>&1 &
+    SERVER=$!
+    PIDS="$PIDS $SERVER"
+
+    for i in $(seq 1 100); do
+        curl -s -m 1 "$URL/api/startup" | grep -q '"ready"' && break
+        sleep 0.2
+    done
+    TOKEN=$(curl -s -X POST "$URL/api/auth/login" -d '{"password":"admin"}' | jq -r '.token // empty')
+    if [ -z "$TOKEN" ]; then
+        echo "ofono-server 未就绪，日志:" >&2
+        tail -n 20 "$WORK/server.log" >&2
+        exit 1
+    fi
+}
+
+# api 方法 路径 [请求体]: 输出响应体 (POST 无请求体时也带 Content-Length: 0)
+api() {
+    if [ "$1" = GET ]; then
+        curl -s -m 30 -H "Authorization: Bearer $TOKEN" "$URL$2"
+    else
+        curl -s -m 30 -X "$1" -H "Authorization: Bearer $TOKEN" -d "${3-}" "$URL$2"
+    fi
+}
+
+# check 描述 jq条件 JSON: 条件为真时通过
+check() {
+    if [ -n "$3" ] && printf '%s' "$3" | jq -e "$2" >/dev/null 2>&1; then
+        echo "ok   $1"
+    else
+        echo "FAIL $1" >&2
+        echo "     $2" >&2
+        printf '%s\n' "$3" | head -c 2000 >&2
+        echo >&2
+        FAILED=1
+    fi
+}
+
+# 结束测试: 服务端异常退出也视为失败
+stack_finish() {
+    if ! kill -0 "$SERVER" 2>/dev/null; then
+        echo "FAIL ofono-server 已退出，日志:" >&2
+        tail -n 20 "$WORK/server.log" >&2
+        FAILED=1
+    fi
+    [ "$FAILED" = 0 ] && echo "PASS $(basename "$0")"
+    exit $FAILED
+}
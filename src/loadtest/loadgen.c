@@ -0,0 +1,446 @@
+/**
+ * @file loadgen.c
+ * @brief 端到端 HTTP 压测客户端 (make loadtest)
+ *
+ * 模拟 N 个同时打开控制台的浏览器，每个客户端一条 keep-alive 连接，
+ * 按 Vue 前端的轮询节奏发请求:
+ *   1s  /api/get/time        (系统设置页)
+ *   2s  /api/netif/stats     (网络接口监控)
+ *   5s  /api/cells, /api/get/Total
+ *   10s /api/sms, /api/sms/sent
+ * -x 可整体加速轮询节奏，用于在客户端数量有限时压出饱和点。
+ *
+ * 延迟从请求的计划发送时间算起 (连接忙时排队的时间也计入)，
+ * 避免服务端变慢时客户端少发请求而低估尾延迟。
+ *
+ * 依次跑完 -c 中的每个客户端数量，每档输出一行 JSON:
+ * 吞吐、p50/p90/p99/最大延迟、错误数、服务端 CPU 占用和 RSS (-p 指定 PID 时)，
+ * 以及各接口的 p99 和错误数；请求积压 (排队数超过客户端数或队列溢出)
+ * 或 p99 超过 -l 时标记 saturated。
+ *
+ * -u 为 https:// 地址时使用 mongoose 内置 TLS (不校验证书)，每条连接握手一次后复用，
+ * 可与 HTTP 的结果对比 HTTPS 对轮询客户端的额外开销。
+ *
+ * 用法: loadgen [-u http://127.0.0.1:18080] [-P 密码] [-c 1,10,50,100] [-t 每档秒数]
+ *               [-x 加速倍数] [-p 服务端PID] [-i 网卡] [-l p99阈值毫秒]
+ */
+
+#include "mongoose.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOADGEN_MAX_CLIENTS 1000
+#define LOADGEN_QUEUE 32
+#define LOADGEN_TIMEOUT_US (10 * 1000000ULL)
+
+typedef struct {
+    const char *path;
+    const char *method;
+    double period_s;
+} Endpoint;
+
+/* 与前端 setInterval 一致 */
+static const Endpoint g_endpoints[] = {
+    {"/api/get/time", "GET", 1},
+    {"/api/netif/stats", "POST", 2},
+    {"/api/cells", "GET", 5},
+    {"/api/get/Total", "GET", 5},
+    {"/api/sms", "GET", 10},
+    {"/api/sms/sent", "GET", 10},
+};
+#define EP_COUNT ((int)(sizeof(g_endpoints) / sizeof(g_endpoints[0])))
+
+typedef struct {
+    uint32_t us;
+    uint8_t ep;
+} Sample;
+
+typedef struct {
+    uint8_t ep;
+    uint64_t sched_us;
+} Pending;
+
+typedef struct {
+    struct mg_connection *c;
+    int connected;
+    int busy;
+    Pending inflight;
+    uint64_t sent_us;
+    Pending queue[LOADGEN_QUEUE];
+    int qhead, qlen;
+    uint64_t next_due[EP_COUNT];
+} Client;
+
+static const char *g_url = "http://127.0.0.1:18080";
+static const char *g_password = "admin";
+static const char *g_iface = "lo";
+static double g_speedup = 1.0;
+static int g_duration_s = 20;
+static int g_server_pid = 0;
+static double g_p99_limit_ms = 500;
+static char g_token[128];
+
+/* https:// 地址时在连接建立后开始 TLS 握手 */
+static void maybe_tls(struct mg_connection *c) {
+    if (mg_url_is_ssl(g_url)) {
+        struct mg_tls_opts opts;
+        memset(&opts, 0, sizeof(opts));
+        opts.skip_verification = 1;
+        mg_tls_init(c, &opts);
+    }
+}
+
+static Sample *g_samples;
+static size_t g_nsamples, g_cap_samples;
+static uint64_t g_scheduled, g_dropped;
+static uint64_t g_errors[EP_COUNT];
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static void record(int ep, uint64_t latency_us) {
+    if (g_nsamples == g_cap_samples) {
+        g_cap_samples = g_cap_samples ? g_cap_samples * 2 : 65536;
+        g_samples = realloc(g_samples, g_cap_samples * sizeof(Sample));
+        if (!g_samples) {
+            fprintf(stderr, "loadgen: 内存不足\n");
+            exit(1);
+        }
+    }
+    g_samples[g_nsamples].us = latency_us > UINT32_MAX ? UINT32_MAX : (uint32_t)latency_us;
+    g_samples[g_nsamples].ep = (uint8_t)ep;
+    g_nsamples++;
+}
+
+/* ==================== 服务端资源 ==================== */
+
+/* utime + stime (时钟滴答) */
+static long long proc_cpu_ticks(int pid) {
+    char path[64], buf[1024];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    size_t n = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    buf[n] = '\0';
+
+    /* comm 可能含空格，从最后一个 ')' 之后开始数: state 为第 3 列，utime/stime 为第 14/15 列 */
+    char *p = strrchr(buf, ')');
+    if (!p) return -1;
+    unsigned long long utime = 0, stime = 0;
+    if (sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) != 2) {
+        return -1;
+    }
+    return (long long)(utime + stime);
+}
+
+static long proc_status_kb(int pid, const char *key) {
+    char path[64], line[256];
+    size_t klen = strlen(key);
+    long kb = -1;
+    snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, key, klen) == 0 && line[klen] == ':') {
+            kb = strtol(line + klen + 1, NULL, 10);
+            break;
+        }
+    }
+    fclose(fp);
+    return kb;
+}
+
+/* ==================== 登录 ==================== */
+
+static int g_login_done;
+
+static void login_fn(struct mg_connection *c, int ev, void *ev_data) {
+    if (ev == MG_EV_CONNECT) {
+        char body[160];
+        maybe_tls(c);
+        int len = snprintf(body, sizeof(body), "{\"password\":\"%s\"}", g_password);
+        mg_printf(c,
+                  "POST /api/auth/login HTTP/1.1\r\nHost: loadgen\r\n"
+                  "Content-Type: application/json\r\nContent-Length: %d\r\n\r\n%s",
+                  len, body);
+    } else if (ev == MG_EV_HTTP_MSG) {
+        struct mg_http_message *hm = (struct mg_http_message *)ev_data;
+        char *token = mg_json_get_str(hm->body, "$.token");
+        if (token) {
+            snprintf(g_token, sizeof(g_token), "%s", token);
+            free(token);
+        }
+        g_login_done = 1;
+        c->is_closing = 1;
+    } else if (ev == MG_EV_ERROR) {
+        g_login_done = -1;
+    }
+}
+
+/* 服务端刚启动时可能仍在预热 (503)，30 秒内重试 */
+static int login(struct mg_mgr *mgr) {
+    uint64_t deadline = now_us() + 30 * 1000000ULL;
+    while (now_us() < deadline) {
+        g_login_done = 0;
+        if (mg_http_connect(mgr, g_url, login_fn, NULL)) {
+            while (g_login_done == 0 && now_us() < deadline) mg_mgr_poll(mgr, 10);
+            if (g_login_done == 1 && g_token[0]) return 0;
+        }
+        for (int i = 0; i < 50; i++) mg_mgr_poll(mgr, 10);
+    }
+    return -1;
+}
+
+/* ==================== 客户端 ==================== */
+
+static void client_send(Client *cl) {
+    const Endpoint *e = &g_endpoints[cl->inflight.ep];
+    if (strcmp(e->method, "POST") == 0) {
+        char body[96];
+        int len = snprintf(body, sizeof(body), "{\"interface\":\"%s\"}", g_iface);
+        mg_printf(cl->c,
+                  "POST %s HTTP/1.1\r\nHost: loadgen\r\nAuthorization: Bearer %s\r\n"
+                  "Content-Type: application/json\r\nContent-Length: %d\r\n\r\n%s",
+                  e->path, g_token, len, body);
+    } else {
+        mg_printf(cl->c, "GET %s HTTP/1.1\r\nHost: loadgen\r\nAuthorization: Bearer %s\r\n\r\n",
+                  e->path, g_token);
+    }
+    cl->sent_us = now_us();
+}
+
+static void client_fn(struct mg_connection *c, int ev, void *ev_data) {
+    Client *cl = (Client *)c->fn_data;
+    if (ev == MG_EV_CONNECT) {
+        maybe_tls(c);
+        cl->connected = 1;
+    } else if (ev == MG_EV_HTTP_MSG) {
+        struct mg_http_message *hm = (struct mg_http_message *)ev_data;
+        if (cl->busy) {
+            record(cl->inflight.ep, now_us() - cl->inflight.sched_us);
+            if (mg_http_status(hm) != 200) g_errors[cl->inflight.ep]++;
+            cl->busy = 0;
+        }
+    } else if (ev == MG_EV_CLOSE) {
+        if (cl->busy) g_errors[cl->inflight.ep]++;
+        cl->c = NULL;
+        cl->connected = 0;
+        cl->busy = 0;
+    }
+}
+
+static void client_tick(struct mg_mgr *mgr, Client *cl, uint64_t now) {
+    /* 到期的轮询入队，队列满说明该客户端已严重滞后，计为丢弃 */
+    for (int i = 0; i < EP_COUNT; i++) {
+        uint64_t period = (uint64_t)(g_endpoints[i].period_s * 1000000.0 / g_speedup);
+        while (cl->next_due[i] <= now) {
+            g_scheduled++;
+            if (cl->qlen < LOADGEN_QUEUE) {
+                Pending *p = &cl->queue[(cl->qhead + cl->qlen) % LOADGEN_QUEUE];
+                p->ep = (uint8_t)i;
+                p->sched_us = cl->next_due[i];
+                cl->qlen++;
+            } else {
+                g_dropped++;
+            }
+            cl->next_due[i] += period;
+        }
+    }
+
+    if (!cl->c) {
+        cl->c = mg_http_connect(mgr, g_url, client_fn, cl);
+        return;
+    }
+    if (cl->busy && now - cl->sent_us > LOADGEN_TIMEOUT_US) {
+        cl->c->is_closing = 1;
+        return;
+    }
+    if (cl->connected && !cl->busy && cl->qlen > 0) {
+        cl->inflight = cl->queue[cl->qhead];
+        cl->qhead = (cl->qhead + 1) % LOADGEN_QUEUE;
+        cl->qlen--;
+        cl->busy = 1;
+        client_send(cl);
+    }
+}
+
+/* ==================== 统计 ==================== */
+
+static int cmp_sample(const void *a, const void *b) {
+    uint32_t x = ((const Sample *)a)->us, y = ((const Sample *)b)->us;
+    return x < y ? -1 : x > y;
+}
+
+/* 已排序样本的分位数 (毫秒) */
+static double percentile_ms(const Sample *s, size_t n, double q) {
+    if (n == 0) return 0;
+    size_t idx = (size_t)(q * (double)(n - 1) + 0.5);
+    return s[idx].us / 1000.0;
+}
+
+static int run_step(struct mg_mgr *mgr, int nclients) {
+    static Client clients[LOADGEN_MAX_CLIENTS];
+    uint64_t start = now_us();
+    uint64_t end = start + (uint64_t)g_duration_s * 1000000ULL;
+
+    memset(clients, 0, sizeof(clients));
+    g_nsamples = 0;
+    g_scheduled = 0;
+    g_dropped = 0;
+    memset(g_errors, 0, sizeof(g_errors));
+
+    /* 各客户端的轮询相位随机错开，模拟不同时间打开的页面 */
+    for (int i = 0; i < nclients; i++) {
+        for (int e = 0; e < EP_COUNT; e++) {
+            uint64_t period = (uint64_t)(g_endpoints[e].period_s * 1000000.0 / g_speedup);
+            clients[i].next_due[e] = start + (uint64_t)rand() % period;
+        }
+    }
+
+    long long cpu0 = g_server_pid ? proc_cpu_ticks(g_server_pid) : -1;
+    long long self0 = proc_cpu_ticks(getpid());
+    long rss_peak = -1;
+    uint64_t next_sample = start;
+
+    for (uint64_t now = start; now < end; now = now_us()) {
+        for (int i = 0; i < nclients; i++) client_tick(mgr, &clients[i], now);
+        mg_mgr_poll(mgr, 1);
+        if (g_server_pid && now >= next_sample) {
+            long rss = proc_status_kb(g_server_pid, "VmRSS");
+            if (rss > rss_peak) rss_peak = rss;
+            next_sample = now + 1000000ULL;
+        }
+    }
+    uint64_t elapsed = now_us() - start;
+    long long cpu1 = g_server_pid ? proc_cpu_ticks(g_server_pid) : -1;
+    long long self1 = proc_cpu_ticks(getpid());
+
+    /* 结束时仍在排队或未返回的请求数; 断开本档的连接，未完成的请求不计入 */
+    int backlog = 0;
+    for (int i = 0; i < nclients; i++) {
+        backlog += clients[i].qlen + clients[i].busy;
+        if (clients[i].c) {
+            clients[i].busy = 0;
+            clients[i].c->is_closing = 1;
+        }
+    }
+    for (int i = 0; i < 20; i++) mg_mgr_poll(mgr, 5);
+
+    qsort(g_samples, g_nsamples, sizeof(Sample), cmp_sample);
+    double secs = (double)elapsed / 1e6;
+    double rps = (double)g_nsamples / secs;
+    double offered = (double)g_scheduled / secs;
+    double p99 = percentile_ms(g_samples, g_nsamples, 0.99);
+    uint64_t errors = 0;
+    for (int e = 0; e < EP_COUNT; e++) errors += g_errors[e];
+    /* 稳态下每个客户端最多有一个请求未完成，积压超过客户端数说明服务端跟不上 */
+    int saturated = g_dropped > 0 || backlog > nclients || p99 > g_p99_limit_ms;
+
+    fprintf(stdout,
+            "{\"clients\":%d,\"offered_rps\":%.1f,\"rps\":%.1f,\"requests\":%zu,"
+            "\"errors\":%llu,\"backlog\":%d,\"dropped\":%llu,\"p50_ms\":%.2f,\"p90_ms\":%.2f,"
+            "\"p99_ms\":%.2f,\"max_ms\":%.2f",
+            nclients, offered, rps, g_nsamples, (unsigned long long)errors,
+            backlog, (unsigned long long)g_dropped, percentile_ms(g_samples, g_nsamples, 0.50),
+            percentile_ms(g_samples, g_nsamples, 0.90), p99,
+            g_nsamples ? g_samples[g_nsamples - 1].us / 1000.0 : 0.0);
+    /* 压测客户端自身的 CPU 占用接近 100% 时，结果反映的是客户端瓶颈 */
+    double hz = (double)sysconf(_SC_CLK_TCK);
+    fprintf(stdout, ",\"loadgen_cpu_pct\":%.1f", (double)(self1 - self0) / hz / secs * 100.0);
+    if (cpu0 >= 0 && cpu1 >= 0) {
+        double cpu = (double)(cpu1 - cpu0) / hz / secs * 100.0;
+        fprintf(stdout, ",\"cpu_pct\":%.1f,\"rss_kb\":%ld,\"rss_peak_kb\":%ld", cpu,
+                proc_status_kb(g_server_pid, "VmRSS"), rss_peak);
+    }
+
+    /* 各接口的 p99 和非 200 响应数 (样本已按延迟排序，按接口顺序筛出仍有序) */
+    Sample *tmp = malloc((g_nsamples ? g_nsamples : 1) * sizeof(Sample));
+    fprintf(stdout, ",\"routes\":{");
+    for (int e = 0; e < EP_COUNT; e++) {
+        size_t n = 0;
+        for (size_t i = 0; i < g_nsamples; i++) {
+            if (g_samples[i].ep == e) tmp[n++] = g_samples[i];
+        }
+        fprintf(stdout, "%s\"%s\":{\"count\":%zu,\"errors\":%llu,\"p99_ms\":%.2f}", e ? "," : "",
+                g_endpoints[e].path, n, (unsigned long long)g_errors[e], percentile_ms(tmp, n, 0.99));
+    }
+    free(tmp);
+    fprintf(stdout, "},\"saturated\":%s}\n", saturated ? "true" : "false");
+    fflush(stdout);
+    return saturated;
+}
+
+int main(int argc, char *argv[]) {
+    const char *steps = "1,10,50,100,200";
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            fprintf(stderr, "loadgen: 参数 %s 缺少取值\n", argv[i]);
+            return 1;
+        }
+        if (strcmp(argv[i], "-u") == 0) {
+            g_url = argv[++i];
+        } else if (strcmp(argv[i], "-P") == 0) {
+            g_password = argv[++i];
+        } else if (strcmp(argv[i], "-c") == 0) {
+            steps = argv[++i];
+        } else if (strcmp(argv[i], "-t") == 0) {
+            g_duration_s = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-x") == 0) {
+            g_speedup = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-p") == 0) {
+            g_server_pid = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-i") == 0) {
+            g_iface = argv[++i];
+        } else if (strcmp(argv[i], "-l") == 0) {
+            g_p99_limit_ms = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "loadgen: 未知参数 %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (g_duration_s <= 0 || g_speedup <= 0) {
+        fprintf(stderr, "loadgen: -t 和 -x 必须大于 0\n");
+        return 1;
+    }
+
+    mg_log_set(MG_LL_NONE);
+    srand((unsigned)time(NULL));
+
+    struct mg_mgr mgr;
+    mg_mgr_init(&mgr);
+    if (login(&mgr) != 0) {
+        fprintf(stderr, "loadgen: 登录 %s 失败\n", g_url);
+        mg_mgr_free(&mgr);
+        return 1;
+    }
+
+    int knee = 0;
+    char *list = strdup(steps);
+    for (char *tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+        int n = atoi(tok);
+        if (n <= 0 || n > LOADGEN_MAX_CLIENTS) {
+            fprintf(stderr, "loadgen: 客户端数量 %s 超出范围 (1~%d)\n", tok, LOADGEN_MAX_CLIENTS);
+            continue;
+        }
+        if (run_step(&mgr, n) && !knee) knee = n;
+    }
+    free(list);
+
+    if (knee) {
+        fprintf(stderr, "loadgen: %d 个客户端时达到饱和\n", knee);
+    } else {
+        fprintf(stderr, "loadgen: 所有档位均未饱和\n");
+    }
+    mg_mgr_free(&mgr);
+    free(g_samples);
+    return 0;
+}
@@ -0,0 +1,507 @@
+/**
+ * @file mock_ofono.c
+ * @brief 主机压测用的 oFono 模拟服务 (make loadtest)
+ *
+ * 在指定总线上注册 org.ofono，实现 ofono-server 用到的接口子集:
+ * Manager / Modem / SimManager / RadioSettings / NetworkRegistration / ConnectionManager /
+ * ConnectionContext / NetworkMonitor / MessageManager。
+ * 两个卡槽 /ril_0 (数据卡，在线) 和 /ril_1 (离线) 各有一个 internet 上下文；
+ * SetDataCard 广播 Manager.DataCard，断开原卡槽数据连接，
+ * 约 1.2 秒后激活新卡槽数据连接。
+ * 属性保存在内存中，SetProperty 会广播 PropertyChanged；
+ * SendAtcmd 对邻区查询 (AT+SPENGMD=0,14,2 / 0,6,6) 返回 bench/fixtures 中的设备原始输出；
+ * AT+SPLBAND 锁频状态保存在内存中，服务小区查询 (AT+SPENGMD=0,14,1 / 0,6,0) 按
+ * 当前锁定从内置的模拟站点表中选择驻留频段并生成应答 (优先 5G)，
+ * 同时更新 NetworkRegistration.Technology；锁定的频段均无站点时视为无服务。
+ * 其余命令返回 "OK"。
+ *
+ * ofono-server 固定连接系统总线，压测脚本通过 DBUS_SYSTEM_BUS_ADDRESS
+ * 把服务端和本进程指向同一条私有总线。
+ *
+ * 用法: mock_ofono [-d fixtures目录] [-a AT命令延迟毫秒]
+ */
+
+#include <gio/gio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MOCK_MODEM_PATH "/ril_0"
+#define MOCK_CONTEXT_PATH "/ril_0/context1"
+#define MOCK_MODEM2_PATH "/ril_1"
+#define MOCK_CONTEXT2_PATH "/ril_1/context1"
+
+/* 切卡后新卡槽数据连接激活的延迟 */
+#define MOCK_DATA_UP_DELAY_MS 1200
+
+static const char *g_fixture_dir = "bench/fixtures";
+static guint g_at_delay_ms = 0;
+static char g_data_card[16] = MOCK_MODEM_PATH;
+
+/* 属性表: "路径|接口" -> (属性名 -> GVariant) */
+static GHashTable *g_props = NULL;
+
+/* AT 命令 -> 样本文件 */
+static const struct {
+    const char *cmd;
+    const char *fixture;
+} g_at_fixtures[] = {
+    {"AT+SPENGMD=0,14,2", "spengmd_nr_neighbor.txt"},
+    {"AT+SPENGMD=0,6,6", "spengmd_lte_neighbor.txt"},
+    {NULL, NULL},
+};
+
+/* 锁频状态 (AT+SPLBAND 位掩码，0=不锁定) */
+static struct {
+    int tdd4g, fdd4g, fdd5g, tdd5g;
+} g_band_lock;
+
+/* 模拟站点: 各频段在当前位置的信号 */
+static const struct {
+    int nr;         /* 1=5G */
+    int tdd;        /* 1=TDD 位掩码 */
+    int bit;        /* AT+SPLBAND 位 */
+    int band;       /* 频段号 */
+    int arfcn;
+    int pci;
+    int rsrp;       /* dBm */
+    int sinr;       /* dB */
+} g_sites[] = {
+    {1, 1, 256, 78, 627264, 356, -98, 15},
+    {1, 1, 16, 41, 504990, 122, -86, 12},
+    {1, 0, 512, 28, 152650, 87, -95, 6},
+    {0, 0, 4, 3, 1850, 201, -90, 10},
+    {0, 1, 256, 41, 40936, 64, -102, 4},
+    {0, 0, 1, 1, 100, 311, -108, 2},
+};
+
+static const char g_introspection_xml[] =
+    "<node>"
+    "  <interface name='org.ofono.Manager'>"
+    "    <method name='GetModems'><arg type='a(oa{sv})' direction='out'/></method>"
+    "    <method name='GetDataCard'><arg type='o' direction='out'/></method>"
+    "    <method name='SetDataCard'><arg type='o' direction='in'/></method>"
+    "    <signal name='PropertyChanged'><arg type='s'/><arg type='v'/></signal>"
+    "  </interface>"
+    "  <interface name='org.ofono.Modem'>"
+    "    <method name='GetProperties'><arg type='a{sv}' direction='out'/></method>"
+    "    <method name='SetProperty'><arg type='s' direction='in'/><arg type='v' direction='in'/></method>"
+    "    <method name='SendAtcmd'><arg type='s' direction='in'/><arg type='s' direction='out'/></method>"
+    "    <signal name='PropertyChanged'><arg type='s'/><arg type='v'/></signal>"
+    "  </interface>"
+    "  <interface name='org.ofono.SimManager'>"
+    "    <method name='GetProperties'><arg type='a{sv}' direction='out'/></method>"
+    "    <signal name='PropertyChanged'><arg type='s'/><arg type='v'/></signal>"
+    "  </interface>"
+    "  <interface name='org.ofono.RadioSettings'>"
+    "    <method name='GetProperties'><arg type='a{sv}' direction='out'/></method>"
+    "    <method name='SetProperty'><arg type='s' direction='in'/><arg type='v' direction='in'/></method>"
+    "    <signal name='PropertyChanged'><arg type='s'/><arg type='v'/></signal>"
+    "  </interface>"
+    "  <interface name='org.ofono.NetworkRegistration'>"
+    "    <method name='GetProperties'><arg type='a{sv}' direction='out'/></method>"
+    "    <signal name='PropertyChanged'><arg type='s'/><arg type='v'/></signal>"
+    "  </interface>"
+    "  <interface name='org.ofono.ConnectionManager'>"
+    "    <method name='GetProperties'><arg type='a{sv}' direction='out'/></method>"
+    "    <method name='SetProperty'><arg type='s' direction='in'/><arg type='v' direction='in'/></method>"
+    "    <method name='GetContexts'><arg type='a(oa{sv})' direction='out'/></method>"
+    "    <signal name='PropertyChanged'><arg type='s'/><arg type='v'/></signal>"
+    "  </interface>"
+    "  <interface name='org.ofono.NetworkMonitor'>"
+    "    <method name='GetServingCellInformation'><arg type='a{sv}' direction='out'/></method>"
+    "  </interface>"
+    "  <interface name='org.ofono.MessageManager'>"
+    "    <method name='SendMessage'><arg type='s' direction='in'/><arg type='s' direction='in'/>"
+    "      <arg type='o' direction='out'/></method>"
+    "    <signal name='IncomingMessage'><arg type='s'/><arg type='a{sv}'/></signal>"
+    "  </interface>"
+    "  <interface name='org.ofono.ConnectionContext'>"
+    "    <method name='GetProperties'><arg type='a{sv}' direction='out'/></method>"
+    "    <method name='SetProperty'><arg type='s' direction='in'/><arg type='v' direction='in'/></method>"
+    "    <signal name='PropertyChanged'><arg type='s'/><arg type='v'/></signal>"
+    "  </interface>"
+    "</node>";
+
+/* ==================== 属性表 ==================== */
+
+static GHashTable *props_table(const char *path, const char *iface) {
+    char *key = g_strdup_printf("%s|%s", path, iface);
+    GHashTable *t = g_hash_table_lookup(g_props, key);
+    if (!t) {
+        t = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_variant_unref);
+        g_hash_table_insert(g_props, key, t);
+    } else {
+        g_free(key);
+    }
+    return t;
+}
+
+static void props_set(const char *path, const char *iface, const char *name, GVariant *value) {
+    g_hash_table_insert(props_table(path, iface), g_strdup(name), g_variant_ref_sink(value));
+}
+
+static GVariant *props_to_dict(const char *path, const char *iface) {
+    GVariantBuilder b;
+    GHashTableIter it;
+    gpointer k, v;
+
+    g_variant_builder_init(&b, G_VARIANT_TYPE("a{sv}"));
+    g_hash_table_iter_init(&it, props_table(path, iface));
+    while (g_hash_table_iter_next(&it, &k, &v)) {
+        g_variant_builder_add(&b, "{sv}", (const char *)k, (GVariant *)v);
+    }
+    return g_variant_builder_end(&b);
+}
+
+static void props_init(void) {
+    g_props = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_hash_table_unref);
+
+    props_set(MOCK_MODEM_PATH, "org.ofono.Modem", "Online", g_variant_new_boolean(TRUE));
+    props_set(MOCK_MODEM_PATH, "org.ofono.Modem", "Powered", g_variant_new_boolean(TRUE));
+    props_set(MOCK_MODEM_PATH, "org.ofono.Modem", "Manufacturer", g_variant_new_string("Mock"));
+    props_set(MOCK_MODEM_PATH, "org.ofono.Modem", "Model", g_variant_new_string("UDX710"));
+    props_set(MOCK_MODEM_PATH, "org.ofono.Modem", "Serial", g_variant_new_string("860000000000001"));
+    props_set(MOCK_MODEM_PATH, "org.ofono.Modem", "Revision", g_variant_new_string("mock-1.0"));
+
+    props_set(MOCK_MODEM_PATH, "org.ofono.RadioSettings", "TechnologyPreference",
+              g_variant_new_string("NR 5G/LTE auto"));
+
+    props_set(MOCK_MODEM_PATH, "org.ofono.NetworkRegistration", "Status", g_variant_new_string("registered"));
+    props_set(MOCK_MODEM_PATH, "org.ofono.NetworkRegistration", "Technology", g_variant_new_string("nr"));
+    props_set(MOCK_MODEM_PATH, "org.ofono.NetworkRegistration", "Name", g_variant_new_string("Mock Operator"));
+    props_set(MOCK_MODEM_PATH, "org.ofono.NetworkRegistration", "MobileCountryCode", g_variant_new_string("460"));
+    props_set(MOCK_MODEM_PATH, "org.ofono.NetworkRegistration", "MobileNetworkCode", g_variant_new_string("00"));
+    props_set(MOCK_MODEM_PATH, "org.ofono.NetworkRegistration", "Strength", g_variant_new_byte(72));
+    props_set(MOCK_MODEM_PATH, "org.ofono.NetworkRegistration", "StrengthDbm", g_variant_new_int32(-88));
+
+    props_set(MOCK_MODEM_PATH, "org.ofono.ConnectionManager", "Attached", g_variant_new_boolean(TRUE));
+    props_set(MOCK_MODEM_PATH, "org.ofono.ConnectionManager", "Powered", g_variant_new_boolean(TRUE));
+    props_set(MOCK_MODEM_PATH, "org.ofono.ConnectionManager", "RoamingAllowed", g_variant_new_boolean(FALSE));
+
+    props_set(MOCK_CONTEXT_PATH, "org.ofono.ConnectionContext", "Active", g_variant_new_boolean(TRUE));
+    props_set(MOCK_CONTEXT_PATH, "org.ofono.ConnectionContext", "Name", g_variant_new_string("Internet"));
+    props_set(MOCK_CONTEXT_PATH, "org.ofono.ConnectionContext", "Type", g_variant_new_string("internet"));
+    props_set(MOCK_CONTEXT_PATH, "org.ofono.ConnectionContext", "AccessPointName", g_variant_new_string("cmnet"));
+    props_set(MOCK_CONTEXT_PATH, "org.ofono.ConnectionContext", "Protocol", g_variant_new_string("dual"));
+    props_set(MOCK_CONTEXT_PATH, "org.ofono.ConnectionContext", "Username", g_variant_new_string(""));
+    props_set(MOCK_CONTEXT_PATH, "org.ofono.ConnectionContext", "Password", g_variant_new_string(""));
+    props_set(MOCK_CONTEXT_PATH, "org.ofono.ConnectionContext", "AuthenticationMethod",
+              g_variant_new_string("chap"));
+
+    props_set(MOCK_MODEM_PATH, "org.ofono.SimManager", "Present", g_variant_new_boolean(TRUE));
+    props_set(MOCK_MODEM_PATH, "org.ofono.SimManager", "CardIdentifier", g_variant_new_string("89860000000000000001"));
+    props_set(MOCK_MODEM_PATH, "org.ofono.SimManager", "SubscriberIdentity", g_variant_new_string("460001234567890"));
+    props_set(MOCK_MODEM_PATH, "org.ofono.SimManager", "ServiceProviderName", g_variant_new_string("CMCC"));
+
+    /* 第二卡槽: 离线，LTE only */
+    props_set(MOCK_MODEM2_PATH, "org.ofono.Modem", "Online", g_variant_new_boolean(FALSE));
+    props_set(MOCK_MODEM2_PATH, "org.ofono.Modem", "Powered", g_variant_new_boolean(TRUE));
+    props_set(MOCK_MODEM2_PATH, "org.ofono.SimManager", "Present", g_variant_new_boolean(TRUE));
+    props_set(MOCK_MODEM2_PATH, "org.ofono.SimManager", "CardIdentifier", g_variant_new_string("89860100000000000002"));
+    props_set(MOCK_MODEM2_PATH, "org.ofono.SimManager", "SubscriberIdentity", g_variant_new_string("460011234567890"));
+    props_set(MOCK_MODEM2_PATH, "org.ofono.SimManager", "ServiceProviderName", g_variant_new_string("CUCC"));
+    props_set(MOCK_MODEM2_PATH, "org.ofono.RadioSettings", "TechnologyPreference", g_variant_new_string("LTE only"));
+    props_set(MOCK_MODEM2_PATH, "org.ofono.NetworkRegistration", "Status", g_variant_new_string("registered"));
+    props_set(MOCK_MODEM2_PATH, "org.ofono.NetworkRegistration", "Technology", g_variant_new_string("lte"));
+    props_set(MOCK_MODEM2_PATH, "org.ofono.NetworkRegistration", "Name", g_variant_new_string("Mock Operator 2"));
+    props_set(MOCK_MODEM2_PATH, "org.ofono.ConnectionManager", "Attached", g_variant_new_boolean(TRUE));
+    props_set(MOCK_MODEM2_PATH, "org.ofono.ConnectionManager", "Powered", g_variant_new_boolean(TRUE));
+    props_set(MOCK_CONTEXT2_PATH, "org.ofono.ConnectionContext", "Active", g_variant_new_boolean(FALSE));
+    props_set(MOCK_CONTEXT2_PATH, "org.ofono.ConnectionContext", "Name", g_variant_new_string("Internet"));
+    props_set(MOCK_CONTEXT2_PATH, "org.ofono.ConnectionContext", "Type", g_variant_new_string("internet"));
+    props_set(MOCK_CONTEXT2_PATH, "org.ofono.ConnectionContext", "AccessPointName", g_variant_new_string("3gnet"));
+}
+
+/* 设置属性并广播 PropertyChanged */
+static void props_update(GDBusConnection *conn, const char *path, const char *iface, const char *name,
+                         GVariant *value) {
+    props_set(path, iface, name, value);
+    g_dbus_connection_emit_signal(conn, NULL, path, iface, "PropertyChanged",
+                                  g_variant_new("(sv)", name, value), NULL);
+}
+
+/* ==================== AT 命令 ==================== */
+
+/* 按锁频状态选择驻留站点: 优先 5G，同制式内按 SINR + (RSRP+140)/4 选最好的，无可用站点返回 -1 */
+static int camped_site(void) {
+    int best = -1;
+    for (int i = 0; i < (int)G_N_ELEMENTS(g_sites); i++) {
+        int mask, any;
+        if (g_sites[i].nr) {
+            mask = g_sites[i].tdd ? g_band_lock.tdd5g : g_band_lock.fdd5g;
+            any = g_band_lock.tdd5g | g_band_lock.fdd5g;
+        } else {
+            mask = g_sites[i].tdd ? g_band_lock.tdd4g : g_band_lock.fdd4g;
+            any = g_band_lock.tdd4g | g_band_lock.fdd4g;
+        }
+        if (any && !(mask & g_sites[i].bit)) continue;
+        if (best >= 0) {
+            if (g_sites[best].nr != g_sites[i].nr) {
+                if (g_sites[best].nr) continue;
+            } else if (g_sites[i].sinr * 4 + g_sites[i].rsrp <= g_sites[best].sinr * 4 + g_sites[best].rsrp) {
+                continue;
+            }
+        }
+        best = i;
+    }
+    return best;
+}
+
+/*
+ * 生成服务小区应答: 以 "-" 分隔的行 (负数前多一个 "-")，
+ * 第 0~4 行为频段/频点/PCI/RSRP/RSRQ，SINR 在第 15 行 (5G) 或第 33 行 (4G)，数值 ×100
+ */
+static char *serving_reply(int nr) {
+    int site = camped_site();
+    if (site < 0 || g_sites[site].nr != nr) return g_strdup("OK");
+
+    int sinr_row = nr ? 15 : 33;
+    GString *s = g_string_new(NULL);
+    g_string_append_printf(s, "%d-%d-%d-%d-%d", g_sites[site].band, g_sites[site].arfcn, g_sites[site].pci,
+                           g_sites[site].rsrp * 100, -1050);
+    for (int row = 5; row < 40; row++) {
+        g_string_append_printf(s, "-%d", row == sinr_row ? g_sites[site].sinr * 100 : 0);
+    }
+    g_string_append(s, "\r\nOK");
+    return g_string_free(s, FALSE);
+}
+
+/* 锁频后更新注册制式 */
+static void update_technology(GDBusConnection *conn) {
+    int site = camped_site();
+    const char *tech = site < 0 ? "none" : g_sites[site].nr ? "nr" : "lte";
+    GVariant *value = g_variant_new_string(tech);
+    props_set(MOCK_MODEM_PATH, "org.ofono.NetworkRegistration", "Technology", value);
+    g_dbus_connection_emit_signal(conn, NULL, MOCK_MODEM_PATH, "org.ofono.NetworkRegistration",
+                                  "PropertyChanged", g_variant_new("(sv)", "Technology", value), NULL);
+}
+
+static char *at_reply(GDBusConnection *conn, const char *cmd) {
+    int a, b;
+    if (strcmp(cmd, "AT+SPLBAND=0") == 0) {
+        return g_strdup_printf("+SPLBAND: 0,%d,0,%d,0\r\nOK", g_band_lock.tdd4g, g_band_lock.fdd4g);
+    } else if (strcmp(cmd, "AT+SPLBAND=3") == 0) {
+        return g_strdup_printf("+SPLBAND: %d,0,%d,0\r\nOK", g_band_lock.fdd5g, g_band_lock.tdd5g);
+    } else if (sscanf(cmd, "AT+SPLBAND=1,0,%d,0,%d,0", &a, &b) == 2) {
+        g_band_lock.tdd4g = a;
+        g_band_lock.fdd4g = b;
+        update_technology(conn);
+        return g_strdup("OK");
+    } else if (sscanf(cmd, "AT+SPLBAND=2,%d,0,%d,0", &a, &b) == 2) {
+        g_band_lock.fdd5g = a;
+        g_band_lock.tdd5g = b;
+        update_technology(conn);
+        return g_strdup("OK");
+    } else if (strcmp(cmd, "AT+SPENGMD=0,14,1") == 0) {
+        return serving_reply(1);
+    } else if (strcmp(cmd, "AT+SPENGMD=0,6,0") == 0) {
+        return serving_reply(0);
+    }
+
+    for (int i = 0; g_at_fixtures[i].cmd; i++) {
+        if (strcmp(cmd, g_at_fixtures[i].cmd) == 0) {
+            char *path = g_build_filename(g_fixture_dir, g_at_fixtures[i].fixture, NULL);
+            char *content = NULL;
+            if (!g_file_get_contents(path, &content, NULL, NULL)) {
+                fprintf(stderr, "mock_ofono: 无法读取样本 %s\n", path);
+            }
+            g_free(path);
+            if (content) return content;
+            break;
+        }
+    }
+    return g_strdup("OK");
+}
+
+typedef struct {
+    GDBusMethodInvocation *invocation;
+    char *reply;
+} DelayedReply;
+
+static gboolean at_reply_later(gpointer data) {
+    DelayedReply *d = data;
+    g_dbus_method_invocation_return_value(d->invocation, g_variant_new("(s)", d->reply));
+    g_free(d->reply);
+    g_free(d);
+    return G_SOURCE_REMOVE;
+}
+
+/* ==================== 方法分发 ==================== */
+
+static GVariant *modem_list(void) {
+    GVariantBuilder b;
+    g_variant_builder_init(&b, G_VARIANT_TYPE("a(oa{sv})"));
+    g_variant_builder_add(&b, "(o@a{sv})", MOCK_MODEM_PATH, props_to_dict(MOCK_MODEM_PATH, "org.ofono.Modem"));
+    g_variant_builder_add(&b, "(o@a{sv})", MOCK_MODEM2_PATH, props_to_dict(MOCK_MODEM2_PATH, "org.ofono.Modem"));
+    return g_variant_builder_end(&b);
+}
+
+static const char *context_of(const char *modem_path) {
+    return strcmp(modem_path, MOCK_MODEM2_PATH) == 0 ? MOCK_CONTEXT2_PATH : MOCK_CONTEXT_PATH;
+}
+
+static GVariant *context_list(const char *modem_path) {
+    const char *ctx = context_of(modem_path);
+    GVariantBuilder b;
+    g_variant_builder_init(&b, G_VARIANT_TYPE("a(oa{sv})"));
+    g_variant_builder_add(&b, "(o@a{sv})", ctx, props_to_dict(ctx, "org.ofono.ConnectionContext"));
+    return g_variant_builder_end(&b);
+}
+
+/* ==================== 切卡 ==================== */
+
+static gboolean data_up_later(gpointer data) {
+    GDBusConnection *conn = data;
+    props_update(conn, context_of(g_data_card), "org.ofono.ConnectionContext", "Active",
+                 g_variant_new_boolean(TRUE));
+    return G_SOURCE_REMOVE;
+}
+
+static void set_data_card(GDBusConnection *conn, const char *path) {
+    if (strcmp(path, g_data_card) == 0) return;
+
+    props_update(conn, context_of(g_data_card), "org.ofono.ConnectionContext", "Active",
+                 g_variant_new_boolean(FALSE));
+    snprintf(g_data_card, sizeof(g_data_card), "%s", path);
+    g_dbus_connection_emit_signal(conn, NULL, "/", "org.ofono.Manager", "PropertyChanged",
+                                  g_variant_new("(sv)", "DataCard", g_variant_new_object_path(path)), NULL);
+    g_timeout_add(MOCK_DATA_UP_DELAY_MS, data_up_later, conn);
+}
+
+static GVariant *serving_cell(void) {
+    GVariantBuilder b;
+    g_variant_builder_init(&b, G_VARIANT_TYPE("a{sv}"));
+    GVariant *tech = g_hash_table_lookup(props_table(MOCK_MODEM_PATH, "org.ofono.NetworkRegistration"),
+                                         "Technology");
+    g_variant_builder_add(&b, "{sv}", "Technology", tech ? tech : g_variant_new_string("nr"));
+    int site = camped_site();
+    g_variant_builder_add(&b, "{sv}", "Band", g_variant_new_int32(site < 0 ? 0 : g_sites[site].band));
+    g_variant_builder_add(&b, "{sv}", "CellId", g_variant_new_uint32(0x1234567));
+    return g_variant_builder_end(&b);
+}
+
+static void handle_method_call(GDBusConnection *conn, const gchar *sender, const gchar *path,
+                               const gchar *iface, const gchar *method, GVariant *params,
+                               GDBusMethodInvocation *invocation, gpointer user_data) {
+    (void)sender;
+    (void)user_data;
+
+    if (strcmp(method, "GetProperties") == 0) {
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("(@a{sv})", props_to_dict(path, iface)));
+    } else if (strcmp(method, "SetProperty") == 0) {
+        const char *name = NULL;
+        GVariant *value = NULL;
+        g_variant_get(params, "(&sv)", &name, &value);
+        props_update(conn, path, iface, name, value);
+        g_variant_unref(value);
+        g_dbus_method_invocation_return_value(invocation, NULL);
+    } else if (strcmp(method, "GetModems") == 0) {
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("(@a(oa{sv}))", modem_list()));
+    } else if (strcmp(method, "GetDataCard") == 0) {
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("(o)", g_data_card));
+    } else if (strcmp(method, "SetDataCard") == 0) {
+        const char *card = NULL;
+        g_variant_get(params, "(&o)", &card);
+        if (strcmp(card, MOCK_MODEM_PATH) != 0 && strcmp(card, MOCK_MODEM2_PATH) != 0) {
+            g_dbus_method_invocation_return_dbus_error(invocation, "org.ofono.Error.InvalidArguments", card);
+            return;
+        }
+        set_data_card(conn, card);
+        g_dbus_method_invocation_return_value(invocation, NULL);
+    } else if (strcmp(method, "GetContexts") == 0) {
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("(@a(oa{sv}))", context_list(path)));
+    } else if (strcmp(method, "GetServingCellInformation") == 0) {
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("(@a{sv})", serving_cell()));
+    } else if (strcmp(method, "SendMessage") == 0) {
+        static unsigned seq = 0;
+        char msg_path[64];
+        snprintf(msg_path, sizeof(msg_path), "%s/message_%u", MOCK_MODEM_PATH, ++seq);
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("(o)", msg_path));
+    } else if (strcmp(method, "SendAtcmd") == 0) {
+        const char *cmd = NULL;
+        g_variant_get(params, "(&s)", &cmd);
+        char *reply = at_reply(conn, cmd);
+        if (g_at_delay_ms == 0) {
+            g_dbus_method_invocation_return_value(invocation, g_variant_new("(s)", reply));
+            g_free(reply);
+        } else {
+            /* 模拟模块处理 AT 命令的耗时，不阻塞其他调用 */
+            DelayedReply *d = g_new0(DelayedReply, 1);
+            d->invocation = invocation;
+            d->reply = reply;
+            g_timeout_add(g_at_delay_ms, at_reply_later, d);
+        }
+    } else {
+        g_dbus_method_invocation_return_dbus_error(invocation, "org.ofono.Error.NotImplemented", method);
+    }
+}
+
+static const GDBusInterfaceVTable g_vtable = {handle_method_call, NULL, NULL, {0}};
+
+static void register_iface(GDBusConnection *conn, GDBusNodeInfo *node, const char *path, const char *iface) {
+    GError *error = NULL;
+    GDBusInterfaceInfo *info = g_dbus_node_info_lookup_interface(node, iface);
+    if (g_dbus_connection_register_object(conn, path, info, &g_vtable, NULL, NULL, &error) == 0) {
+        fprintf(stderr, "mock_ofono: 注册 %s %s 失败: %s\n", path, iface, error->message);
+        g_error_free(error);
+        exit(1);
+    }
+}
+
+static void on_bus_acquired(GDBusConnection *conn, const gchar *name, gpointer user_data) {
+    static const char *modems[] = {MOCK_MODEM_PATH, MOCK_MODEM2_PATH};
+    GDBusNodeInfo *node = user_data;
+    (void)name;
+
+    register_iface(conn, node, "/", "org.ofono.Manager");
+    for (int i = 0; i < 2; i++) {
+        register_iface(conn, node, modems[i], "org.ofono.Modem");
+        register_iface(conn, node, modems[i], "org.ofono.SimManager");
+        register_iface(conn, node, modems[i], "org.ofono.RadioSettings");
+        register_iface(conn, node, modems[i], "org.ofono.NetworkRegistration");
+        register_iface(conn, node, modems[i], "org.ofono.ConnectionManager");
+        register_iface(conn, node, modems[i], "org.ofono.NetworkMonitor");
+        register_iface(conn, node, modems[i], "org.ofono.MessageManager");
+    }
+    register_iface(conn, node, MOCK_CONTEXT_PATH, "org.ofono.ConnectionContext");
+    register_iface(conn, node, MOCK_CONTEXT2_PATH, "org.ofono.ConnectionContext");
+}
+
+static void on_name_acquired(GDBusConnection *conn, const gchar *name, gpointer user_data) {
+    (void)conn;
+    (void)user_data;
+    fprintf(stdout, "mock_ofono: 已注册 %s\n", name);
+    fflush(stdout);
+}
+
+static void on_name_lost(GDBusConnection *conn, const gchar *name, gpointer user_data) {
+    (void)user_data;
+    fprintf(stderr, "mock_ofono: 无法获取总线名 %s%s\n", name, conn ? "" : " (总线不可用)");
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            g_fixture_dir = argv[++i];
+        } else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+            g_at_delay_ms = (guint)strtoul(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "用法: %s [-d fixtures目录] [-a AT命令延迟毫秒]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    props_init();
+    GDBusNodeInfo *node = g_dbus_node_info_new_for_xml(g_introspection_xml, NULL);
+    guint owner = g_bus_own_name(G_BUS_TYPE_SYSTEM, "org.ofono", G_BUS_NAME_OWNER_FLAGS_NONE,
+                                 on_bus_acquired, on_name_acquired, on_name_lost, node, NULL);
+
+    GMainLoop *loop = g_main_loop_new(NULL, FALSE);
+    g_main_loop_run(loop);
+
+    g_bus_unown_name(owner);
+    g_dbus_node_info_unref(node);
+    return 0;
+}
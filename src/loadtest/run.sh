@@ -0,0 +1,74 @@
+#!/bin/sh
+# 端到端压测: 私有 D-Bus 总线 + oFono 模拟服务 + 临时数据库上的主机版 ofono-server
+# 用法: loadtest/run.sh 构建目录 [loadgen 参数...]
+# 构建目录中需要 ofono-server、mock_ofono、loadgen (由 make loadtest 生成)
+# 环境变量: LOADTEST_PORT (默认 18080)、LOADTEST_TLS_PORT (默认 18443)、
+#           LOADTEST_HTTPS=1 (压测 HTTPS 端口)、LOADTEST_AT_DELAY (模拟 AT 命令耗时，毫秒)
+
+if [ $# -lt 1 ]; then
+    echo "用法: $0 构建目录 [loadgen 参数...]" >&2
+    exit 1
+fi
+
+BIN=$(cd "$1" && pwd) || exit 1
+shift
+FIXTURES=$(cd "$(dirname "$0")/../bench/fixtures" && pwd)
+PORT=${LOADTEST_PORT:-18080}
+TLS_PORT=${LOADTEST_TLS_PORT:-18443}
+WORK=$(mktemp -d /tmp/loadtest.XXXXXX)
+PIDS=""
+
+cleanup() {
+    for p in $PIDS; do kill "$p" 2>/dev/null; done
+    wait 2>/dev/null
+    rm -rf "$WORK"
+}
+trap cleanup EXIT INT TERM
+
+# 私有总线: 允许任意进程注册 org.ofono
+cat > "$WORK/bus.conf" <<EOF
+<busconfig>
+  <type>system</type>
+  <listen>unix:path=$WORK/bus</listen>
+  <auth>EXTERNAL</auth>
+  <policy context="default">
+    <allow own="*"/>
+    <allow send_destination="*" eavesdrop="true"/>
+    <allow eavesdrop="true"/>
+  </policy>
+</busconfig>
+EOF
+dbus-daemon --config-file="$WORK/bus.conf" --nofork --nopidfile >"$WORK/dbus.log" 2>&1 &
+PIDS="$PIDS $!"
+for i in $(seq 1 50); do [ -S "$WORK/bus" ] && break; sleep 0.1; done
+if [ ! -S "$WORK/bus" ]; then
+    echo "dbus-daemon 启动失败:" >&2
+    cat "$WORK/dbus.log" >&2
+    exit 1
+fi
+export DBUS_SYSTEM_BUS_ADDRESS="unix:path=$WORK/bus"
+
+"$BIN/mock_ofono" -d "$FIXTURES" -a "${LOADTEST_AT_DELAY:-0}" >"$WORK/mock.log" 2>&1 &
+PIDS="$PIDS $!"
+for i in $(seq 1 50); do grep -q org.ofono "$WORK/mock.log" && break; sleep 0.1; done
+
+# 服务端在临时目录中运行，数据库 (6677.db) 和自签名证书随目录一起删除
+(cd "$WORK" && exec "$BIN/ofono-server" "$PORT" "$TLS_PORT") >"$WORK/server.log" 2>&1 &
+SERVER=$!
+PIDS="$PIDS $SERVER"
+
+if [ "${LOADTEST_HTTPS:-0}" = 1 ]; then
+    # 证书在后台生成，HTTPS 端口稍晚于 HTTP 开始监听 (loadgen 登录时会重试)
+    URL="https://127.0.0.1:$TLS_PORT"
+else
+    URL="http://127.0.0.1:$PORT"
+fi
+
+"$BIN/loadgen" -u "$URL" -p "$SERVER" "$@"
+status=$?
+if ! kill -0 "$SERVER" 2>/dev/null; then
+    echo "ofono-server 已退出，日志:" >&2
+    tail -n 20 "$WORK/server.log" >&2
+    status=1
+fi
+exit $status
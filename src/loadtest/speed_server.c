@@ -0,0 +1,163 @@
+/**
+ * @file speed_server.c
+ * @brief 测速替身服务器 (/api/speedtest 的本地对端)
+ *
+ * 与 LibreSpeed 的接口兼容:
+ *   GET  任意路径   返回随机内容，大小取查询参数 bytes=N 或 ckSize=N (MB)，
+ *                   都没有时一直发送到客户端断开
+ *   POST 任意路径   读取并丢弃请求体 (按 Content-Length，或直到客户端断开)，返回 200
+ *
+ * 每条连接一个线程，只用于在主机上验证测速引擎的吞吐统计和 CPU 开销。
+ *
+ * 用法: speed_server [-p 端口]
+ *       curl -X POST .../api/speedtest -d '{"download_url":"http://127.0.0.1:18090/garbage",
+ *                                           "upload_url":"http://127.0.0.1:18090/empty"}'
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static uint8_t g_payload[64 * 1024];
+
+static int send_all(int fd, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* 查询参数取值，未找到返回 -1 */
+static long long query_ll(const char *line, const char *name) {
+    const char *q = strchr(line, '?');
+    size_t len = strlen(name);
+    for (const char *p = q; p; p = strchr(p + 1, '&')) {
+        if (strncmp(p + 1, name, len) == 0 && p[1 + len] == '=') return atoll(p + 2 + len);
+    }
+    return -1;
+}
+
+static void serve_download(int fd, const char *line) {
+    long long size = query_ll(line, "bytes");
+    long long ck = query_ll(line, "ckSize");
+    if (size < 0 && ck > 0) size = ck * 1024 * 1024;
+
+    char hdr[160];
+    if (size >= 0) {
+        snprintf(hdr, sizeof(hdr),
+                 "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: %lld\r\n"
+                 "Connection: close\r\n\r\n", size);
+    } else {
+        snprintf(hdr, sizeof(hdr),
+                 "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nConnection: close\r\n\r\n");
+    }
+    if (send_all(fd, hdr, strlen(hdr)) != 0) return;
+
+    while (size < 0 || size > 0) {
+        size_t n = sizeof(g_payload);
+        if (size >= 0 && (long long)n > size) n = (size_t)size;
+        if (send_all(fd, g_payload, n) != 0) return;
+        if (size > 0) size -= (long long)n;
+    }
+}
+
+static void serve_upload(int fd, long long length, size_t buffered) {
+    long long left = length >= 0 ? length - (long long)buffered : -1;
+    uint8_t buf[64 * 1024];
+    while (left != 0) {
+        size_t want = left > 0 && left < (long long)sizeof(buf) ? (size_t)left : sizeof(buf);
+        ssize_t n = recv(fd, buf, want, 0);
+        if (n <= 0) return;
+        if (left > 0) left -= n;
+    }
+    const char *resp = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    send_all(fd, resp, strlen(resp));
+}
+
+static void *conn_thread(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    char req[8192];
+    size_t len = 0;
+    char *end = NULL;
+
+    while (!end && len < sizeof(req) - 1) {
+        ssize_t n = recv(fd, req + len, sizeof(req) - 1 - len, 0);
+        if (n <= 0) break;
+        len += (size_t)n;
+        req[len] = '\0';
+        end = strstr(req, "\r\n\r\n");
+    }
+
+    if (end) {
+        *end = '\0';
+        size_t buffered = len - (size_t)(end + 4 - req);
+        char *eol = strstr(req, "\r\n");
+        if (eol) *eol = '\0';
+        if (strncmp(req, "POST ", 5) == 0) {
+            long long length = -1;
+            for (char *h = eol ? eol + 2 : NULL; h && *h; h = strstr(h, "\r\n") ? strstr(h, "\r\n") + 2 : NULL) {
+                if (strncasecmp(h, "Content-Length:", 15) == 0) length = atoll(h + 15);
+            }
+            serve_upload(fd, length, buffered);
+        } else {
+            serve_download(fd, req);
+        }
+    }
+    close(fd);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    int port = 18090;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "用法: speed_server [-p 端口]\n");
+            return 1;
+        }
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    uint32_t x = 2463534242u;
+    for (size_t i = 0; i < sizeof(g_payload); i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        g_payload[i] = (uint8_t)x;
+    }
+
+    int lfd = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons((uint16_t)port)};
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(lfd, 64) != 0) {
+        perror("speed_server: listen");
+        return 1;
+    }
+    fprintf(stderr, "speed_server: 监听 :%d\n", port);
+
+    for (;;) {
+        int fd = accept(lfd, NULL, NULL);
+        if (fd < 0) continue;
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, conn_thread, (void *)(intptr_t)fd) != 0) {
+            close(fd);
+            continue;
+        }
+        pthread_detach(tid);
+    }
+}
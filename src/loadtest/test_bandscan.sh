@@ -0,0 +1,77 @@
+#!/bin/sh
+# 频段扫描场景测试: 模拟模块按 AT+SPLBAND 锁定从站点表中选择驻留频段
+# 用法: loadtest/test_bandscan.sh 构建目录 (需要 ofono-server、mock_ofono、speed_server)
+#
+# 1. 扫描 N78 / N79 / FDD_03 并应用: N78 被锁定；N79 无站点 (无服务)，
+#    只锁 4G 时模块仍驻留 5G (其他频段)，两者都不参与排名
+# 2. 采样途中取消: 当前候选保留已采集的样本并标记 cancelled，恢复扫描前的锁定 (N78)
+# 3. 测速: 拒绝非 http(s) 的 probe_url；对本地替身服务器测速，结束后测速配置保持不变
+
+if [ $# -lt 1 ]; then
+    echo "用法: $0 构建目录" >&2
+    exit 1
+fi
+BIN=$(cd "$1" && pwd) || exit 1
+. "$(dirname "$0")/env.sh"
+
+SPEED_PORT=18090
+
+# 等待扫描结束，输出最终状态
+wait_scan() {
+    for i in $(seq 1 300); do
+        s=$(api GET /api/bandscan)
+        [ "$(printf '%s' "$s" | jq -r .state)" != running ] && break
+        sleep 0.2
+    done
+    printf '%s' "$s"
+}
+
+stack_start
+
+r=$(api POST /api/bandscan/start \
+    '{"candidates":[["N78"],["N79"],["FDD_03"]],"settle_sec":0,"samples":2,"interval_ms":100}')
+check "扫描启动" '.success == true and .candidates == 3' "$r"
+s=$(wait_scan)
+check "扫描完成并应用 N78" '.state == "done" and .applied == "N78"' "$s"
+check "只有 N78 参与排名" '[.candidates[] | select(.rank > 0) | .name] == ["N78"]' "$s"
+check "N79 无服务" '.candidates[1].status == "no_service" and .candidates[1].rank == 0' "$s"
+check "FDD_03 驻留在其他频段" '.candidates[2].status == "other_band" and .candidates[2].serving_band == "N78"' "$s"
+check "采样数" '.candidates[0].samples == 2 and .candidates[0].sinr_avg == 15' "$s"
+b=$(api GET /api/current_band)
+check "当前驻留 N78" 'tostring | test("N78")' "$b"
+
+r=$(api POST /api/bandscan/start \
+    '{"candidates":[["N41"],["FDD_03"]],"settle_sec":0,"samples":20,"interval_ms":500}')
+check "第二次扫描启动" '.success == true' "$r"
+for i in $(seq 1 100); do
+    s=$(api GET /api/bandscan)
+    printf '%s' "$s" | jq -e '.candidates[0].status == "measuring"' >/dev/null && break
+    sleep 0.1
+done
+# 锁频 (数次 AT 命令) 完成后已采集若干样本，仍在采样间隔中
+sleep 5
+r=$(api POST /api/bandscan/cancel)
+check "取消请求" '.status == "success" or .success == true' "$r"
+s=$(wait_scan)
+check "扫描已取消" '.state == "cancelled"' "$s"
+check "没有停留在 measuring 的候选" '[.candidates[] | select(.status == "measuring")] | length == 0' "$s"
+check "当前候选保留部分样本" \
+    '.candidates[0].status == "cancelled" and .candidates[0].samples >= 1 and .candidates[0].samples < 20' "$s"
+check "未测量的候选保持 pending" '.candidates[1].status == "pending"' "$s"
+b=$(api GET /api/current_band)
+check "恢复扫描前的锁定 (N78)" 'tostring | test("N78")' "$b"
+
+r=$(api POST /api/bandscan/start '{"candidates":[["N78"]],"probe_url":"-o/tmp/x file:///etc/passwd"}')
+check "拒绝非 http(s) 的测速地址" '.error != null' "$r"
+
+"$BIN/speed_server" -p "$SPEED_PORT" >"$WORK/speed.log" 2>&1 &
+PIDS="$PIDS $!"
+r=$(api POST /api/bandscan/start "{\"candidates\":[[\"N78\"]],\"settle_sec\":0,\"samples\":1,
+    \"probe_url\":\"http://127.0.0.1:$SPEED_PORT/garbage\",\"probe_sec\":2}")
+check "测速扫描启动" '.success == true' "$r"
+s=$(wait_scan)
+check "候选下行测速" '.state == "done" and .candidates[0].throughput_kbps > 0' "$s"
+t=$(api GET /api/speedtest)
+check "测速配置未被扫描覆盖" '.state == "done" and .config.download_url == "" and .config.duration_sec == 10' "$t"
+
+stack_finish
@@ -0,0 +1,114 @@
+#!/bin/sh
+# 带宽整形场景测试: 私有网络命名空间中用 veth 模拟热点客户端，测速替身服务器作为对端
+# 用法: loadtest/test_qos.sh 构建目录 (需要 ofono-server、mock_ofono、speed_server、unshare、nsenter、ip、tc)
+#
+#   本命名空间  lan0 192.168.77.1 ── veth ── cli0 192.168.77.10  客户端命名空间 (curl)
+#               wan0 (ifb，仅承载 WAN 出方向整形)
+#
+# 1. 客户端下行 4 Mbit / 上行 2 Mbit: 持续下载/上传时该客户端类的字节速率落在限速附近
+# 2. 修改限速: 只增量替换该客户端的类，下行速率随之变化
+# 3. 关闭: 删除 LAN/IFB/WAN 上的整形规则
+
+if [ $# -lt 1 ]; then
+    echo "用法: $0 构建目录" >&2
+    exit 1
+fi
+BIN=$(cd "$1" && pwd) || exit 1
+NEED_NETNS=1
+. "$(dirname "$0")/env.sh"
+
+CLIENT_IP=192.168.77.10
+SPEED_PORT=18090
+
+# 客户端命名空间由一个常驻进程持有
+unshare -n sleep 600 &
+HOLDER=$!
+PIDS="$PIDS $HOLDER"
+sleep 0.2
+ip link add lan0 type veth peer name cli0 && ip link set cli0 netns "$HOLDER" && ip link add wan0 type ifb || {
+    echo "SKIP $(basename "$0"): 无法创建 veth/ifb 接口"
+    exit 0
+}
+ip addr add 192.168.77.1/24 dev lan0
+ip link set lan0 up
+ip link set wan0 up
+nsenter -t "$HOLDER" -n sh -c "ip link set lo up; ip addr add $CLIENT_IP/24 dev cli0; ip link set cli0 up"
+
+# 叶子队列: 优先 fq_codel，内核不支持时退回 pfifo
+LEAF=pfifo
+if tc qdisc add dev wan0 root fq_codel 2>/dev/null; then
+    LEAF=fq_codel
+    tc qdisc del dev wan0 root
+fi
+
+"$BIN/speed_server" -p "$SPEED_PORT" >"$WORK/speed.log" 2>&1 &
+PIDS="$PIDS $!"
+head -c 8000000 /dev/urandom > "$WORK/upload.bin"
+
+# 客户端测速 (字节/秒): down 或 up
+# curl 持续传输期间，按 /api/qos 中该客户端类的字节计数在 3 秒窗口内的增量计算，
+# 跳过开头 1.5 秒 (慢启动、套接字缓冲区填充)
+client_speed() {
+    if [ "$1" = down ]; then
+        nsenter -t "$HOLDER" -n curl -s -o /dev/null --max-time 6 \
+            "http://192.168.77.1:$SPEED_PORT/garbage?bytes=100000000" &
+        field=download
+    else
+        nsenter -t "$HOLDER" -n curl -s -o /dev/null --max-time 6 \
+            --data-binary @"$WORK/upload.bin" "http://192.168.77.1:$SPEED_PORT/empty" &
+        field=upload
+    fi
+    curl_pid=$!
+    sleep 1.5
+    b1=$(api GET /api/qos | jq ".clients[0].$field.bytes")
+    sleep 3
+    b2=$(api GET /api/qos | jq ".clients[0].$field.bytes")
+    wait "$curl_pid"
+    echo $(((b2 - b1) / 3))
+}
+
+# 速率 (字节/秒，含链路层开销) 与限速 (kbit) 相差不超过 15%
+near() {
+    awk -v r="$1" -v k="$2" 'BEGIN { e = k * 125; exit !(r > e * 0.85 && r < e * 1.15) }'
+}
+
+stack_start
+
+r=$(api POST /api/qos "{\"enabled\":true,\"lan_iface\":\"lan0\",\"wan_iface\":\"wan0\",\"ifb_iface\":\"ifb9\",
+    \"down_kbit\":50000,\"up_kbit\":20000,\"leaf\":\"$LEAF\",
+    \"clients\":[{\"ip\":\"$CLIENT_IP\",\"down_kbit\":4000,\"up_kbit\":2000}]}")
+check "规则下发无错误" '.status == "success" and .error == ""' "$r"
+s=$(api GET /api/qos)
+check "整形树已建立" '.state | .download_tree and .upload_tree and .wan_tree' "$s"
+
+tc class show dev lan0 | grep -q "1:10 .*ceil 4Mbit" && echo "ok   LAN 客户端类 ceil 4Mbit" ||
+    { echo "FAIL LAN 客户端类" >&2; tc class show dev lan0 >&2; FAILED=1; }
+tc class show dev ifb9 | grep -q "1:10 .*ceil 2Mbit" && echo "ok   IFB 客户端类 ceil 2Mbit" ||
+    { echo "FAIL IFB 客户端类" >&2; tc class show dev ifb9 >&2; FAILED=1; }
+
+down=$(client_speed down)
+near "$down" 4000 && echo "ok   下行 ${down} B/s ≈ 4 Mbit" || { echo "FAIL 下行 ${down} B/s，期望约 500000" >&2; FAILED=1; }
+up=$(client_speed up)
+near "$up" 2000 && echo "ok   上行 ${up} B/s ≈ 2 Mbit" || { echo "FAIL 上行 ${up} B/s，期望约 250000" >&2; FAILED=1; }
+
+s=$(api GET /api/qos)
+check "客户端字节计数" '.clients[0].download.bytes > 1000000 and .clients[0].upload.bytes > 500000' "$s"
+
+r=$(api POST /api/qos "{\"clients\":[{\"ip\":\"$CLIENT_IP\",\"down_kbit\":8000,\"up_kbit\":2000}]}")
+check "修改限速只替换一个类" '.status == "success" and .commands == 1' "$r"
+tc class show dev lan0 | grep -q "1:10 .*ceil 8Mbit" && echo "ok   LAN 客户端类 ceil 8Mbit" ||
+    { echo "FAIL 修改后的 LAN 客户端类" >&2; tc class show dev lan0 >&2; FAILED=1; }
+down=$(client_speed down)
+near "$down" 8000 && echo "ok   下行 ${down} B/s ≈ 8 Mbit" || { echo "FAIL 下行 ${down} B/s，期望约 1000000" >&2; FAILED=1; }
+
+r=$(api POST /api/qos '{"enabled":false}')
+check "关闭整形" '.status == "success" and .error == ""' "$r"
+if tc qdisc show dev lan0 | grep -q htb || tc qdisc show dev wan0 | grep -q htb; then
+    echo "FAIL 关闭后仍有 htb 规则" >&2
+    tc qdisc show >&2
+    FAILED=1
+else
+    echo "ok   关闭后 LAN/WAN 无 htb 规则"
+fi
+
+stack_finish
@@ -0,0 +1,97 @@
+#!/bin/sh
+# USB 模式热切换场景测试: USB_MODE_ROOT 指向临时目录中的假 configfs/sysfs 树
+# 用法: loadtest/test_usb.sh 构建目录 (需要 ofono-server、mock_ofono)
+#
+# 初始状态与设备出厂的 RNDIS 配置相同 (f1=rndis.gs4，f2-f9 为串口/adb)。
+# 1. RNDIS 的 dry_run 计划没有 configfs 变更，不解绑 UDC
+# 2. 切换到 NCM: 解绑一次、替换 f1、删除 rndis 功能目录、改写 PID/配置名，随后重新绑定
+# 3. 再次计划 NCM 无变更；切回 RNDIS 后目录树与初始状态一致
+
+if [ $# -lt 1 ]; then
+    echo "用法: $0 构建目录" >&2
+    exit 1
+fi
+BIN=$(cd "$1" && pwd) || exit 1
+. "$(dirname "$0")/env.sh"
+
+ROOT="$WORK/usbroot"
+G=$ROOT/sys/kernel/config/usb_gadget/g1
+F=$G/functions
+C=$G/configs/b.1
+UDC=29100000.dwc3
+
+mkdir -p "$F" "$C/strings/0x409" "$ROOT/sys/class/udc/$UDC" "$ROOT/dev/usb-ffs/adb" \
+    "$ROOT/sys/class/net/rndis0" "$ROOT/sys/class/net/usb0"
+echo "$UDC" > "$G/UDC"
+echo 0x1782 > "$G/idVendor"
+echo 0x4038 > "$G/idProduct"
+echo 0x0404 > "$G/bcdDevice"
+echo 0x00 > "$G/bDeviceClass"
+echo rndis > "$C/strings/0x409/configuration"
+echo 500 > "$C/MaxPower"
+echo 0xc0 > "$C/bmAttributes"
+for f in rndis.gs4 gser.gs0 gser.gs2 gser.gs3 gser.gs4 gser.gs5 gser.gs6 vser.gs0 ffs.adb; do
+    mkdir "$F/$f"
+done
+i=1
+for f in rndis.gs4 gser.gs2 gser.gs0 vser.gs0 gser.gs3 ffs.adb gser.gs4 gser.gs5 gser.gs6; do
+    ln -s "$F/$f" "$C/f$i"
+    i=$((i + 1))
+done
+touch "$ROOT/dev/usb-ffs/adb/ep1"
+
+# 目录树快照: 链接目标和属性文件内容 (忽略末尾换行，sysfs 写入时可以不带)
+tree_state() {
+    (cd "$ROOT" && find . -type l -printf '%p -> %l\n' -o -type f -printf '%p ' \
+        -exec sh -c 'printf "%s\n" "$(cat "$1")"' _ {} \; | sort)
+}
+INITIAL=$(tree_state)
+
+export USB_MODE_ROOT="$ROOT"
+stack_start
+
+# 执行切换并等待完成，输出最近一次计划
+switch_mode() {
+    api POST /api/usb-advance "{\"mode\":$1}" >/dev/null
+    sleep 0.3
+    for i in $(seq 1 50); do
+        s=$(api GET /api/usb-advance)
+        printf '%s' "$s" | jq -e '.Data.switching == false' >/dev/null && break
+        sleep 0.1
+    done
+    printf '%s' "$s"
+}
+
+p=$(api POST /api/usb-advance '{"mode":3,"dry_run":true}')
+check "RNDIS 计划无 configfs 变更" \
+    '.Code == 0 and ([.Data.steps[].op] | index("udc_unbind") == null and index("symlink") == null and index("udc_bind") == null)' "$p"
+
+p=$(api POST /api/usb-advance '{"mode":1,"dry_run":true}')
+check "NCM 计划只解绑一次" '[.Data.steps[] | select(.op == "udc_unbind")] | length == 1' "$p"
+check "NCM 计划只替换 f1" \
+    '[.Data.steps[] | select(.op == "unlink" or .op == "symlink") | .path | split("/") | last] == ["f1", "f1"]' "$p"
+
+s=$(switch_mode 1)
+check "切换到 NCM 成功" '.Data.last.ret == 0 and .Data.last.mode == "cdc_ncm" and ([.Data.last.steps[].ok] | all)' "$s"
+check "记录链路中断时长" '.Data.last.outage_ms > 0 and .Data.last.outage_ms <= .Data.last.total_ms' "$s"
+check "f1 指向 ncm.gs0" '. == "ncm.gs0"' "\"$(basename "$(readlink "$C/f1")")\""
+check "删除 rndis 功能目录" '. == false' "$([ -d "$F/rndis.gs4" ] && echo true || echo false)"
+check "PID 与配置名" '. == "0x4040 ncm"' "\"$(cat "$G/idProduct") $(cat "$C/strings/0x409/configuration")\""
+check "UDC 重新绑定" ". == \"$UDC\"" "\"$(cat "$G/UDC")\""
+
+p=$(api POST /api/usb-advance '{"mode":1,"dry_run":true}')
+check "已是 NCM 时计划无 configfs 变更" '[.Data.steps[].op] | index("udc_unbind") == null' "$p"
+
+s=$(switch_mode 3)
+check "切回 RNDIS 成功" '.Data.last.ret == 0 and .Data.last.mode == "rndis"' "$s"
+if [ "$(tree_state)" = "$INITIAL" ]; then
+    echo "ok   目录树恢复到初始状态"
+else
+    echo "FAIL 目录树与初始状态不同:" >&2
+    tree_state | diff -u /dev/fd/3 - 3<<EOF >&2
+$INITIAL
+EOF
+    FAILED=1
+fi
+
+stack_finish
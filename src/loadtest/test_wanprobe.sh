@@ -0,0 +1,61 @@
+#!/bin/sh
+# WAN 探测场景测试: 在私有网络命名空间中以本地替身作为探测目标
+# 用法: loadtest/test_wanprobe.sh 构建目录 (需要 ofono-server、mock_ofono、unshare、ip)
+#
+#   tcp:127.0.0.1:服务端口   正常应答
+#   tcp:127.0.0.1:1          端口关闭，RST 同样计为应答
+#   icmp:127.0.0.1           ICMP Echo
+#   tcp/icmp:10.9.9.2        经 ifb 接口发出后被丢弃 (ifb 只转发 tc 重定向来的包)，全部超时
+# 随后 iface 绑定到 ifb 接口: 本机目标也不可达，验证 SO_BINDTODEVICE 生效；reset 清空统计。
+
+if [ $# -lt 1 ]; then
+    echo "用法: $0 构建目录" >&2
+    exit 1
+fi
+BIN=$(cd "$1" && pwd) || exit 1
+NEED_NETNS=1
+. "$(dirname "$0")/env.sh"
+
+ip link add probe0 type ifb && ip addr add 10.9.9.1/24 dev probe0 && ip link set probe0 up || {
+    echo "SKIP $(basename "$0"): 无法创建 ifb 接口"
+    exit 0
+}
+
+stack_start
+
+r=$(api POST /api/wanprobe "{\"enabled\":true,\"interval_sec\":1,\"count\":3,\"timeout_ms\":300,\"iface\":\"\",
+    \"targets\":[\"tcp:127.0.0.1:$PORT\",\"tcp:127.0.0.1:1\",\"icmp:127.0.0.1\",\"tcp:10.9.9.2:80\",\"icmp:10.9.9.2\"]}")
+check "配置已保存" '.status == "success"' "$r"
+for i in $(seq 1 50); do
+    s=$(api GET /api/wanprobe)
+    printf '%s' "$s" | jq -e '[.targets[].sent] | min >= 6' >/dev/null && break
+    sleep 0.2
+done
+check "探测线程运行" '.state.running == true and .state.rounds >= 2' "$s"
+check "本机 TCP 端口全部应答" '.targets[0].loss_pct == 0 and .targets[0].received == .targets[0].sent' "$s"
+check "关闭端口 (RST) 计为应答" '.targets[1].loss_pct == 0 and .targets[1].received > 0' "$s"
+check "ICMP Echo 应答" '.targets[2].loss_pct == 0 and .targets[2].rtt_ms.max < 300' "$s"
+check "RTT 分位数有序" '.targets[0].rtt_ms | .min <= .p50 and .p50 <= .p90 and .p90 <= .p99 and .p99 <= .max' "$s"
+check "被丢弃的 TCP 目标全部丢包" '.targets[3].received == 0 and .targets[3].loss_pct == 100' "$s"
+check "被丢弃的 ICMP 目标全部丢包" '.targets[4].received == 0 and .targets[4].loss_pct == 100' "$s"
+check "逐轮历史" '.targets[0].history | length >= 2 and all(.sent == 3)' "$s"
+code=$(curl -s -o /dev/null -w '%{http_code}' -H "Authorization: Bearer $TOKEN" "$URL/metrics")
+check "会话令牌不能拉取指标" '. == 401' "$code"
+SCRAPE=$(api POST /api/auth/scrape-token | jq -r '.token // empty')
+m=$(curl -s -H "Authorization: Bearer $SCRAPE" "$URL/metrics")
+check "指标: 5 个目标中 2 个全丢 (40%)" \
+    'test("ofono_wan_loss_percent 40\\.00") and test("ofono_wan_reachable_targets 3")' "$(printf '%s' "$m" | jq -Rs .)"
+
+r=$(api POST /api/wanprobe "{\"iface\":\"probe0\",\"targets\":[\"tcp:127.0.0.1:$PORT\"],\"reset\":true}")
+check "绑定接口并清空统计" '.status == "success"' "$r"
+sleep 0.5
+s=$(api GET /api/wanprobe)
+check "清空后重新计数" '.targets | length == 1 and .[0].sent <= 3' "$s"
+for i in $(seq 1 50); do
+    s=$(api GET /api/wanprobe)
+    printf '%s' "$s" | jq -e '.targets[0].sent >= 6' >/dev/null && break
+    sleep 0.2
+done
+check "绑定到 ifb 接口后本机目标不可达" '.config.iface == "probe0" and .targets[0].received == 0' "$s"
+
+stack_finish
@@ -3,37 +3,36 @@
  * @brief 服务器主程序入口 (对应 Go: main.go)
  */
 
+#include "feature.h"
 #include "http_server.h"
-#include "netif.h"
 #include "ofono.h"
+#include "startup.h"
+#include "tls.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 int main(int argc, char *argv[]) {
   const char *port = "6677";
+#if FEATURE_TLS
+  const char *tls_port = TLS_DEFAULT_PORT;
+#endif
+
+  /* 记录进程启动时间 */
+  startup_init();
 
   /* 解析命令行参数 */
   if (argc > 1) {
     port = argv[1];
   }
-
-  printf("=== ofono-server (C version) ===\n");
-
-  /* 同步系统时间 */
-  system("ntpdate ntp.aliyun.com > /dev/null 2>&1 &");
-
-  /* 初始化 ofono D-Bus 连接 */
-  if (!ofono_init()) {
-    fprintf(stderr, "警告: ofono D-Bus 连接失败，部分功能可能不可用\n");
+#if FEATURE_TLS
+  /* 第二个参数为 HTTPS 端口，0 表示不启用 */
+  if (argc > 2) {
+    tls_port = argv[2];
   }
+#endif
 
-  /* 初始化网络接口监听（自动恢复之前启用的监听） */
-  init_netif();
-
-  /* 启动数据连接监听（无论当前状态） */
-  printf("启动数据连接监听...\n");
-  ofono_start_data_monitor();
+  printf("=== ofono-server (C version) ===\n");
 
   /* 启动 HTTP 服务器 */
   if (http_server_start(port) != 0) {
@@ -42,6 +41,9 @@ int main(int argc, char *argv[]) {
     ofono_deinit();
     return 1;
   }
+#if FEATURE_TLS
+  http_server_enable_tls(tls_port);
+#endif
 
   /* 运行事件循环 */
   http_server_run();
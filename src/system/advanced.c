@@ -3,6 +3,7 @@
  * @brief 高级网络功能实现 (Go: handlers/advanced.go)
  */
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,11 +11,15 @@
 #include <glib.h>
 #include "mongoose.h"
 #include "advanced.h"
+#include "bandscan.h"
+#include "cellsel.h"
+#include "radiocfg.h"
 #include "dbus_core.h"
 #include "exec_utils.h"
 #include "http_utils.h"
 #include "ofono.h"
 #include "json_builder.h"
+#include "telemetry.h"
 
 /* 频段映射结构 */
 typedef struct {
@@ -186,77 +191,122 @@ static int parse_bands_array(const char *json_str, char bands[][32], int max_ban
     return count;
 }
 
-/* POST /api/lock_bands - 锁定频段 */
-void handle_lock_bands(struct mg_connection *c, struct mg_http_message *hm) {
-    HTTP_CHECK_POST(c, hm);
+/* 解析 AT+SPLBAND 查询结果中的位掩码 (4G: +SPLBAND: 0,tdd,0,fdd,0; 5G: +SPLBAND: fdd,0,tdd,0) */
+int advanced_get_band_lock(BandLockMask *mask) {
+    char *result4G = NULL, *result5G = NULL;
+    int ret = 0;
 
-    char bands[32][32] = {{0}};
-    int band_count = parse_bands_array(hm->body.buf, bands, 32);
+    memset(mask, 0, sizeof(*mask));
+    if (execute_at("AT+SPLBAND=0", &result4G) == 0 && result4G) {
+        char *p = strstr(result4G, "+SPLBAND:");
+        if (p) sscanf(p, "+SPLBAND: 0,%d,0,%d,0", &mask->tdd4g, &mask->fdd4g);
+    } else {
+        ret = -1;
+    }
+    if (execute_at("AT+SPLBAND=3", &result5G) == 0 && result5G) {
+        char *p = strstr(result5G, "+SPLBAND:");
+        if (p) sscanf(p, "+SPLBAND: %d,0,%d,0", &mask->fdd5g, &mask->tdd5g);
+    } else {
+        ret = -1;
+    }
 
-    printf("收到锁频请求，要锁定的频段数量: %d\n", band_count);
+    if (result4G) g_free(result4G);
+    if (result5G) g_free(result5G);
+    return ret;
+}
 
-    /* 计算位掩码 */
-    int tdd4G = 0, fdd4G = 0, fdd5G = 0, tdd5G = 0;
-    for (int i = 0; i < band_count; i++) {
-        const BandMapping *bm = find_band(bands[i]);
-        if (bm) {
-            printf("处理频段 %s: 模式=%s, 类型=%s, 值=%d\n", bm->name, bm->mode, bm->type, bm->value);
-            if (strcmp(bm->mode, "4G") == 0 && strcmp(bm->type, "TDD") == 0) {
-                tdd4G |= bm->value;
-            } else if (strcmp(bm->mode, "4G") == 0 && strcmp(bm->type, "FDD") == 0) {
-                fdd4G |= bm->value;
-            } else if (strcmp(bm->mode, "5G") == 0 && strcmp(bm->type, "TDD") == 0) {
-                tdd5G |= bm->value;
-            } else if (strcmp(bm->mode, "5G") == 0 && strcmp(bm->type, "FDD") == 0) {
-                fdd5G |= bm->value;
-            }
+int advanced_band_mask_from_names(const char names[][32], int count, BandLockMask *mask) {
+    int matched = 0;
+
+    memset(mask, 0, sizeof(*mask));
+    for (int i = 0; i < count; i++) {
+        const BandMapping *bm = find_band(names[i]);
+        if (!bm) continue;
+        if (strcmp(bm->mode, "4G") == 0 && strcmp(bm->type, "TDD") == 0) {
+            mask->tdd4g |= bm->value;
+        } else if (strcmp(bm->mode, "4G") == 0 && strcmp(bm->type, "FDD") == 0) {
+            mask->fdd4g |= bm->value;
+        } else if (strcmp(bm->mode, "5G") == 0 && strcmp(bm->type, "TDD") == 0) {
+            mask->tdd5g |= bm->value;
+        } else if (strcmp(bm->mode, "5G") == 0 && strcmp(bm->type, "FDD") == 0) {
+            mask->fdd5g |= bm->value;
         }
+        matched++;
     }
+    return matched;
+}
 
-    printf("计算结果: 4G TDD=%d, 4G FDD=%d, 5G FDD=%d, 5G TDD=%d\n", tdd4G, fdd4G, fdd5G, tdd5G);
+const char *advanced_band_name(int index) {
+    if (index < 0 || index >= (int)(sizeof(band_map) / sizeof(band_map[0])) - 1) return NULL;
+    return band_map[index].name;
+}
 
+/* 执行一条 AT 命令并等待模块处理，忽略返回内容 */
+static int at_step(const char *cmd) {
     char *result = NULL;
+    int ret = execute_at(cmd, &result);
+    if (result) g_free(result);
+    usleep(300000);
+    return ret;
+}
+
+int advanced_radio_off(void) {
+    return at_step("AT+SFUN=5") == 0 ? 0 : -1;
+}
+
+void advanced_radio_on(void) {
+    char *result = NULL;
+
+    at_step("AT+SFUN=4");
+    /* 激活网络 */
+    execute_at("AT+CGACT=0,1", &result);
+    if (result) g_free(result);
+}
+
+int advanced_write_band_lock(const BandLockMask *mask) {
     char cmd[128];
+    int ret = 0;
 
-    /* 执行命令序列 */
-    /* 1. 关闭设备 */
-    if (execute_at("AT+SFUN=5", &result) != 0) {
-        HTTP_ERROR(c, 500, "关闭设备失败");
-        if (result) g_free(result);
-        return;
-    }
-    if (result) { g_free(result); result = NULL; }
-    usleep(300000);
+    printf("设置频段锁定: 4G TDD=%d, 4G FDD=%d, 5G FDD=%d, 5G TDD=%d\n",
+           mask->tdd4g, mask->fdd4g, mask->fdd5g, mask->tdd5g);
 
-    /* 2. 解锁5G频段 */
-    execute_at("AT+SPLBAND=2,0,0,0,0", &result);
-    if (result) { g_free(result); result = NULL; }
-    usleep(300000);
+    /* 4G 频段 (全 0 为解锁) */
+    snprintf(cmd, sizeof(cmd), "AT+SPLBAND=1,0,%d,0,%d,0", mask->tdd4g, mask->fdd4g);
+    if (at_step(cmd) != 0) ret = -1;
 
-    /* 3. 锁定4G频段 */
-    if (tdd4G != 0 || fdd4G != 0) {
-        snprintf(cmd, sizeof(cmd), "AT+SPLBAND=1,0,%d,0,%d,0", tdd4G, fdd4G);
-        execute_at(cmd, &result);
-        if (result) { g_free(result); result = NULL; }
-        usleep(300000);
-    }
+    /* 5G 频段 (全 0 为解锁) */
+    snprintf(cmd, sizeof(cmd), "AT+SPLBAND=2,%d,0,%d,0", mask->fdd5g, mask->tdd5g);
+    if (at_step(cmd) != 0) ret = -1;
+    return ret;
+}
+
+int advanced_set_band_lock(const BandLockMask *mask) {
+    if (advanced_radio_off() != 0) return -1;
+    int ret = advanced_write_band_lock(mask);
+    advanced_radio_on();
+    return ret;
+}
+
+/* POST /api/lock_bands - 锁定频段 */
+void handle_lock_bands(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_POST(c, hm);
 
-    /* 4. 锁定5G频段 */
-    if (fdd5G != 0 || tdd5G != 0) {
-        snprintf(cmd, sizeof(cmd), "AT+SPLBAND=2,%d,0,%d,0", fdd5G, tdd5G);
-        execute_at(cmd, &result);
-        if (result) { g_free(result); result = NULL; }
-        usleep(300000);
+    if (bandscan_running() || radiocfg_running()) {
+        HTTP_ERROR(c, 409, "射频配置或频段扫描进行中");
+        return;
     }
 
-    /* 5. 开启设备 */
-    execute_at("AT+SFUN=4", &result);
-    if (result) { g_free(result); result = NULL; }
-    usleep(300000);
+    char bands[32][32] = {{0}};
+    int band_count = parse_bands_array(hm->body.buf, bands, 32);
 
-    /* 6. 激活网络 */
-    execute_at("AT+CGACT=0,1", &result);
-    if (result) g_free(result);
+    printf("收到锁频请求，要锁定的频段数量: %d\n", band_count);
+
+    BandLockMask mask;
+    advanced_band_mask_from_names(bands, band_count, &mask);
+    if (advanced_set_band_lock(&mask) != 0) {
+        HTTP_ERROR(c, 500, "关闭设备失败");
+        return;
+    }
 
     printf("频段锁定成功\n");
     JsonBuilder *j = json_new();
@@ -272,36 +322,17 @@ void handle_lock_bands(struct mg_connection *c, struct mg_http_message *hm) {
 void handle_unlock_bands(struct mg_connection *c, struct mg_http_message *hm) {
     HTTP_CHECK_POST(c, hm);
 
-    printf("开始解锁所有频段...\n");
-    char *result = NULL;
+    if (bandscan_running() || radiocfg_running()) {
+        HTTP_ERROR(c, 409, "射频配置或频段扫描进行中");
+        return;
+    }
 
-    /* 1. 关闭设备 */
-    if (execute_at("AT+SFUN=5", &result) != 0) {
+    printf("开始解锁所有频段...\n");
+    BandLockMask mask = {0, 0, 0, 0};
+    if (advanced_set_band_lock(&mask) != 0) {
         HTTP_ERROR(c, 500, "关闭设备失败");
-        if (result) g_free(result);
         return;
     }
-    if (result) { g_free(result); result = NULL; }
-    usleep(300000);
-
-    /* 2. 解锁4G频段 */
-    execute_at("AT+SPLBAND=1,0,0,0,0,0", &result);
-    if (result) { g_free(result); result = NULL; }
-    usleep(300000);
-
-    /* 3. 解锁5G频段 */
-    execute_at("AT+SPLBAND=2,0,0,0,0", &result);
-    if (result) { g_free(result); result = NULL; }
-    usleep(300000);
-
-    /* 4. 开启设备 */
-    execute_at("AT+SFUN=4", &result);
-    if (result) { g_free(result); result = NULL; }
-    usleep(300000);
-
-    /* 5. 激活网络 */
-    execute_at("AT+CGACT=0,1", &result);
-    if (result) g_free(result);
 
     printf("频段解锁成功\n");
     JsonBuilder *j = json_new();
@@ -312,8 +343,8 @@ void handle_unlock_bands(struct mg_connection *c, struct mg_http_message *hm) {
     HTTP_OK_FREE(c, json_finish(j));
 }
 
-/* 解析小区数据 (复用 handlers.c 中的函数) */
-extern int parse_cell_to_vec(const char *input, char data[64][16][32]);
+/* 小区解析表大小 (64行 x 16列 x 32字节 = 32KB)，从请求内存池分配，不放在栈上 */
+#define CELL_GRID_SIZE (64 * 16 * 32)
 
 /**
  * 根据 NR ARFCN 推算 5G 频段
@@ -375,55 +406,90 @@ static int is_5g_network(void) {
     return 0; /* 4G 或其他 */
 }
 
-/* 辅助函数：添加小区对象到JSON Builder */
-static void add_cell_to_json(JsonBuilder *j, const char *rat, const char *band_prefix, 
-                              const char *band, int arfcn, int pci,
-                              double rsrp, double rsrq, double sinr, int is_serving) {
-    char band_str[32];
-    snprintf(band_str, sizeof(band_str), "%s%s", band_prefix, band);
-    
-    json_arr_obj_open(j);
-    json_add_str(j, "rat", rat);
-    json_add_str(j, "band", band_str);
-    json_add_int(j, "arfcn", arfcn);
-    json_add_int(j, "pci", pci);
-    json_add_double(j, "rsrp", rsrp);
-    json_add_double(j, "rsrq", rsrq);
-    json_add_double(j, "sinr", sinr);
-    json_add_bool(j, "isServing", is_serving);
-    json_obj_close(j);
+int advanced_get_serving_cell(ServingCell *cell) {
+    if (!cell) return -1;
+    memset(cell, 0, sizeof(ServingCell));
+    strcpy(cell->net_type, "N/A");
+    strcpy(cell->band, "N/A");
+
+    /* 5G: AT+SPENGMD=0,14,1 (SINR 在第15行); 4G: AT+SPENGMD=0,6,0 (SINR 在第33行) */
+    int is_5g = is_5g_network();
+    const char *cmd = is_5g ? "AT+SPENGMD=0,14,1" : "AT+SPENGMD=0,6,0";
+    int min_rows = is_5g ? 15 : 33;
+    int sinr_row = is_5g ? 15 : 33;
+
+    char *result = NULL;
+    if (execute_at(cmd, &result) != 0 || !result || strlen(result) <= 100) {
+        if (result) g_free(result);
+        return -1;
+    }
+
+    char (*data)[16][32] = arena_calloc(CELL_GRID_SIZE);
+    if (!data) {
+        g_free(result);
+        return -1;
+    }
+    int rows = parse_cell_to_vec(result, data);
+    g_free(result);
+
+    int ret = -1;
+    if (rows > min_rows) {
+        strcpy(cell->net_type, is_5g ? "5G NR" : "4G LTE");
+        if (strlen(data[0][0]) > 0) {
+            snprintf(cell->band, sizeof(cell->band), "%s%.30s", is_5g ? "N" : "B", data[0][0]);
+        }
+        if (strlen(data[1][0]) > 0) cell->arfcn = atoi(data[1][0]);
+        if (strlen(data[2][0]) > 0) cell->pci = atoi(data[2][0]);
+        if (strlen(data[3][0]) > 0) cell->rsrp = atof(data[3][0]) / 100.0;
+        if (strlen(data[4][0]) > 0) cell->rsrq = atof(data[4][0]) / 100.0;
+        if (strlen(data[sinr_row][0]) > 0) cell->sinr = atof(data[sinr_row][0]) / 100.0;
+        printf("当前连接%s频段: Band=%s, ARFCN=%d, PCI=%d, RSRP=%.2f, RSRQ=%.2f, SINR=%.2f\n",
+               is_5g ? "5G" : "4G", cell->band, cell->arfcn, cell->pci,
+               cell->rsrp, cell->rsrq, cell->sinr);
+        telemetry_update_radio(cell);
+        ret = 0;
+    }
+
+    arena_free(data);
+    return ret;
 }
 
-/* GET /api/cells - 获取小区信息 */
-void handle_get_cells(struct mg_connection *c, struct mg_http_message *hm) {
-    HTTP_CHECK_GET(c, hm);
+static void add_cell(CellInfo *cells, int max, int *count, const char *rat, const char *band_prefix,
+                     const char *band, int arfcn, int pci,
+                     double rsrp, double rsrq, double sinr, int is_serving) {
+    if (*count >= max) return;
+    CellInfo *cell = &cells[(*count)++];
+    snprintf(cell->rat, sizeof(cell->rat), "%s", rat);
+    snprintf(cell->band, sizeof(cell->band), "%s%.12s", band_prefix, band);
+    cell->arfcn = arfcn;
+    cell->pci = pci;
+    cell->rsrp = rsrp;
+    cell->rsrq = rsrq;
+    cell->sinr = sinr;
+    cell->is_serving = is_serving;
+}
 
-    printf("开始获取小区信息...\n");
+int advanced_get_cells(CellInfo *cells, int max) {
     char *result = NULL;
-    
+    int cell_count = 0;
+
     /* 通过 D-Bus 判断网络类型 (与 Go 版本一致) */
     int is_5g = is_5g_network();
     printf("检测到%s网络\n", is_5g ? "5G" : "4G");
 
-    JsonBuilder *j = json_new();
-    json_obj_open(j);
-    json_add_int(j, "Code", 0);
-    json_add_str(j, "Error", "");
-    json_arr_open(j, "Data");
-    
-    int cell_count = 0;
+    char (*data)[16][32] = arena_alloc(CELL_GRID_SIZE);
+    if (!data) return -1;
 
     if (is_5g) {
         /* 5G 主小区 */
         if (execute_at("AT+SPENGMD=0,14,1", &result) == 0 && result) {
-            char data[64][16][32] = {{{0}}};
+            memset(data, 0, CELL_GRID_SIZE);
             int rows = parse_cell_to_vec(result, data);
             if (rows > 15) {
-                add_cell_to_json(j, "5G", "N", data[0][0],
+                add_cell(cells, max, &cell_count, "5G", "N", data[0][0],
                     atoi(data[1][0]), atoi(data[2][0]),
                     atof(data[3][0]) / 100.0, atof(data[4][0]) / 100.0,
                     atof(data[15][0]) / 100.0, 1);
-                cell_count++;
             }
             g_free(result);
             result = NULL;
@@ -431,7 +497,7 @@ void handle_get_cells(struct mg_connection *c, struct mg_http_message *hm) {
 
         /* 5G 邻小区 */
         if (execute_at("AT+SPENGMD=0,14,2", &result) == 0 && result) {
-            char data[64][16][32] = {{{0}}};
+            memset(data, 0, CELL_GRID_SIZE);
             int rows = parse_cell_to_vec(result, data);
             if (rows > 5) {
                 int col_count = 0;
@@ -447,11 +513,10 @@ void handle_get_cells(struct mg_connection *c, struct mg_http_message *hm) {
                         band_str = arfcn_to_nr_band(arfcn);
                     }
                     
-                    add_cell_to_json(j, "5G", "N", band_str,
+                    add_cell(cells, max, &cell_count, "5G", "N", band_str,
                         arfcn, pci,
                         atof(data[3][i]) / 100.0, atof(data[4][i]) / 100.0,
                         atof(data[5][i]) / 100.0, 0);
-                    cell_count++;
                 }
             }
             g_free(result);
@@ -459,14 +524,13 @@ void handle_get_cells(struct mg_connection *c, struct mg_http_message *hm) {
     } else {
         /* 4G 主小区 */
         if (execute_at("AT+SPENGMD=0,6,0", &result) == 0 && result) {
-            char data[64][16][32] = {{{0}}};
+            memset(data, 0, CELL_GRID_SIZE);
             int rows = parse_cell_to_vec(result, data);
             if (rows > 33) {
-                add_cell_to_json(j, "4G", "B", data[0][0],
+                add_cell(cells, max, &cell_count, "4G", "B", data[0][0],
                     atoi(data[1][0]), atoi(data[2][0]),
                     atof(data[3][0]) / 100.0, atof(data[4][0]) / 100.0,
                     atof(data[33][0]) / 100.0, 1);
-                cell_count++;
             }
             g_free(result);
             result = NULL;
@@ -474,7 +538,7 @@ void handle_get_cells(struct mg_connection *c, struct mg_http_message *hm) {
 
         /* 4G 邻小区 */
         if (execute_at("AT+SPENGMD=0,6,6", &result) == 0 && result) {
-            char data[64][16][32] = {{{0}}};
+            memset(data, 0, CELL_GRID_SIZE);
             int rows = parse_cell_to_vec(result, data);
             for (int i = 0; i < rows; i++) {
                 int arfcn = atoi(data[i][0]);
@@ -488,81 +552,146 @@ void handle_get_cells(struct mg_connection *c, struct mg_http_message *hm) {
                     if (strlen(band) == 0) band = "0";  /* 未知频段默认显示0 */
                 }
                 
-                add_cell_to_json(j, "4G", "B", band,
+                add_cell(cells, max, &cell_count, "4G", "B", band,
                     arfcn, pci,
                     atof(data[i][2]) / 100.0, atof(data[i][3]) / 100.0,
                     atof(data[i][6]) / 100.0, 0);
-                cell_count++;
             }
             g_free(result);
         }
     }
 
+    arena_free(data);
+    return cell_count;
+}
+
+/* GET /api/cells - 获取小区信息 */
+void handle_get_cells(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    printf("开始获取小区信息...\n");
+    CellInfo *cells = arena_alloc(sizeof(CellInfo) * ADVANCED_MAX_CELLS);
+    if (!cells) {
+        HTTP_ERROR(c, 500, "Out of memory");
+        return;
+    }
+    int cell_count = advanced_get_cells(cells, ADVANCED_MAX_CELLS);
+    if (cell_count < 0) {
+        arena_free(cells);
+        HTTP_ERROR(c, 500, "Out of memory");
+        return;
+    }
+
+    JsonBuilder *j = json_new();
+    json_obj_open(j);
+    json_add_int(j, "Code", 0);
+    json_add_str(j, "Error", "");
+    json_arr_open(j, "Data");
+    for (int i = 0; i < cell_count; i++) {
+        json_arr_obj_open(j);
+        json_add_str(j, "rat", cells[i].rat);
+        json_add_str(j, "band", cells[i].band);
+        json_add_int(j, "arfcn", cells[i].arfcn);
+        json_add_int(j, "pci", cells[i].pci);
+        json_add_double(j, "rsrp", cells[i].rsrp);
+        json_add_double(j, "rsrq", cells[i].rsrq);
+        json_add_double(j, "sinr", cells[i].sinr);
+        json_add_bool(j, "isServing", cells[i].is_serving);
+        json_obj_close(j);
+    }
     json_arr_close(j);
     json_obj_close(j);
     printf("小区信息获取完成，共 %d 个小区\n", cell_count);
+    arena_free(cells);
 
     HTTP_OK_FREE(c, json_finish(j));
 }
 
+/* 最近一次写入的小区锁定 (模块没有查询命令，本进程写入之前视为未知) */
+static struct {
+    int known;
+    int lock;
+    int is_5g;
+    int arfcn;
+    int pci;
+} g_cell_lock;
+static pthread_mutex_t g_cell_lock_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+int advanced_write_cell_lock(int lock, int is_5g, int arfcn, int pci) {
+    int ret = 0;
+
+    /* 先解锁 4G 和 5G */
+    if (at_step("AT+SPFORCEFRQ=12,0") != 0) ret = -1;
+    if (at_step("AT+SPFORCEFRQ=16,0") != 0) ret = -1;
+
+    if (lock && ret == 0) {
+        char cmd[128];
+        /* band 参数: 4G=12, 5G=16 */
+        snprintf(cmd, sizeof(cmd), "AT+SPFORCEFRQ=%d,2,%d,%d", is_5g ? 16 : 12, arfcn, pci);
+        if (at_step(cmd) != 0) ret = -1;
+    }
+
+    /* 写入失败时模块的锁定状态不确定，下次必须重新写入 */
+    pthread_mutex_lock(&g_cell_lock_mutex);
+    g_cell_lock.known = ret == 0;
+    g_cell_lock.lock = lock ? 1 : 0;
+    g_cell_lock.is_5g = lock && is_5g ? 1 : 0;
+    g_cell_lock.arfcn = lock ? arfcn : 0;
+    g_cell_lock.pci = lock ? pci : 0;
+    pthread_mutex_unlock(&g_cell_lock_mutex);
+    return ret;
+}
+
+int advanced_get_cell_lock(int *lock, int *is_5g, int *arfcn, int *pci) {
+    pthread_mutex_lock(&g_cell_lock_mutex);
+    int known = g_cell_lock.known;
+    *lock = g_cell_lock.lock;
+    *is_5g = g_cell_lock.is_5g;
+    *arfcn = g_cell_lock.arfcn;
+    *pci = g_cell_lock.pci;
+    pthread_mutex_unlock(&g_cell_lock_mutex);
+    return known ? 0 : -1;
+}
+
+int advanced_lock_cell(int is_5g, int arfcn, int pci) {
+    advanced_radio_off();
+    int ret = advanced_write_cell_lock(1, is_5g, arfcn, pci);
+    advanced_radio_on();
+    return ret;
+}
+
+int advanced_unlock_cell(void) {
+    advanced_radio_off();
+    int ret = advanced_write_cell_lock(0, 0, 0, 0);
+    advanced_radio_on();
+    return ret;
+}
 
 /* POST /api/lock_cell - 锁定小区 */
 void handle_lock_cell(struct mg_connection *c, struct mg_http_message *hm) {
     HTTP_CHECK_POST(c, hm);
 
+    if (cellsel_auto_lock_enabled()) {
+        HTTP_ERROR(c, 409, "自动选择小区已启用");
+        return;
+    }
+
     char technology[32] = {0}, arfcn[32] = {0}, pci[32] = {0};
 
     /* 使用mongoose JSON API解析 */
-    char *tech_str = mg_json_get_str(hm->body, "$.technology");
-    char *arfcn_str = mg_json_get_str(hm->body, "$.arfcn");
-    char *pci_str = mg_json_get_str(hm->body, "$.pci");
-    
-    if (tech_str) { strncpy(technology, tech_str, sizeof(technology) - 1); free(tech_str); }
-    if (arfcn_str) { strncpy(arfcn, arfcn_str, sizeof(arfcn) - 1); free(arfcn_str); }
-    if (pci_str) { strncpy(pci, pci_str, sizeof(pci) - 1); free(pci_str); }
+    http_json_get_str(hm->body, "$.technology", technology, sizeof(technology));
+    http_json_get_str(hm->body, "$.arfcn", arfcn, sizeof(arfcn));
+    http_json_get_str(hm->body, "$.pci", pci, sizeof(pci));
 
     printf("收到锁小区请求: Technology=%s, ARFCN=%s, PCI=%s\n", technology, arfcn, pci);
 
-    /* 确定 band 参数 */
-    const char *band = "12"; /* 4G */
-    if (strstr(technology, "5G") || strstr(technology, "NR") ||
-        strstr(technology, "5g") || strstr(technology, "nr")) {
-        band = "16"; /* 5G */
+    int is_5g = strstr(technology, "5G") || strstr(technology, "NR") ||
+                strstr(technology, "5g") || strstr(technology, "nr");
+    if (advanced_lock_cell(is_5g, atoi(arfcn), atoi(pci)) != 0) {
+        HTTP_ERROR(c, 500, "小区锁定失败");
+        return;
     }
 
-    char *result = NULL;
-    char cmd[128];
-
-    /* 1. 关闭射频 */
-    execute_at("AT+SFUN=5", &result);
-    if (result) { g_free(result); result = NULL; }
-    usleep(300000);
-
-    /* 2. 解锁4G */
-    execute_at("AT+SPFORCEFRQ=12,0", &result);
-    if (result) { g_free(result); result = NULL; }
-    usleep(300000);
-
-    /* 3. 解锁5G */
-    execute_at("AT+SPFORCEFRQ=16,0", &result);
-    if (result) { g_free(result); result = NULL; }
-    usleep(300000);
-
-    /* 4. 锁定小区 */
-    snprintf(cmd, sizeof(cmd), "AT+SPFORCEFRQ=%s,2,%s,%s", band, arfcn, pci);
-    execute_at(cmd, &result);
-    if (result) { g_free(result); result = NULL; }
-    usleep(300000);
-
-    /* 5. 打开射频 */
-    execute_at("AT+SFUN=4", &result);
-    if (result) { g_free(result); result = NULL; }
-    usleep(300000);
-
-    /* 6. 激活网络 */
-    execute_at("AT+CGACT=0,1", &result);
-    if (result) g_free(result);
-
     printf("小区锁定成功\n");
     JsonBuilder *j = json_new();
     json_obj_open(j);
@@ -580,32 +709,16 @@ void handle_lock_cell(struct mg_connection *c, struct mg_http_message *hm) {
 void handle_unlock_cell(struct mg_connection *c, struct mg_http_message *hm) {
     HTTP_CHECK_POST(c, hm);
 
-    printf("开始解锁小区...\n");
-    char *result = NULL;
-
-    /* 1. 关闭射频 */
-    execute_at("AT+SFUN=5", &result);
-    if (result) { g_free(result); result = NULL; }
-    usleep(300000);
-
-    /* 2. 解锁4G */
-    execute_at("AT+SPFORCEFRQ=12,0", &result);
-    if (result) { g_free(result); result = NULL; }
-    usleep(300000);
-
-    /* 3. 解锁5G */
-    execute_at("AT+SPFORCEFRQ=16,0", &result);
-    if (result) { g_free(result); result = NULL; }
-    usleep(300000);
-
-    /* 4. 打开射频 */
-    execute_at("AT+SFUN=4", &result);
-    if (result) { g_free(result); result = NULL; }
-    usleep(300000);
+    if (cellsel_auto_lock_enabled()) {
+        HTTP_ERROR(c, 409, "自动选择小区已启用");
+        return;
+    }
 
-    /* 5. 激活网络 */
-    execute_at("AT+CGACT=0,1", &result);
-    if (result) g_free(result);
+    printf("开始解锁小区...\n");
+    if (advanced_unlock_cell() != 0) {
+        HTTP_ERROR(c, 500, "小区解锁失败");
+        return;
+    }
 
     printf("小区解锁成功\n");
     JsonBuilder *j = json_new();
@@ -0,0 +1,161 @@
+/**
+ * @file arena.c
+ * @brief 请求级内存池实现
+ */
+
+#include "arena.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 当前线程绑定的内存池 (NULL 表示回退到 malloc) */
+static __thread Arena *t_arena = NULL;
+
+#define ALIGN_UP(n) (((n) + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1))
+
+static ArenaBlock *block_new(size_t size) {
+    ArenaBlock *b = (ArenaBlock *)malloc(ALIGN_UP(sizeof(ArenaBlock)) + size);
+    if (!b) return NULL;
+    b->next = NULL;
+    b->size = size;
+    b->used = 0;
+    b->data = (unsigned char *)b + ALIGN_UP(sizeof(ArenaBlock));
+    return b;
+}
+
+static int block_owns(const ArenaBlock *b, const void *p) {
+    const unsigned char *q = (const unsigned char *)p;
+    return q >= b->data && q < b->data + b->size;
+}
+
+static int arena_owns(const Arena *a, const void *p) {
+    for (const ArenaBlock *b = a->head; b; b = b->next) {
+        if (block_owns(b, p)) return 1;
+    }
+    return 0;
+}
+
+static void *arena_bump(Arena *a, size_t size) {
+    size_t need = ALIGN_UP(size ? size : 1);
+    ArenaBlock *b = a->head;
+
+    if (!b || b->size - b->used < need) {
+        /* 当前块不足: 新块至少为默认块大小，大分配独占一块 */
+        size_t bsize = need > ARENA_BLOCK_SIZE ? need : ARENA_BLOCK_SIZE;
+        ArenaBlock *nb = block_new(bsize);
+        if (!nb) return NULL;
+        nb->next = a->head;
+        a->head = nb;
+        a->capacity += bsize;
+        b = nb;
+    }
+
+    void *p = b->data + b->used;
+    b->used += need;
+    a->used += need;
+    a->count++;
+    a->last = p;
+    return p;
+}
+
+void arena_begin(Arena *a) {
+    if (!a) return;
+    a->count = 0;
+    a->used = 0;
+    a->last = NULL;
+    t_arena = a;
+}
+
+void arena_end(Arena *a) {
+    if (!a) return;
+    if (t_arena == a) t_arena = NULL;
+
+    if (a->head && a->head->next) {
+        /* 多块: 合并为一个足以容纳本次用量的块，后续同类请求只用一块 */
+        size_t want = ALIGN_UP(a->used);
+        if (want > ARENA_RETAIN_MAX) want = ARENA_RETAIN_MAX;
+        if (want < ARENA_BLOCK_SIZE) want = ARENA_BLOCK_SIZE;
+        arena_release(a);
+        a->head = block_new(want);
+        a->capacity = a->head ? want : 0;
+    } else if (a->head && a->head->size > ARENA_RETAIN_MAX) {
+        /* 单个超大块不保留 */
+        arena_release(a);
+    } else if (a->head) {
+        a->head->used = 0;
+    }
+    a->last = NULL;
+}
+
+void arena_release(Arena *a) {
+    if (!a) return;
+    ArenaBlock *b = a->head;
+    while (b) {
+        ArenaBlock *next = b->next;
+        free(b);
+        b = next;
+    }
+    a->head = NULL;
+    a->last = NULL;
+    a->capacity = 0;
+}
+
+void *arena_alloc(size_t size) {
+    Arena *a = t_arena;
+    if (!a) return malloc(size ? size : 1);
+    return arena_bump(a, size);
+}
+
+void *arena_calloc(size_t size) {
+    Arena *a = t_arena;
+    if (!a) return calloc(1, size ? size : 1);
+    void *p = arena_bump(a, size);
+    if (p) memset(p, 0, size);
+    return p;
+}
+
+void *arena_realloc(void *ptr, size_t old_size, size_t new_size) {
+    Arena *a = t_arena;
+    if (!ptr) return arena_alloc(new_size);
+    if (!a || !arena_owns(a, ptr)) return realloc(ptr, new_size);
+
+    /* 最近一次分配且位于当前块: 原地扩展 */
+    ArenaBlock *b = a->head;
+    if (ptr == a->last && block_owns(b, ptr)) {
+        size_t off = (size_t)((unsigned char *)ptr - b->data);
+        size_t need = ALIGN_UP(new_size);
+        size_t cur = b->used - off;
+        if (need <= cur) return ptr;
+        if (off + need <= b->size) {
+            b->used = off + need;
+            a->used += need - cur;
+            return ptr;
+        }
+    }
+
+    void *p = arena_bump(a, new_size);
+    if (!p) return NULL;
+    memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+    return p;
+}
+
+char *arena_strndup(const char *s, size_t len) {
+    if (!s) return NULL;
+    len = strnlen(s, len);
+    char *p = (char *)arena_alloc(len + 1);
+    if (!p) return NULL;
+    memcpy(p, s, len);
+    p[len] = '\0';
+    return p;
+}
+
+void arena_free(void *ptr) {
+    if (!ptr) return;
+    Arena *a = t_arena;
+    if (a && arena_owns(a, ptr)) return;
+    free(ptr);
+}
+
+Arena *arena_current(void) {
+    return t_arena;
+}
@@ -18,6 +18,17 @@ extern int run_command(char *output, size_t output_size, const char *cmd, ...);
 
 /* 配置键名 */
 #define KEY_PASSWORD_HASH   "auth_password_hash"
+#define KEY_SCRAPE_TOKEN    "auth_scrape_token"
+
+/* 抓取令牌的内存副本 (空=未启用)，只在 HTTP 事件循环中读写 */
+static char g_scrape_token[AUTH_TOKEN_SIZE];
+
+/* 一次性连接票据 (expire=0 为空槽位)，只在 HTTP 事件循环中读写 */
+static struct {
+    char ticket[AUTH_TOKEN_SIZE];
+    time_t issued;
+    time_t expire;
+} g_tickets[AUTH_MAX_TICKETS];
 
 /**
  * 生成随机Token
@@ -51,6 +62,20 @@ static int generate_token(char *token, size_t size)
     return 0;
 }
 
+/**
+ * 比较两个令牌，逐字节比较全部内容，耗时与匹配位置无关
+ */
+static int token_equal(const char *a, const char *b)
+{
+    if (strlen(a) != AUTH_TOKEN_SIZE - 1 || strlen(b) != AUTH_TOKEN_SIZE - 1) return 0;
+
+    unsigned char diff = 0;
+    for (int i = 0; i < AUTH_TOKEN_SIZE - 1; i++) {
+        diff |= (unsigned char)(a[i] ^ b[i]);
+    }
+    return diff == 0;
+}
+
 /**
  * 验证密码
  */
@@ -123,6 +148,10 @@ int auth_init(void)
     
     /* 启动时清理过期Token */
     cleanup_expired_tokens();
+
+    /* 抓取令牌为空表示未启用 */
+    config_get_optional(KEY_SCRAPE_TOKEN, g_scrape_token, sizeof(g_scrape_token), "");
+    if (strlen(g_scrape_token) != AUTH_TOKEN_SIZE - 1) g_scrape_token[0] = '\0';
     
     printf("[AUTH] 认证模块初始化完成\n");
     return 0;
@@ -301,3 +330,84 @@ int auth_is_required(void)
     
     return 0;
 }
+
+int auth_scrape_token_get(char *token, size_t size)
+{
+    if (!token || size < AUTH_TOKEN_SIZE) return -1;
+    snprintf(token, size, "%s", g_scrape_token);
+    return g_scrape_token[0] ? 0 : -1;
+}
+
+int auth_scrape_token_rotate(char *token, size_t size)
+{
+    char new_token[AUTH_TOKEN_SIZE];
+
+    if (!token || size < AUTH_TOKEN_SIZE) return -2;
+    if (generate_token(new_token, sizeof(new_token)) != 0) return -2;
+    if (config_set(KEY_SCRAPE_TOKEN, new_token) != 0) return -2;
+
+    memcpy(g_scrape_token, new_token, sizeof(g_scrape_token));
+    snprintf(token, size, "%s", new_token);
+    printf("[AUTH] 已生成新的抓取令牌\n");
+    return 0;
+}
+
+int auth_scrape_token_clear(void)
+{
+    if (config_set_optional(KEY_SCRAPE_TOKEN, "") != 0) return -1;
+    g_scrape_token[0] = '\0';
+    printf("[AUTH] 已停用抓取令牌\n");
+    return 0;
+}
+
+int auth_verify_scrape_token(const char *token)
+{
+    if (!token || !g_scrape_token[0]) return -1;
+    return token_equal(token, g_scrape_token) ? 0 : -1;
+}
+
+int auth_ticket_issue(char *ticket, size_t size)
+{
+    time_t now = time(NULL);
+    int slot = 0;
+
+    if (!ticket || size < AUTH_TOKEN_SIZE) return -1;
+
+    /* 优先使用空闲或已过期的槽位，否则覆盖最早签发的票据 */
+    for (int i = 0; i < AUTH_MAX_TICKETS; i++) {
+        if (g_tickets[i].expire <= now) {
+            slot = i;
+            break;
+        }
+        if (g_tickets[i].issued < g_tickets[slot].issued) slot = i;
+    }
+
+    if (generate_token(g_tickets[slot].ticket, sizeof(g_tickets[slot].ticket)) != 0) {
+        g_tickets[slot].expire = 0;
+        return -1;
+    }
+    g_tickets[slot].issued = now;
+    g_tickets[slot].expire = now + AUTH_TICKET_EXPIRE_SECONDS;
+    snprintf(ticket, size, "%s", g_tickets[slot].ticket);
+    return 0;
+}
+
+int auth_ticket_consume(const char *ticket)
+{
+    time_t now = time(NULL);
+    int found = -1;
+
+    if (!ticket) return -1;
+
+    /* 检查所有槽位，顺带清除过期票据 */
+    for (int i = 0; i < AUTH_MAX_TICKETS; i++) {
+        if (g_tickets[i].expire == 0) continue;
+        if (g_tickets[i].expire <= now) {
+            memset(&g_tickets[i], 0, sizeof(g_tickets[i]));
+        } else if (token_equal(ticket, g_tickets[i].ticket)) {
+            memset(&g_tickets[i], 0, sizeof(g_tickets[i]));
+            found = 0;
+        }
+    }
+    return found;
+}
@@ -0,0 +1,457 @@
+/**
+ * @file bandscan.c
+ * @brief 频段扫描与自动选择实现
+ */
+
+#include "bandscan.h"
+#include "advanced.h"
+#include "http_utils.h"
+#include "json_builder.h"
+#include "log.h"
+#include "radiocfg.h"
+#include "speedtest.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* 任务状态 */
+typedef enum {
+    SCAN_IDLE = 0,
+    SCAN_RUNNING,
+    SCAN_DONE,
+    SCAN_CANCELLED,
+    SCAN_FAILED,
+} ScanState;
+
+static const char *const SCAN_STATE_NAMES[] = {"idle", "running", "done", "cancelled", "failed"};
+
+/* 候选组合及其测量结果 */
+typedef struct {
+    char name[96];              /* 频段名称，以 "+" 连接，如 "FDD_03+TDD_40" */
+    char labels[96];            /* 对应的小区频段标签，如 "B3,B40" */
+    BandLockMask mask;
+    const char *status;         /* pending/measuring/ok/other_band/no_service/failed/cancelled */
+    int samples;                /* 驻留在候选频段上的有效采样数 */
+    char serving_band[32];      /* 最后一次采样的服务频段 */
+    double rsrp_avg, rsrp_min;
+    double sinr_avg, sinr_min;
+    double throughput_kbps;     /* -1=未测速 */
+    double score;
+    int rank;                   /* 1=最佳，0=未排名 */
+} ScanCandidate;
+
+static struct {
+    ScanState state;
+    int cancel;
+    /* 参数 */
+    int settle_sec;
+    int samples;
+    int interval_ms;
+    int apply;
+    int probe_sec;
+    char probe_url[256];
+    /* 进度与结果 */
+    ScanCandidate cand[BANDSCAN_MAX_CANDIDATES];
+    int count;
+    int current;                /* 正在测量的序号，-1=无 */
+    char applied[96];           /* 扫描结束后生效的锁定 */
+    char message[128];
+    time_t started;
+    time_t finished;
+} g_scan;
+
+static pthread_mutex_t g_scan_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int bandscan_running(void) {
+    pthread_mutex_lock(&g_scan_lock);
+    int running = g_scan.state == SCAN_RUNNING;
+    pthread_mutex_unlock(&g_scan_lock);
+    return running;
+}
+
+static int scan_cancelled(void) {
+    pthread_mutex_lock(&g_scan_lock);
+    int cancel = g_scan.cancel;
+    pthread_mutex_unlock(&g_scan_lock);
+    return cancel;
+}
+
+/* 可取消的等待，被取消返回 0 */
+static int scan_sleep(int ms) {
+    for (int waited = 0; waited < ms; waited += 100) {
+        if (scan_cancelled()) return 0;
+        usleep(100000);
+    }
+    return !scan_cancelled();
+}
+
+/* 频段名称转换为小区频段标签: "N78" -> "N78"，"FDD_03" -> "B3"，"TDD_40" -> "B40" */
+static void band_label(const char *name, char *out, size_t size) {
+    if (name[0] == 'N') {
+        snprintf(out, size, "N%d", atoi(name + 1));
+    } else {
+        const char *us = strchr(name, '_');
+        snprintf(out, size, "B%d", us ? atoi(us + 1) : 0);
+    }
+}
+
+/* 服务频段是否属于候选组合 */
+static int band_in_labels(const char *band, const char *labels) {
+    size_t n = strlen(band);
+    for (const char *p = labels; (p = strstr(p, band)) != NULL; p += n) {
+        if ((p == labels || p[-1] == ',') && (p[n] == ',' || p[n] == '\0')) return 1;
+    }
+    return 0;
+}
+
+/* ==================== 测量 ==================== */
+
+/* 测量一个候选组合 (调用前已锁频并等待驻留)，被取消时保留已采集的样本并标记 cancelled */
+static void measure_candidate(ScanCandidate *cd, int samples, int interval_ms,
+                              const char *probe_url, int probe_sec) {
+    ScanCandidate r = *cd;
+    double rsrp_sum = 0, sinr_sum = 0;
+    int cancelled = 0;
+
+    r.samples = 0;
+    r.rsrp_min = 0;
+    r.sinr_min = 0;
+    for (int i = 0; i < samples; i++) {
+        if (i > 0 && !scan_sleep(interval_ms)) {
+            cancelled = 1;
+            break;
+        }
+
+        ServingCell cell;
+        if (advanced_get_serving_cell(&cell) != 0) continue;
+        snprintf(r.serving_band, sizeof(r.serving_band), "%s", cell.band);
+        if (!band_in_labels(cell.band, r.labels)) continue;
+
+        if (r.samples == 0 || cell.rsrp < r.rsrp_min) r.rsrp_min = cell.rsrp;
+        if (r.samples == 0 || cell.sinr < r.sinr_min) r.sinr_min = cell.sinr;
+        rsrp_sum += cell.rsrp;
+        sinr_sum += cell.sinr;
+        r.samples++;
+    }
+
+    if (r.samples > 0) {
+        r.rsrp_avg = rsrp_sum / r.samples;
+        r.sinr_avg = sinr_sum / r.samples;
+        r.score = r.sinr_avg + (r.rsrp_avg + 140.0) / 4.0;
+    }
+
+    if (cancelled) {
+        /* 样本不完整，不参与排名 */
+        r.status = "cancelled";
+    } else if (r.samples > 0) {
+        r.status = "ok";
+        if (probe_url[0] != '\0' && !scan_cancelled()) {
+            r.throughput_kbps = speedtest_probe_download(probe_url, probe_sec);
+        }
+    } else {
+        /* 有服务但驻留在候选之外的频段 (如仅锁 4G 时回落到 5G) */
+        r.status = r.serving_band[0] ? "other_band" : "no_service";
+    }
+
+    pthread_mutex_lock(&g_scan_lock);
+    *cd = r;
+    pthread_mutex_unlock(&g_scan_lock);
+}
+
+/* 候选排序值: 有测速结果时按速率，否则按信号评分 */
+static double candidate_key(const ScanCandidate *cd, int by_throughput) {
+    return by_throughput ? cd->throughput_kbps : cd->score;
+}
+
+/* 排名，返回最佳候选序号，没有可用候选返回 -1 */
+static int rank_candidates(void) {
+    int by_throughput = 0;
+    for (int i = 0; i < g_scan.count; i++) {
+        if (strcmp(g_scan.cand[i].status, "ok") == 0 && g_scan.cand[i].throughput_kbps >= 0)
+            by_throughput = 1;
+    }
+
+    int best = -1;
+    for (int rank = 1;; rank++) {
+        int pick = -1;
+        for (int i = 0; i < g_scan.count; i++) {
+            const ScanCandidate *cd = &g_scan.cand[i];
+            if (cd->rank != 0 || strcmp(cd->status, "ok") != 0) continue;
+            if (pick < 0 || candidate_key(cd, by_throughput) > candidate_key(&g_scan.cand[pick], by_throughput))
+                pick = i;
+        }
+        if (pick < 0) break;
+        g_scan.cand[pick].rank = rank;
+        if (rank == 1) best = pick;
+    }
+    return best;
+}
+
+/* ==================== 任务线程 ==================== */
+
+static void scan_finish(ScanState state, const char *applied, const char *message) {
+    pthread_mutex_lock(&g_scan_lock);
+    g_scan.state = state;
+    g_scan.current = -1;
+    g_scan.finished = time(NULL);
+    snprintf(g_scan.applied, sizeof(g_scan.applied), "%s", applied);
+    snprintf(g_scan.message, sizeof(g_scan.message), "%s", message);
+    pthread_mutex_unlock(&g_scan_lock);
+    LOG_I("频段扫描结束: %s (当前锁定 %s)", message, applied);
+}
+
+static void *bandscan_thread(void *arg) {
+    (void)arg;
+    BandLockMask original;
+    int have_original = advanced_get_band_lock(&original) == 0;
+    if (!have_original) memset(&original, 0, sizeof(original));
+
+    for (int i = 0; i < g_scan.count; i++) {
+        if (scan_cancelled()) break;
+
+        pthread_mutex_lock(&g_scan_lock);
+        g_scan.current = i;
+        g_scan.cand[i].status = "measuring";
+        ScanCandidate *cd = &g_scan.cand[i];
+        pthread_mutex_unlock(&g_scan_lock);
+
+        LOG_I("频段扫描 %d/%d: %s", i + 1, g_scan.count, cd->name);
+        if (advanced_set_band_lock(&cd->mask) != 0) {
+            pthread_mutex_lock(&g_scan_lock);
+            cd->status = "failed";
+            pthread_mutex_unlock(&g_scan_lock);
+            continue;
+        }
+        if (!scan_sleep(g_scan.settle_sec * 1000)) {
+            pthread_mutex_lock(&g_scan_lock);
+            cd->status = "cancelled";
+            pthread_mutex_unlock(&g_scan_lock);
+            break;
+        }
+        measure_candidate(cd, g_scan.samples, g_scan.interval_ms, g_scan.probe_url, g_scan.probe_sec);
+    }
+
+    const char *restore_name = have_original ? "original" : "unlocked";
+    if (scan_cancelled()) {
+        advanced_set_band_lock(&original);
+        scan_finish(SCAN_CANCELLED, restore_name, "已取消，恢复扫描前的锁定");
+        return NULL;
+    }
+
+    pthread_mutex_lock(&g_scan_lock);
+    int best = rank_candidates();
+    ScanCandidate winner = best >= 0 ? g_scan.cand[best] : g_scan.cand[0];
+    pthread_mutex_unlock(&g_scan_lock);
+
+    if (best < 0) {
+        advanced_set_band_lock(&original);
+        scan_finish(SCAN_FAILED, restore_name, "没有可驻留的候选组合，恢复扫描前的锁定");
+    } else if (!g_scan.apply) {
+        advanced_set_band_lock(&original);
+        scan_finish(SCAN_DONE, restore_name, "扫描完成，未应用 (apply=false)");
+    } else if (advanced_set_band_lock(&winner.mask) != 0) {
+        scan_finish(SCAN_FAILED, "unknown", "应用最佳组合失败");
+    } else {
+        scan_finish(SCAN_DONE, winner.name, "扫描完成，已锁定最佳组合");
+    }
+    return NULL;
+}
+
+/* ==================== API ==================== */
+
+/* 解析一个候选组合 (频段名称数组)，成功返回 0 */
+static int parse_candidate(struct mg_str arr, ScanCandidate *cd) {
+    char names[16][32];
+    int count = 0;
+    size_t ofs = 0;
+    struct mg_str key, val;
+
+    memset(cd, 0, sizeof(*cd));
+    while ((ofs = mg_json_next(arr, ofs, &key, &val)) > 0) {
+        if (count >= 16 || val.len < 3 || val.len - 2 >= sizeof(names[0]) || val.buf[0] != '"')
+            return -1;
+        snprintf(names[count], sizeof(names[count]), "%.*s", (int)val.len - 2, val.buf + 1);
+        count++;
+    }
+    if (count == 0 || advanced_band_mask_from_names(names, count, &cd->mask) != count) return -1;
+
+    for (int i = 0; i < count; i++) {
+        char label[16];
+        band_label(names[i], label, sizeof(label));
+        size_t n = strlen(cd->name), m = strlen(cd->labels);
+        snprintf(cd->name + n, sizeof(cd->name) - n, "%s%s", i ? "+" : "", names[i]);
+        snprintf(cd->labels + m, sizeof(cd->labels) - m, "%s%s", i ? "," : "", label);
+    }
+    return 0;
+}
+
+static int clamp_int(long v, int lo, int hi) {
+    return v < lo ? lo : v > hi ? hi : (int)v;
+}
+
+void handle_bandscan_start(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_POST(c, hm);
+
+    ScanCandidate cand[BANDSCAN_MAX_CANDIDATES];
+    int count = 0;
+
+    int len = 0;
+    int arr_ofs = hm->body.len ? mg_json_get(hm->body, "$.candidates", &len) : -1;
+    if (arr_ofs >= 0) {
+        struct mg_str arr = mg_str_n(hm->body.buf + arr_ofs, (size_t)len);
+        size_t ofs = 0;
+        struct mg_str key, val;
+        while ((ofs = mg_json_next(arr, ofs, &key, &val)) > 0) {
+            if (count >= BANDSCAN_MAX_CANDIDATES || val.buf[0] != '[' ||
+                parse_candidate(val, &cand[count]) != 0) {
+                HTTP_ERROR(c, 400, "candidates 格式错误或包含未知频段");
+                return;
+            }
+            count++;
+        }
+    } else {
+        /* 默认: 每个支持的频段单独一组 */
+        const char *name;
+        while (count < BANDSCAN_MAX_CANDIDATES && (name = advanced_band_name(count)) != NULL) {
+            char json[48];
+            snprintf(json, sizeof(json), "[\"%s\"]", name);
+            parse_candidate(mg_str(json), &cand[count]);
+            count++;
+        }
+    }
+    if (count == 0) {
+        HTTP_ERROR(c, 400, "没有候选组合");
+        return;
+    }
+
+    char probe_url[256] = {0};
+    http_json_get_str(hm->body, "$.probe_url", probe_url, sizeof(probe_url));
+    const char *msg = speedtest_check_url(probe_url);
+    if (msg) {
+        HTTP_ERROR(c, 400, msg);
+        return;
+    }
+    if (speedtest_running()) {
+        HTTP_ERROR(c, 409, "测速进行中");
+        return;
+    }
+    bool apply = true;
+    mg_json_get_bool(hm->body, "$.apply", &apply);
+
+    pthread_mutex_lock(&g_scan_lock);
+    if (g_scan.state == SCAN_RUNNING || radiocfg_running()) {
+        pthread_mutex_unlock(&g_scan_lock);
+        HTTP_ERROR(c, 409, "射频配置或频段扫描进行中");
+        return;
+    }
+    memset(&g_scan, 0, sizeof(g_scan));
+    g_scan.settle_sec = clamp_int(mg_json_get_long(hm->body, "$.settle_sec", BANDSCAN_SETTLE_SEC_DEFAULT), 0, 120);
+    g_scan.samples = clamp_int(mg_json_get_long(hm->body, "$.samples", BANDSCAN_SAMPLES_DEFAULT), 1, 20);
+    g_scan.interval_ms = clamp_int(mg_json_get_long(hm->body, "$.interval_ms", BANDSCAN_INTERVAL_MS_DEFAULT), 0, 60000);
+    g_scan.probe_sec = clamp_int(mg_json_get_long(hm->body, "$.probe_sec", 10), 1, BANDSCAN_THROUGHPUT_SEC_MAX);
+    g_scan.apply = apply ? 1 : 0;
+    snprintf(g_scan.probe_url, sizeof(g_scan.probe_url), "%s", probe_url);
+    for (int i = 0; i < count; i++) {
+        cand[i].status = "pending";
+        cand[i].throughput_kbps = -1;
+    }
+    memcpy(g_scan.cand, cand, sizeof(ScanCandidate) * count);
+    g_scan.count = count;
+    g_scan.current = -1;
+    g_scan.started = time(NULL);
+    g_scan.state = SCAN_RUNNING;
+
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, bandscan_thread, NULL) != 0) {
+        g_scan.state = SCAN_FAILED;
+        snprintf(g_scan.message, sizeof(g_scan.message), "创建扫描线程失败");
+        pthread_mutex_unlock(&g_scan_lock);
+        HTTP_ERROR(c, 500, "创建扫描线程失败");
+        return;
+    }
+    pthread_detach(tid);
+    pthread_mutex_unlock(&g_scan_lock);
+
+    LOG_I("频段扫描开始: %d 个候选组合", count);
+    JsonBuilder *j = json_new();
+    json_obj_open(j);
+    json_add_bool(j, "success", 1);
+    json_add_int(j, "candidates", count);
+    json_add_int(j, "estimated_sec",
+                 count * (g_scan.settle_sec + 2 + (g_scan.samples - 1) * g_scan.interval_ms / 1000 +
+                          (probe_url[0] ? g_scan.probe_sec : 0)));
+    json_obj_close(j);
+    HTTP_OK_FREE(c, json_finish(j));
+}
+
+void handle_bandscan_cancel(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_POST(c, hm);
+
+    pthread_mutex_lock(&g_scan_lock);
+    int running = g_scan.state == SCAN_RUNNING;
+    if (running) g_scan.cancel = 1;
+    pthread_mutex_unlock(&g_scan_lock);
+
+    if (!running) {
+        HTTP_ERROR(c, 409, "没有正在进行的频段扫描");
+        return;
+    }
+    HTTP_SUCCESS(c, "正在取消，完成当前步骤后恢复原锁定");
+}
+
+void handle_bandscan_status(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    pthread_mutex_lock(&g_scan_lock);
+    JsonBuilder *j = json_new();
+    json_obj_open(j);
+    json_add_str(j, "state", SCAN_STATE_NAMES[g_scan.state]);
+    json_add_bool(j, "cancelling", g_scan.state == SCAN_RUNNING && g_scan.cancel);
+    json_add_long(j, "started", (long long)g_scan.started);
+    json_add_long(j, "finished", (long long)g_scan.finished);
+    json_add_str(j, "applied", g_scan.applied);
+    json_add_str(j, "message", g_scan.message);
+
+    json_key_obj_open(j, "progress");
+    json_add_int(j, "current", g_scan.current >= 0 ? g_scan.current + 1 : 0);
+    json_add_int(j, "total", g_scan.count);
+    json_add_str(j, "candidate", g_scan.current >= 0 ? g_scan.cand[g_scan.current].name : "");
+    json_obj_close(j);
+
+    json_key_obj_open(j, "params");
+    json_add_int(j, "settle_sec", g_scan.settle_sec);
+    json_add_int(j, "samples", g_scan.samples);
+    json_add_int(j, "interval_ms", g_scan.interval_ms);
+    json_add_str(j, "probe_url", g_scan.probe_url);
+    json_add_int(j, "probe_sec", g_scan.probe_url[0] ? g_scan.probe_sec : 0);
+    json_add_bool(j, "apply", g_scan.apply);
+    json_obj_close(j);
+
+    json_arr_open(j, "candidates");
+    for (int i = 0; i < g_scan.count; i++) {
+        const ScanCandidate *cd = &g_scan.cand[i];
+        json_arr_obj_open(j);
+        json_add_str(j, "name", cd->name);
+        json_add_str(j, "status", cd->status);
+        json_add_int(j, "samples", cd->samples);
+        json_add_str(j, "serving_band", cd->serving_band);
+        if (cd->samples > 0) {
+            json_add_double(j, "rsrp_avg", cd->rsrp_avg);
+            json_add_double(j, "rsrp_min", cd->rsrp_min);
+            json_add_double(j, "sinr_avg", cd->sinr_avg);
+            json_add_double(j, "sinr_min", cd->sinr_min);
+            json_add_double(j, "score", cd->score);
+        }
+        if (cd->throughput_kbps >= 0) json_add_double(j, "throughput_kbps", cd->throughput_kbps);
+        json_add_int(j, "rank", cd->rank);
+        json_obj_close(j);
+    }
+    json_arr_close(j);
+    json_obj_close(j);
+    pthread_mutex_unlock(&g_scan_lock);
+
+    HTTP_OK_FREE(c, json_finish(j));
+}
@@ -0,0 +1,574 @@
+/**
+ * @file cellsel.c
+ * @brief 小区选择实现
+ */
+
+#include "cellsel.h"
+#include "advanced.h"
+#include "arena.h"
+#include "bandscan.h"
+#include "database.h"
+#include "http_utils.h"
+#include "json_builder.h"
+#include "log.h"
+#include "radiocfg.h"
+#include "worker.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* 配置 */
+typedef struct {
+    int enabled;
+    int auto_lock;
+    int interval_sec;
+    int window;
+    int min_samples;
+    double w_sinr;
+    double w_rsrp;
+    double w_stability;
+    double degrade_sinr_4g;             /* 劣化门限按制式区分: NR SS-RSRP 与 LTE RSRP 量程不同 */
+    double degrade_rsrp_4g;
+    double degrade_sinr_5g;
+    double degrade_rsrp_5g;
+    int degrade_count;
+    int holdoff_sec;
+} CellSelConfig;
+
+/* 跟踪的小区: 按轮次号存放在环形窗口中 (槽位 = 轮次 % window) */
+typedef struct {
+    int used;
+    int is_5g;
+    char band[16];
+    int arfcn;
+    int pci;
+    int serving;                        /* 最近一轮是否为服务小区 */
+    unsigned tick[CELLSEL_WINDOW_MAX];  /* 槽位对应的轮次，0=空 */
+    float rsrp[CELLSEL_WINDOW_MAX];
+    float sinr[CELLSEL_WINDOW_MAX];
+} CellTrack;
+
+/* 窗口统计 */
+typedef struct {
+    int samples;
+    double rsrp_avg;
+    double sinr_avg;
+    double sinr_sd;
+    double score;
+} CellStats;
+
+typedef struct {
+    int is_5g;
+    int arfcn;
+    int pci;
+    time_t until;
+} CellHoldoff;
+
+static struct {
+    CellSelConfig cfg;
+    unsigned ticks;                     /* 已完成的采样轮次 */
+    CellTrack cells[CELLSEL_MAX_TRACKED];
+    /* 引擎设置的锁定 */
+    int locked;
+    int locked_5g;
+    int locked_arfcn;
+    int locked_pci;
+    time_t locked_since;
+    int degrade_streak;
+    CellHoldoff holdoff[CELLSEL_MAX_HOLDOFF];
+    char last_action[128];
+    time_t last_action_time;
+} g_sel;
+
+static pthread_mutex_t g_sel_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* 采样线程 (受 g_sel_lock 保护)，启用或仍有引擎设置的锁定时运行 */
+static void *cellsel_thread(void *arg);
+static int cellsel_wanted(void) { return g_sel.cfg.enabled || g_sel.locked; }
+static Worker g_sel_worker = WORKER_INIT("小区选择", cellsel_thread, cellsel_wanted);
+
+static const CellSelConfig CELLSEL_DEFAULTS = {
+    .enabled = 0,
+    .auto_lock = 0,
+    .interval_sec = 10,
+    .window = 12,
+    .min_samples = 6,
+    .w_sinr = 1.0,
+    .w_rsrp = 0.25,
+    .w_stability = 0.5,
+    .degrade_sinr_4g = 0,
+    .degrade_rsrp_4g = -115,
+    .degrade_sinr_5g = 0,
+    .degrade_rsrp_5g = -110,
+    .degrade_count = 3,
+    .holdoff_sec = 600,
+};
+
+/* ==================== 配置存储 ==================== */
+
+static double config_get_double(const char *key, double default_val) {
+    char buf[32];
+    return config_get(key, buf, sizeof(buf)) == 0 && buf[0] ? atof(buf) : default_val;
+}
+
+static void config_set_double(const char *key, double value) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%g", value);
+    config_set(key, buf);
+}
+
+static void load_config(CellSelConfig *cfg) {
+    const CellSelConfig *d = &CELLSEL_DEFAULTS;
+    cfg->enabled = config_get_int("cellsel_enabled", d->enabled);
+    cfg->auto_lock = config_get_int("cellsel_auto_lock", d->auto_lock);
+    cfg->interval_sec = config_get_int("cellsel_interval_sec", d->interval_sec);
+    cfg->window = config_get_int("cellsel_window", d->window);
+    cfg->min_samples = config_get_int("cellsel_min_samples", d->min_samples);
+    cfg->w_sinr = config_get_double("cellsel_w_sinr", d->w_sinr);
+    cfg->w_rsrp = config_get_double("cellsel_w_rsrp", d->w_rsrp);
+    cfg->w_stability = config_get_double("cellsel_w_stability", d->w_stability);
+    cfg->degrade_sinr_4g = config_get_double("cellsel_degrade_sinr_4g", d->degrade_sinr_4g);
+    cfg->degrade_rsrp_4g = config_get_double("cellsel_degrade_rsrp_4g", d->degrade_rsrp_4g);
+    cfg->degrade_sinr_5g = config_get_double("cellsel_degrade_sinr_5g", d->degrade_sinr_5g);
+    cfg->degrade_rsrp_5g = config_get_double("cellsel_degrade_rsrp_5g", d->degrade_rsrp_5g);
+    cfg->degrade_count = config_get_int("cellsel_degrade_count", d->degrade_count);
+    cfg->holdoff_sec = config_get_int("cellsel_holdoff_sec", d->holdoff_sec);
+}
+
+static void save_config(const CellSelConfig *cfg) {
+    config_set_int("cellsel_enabled", cfg->enabled);
+    config_set_int("cellsel_auto_lock", cfg->auto_lock);
+    config_set_int("cellsel_interval_sec", cfg->interval_sec);
+    config_set_int("cellsel_window", cfg->window);
+    config_set_int("cellsel_min_samples", cfg->min_samples);
+    config_set_double("cellsel_w_sinr", cfg->w_sinr);
+    config_set_double("cellsel_w_rsrp", cfg->w_rsrp);
+    config_set_double("cellsel_w_stability", cfg->w_stability);
+    config_set_double("cellsel_degrade_sinr_4g", cfg->degrade_sinr_4g);
+    config_set_double("cellsel_degrade_rsrp_4g", cfg->degrade_rsrp_4g);
+    config_set_double("cellsel_degrade_sinr_5g", cfg->degrade_sinr_5g);
+    config_set_double("cellsel_degrade_rsrp_5g", cfg->degrade_rsrp_5g);
+    config_set_int("cellsel_degrade_count", cfg->degrade_count);
+    config_set_int("cellsel_holdoff_sec", cfg->holdoff_sec);
+}
+
+/* 引擎设置的锁定随配置持久化，重启后继续监测而不是重复锁定 (不持有 g_sel_lock 调用) */
+static void save_lock_state(int locked, int is_5g, int arfcn, int pci) {
+    char buf[64] = "";
+    if (locked) {
+        snprintf(buf, sizeof(buf), "%d,%d,%d", is_5g, arfcn, pci);
+    }
+    config_set("cellsel_lock", buf);
+}
+
+static void load_lock_state(void) {
+    char buf[64] = "";
+    if (config_get("cellsel_lock", buf, sizeof(buf)) == 0 &&
+        sscanf(buf, "%d,%d,%d", &g_sel.locked_5g, &g_sel.locked_arfcn, &g_sel.locked_pci) == 3) {
+        g_sel.locked = 1;
+        g_sel.locked_since = time(NULL);
+    }
+}
+
+/* ==================== 统计与排名 ==================== */
+
+static int slot_valid(const CellTrack *t, int slot, unsigned now_tick, int window) {
+    return t->tick[slot] != 0 && t->tick[slot] + (unsigned)window > now_tick;
+}
+
+static void cell_stats(const CellTrack *t, const CellSelConfig *cfg, unsigned now_tick, CellStats *st) {
+    double rsrp_sum = 0, sinr_sum = 0, sinr_sq = 0;
+
+    memset(st, 0, sizeof(*st));
+    for (int i = 0; i < cfg->window; i++) {
+        if (!slot_valid(t, i, now_tick, cfg->window)) continue;
+        rsrp_sum += t->rsrp[i];
+        sinr_sum += t->sinr[i];
+        sinr_sq += (double)t->sinr[i] * t->sinr[i];
+        st->samples++;
+    }
+    if (st->samples == 0) return;
+
+    st->rsrp_avg = rsrp_sum / st->samples;
+    st->sinr_avg = sinr_sum / st->samples;
+    double var = sinr_sq / st->samples - st->sinr_avg * st->sinr_avg;
+    st->sinr_sd = var > 0 ? sqrt(var) : 0;
+    st->score = cfg->w_sinr * st->sinr_avg + cfg->w_rsrp * (st->rsrp_avg + 140.0) -
+                cfg->w_stability * st->sinr_sd;
+}
+
+static int in_holdoff(int is_5g, int arfcn, int pci, time_t now) {
+    for (int i = 0; i < CELLSEL_MAX_HOLDOFF; i++) {
+        const CellHoldoff *h = &g_sel.holdoff[i];
+        if (h->until > now && h->is_5g == is_5g && h->arfcn == arfcn && h->pci == pci) return 1;
+    }
+    return 0;
+}
+
+static void add_holdoff(int is_5g, int arfcn, int pci, time_t until) {
+    int slot = 0;
+    for (int i = 1; i < CELLSEL_MAX_HOLDOFF; i++) {
+        if (g_sel.holdoff[i].until < g_sel.holdoff[slot].until) slot = i;
+    }
+    g_sel.holdoff[slot] = (CellHoldoff){is_5g, arfcn, pci, until};
+}
+
+/* 排名第一且不在暂停期内的小区，没有返回 -1 (调用方持有锁) */
+static int best_cell(time_t now) {
+    int best = -1;
+    double best_score = 0;
+    for (int i = 0; i < CELLSEL_MAX_TRACKED; i++) {
+        const CellTrack *t = &g_sel.cells[i];
+        if (!t->used || in_holdoff(t->is_5g, t->arfcn, t->pci, now)) continue;
+        CellStats st;
+        cell_stats(t, &g_sel.cfg, g_sel.ticks, &st);
+        if (st.samples < g_sel.cfg.min_samples) continue;
+        if (best < 0 || st.score > best_score) {
+            best = i;
+            best_score = st.score;
+        }
+    }
+    return best;
+}
+
+/* ==================== 采样线程 ==================== */
+
+static CellTrack *track_find(const CellInfo *cell, int is_5g) {
+    CellTrack *free_slot = NULL;
+    for (int i = 0; i < CELLSEL_MAX_TRACKED; i++) {
+        CellTrack *t = &g_sel.cells[i];
+        if (!t->used) {
+            if (!free_slot) free_slot = t;
+        } else if (t->is_5g == is_5g && t->arfcn == cell->arfcn && t->pci == cell->pci) {
+            return t;
+        }
+    }
+    if (free_slot) {
+        memset(free_slot, 0, sizeof(*free_slot));
+        free_slot->used = 1;
+        free_slot->is_5g = is_5g;
+        free_slot->arfcn = cell->arfcn;
+        free_slot->pci = cell->pci;
+    }
+    return free_slot;
+}
+
+/* 记录一轮测量 (调用方持有锁) */
+static void record_round(const CellInfo *cells, int count) {
+    unsigned tick = ++g_sel.ticks;
+    int slot = (int)(tick % (unsigned)g_sel.cfg.window);
+
+    for (int i = 0; i < CELLSEL_MAX_TRACKED; i++) g_sel.cells[i].serving = 0;
+    for (int i = 0; i < count; i++) {
+        CellTrack *t = track_find(&cells[i], strcmp(cells[i].rat, "5G") == 0);
+        if (!t) continue;
+        /* 邻区列表可能重复包含服务小区，以服务小区测量为准 */
+        if (t->tick[slot] == tick && t->serving) continue;
+        snprintf(t->band, sizeof(t->band), "%s", cells[i].band);
+        t->serving = cells[i].is_serving;
+        t->tick[slot] = tick;
+        t->rsrp[slot] = (float)cells[i].rsrp;
+        t->sinr[slot] = (float)cells[i].sinr;
+    }
+
+    /* 整个窗口内未出现的小区释放槽位 */
+    for (int i = 0; i < CELLSEL_MAX_TRACKED; i++) {
+        CellTrack *t = &g_sel.cells[i];
+        if (!t->used) continue;
+        int any = 0;
+        for (int s = 0; s < g_sel.cfg.window && !any; s++) any = slot_valid(t, s, tick, g_sel.cfg.window);
+        if (!any) t->used = 0;
+    }
+}
+
+static void set_action(const char *msg) {
+    snprintf(g_sel.last_action, sizeof(g_sel.last_action), "%s", msg);
+    g_sel.last_action_time = time(NULL);
+    LOG_I("小区选择: %s", msg);
+}
+
+/*
+ * 检查锁定小区: 本轮服务小区不是锁定小区 (丢失服务) 或信号低于所在制式的门限时累计劣化轮数
+ * @return 1 需要解锁 (调用方持有锁)
+ */
+static int check_degraded(const CellInfo *cells, int count) {
+    const CellInfo *serving = NULL;
+    for (int i = 0; i < count; i++) {
+        if (cells[i].is_serving) serving = &cells[i];
+    }
+
+    const CellSelConfig *cfg = &g_sel.cfg;
+    double min_sinr = g_sel.locked_5g ? cfg->degrade_sinr_5g : cfg->degrade_sinr_4g;
+    double min_rsrp = g_sel.locked_5g ? cfg->degrade_rsrp_5g : cfg->degrade_rsrp_4g;
+    int bad = !serving || (strcmp(serving->rat, "5G") == 0) != g_sel.locked_5g ||
+              serving->arfcn != g_sel.locked_arfcn || serving->pci != g_sel.locked_pci ||
+              serving->sinr < min_sinr || serving->rsrp < min_rsrp;
+    g_sel.degrade_streak = bad ? g_sel.degrade_streak + 1 : 0;
+    return g_sel.degrade_streak >= g_sel.cfg.degrade_count;
+}
+
+/* 本轮决策，返回需要执行的动作: 0=无, 1=锁定 target, -1=解锁 (调用方持有锁) */
+static int decide(const CellInfo *cells, int count, CellTrack *target) {
+    time_t now = time(NULL);
+    char msg[128];
+
+    if (g_sel.locked) {
+        if (!g_sel.cfg.enabled || !g_sel.cfg.auto_lock) {
+            set_action("自动选择已关闭，解除锁定");
+            return -1;
+        }
+        if (!check_degraded(cells, count)) return 0;
+
+        add_holdoff(g_sel.locked_5g, g_sel.locked_arfcn, g_sel.locked_pci, now + g_sel.cfg.holdoff_sec);
+        snprintf(msg, sizeof(msg), "锁定小区 %d/%d 连续 %d 轮劣化，解锁并重新评估",
+                 g_sel.locked_arfcn, g_sel.locked_pci, g_sel.degrade_streak);
+        set_action(msg);
+        return -1;
+    }
+
+    if (!g_sel.cfg.enabled || !g_sel.cfg.auto_lock) return 0;
+    int best = best_cell(now);
+    if (best < 0) return 0;
+
+    *target = g_sel.cells[best];
+    CellStats st;
+    cell_stats(target, &g_sel.cfg, g_sel.ticks, &st);
+    snprintf(msg, sizeof(msg), "锁定 %s %d/%d (score %.2f)", target->band, target->arfcn, target->pci,
+             st.score);
+    set_action(msg);
+    return 1;
+}
+
+/* 可中断的等待，线程应退出时返回 0 */
+static int sel_sleep(int sec) {
+    for (int i = 0; i < sec * 10; i++) {
+        pthread_mutex_lock(&g_sel_lock);
+        int enabled = cellsel_wanted();
+        pthread_mutex_unlock(&g_sel_lock);
+        if (!enabled) return 0;
+        usleep(100000);
+    }
+    return 1;
+}
+
+static void *cellsel_thread(void *arg) {
+    (void)arg;
+    CellInfo *cells = calloc(ADVANCED_MAX_CELLS, sizeof(CellInfo));
+
+    for (;;) {
+        pthread_mutex_lock(&g_sel_lock);
+        int interval = g_sel.cfg.interval_sec;
+        pthread_mutex_unlock(&g_sel_lock);
+        if (!cells || !sel_sleep(interval)) {
+            pthread_mutex_lock(&g_sel_lock);
+            int stop = worker_exit_locked(&g_sel_worker, !cells);
+            pthread_mutex_unlock(&g_sel_lock);
+            if (stop) break;
+            continue;
+        }
+
+        /* 频段扫描、射频配置期间射频反复重启，测量没有意义 */
+        if (bandscan_running() || radiocfg_running()) continue;
+
+        int count = advanced_get_cells(cells, ADVANCED_MAX_CELLS);
+        if (count < 0) continue;
+
+        CellTrack target = {0};
+        pthread_mutex_lock(&g_sel_lock);
+        record_round(cells, count);
+        int action = decide(cells, count, &target);
+        pthread_mutex_unlock(&g_sel_lock);
+
+        if (action == 0) continue;
+        int ret = action > 0 ? advanced_lock_cell(target.is_5g, target.arfcn, target.pci) : advanced_unlock_cell();
+
+        pthread_mutex_lock(&g_sel_lock);
+        if (ret != 0) {
+            /* 写入失败时保持原状态，下一轮重新判断 */
+            set_action(action > 0 ? "锁定小区失败" : "解锁小区失败");
+            pthread_mutex_unlock(&g_sel_lock);
+            continue;
+        }
+        g_sel.locked = action > 0;
+        g_sel.locked_5g = target.is_5g;
+        g_sel.locked_arfcn = action > 0 ? target.arfcn : 0;
+        g_sel.locked_pci = action > 0 ? target.pci : 0;
+        g_sel.locked_since = time(NULL);
+        g_sel.degrade_streak = 0;
+        pthread_mutex_unlock(&g_sel_lock);
+        save_lock_state(action > 0, target.is_5g, target.arfcn, target.pci);
+    }
+
+    free(cells);
+    return NULL;
+}
+
+/* ==================== API ==================== */
+
+int cellsel_init(void) {
+    pthread_mutex_lock(&g_sel_lock);
+    load_config(&g_sel.cfg);
+    load_lock_state();
+    worker_start_locked(&g_sel_worker);
+    pthread_mutex_unlock(&g_sel_lock);
+    return 0;
+}
+
+int cellsel_auto_lock_enabled(void) {
+    pthread_mutex_lock(&g_sel_lock);
+    int on = g_sel.cfg.enabled && g_sel.cfg.auto_lock;
+    pthread_mutex_unlock(&g_sel_lock);
+    return on;
+}
+
+static void add_config_json(JsonBuilder *j, const CellSelConfig *cfg) {
+    json_key_obj_open(j, "config");
+    json_add_bool(j, "enabled", cfg->enabled);
+    json_add_bool(j, "auto_lock", cfg->auto_lock);
+    json_add_int(j, "interval_sec", cfg->interval_sec);
+    json_add_int(j, "window", cfg->window);
+    json_add_int(j, "min_samples", cfg->min_samples);
+    json_add_double(j, "w_sinr", cfg->w_sinr);
+    json_add_double(j, "w_rsrp", cfg->w_rsrp);
+    json_add_double(j, "w_stability", cfg->w_stability);
+    json_add_double(j, "degrade_sinr_4g", cfg->degrade_sinr_4g);
+    json_add_double(j, "degrade_rsrp_4g", cfg->degrade_rsrp_4g);
+    json_add_double(j, "degrade_sinr_5g", cfg->degrade_sinr_5g);
+    json_add_double(j, "degrade_rsrp_5g", cfg->degrade_rsrp_5g);
+    json_add_int(j, "degrade_count", cfg->degrade_count);
+    json_add_int(j, "holdoff_sec", cfg->holdoff_sec);
+    json_obj_close(j);
+}
+
+void handle_cellsel_status(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    time_t now = time(NULL);
+    CellStats *stats = arena_alloc(sizeof(CellStats) * CELLSEL_MAX_TRACKED);
+    if (!stats) {
+        HTTP_ERROR(c, 500, "Out of memory");
+        return;
+    }
+
+    pthread_mutex_lock(&g_sel_lock);
+    JsonBuilder *j = json_new();
+    json_obj_open(j);
+    add_config_json(j, &g_sel.cfg);
+
+    json_key_obj_open(j, "state");
+    json_add_bool(j, "running", g_sel_worker.running);
+    json_add_long(j, "rounds", (long long)g_sel.ticks);
+    json_add_str(j, "last_action", g_sel.last_action);
+    json_add_long(j, "last_action_time", (long long)g_sel.last_action_time);
+    if (g_sel.locked) {
+        json_key_obj_open(j, "locked");
+        json_add_str(j, "rat", g_sel.locked_5g ? "5G" : "4G");
+        json_add_int(j, "arfcn", g_sel.locked_arfcn);
+        json_add_int(j, "pci", g_sel.locked_pci);
+        json_add_long(j, "since", (long long)g_sel.locked_since);
+        json_add_int(j, "degrade_streak", g_sel.degrade_streak);
+        json_obj_close(j);
+    } else {
+        json_add_null(j, "locked");
+    }
+    json_obj_close(j);
+
+    /* 按评分降序输出，采样不足的排在最后 (rank 0) */
+    int order[CELLSEL_MAX_TRACKED];
+    int n = 0;
+    for (int i = 0; i < CELLSEL_MAX_TRACKED; i++) {
+        if (!g_sel.cells[i].used) continue;
+        cell_stats(&g_sel.cells[i], &g_sel.cfg, g_sel.ticks, &stats[i]);
+        order[n++] = i;
+    }
+    for (int a = 1; a < n; a++) {
+        int k = order[a], b = a - 1;
+        int k_ranked = stats[k].samples >= g_sel.cfg.min_samples;
+        while (b >= 0) {
+            int o = order[b];
+            int o_ranked = stats[o].samples >= g_sel.cfg.min_samples;
+            if (o_ranked > k_ranked || (o_ranked == k_ranked && stats[o].score >= stats[k].score)) break;
+            order[b + 1] = o;
+            b--;
+        }
+        order[b + 1] = k;
+    }
+
+    json_arr_open(j, "cells");
+    int rank = 0;
+    for (int a = 0; a < n; a++) {
+        const CellTrack *t = &g_sel.cells[order[a]];
+        const CellStats *st = &stats[order[a]];
+        int ranked = st->samples >= g_sel.cfg.min_samples;
+        json_arr_obj_open(j);
+        json_add_str(j, "rat", t->is_5g ? "5G" : "4G");
+        json_add_str(j, "band", t->band);
+        json_add_int(j, "arfcn", t->arfcn);
+        json_add_int(j, "pci", t->pci);
+        json_add_bool(j, "isServing", t->serving);
+        json_add_int(j, "samples", st->samples);
+        json_add_double(j, "rsrp_avg", st->rsrp_avg);
+        json_add_double(j, "sinr_avg", st->sinr_avg);
+        json_add_double(j, "sinr_sd", st->sinr_sd);
+        json_add_double(j, "score", st->score);
+        json_add_int(j, "rank", ranked ? ++rank : 0);
+        json_add_bool(j, "holdoff", in_holdoff(t->is_5g, t->arfcn, t->pci, now));
+        json_obj_close(j);
+    }
+    json_arr_close(j);
+    json_obj_close(j);
+    pthread_mutex_unlock(&g_sel_lock);
+
+    arena_free(stats);
+    HTTP_OK_FREE(c, json_finish(j));
+}
+
+void handle_cellsel_config(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_POST(c, hm);
+
+    pthread_mutex_lock(&g_sel_lock);
+    CellSelConfig cfg = g_sel.cfg;
+    pthread_mutex_unlock(&g_sel_lock);
+
+    bool b;
+    double d;
+    if (mg_json_get_bool(hm->body, "$.enabled", &b)) cfg.enabled = b;
+    if (mg_json_get_bool(hm->body, "$.auto_lock", &b)) cfg.auto_lock = b;
+    cfg.interval_sec = (int)mg_json_get_long(hm->body, "$.interval_sec", cfg.interval_sec);
+    cfg.window = (int)mg_json_get_long(hm->body, "$.window", cfg.window);
+    cfg.min_samples = (int)mg_json_get_long(hm->body, "$.min_samples", cfg.min_samples);
+    if (mg_json_get_num(hm->body, "$.w_sinr", &d)) cfg.w_sinr = d;
+    if (mg_json_get_num(hm->body, "$.w_rsrp", &d)) cfg.w_rsrp = d;
+    if (mg_json_get_num(hm->body, "$.w_stability", &d)) cfg.w_stability = d;
+    if (mg_json_get_num(hm->body, "$.degrade_sinr_4g", &d)) cfg.degrade_sinr_4g = d;
+    if (mg_json_get_num(hm->body, "$.degrade_rsrp_4g", &d)) cfg.degrade_rsrp_4g = d;
+    if (mg_json_get_num(hm->body, "$.degrade_sinr_5g", &d)) cfg.degrade_sinr_5g = d;
+    if (mg_json_get_num(hm->body, "$.degrade_rsrp_5g", &d)) cfg.degrade_rsrp_5g = d;
+    cfg.degrade_count = (int)mg_json_get_long(hm->body, "$.degrade_count", cfg.degrade_count);
+    cfg.holdoff_sec = (int)mg_json_get_long(hm->body, "$.holdoff_sec", cfg.holdoff_sec);
+
+    if (cfg.interval_sec < 1 || cfg.interval_sec > 3600 || cfg.window < 1 ||
+        cfg.window > CELLSEL_WINDOW_MAX || cfg.min_samples < 1 || cfg.min_samples > cfg.window ||
+        cfg.degrade_count < 1 || cfg.holdoff_sec < 0) {
+        HTTP_ERROR(c, 400, "参数无效");
+        return;
+    }
+
+    pthread_mutex_lock(&g_sel_lock);
+    if (cfg.window != g_sel.cfg.window) {
+        /* 槽位按窗口取模，窗口变化后旧数据无法对齐 */
+        memset(g_sel.cells, 0, sizeof(g_sel.cells));
+    }
+    g_sel.cfg = cfg;
+    worker_start_locked(&g_sel_worker);
+    pthread_mutex_unlock(&g_sel_lock);
+
+    /* 每项配置一次数据库写入，在锁外进行，不阻塞采样线程和状态查询 */
+    save_config(&cfg);
+
+    HTTP_SUCCESS(c, "配置已保存");
+}
@@ -168,7 +168,7 @@ static int create_uevent_socket(void) {
 }
 
 /* 检查是否为电池相关 uevent */
-static gboolean is_battery_event(const char *buf, int len) {
+int is_battery_event(const char *buf, int len) {
     const char *p = buf;
     const char *end = buf + len;
     gboolean is_power_supply = FALSE;
@@ -0,0 +1,939 @@
+/**
+ * @file conntrack.c
+ * @brief 连接跟踪表查看实现 (ctnetlink)
+ */
+
+#include "conntrack.h"
+#include "database.h"
+#include "http_utils.h"
+#include "json_builder.h"
+#include "log.h"
+#include "metrics.h"
+#include "worker.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <limits.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nfnetlink_conntrack.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CT_PROC_DIR "/proc/sys/net/netfilter/"
+
+/* 事件套接字接收缓冲区，突发的建连/断连在此排队 */
+#define CT_EVENT_RCVBUF (1024 * 1024)
+
+/* 配置 */
+typedef struct {
+    int enabled;
+    int accounting;                 /* 允许打开内核 nf_conntrack_acct */
+    int resync_sec;
+} ConntrackConfig;
+
+/* 一条连接 (原方向元组 + 回复方向目的地址，即 SNAT 后的地址) */
+typedef struct {
+    uint8_t family;
+    uint8_t proto;
+    uint8_t tcp_state;              /* 0xff=非 TCP */
+    uint8_t src[16];
+    uint8_t dst[16];
+    uint8_t nat[16];
+    uint32_t id;                    /* 内核连接 ID，dump 与事件中一致 */
+    uint16_t sport;
+    uint16_t dport;
+    uint32_t timeout;
+    uint64_t bytes_up;              /* 原方向 (客户端发出) */
+    uint64_t bytes_down;            /* 回复方向 */
+    uint64_t packets_up;
+    uint64_t packets_down;
+} CtFlow;
+
+enum { CT_TCP, CT_UDP, CT_ICMP, CT_OTHER, CT_PROTO_COUNT };
+
+static const char *const CT_PROTO_NAMES[CT_PROTO_COUNT] = {"tcp", "udp", "icmp", "other"};
+
+typedef struct {
+    uint32_t flows;
+    uint64_t bytes_up;
+    uint64_t bytes_down;
+} CtCounts;
+
+typedef struct {
+    uint8_t family;
+    uint8_t addr[16];
+    CtCounts counts;
+    uint32_t proto_flows[CT_PROTO_COUNT];
+} CtClient;
+
+/* 汇总 (固定大小) */
+typedef struct {
+    CtClient clients[CONNTRACK_MAX_CLIENTS];
+    int client_count;
+    CtCounts others;                /* 客户端表已满时的其余客户端 */
+    CtCounts protos[CT_PROTO_COUNT];
+    CtCounts total;
+} CtSummary;
+
+/* 有序的连接 ID 集合 */
+typedef struct {
+    uint32_t *ids;
+    int count;
+    int cap;
+    int complete;                   /* 0=内存不足，集合缺少部分 ID */
+} CtIdSet;
+
+/* 一次完整 dump 的结果: 汇总 + 连接快照 (最多 CONNTRACK_MAX_FLOWS 条) + 全部连接 ID */
+typedef struct {
+    CtSummary summary;
+    CtFlow *flows;
+    int flow_count;
+    int truncated;
+    CtIdSet *dumped;
+} CtSnapshot;
+
+static struct {
+    ConntrackConfig cfg;
+    int resync_requested;
+    CtSummary summary;
+    CtFlow *flows;                  /* 最近一次 dump 的连接快照，查询只读此处 */
+    int flow_count;
+    int flows_truncated;
+    uint64_t events;
+    unsigned resyncs;
+    unsigned overflows;             /* 事件丢失 (ENOBUFS) 次数 */
+    time_t last_resync;
+    long last_resync_ms;
+    char last_error[96];
+} g_ct;
+
+static pthread_mutex_t g_ct_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* 汇总线程 (受 g_ct_lock 保护) */
+static void *conntrack_thread(void *arg);
+static int conntrack_wanted(void) { return g_ct.cfg.enabled; }
+static Worker g_ct_worker = WORKER_INIT("连接跟踪", conntrack_thread, conntrack_wanted);
+
+static const ConntrackConfig CONNTRACK_DEFAULTS = {
+    .enabled = 0,
+    .accounting = 0,
+    .resync_sec = 30,
+};
+
+/* ==================== netlink ==================== */
+
+#define CT_ATTR_MAX 32
+
+#define ATTR_DATA(a) ((const uint8_t *)(a) + NLA_HDRLEN)
+#define ATTR_LEN(a) ((int)(a)->nla_len - NLA_HDRLEN)
+
+/* 把一层属性按类型放入 tb[0..CT_ATTR_MAX] */
+static void parse_attrs(const void *data, int len, const struct nlattr **tb) {
+    memset(tb, 0, sizeof(*tb) * (CT_ATTR_MAX + 1));
+    const struct nlattr *a = data;
+    while (len >= NLA_HDRLEN && a->nla_len >= NLA_HDRLEN && a->nla_len <= len) {
+        int type = a->nla_type & NLA_TYPE_MASK;
+        if (type <= CT_ATTR_MAX) tb[type] = a;
+        int step = NLA_ALIGN(a->nla_len);
+        len -= step;
+        a = (const struct nlattr *)((const uint8_t *)a + step);
+    }
+}
+
+static void parse_nested(const struct nlattr *a, const struct nlattr **tb) {
+    parse_attrs(ATTR_DATA(a), ATTR_LEN(a), tb);
+}
+
+static uint32_t attr_be32(const struct nlattr *a) {
+    uint32_t v = 0;
+    if (a && ATTR_LEN(a) >= 4) memcpy(&v, ATTR_DATA(a), 4);
+    return ntohl(v);
+}
+
+static uint64_t attr_be64(const struct nlattr *a) {
+    uint32_t v[2] = {0, 0};
+    if (a && ATTR_LEN(a) >= 8) memcpy(v, ATTR_DATA(a), 8);
+    return ((uint64_t)ntohl(v[0]) << 32) | ntohl(v[1]);
+}
+
+static uint16_t attr_be16(const struct nlattr *a) {
+    uint16_t v = 0;
+    if (a && ATTR_LEN(a) >= 2) memcpy(&v, ATTR_DATA(a), 2);
+    return ntohs(v);
+}
+
+static void attr_addr(const struct nlattr *a, uint8_t *dst) {
+    if (a && ATTR_LEN(a) <= 16) memcpy(dst, ATTR_DATA(a), (size_t)ATTR_LEN(a));
+}
+
+/* 解析 CTA_TUPLE_ORIG/REPLY；proto/端口可为 NULL */
+static void parse_tuple(const struct nlattr *tuple, uint8_t *src, uint8_t *dst, uint8_t *proto, uint16_t *sport,
+                        uint16_t *dport) {
+    const struct nlattr *tb[CT_ATTR_MAX + 1], *sub[CT_ATTR_MAX + 1];
+    if (!tuple) return;
+    parse_nested(tuple, tb);
+
+    if (tb[CTA_TUPLE_IP]) {
+        parse_nested(tb[CTA_TUPLE_IP], sub);
+        attr_addr(sub[CTA_IP_V4_SRC] ? sub[CTA_IP_V4_SRC] : sub[CTA_IP_V6_SRC], src);
+        attr_addr(sub[CTA_IP_V4_DST] ? sub[CTA_IP_V4_DST] : sub[CTA_IP_V6_DST], dst);
+    }
+    if (proto && tb[CTA_TUPLE_PROTO]) {
+        parse_nested(tb[CTA_TUPLE_PROTO], sub);
+        if (sub[CTA_PROTO_NUM] && ATTR_LEN(sub[CTA_PROTO_NUM]) >= 1) *proto = ATTR_DATA(sub[CTA_PROTO_NUM])[0];
+        *sport = attr_be16(sub[CTA_PROTO_SRC_PORT]);
+        *dport = attr_be16(sub[CTA_PROTO_DST_PORT]);
+    }
+}
+
+static void parse_counters(const struct nlattr *a, uint64_t *bytes, uint64_t *packets) {
+    const struct nlattr *tb[CT_ATTR_MAX + 1];
+    if (!a) return;
+    parse_nested(a, tb);
+    *bytes = attr_be64(tb[CTA_COUNTERS_BYTES]);
+    *packets = attr_be64(tb[CTA_COUNTERS_PACKETS]);
+}
+
+/* 解析一条 ctnetlink 连接消息，返回 IPCTNL_MSG_CT_NEW/DELETE，其他消息返回 -1 */
+static int parse_flow(const struct nlmsghdr *nlh, CtFlow *f) {
+    if (NFNL_SUBSYS_ID(nlh->nlmsg_type) != NFNL_SUBSYS_CTNETLINK) return -1;
+    int type = NFNL_MSG_TYPE(nlh->nlmsg_type);
+    if (type != IPCTNL_MSG_CT_NEW && type != IPCTNL_MSG_CT_DELETE) return -1;
+    if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(struct nfgenmsg))) return -1;
+
+    const struct nfgenmsg *nfg = NLMSG_DATA(nlh);
+    const struct nlattr *tb[CT_ATTR_MAX + 1];
+    parse_attrs((const uint8_t *)nfg + NLMSG_ALIGN(sizeof(*nfg)),
+                (int)nlh->nlmsg_len - NLMSG_LENGTH(NLMSG_ALIGN(sizeof(*nfg))), tb);
+
+    memset(f, 0, sizeof(*f));
+    f->family = nfg->nfgen_family;
+    f->tcp_state = 0xff;
+    uint8_t reply_src[16];
+    parse_tuple(tb[CTA_TUPLE_ORIG], f->src, f->dst, &f->proto, &f->sport, &f->dport);
+    parse_tuple(tb[CTA_TUPLE_REPLY], reply_src, f->nat, NULL, NULL, NULL);
+    f->id = attr_be32(tb[CTA_ID]);
+    f->timeout = attr_be32(tb[CTA_TIMEOUT]);
+    parse_counters(tb[CTA_COUNTERS_ORIG], &f->bytes_up, &f->packets_up);
+    parse_counters(tb[CTA_COUNTERS_REPLY], &f->bytes_down, &f->packets_down);
+
+    if (tb[CTA_PROTOINFO]) {
+        const struct nlattr *pi[CT_ATTR_MAX + 1], *tcp[CT_ATTR_MAX + 1];
+        parse_nested(tb[CTA_PROTOINFO], pi);
+        if (pi[CTA_PROTOINFO_TCP]) {
+            parse_nested(pi[CTA_PROTOINFO_TCP], tcp);
+            if (tcp[CTA_PROTOINFO_TCP_STATE]) f->tcp_state = ATTR_DATA(tcp[CTA_PROTOINFO_TCP_STATE])[0];
+        }
+    }
+    return type;
+}
+
+static int nl_open(unsigned groups) {
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_NETFILTER);
+    if (fd < 0) return -1;
+    struct sockaddr_nl addr = {.nl_family = AF_NETLINK, .nl_groups = groups};
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+typedef void (*FlowCallback)(const CtFlow *f, void *ctx);
+
+/* 完整 dump 连接表，每条连接回调一次；buf 为 CONNTRACK_RECV_SIZE 字节的接收缓冲区 */
+static int ct_dump(FlowCallback cb, void *ctx, char *buf, char *err, size_t err_size) {
+    int fd = nl_open(0);
+    if (fd < 0) {
+        snprintf(err, err_size, "打开 ctnetlink 失败: %s", strerror(errno));
+        return -1;
+    }
+    struct timeval tv = {.tv_sec = 2};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    struct {
+        struct nlmsghdr nlh;
+        struct nfgenmsg nfg;
+    } req = {
+        .nlh = {.nlmsg_len = sizeof(req),
+                .nlmsg_type = (NFNL_SUBSYS_CTNETLINK << 8) | IPCTNL_MSG_CT_GET,
+                .nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP,
+                .nlmsg_seq = (uint32_t)time(NULL)},
+        .nfg = {.nfgen_family = AF_UNSPEC, .version = NFNETLINK_V0},
+    };
+    if (send(fd, &req, sizeof(req), 0) < 0) {
+        snprintf(err, err_size, "ctnetlink 请求失败: %s", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    int ret = -1;
+    CtFlow f;
+    for (;;) {
+        ssize_t n = recv(fd, buf, CONNTRACK_RECV_SIZE, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            snprintf(err, err_size, "ctnetlink 接收失败: %s", strerror(errno));
+            break;
+        }
+        int done = 0;
+        for (struct nlmsghdr *nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, n); nlh = NLMSG_NEXT(nlh, n)) {
+            if (nlh->nlmsg_type == NLMSG_DONE) {
+                done = 1;
+                ret = 0;
+                break;
+            }
+            if (nlh->nlmsg_type == NLMSG_ERROR) {
+                const struct nlmsgerr *e = NLMSG_DATA(nlh);
+                snprintf(err, err_size, "ctnetlink 错误: %s", strerror(-e->error));
+                done = 1;
+                break;
+            }
+            if (parse_flow(nlh, &f) >= 0) cb(&f, ctx);
+        }
+        if (done) break;
+    }
+    close(fd);
+    return ret;
+}
+
+/* ==================== 汇总 ==================== */
+
+static int proto_class(uint8_t proto) {
+    switch (proto) {
+    case IPPROTO_TCP:
+        return CT_TCP;
+    case IPPROTO_UDP:
+        return CT_UDP;
+    case IPPROTO_ICMP:
+    case IPPROTO_ICMPV6:
+        return CT_ICMP;
+    default:
+        return CT_OTHER;
+    }
+}
+
+static size_t addr_len(uint8_t family) { return family == AF_INET6 ? 16 : 4; }
+
+/*
+ * 计数增减。删除只减连接数: 汇总中的字节来自上次 dump 时的计数，
+ * 与销毁事件携带的最终计数不对应，扣除会把其他连接的字节一起减掉；
+ * 已结束连接的字节在下次重建时移出汇总
+ */
+static void counts_apply(CtCounts *c, const CtFlow *f, int sign) {
+    if (sign > 0) {
+        c->flows++;
+        c->bytes_up += f->bytes_up;
+        c->bytes_down += f->bytes_down;
+        return;
+    }
+    if (c->flows > 0) c->flows--;
+}
+
+static CtClient *find_client(CtSummary *s, const CtFlow *f, int create) {
+    size_t len = addr_len(f->family);
+    CtClient *empty = NULL;
+    for (int i = 0; i < s->client_count; i++) {
+        CtClient *cl = &s->clients[i];
+        if (cl->family == f->family && memcmp(cl->addr, f->src, len) == 0) return cl;
+        if (!empty && cl->counts.flows == 0) empty = cl;
+    }
+    if (!create) return NULL;
+    if (!empty && s->client_count < CONNTRACK_MAX_CLIENTS) empty = &s->clients[s->client_count++];
+    if (!empty) return NULL;
+
+    /* 复用已无连接的客户端槽位 */
+    memset(empty, 0, sizeof(*empty));
+    empty->family = f->family;
+    memcpy(empty->addr, f->src, len);
+    return empty;
+}
+
+static void summary_apply(CtSummary *s, const CtFlow *f, int sign) {
+    int pc = proto_class(f->proto);
+    counts_apply(&s->total, f, sign);
+    counts_apply(&s->protos[pc], f, sign);
+
+    CtClient *cl = find_client(s, f, sign > 0);
+    if (!cl) {
+        counts_apply(&s->others, f, sign);
+        return;
+    }
+    counts_apply(&cl->counts, f, sign);
+    if (sign > 0)
+        cl->proto_flows[pc]++;
+    else if (cl->proto_flows[pc] > 0)
+        cl->proto_flows[pc]--;
+}
+
+/* ==================== 连接 ID 集合 ==================== */
+
+static int idset_grow(CtIdSet *set) {
+    if (set->count < set->cap) return 0;
+    int cap = set->cap ? set->cap * 2 : 1024;
+    uint32_t *ids = realloc(set->ids, sizeof(uint32_t) * (size_t)cap);
+    if (!ids) {
+        set->complete = 0;
+        return -1;
+    }
+    set->ids = ids;
+    set->cap = cap;
+    return 0;
+}
+
+static int id_cmp(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* 返回 id 的位置，不存在时返回 -(插入位置)-1 */
+static int idset_find(const CtIdSet *set, uint32_t id) {
+    int lo = 0, hi = set->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (set->ids[mid] < id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < set->count && set->ids[lo] == id ? lo : -lo - 1;
+}
+
+static void idset_insert(CtIdSet *set, int pos, uint32_t id) {
+    if (idset_grow(set) != 0) return;
+    memmove(&set->ids[pos + 1], &set->ids[pos], sizeof(uint32_t) * (size_t)(set->count - pos));
+    set->ids[pos] = id;
+    set->count++;
+}
+
+static void idset_remove(CtIdSet *set, int pos) {
+    memmove(&set->ids[pos], &set->ids[pos + 1], sizeof(uint32_t) * (size_t)(set->count - pos - 1));
+    set->count--;
+}
+
+/*
+ * dump 期间排队的事件按连接 ID 去重后应用 (调用方持有锁):
+ * 新建的连接已在 dump 中则已计入；销毁的连接不在 dump 中说明在 dump 之前已结束，
+ * 汇总中本来就没有。dump 中途新建又销毁的连接经新建加入集合，销毁时正常扣除。
+ * 返回 1 表示需要应用该事件
+ */
+static int dedupe_event(CtIdSet *set, const CtFlow *f, int sign) {
+    int pos = idset_find(set, f->id);
+    if (sign > 0) {
+        if (pos >= 0) return 0;
+        idset_insert(set, -pos - 1, f->id);
+        return 1;
+    }
+    /* 集合不完整时无法区分，按普通事件处理 */
+    if (pos < 0) return !set->complete;
+    idset_remove(set, pos);
+    return 1;
+}
+
+static void resync_cb(const CtFlow *f, void *ctx) {
+    CtSnapshot *snap = ctx;
+    summary_apply(&snap->summary, f, 1);
+    if (idset_grow(snap->dumped) == 0) snap->dumped->ids[snap->dumped->count++] = f->id;
+    if (snap->flows && snap->flow_count < CONNTRACK_MAX_FLOWS)
+        snap->flows[snap->flow_count++] = *f;
+    else
+        snap->truncated = 1;
+}
+
+/* 读取 /proc/sys/net/netfilter 下的整数，失败返回 -1 */
+static long read_proc_long(const char *name) {
+    char path[128], buf[32];
+    snprintf(path, sizeof(path), CT_PROC_DIR "%s", name);
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    long v = fgets(buf, sizeof(buf), fp) ? strtol(buf, NULL, 10) : -1;
+    fclose(fp);
+    return v;
+}
+
+/*
+ * 字节统计需要内核连接计数 (只对之后新建的连接生效)。
+ * 这是全局 sysctl，只在配置 accounting 时修改，未开启时仅提示
+ */
+static void check_accounting(int allow) {
+    long acct = read_proc_long("nf_conntrack_acct");
+    if (acct != 0) return;
+    if (!allow) {
+        LOG_I("连接跟踪: nf_conntrack_acct 未开启，字节统计为 0 (配置 accounting 可自动开启)");
+        return;
+    }
+    FILE *fp = fopen(CT_PROC_DIR "nf_conntrack_acct", "w");
+    if (!fp) {
+        LOG_W("连接跟踪: 开启 nf_conntrack_acct 失败: %s", strerror(errno));
+        return;
+    }
+    fputs("1\n", fp);
+    fclose(fp);
+    LOG_W("连接跟踪: 已将 nf_conntrack_acct 由 0 改为 1 (系统全局设置，关闭本模块不会恢复)");
+}
+
+/*
+ * 完整 dump 重建汇总和连接快照；spare 为线程持有的空闲快照缓冲区，与当前快照交换；
+ * dumped 输出本次 dump 的全部连接 ID (有序)，用于对 dump 期间排队的事件去重
+ * @return 0成功，-1失败 (汇总保持不变)
+ */
+static int resync(char *buf, CtFlow **spare, CtIdSet *dumped) {
+    static CtSnapshot building;     /* 只由汇总线程使用 */
+    char err[96] = "";
+    uint64_t start = metrics_now_us();
+
+    memset(&building, 0, sizeof(building));
+    if (!*spare) *spare = malloc(sizeof(CtFlow) * CONNTRACK_MAX_FLOWS);
+    building.flows = *spare;        /* 分配失败时只重建汇总，快照标记为截断 */
+    dumped->count = 0;
+    dumped->complete = 1;
+    building.dumped = dumped;
+    int ret = ct_dump(resync_cb, &building, buf, err, sizeof(err));
+    if (dumped->count > 1) qsort(dumped->ids, (size_t)dumped->count, sizeof(uint32_t), id_cmp);
+
+    pthread_mutex_lock(&g_ct_lock);
+    if (ret == 0) {
+        g_ct.summary = building.summary;
+        *spare = g_ct.flows;
+        g_ct.flows = building.flows;
+        g_ct.flow_count = building.flow_count;
+        g_ct.flows_truncated = building.truncated;
+        g_ct.resyncs++;
+        g_ct.last_resync = time(NULL);
+        g_ct.last_resync_ms = (long)((metrics_now_us() - start) / 1000);
+    }
+    snprintf(g_ct.last_error, sizeof(g_ct.last_error), "%s", err);
+    pthread_mutex_unlock(&g_ct_lock);
+    if (ret != 0) LOG_W("连接跟踪: %s", err);
+    return ret;
+}
+
+/* 读取所有排队的事件，dedupe 非 NULL 时按 dump 的连接 ID 去重；返回 -1 表示事件丢失需要重建 */
+static int read_events(int fd, char *buf, CtIdSet *dedupe) {
+    CtFlow f;
+    for (;;) {
+        ssize_t n = recv(fd, buf, CONNTRACK_RECV_SIZE, MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            if (errno == EINTR) continue;
+            return errno == ENOBUFS ? -1 : 0;
+        }
+
+        pthread_mutex_lock(&g_ct_lock);
+        for (struct nlmsghdr *nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, n); nlh = NLMSG_NEXT(nlh, n)) {
+            int type = parse_flow(nlh, &f);
+            if (type < 0) continue;
+            int sign = type == IPCTNL_MSG_CT_DELETE ? -1 : 1;
+            g_ct.events++;
+            if (dedupe && !dedupe_event(dedupe, &f, sign)) continue;
+            summary_apply(&g_ct.summary, &f, sign);
+        }
+        pthread_mutex_unlock(&g_ct_lock);
+    }
+}
+
+static void *conntrack_thread(void *arg) {
+    (void)arg;
+    char *buf = malloc(CONNTRACK_RECV_SIZE);
+    CtFlow *spare = NULL;
+    CtIdSet dumped = {0};
+    int fd = -1;
+    int acct_checked = 0;
+    time_t next_resync = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&g_ct_lock);
+        if (worker_exit_locked(&g_ct_worker, !buf)) {
+            pthread_mutex_unlock(&g_ct_lock);
+            break;
+        }
+        int resync_sec = g_ct.cfg.resync_sec;
+        int accounting = g_ct.cfg.accounting;
+        if (g_ct.resync_requested) next_resync = 0;
+        g_ct.resync_requested = 0;
+        pthread_mutex_unlock(&g_ct_lock);
+
+        /* 启动时检查一次，之后配置允许修改时再检查 */
+        if (acct_checked < 1 + accounting) {
+            check_accounting(accounting);
+            acct_checked = 1 + accounting;
+        }
+
+        if (fd < 0) {
+            /* 只订阅新建和销毁，状态更新事件量大且不影响汇总 */
+            fd = nl_open((1u << (NFNLGRP_CONNTRACK_NEW - 1)) | (1u << (NFNLGRP_CONNTRACK_DESTROY - 1)));
+            if (fd < 0) {
+                pthread_mutex_lock(&g_ct_lock);
+                snprintf(g_ct.last_error, sizeof(g_ct.last_error), "订阅 ctnetlink 事件失败: %s", strerror(errno));
+                pthread_mutex_unlock(&g_ct_lock);
+                sleep(5);
+                continue;
+            }
+            int size = CT_EVENT_RCVBUF;
+            if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) != 0)
+                setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+            next_resync = 0;
+        }
+
+        int lost = 0;
+        if (time(NULL) >= next_resync) {
+            /* dump 期间的事件在事件套接字中排队，重建后去重应用 */
+            int ret = resync(buf, &spare, &dumped);
+            lost = read_events(fd, buf, ret == 0 ? &dumped : NULL) != 0;
+            next_resync = time(NULL) + resync_sec;
+        }
+
+        struct pollfd p = {.fd = fd, .events = POLLIN};
+        if (!lost && poll(&p, 1, 1000) > 0) lost = read_events(fd, buf, NULL) != 0;
+        if (lost) {
+            pthread_mutex_lock(&g_ct_lock);
+            g_ct.overflows++;
+            pthread_mutex_unlock(&g_ct_lock);
+            next_resync = 0;
+        }
+    }
+
+    if (fd >= 0) close(fd);
+    free(dumped.ids);
+    free(spare);
+    free(buf);
+    return NULL;
+}
+
+static void load_config(ConntrackConfig *cfg) {
+    cfg->enabled = config_get_int("conntrack_enabled", CONNTRACK_DEFAULTS.enabled);
+    cfg->accounting = config_get_int("conntrack_accounting", CONNTRACK_DEFAULTS.accounting);
+    cfg->resync_sec = config_get_int("conntrack_resync_sec", CONNTRACK_DEFAULTS.resync_sec);
+}
+
+static void save_config(const ConntrackConfig *cfg) {
+    config_set_int("conntrack_enabled", cfg->enabled);
+    config_set_int("conntrack_accounting", cfg->accounting);
+    config_set_int("conntrack_resync_sec", cfg->resync_sec);
+}
+
+int conntrack_init(void) {
+    pthread_mutex_lock(&g_ct_lock);
+    load_config(&g_ct.cfg);
+    worker_start_locked(&g_ct_worker);
+    pthread_mutex_unlock(&g_ct_lock);
+    return 0;
+}
+
+/* ==================== API ==================== */
+
+static const char *proto_name(uint8_t proto, char *buf, size_t size) {
+    switch (proto) {
+    case IPPROTO_TCP:
+        return "tcp";
+    case IPPROTO_UDP:
+        return "udp";
+    case IPPROTO_ICMP:
+        return "icmp";
+    case IPPROTO_ICMPV6:
+        return "icmpv6";
+    case IPPROTO_GRE:
+        return "gre";
+    case IPPROTO_SCTP:
+        return "sctp";
+    default:
+        snprintf(buf, size, "%u", proto);
+        return buf;
+    }
+}
+
+static const char *tcp_state_name(uint8_t state) {
+    static const char *const names[] = {"NONE",       "SYN_SENT", "SYN_RECV",  "ESTABLISHED", "FIN_WAIT",
+                                        "CLOSE_WAIT", "LAST_ACK", "TIME_WAIT", "CLOSE",       "SYN_SENT2"};
+    return state < sizeof(names) / sizeof(names[0]) ? names[state] : "UNKNOWN";
+}
+
+static void add_counts(JsonBuilder *j, const CtCounts *c) {
+    json_add_int(j, "flows", (int)c->flows);
+    json_add_long(j, "bytes_up", (long long)c->bytes_up);
+    json_add_long(j, "bytes_down", (long long)c->bytes_down);
+}
+
+static int client_cmp(const void *a, const void *b) {
+    const CtClient *x = a, *y = b;
+    uint64_t bx = x->counts.bytes_up + x->counts.bytes_down;
+    uint64_t by = y->counts.bytes_up + y->counts.bytes_down;
+    if (bx != by) return bx > by ? -1 : 1;
+    return (int)y->counts.flows - (int)x->counts.flows;
+}
+
+void handle_conntrack_summary(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    char buf[16];
+    int top = 10;
+    if (mg_http_get_var(&hm->query, "top", buf, sizeof(buf)) > 0) {
+        top = atoi(buf);
+        if (top <= 0 || top > CONNTRACK_MAX_CLIENTS) top = CONNTRACK_MAX_CLIENTS;
+    }
+
+    CtSummary *s = malloc(sizeof(*s));
+    if (!s) {
+        HTTP_ERROR(c, 500, "内存不足");
+        return;
+    }
+
+    JsonBuilder *j = json_new();
+    json_obj_open(j);
+
+    pthread_mutex_lock(&g_ct_lock);
+    *s = g_ct.summary;
+    json_key_obj_open(j, "config");
+    json_add_bool(j, "enabled", g_ct.cfg.enabled);
+    json_add_bool(j, "accounting", g_ct.cfg.accounting);
+    json_add_int(j, "resync_sec", g_ct.cfg.resync_sec);
+    json_obj_close(j);
+
+    json_key_obj_open(j, "state");
+    json_add_bool(j, "running", g_ct_worker.running);
+    json_add_long(j, "events", (long long)g_ct.events);
+    json_add_int(j, "resyncs", (int)g_ct.resyncs);
+    json_add_int(j, "overflows", (int)g_ct.overflows);
+    json_add_long(j, "last_resync", (long long)g_ct.last_resync);
+    json_add_long(j, "last_resync_ms", g_ct.last_resync_ms);
+    json_add_int(j, "snapshot_flows", g_ct.flow_count);
+    json_add_bool(j, "snapshot_truncated", g_ct.flows_truncated);
+    json_add_str(j, "last_error", g_ct.last_error);
+    json_obj_close(j);
+    pthread_mutex_unlock(&g_ct_lock);
+
+    json_key_obj_open(j, "kernel");
+    json_add_long(j, "count", read_proc_long("nf_conntrack_count"));
+    json_add_long(j, "max", read_proc_long("nf_conntrack_max"));
+    json_add_bool(j, "accounting", read_proc_long("nf_conntrack_acct") > 0);
+    json_obj_close(j);
+
+    json_key_obj_open(j, "total");
+    add_counts(j, &s->total);
+    json_obj_close(j);
+
+    json_key_obj_open(j, "protocols");
+    for (int i = 0; i < CT_PROTO_COUNT; i++) {
+        json_key_obj_open(j, CT_PROTO_NAMES[i]);
+        add_counts(j, &s->protos[i]);
+        json_obj_close(j);
+    }
+    json_obj_close(j);
+
+    /* 按字节排序的前 top 个客户端 */
+    qsort(s->clients, (size_t)s->client_count, sizeof(CtClient), client_cmp);
+    json_arr_open(j, "clients");
+    for (int i = 0; i < s->client_count && i < top; i++) {
+        const CtClient *cl = &s->clients[i];
+        if (cl->counts.flows == 0 && cl->counts.bytes_up + cl->counts.bytes_down == 0) continue;
+        char ip[INET6_ADDRSTRLEN];
+        inet_ntop(cl->family, cl->addr, ip, sizeof(ip));
+        json_arr_obj_open(j);
+        json_add_str(j, "ip", ip);
+        add_counts(j, &cl->counts);
+        for (int k = 0; k < CT_PROTO_COUNT; k++) {
+            char key[16];
+            snprintf(key, sizeof(key), "%s_flows", CT_PROTO_NAMES[k]);
+            json_add_int(j, key, (int)cl->proto_flows[k]);
+        }
+        json_obj_close(j);
+    }
+    json_arr_close(j);
+
+    json_key_obj_open(j, "others");
+    add_counts(j, &s->others);
+    json_obj_close(j);
+
+    json_obj_close(j);
+    free(s);
+    HTTP_OK_FREE(c, json_finish(j));
+}
+
+void handle_conntrack_config(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_POST(c, hm);
+
+    pthread_mutex_lock(&g_ct_lock);
+    ConntrackConfig cfg = g_ct.cfg;
+    pthread_mutex_unlock(&g_ct_lock);
+
+    bool b;
+    if (mg_json_get_bool(hm->body, "$.enabled", &b)) cfg.enabled = b;
+    if (mg_json_get_bool(hm->body, "$.accounting", &b)) cfg.accounting = b;
+    cfg.resync_sec = (int)mg_json_get_long(hm->body, "$.resync_sec", cfg.resync_sec);
+    if (cfg.resync_sec < 5 || cfg.resync_sec > 3600) {
+        HTTP_ERROR(c, 400, "resync_sec 范围 5-3600");
+        return;
+    }
+
+    pthread_mutex_lock(&g_ct_lock);
+    g_ct.cfg = cfg;
+    g_ct.resync_requested = 1;
+    save_config(&cfg);
+    worker_start_locked(&g_ct_worker);
+    pthread_mutex_unlock(&g_ct_lock);
+
+    HTTP_SUCCESS(c, "配置已保存");
+}
+
+/* 分页查询: 遍历连接快照，只保留当前页需要的连接 */
+typedef struct {
+    int has_client;
+    uint8_t family;
+    uint8_t addr[16];
+    int proto;                      /* -1=任意 */
+    int port;                       /* -1=任意 */
+    int by_bytes;
+    int offset;
+    int limit;
+    int total;
+    CtFlow *page;
+    int count;
+} FlowQuery;
+
+static uint64_t flow_bytes(const CtFlow *f) { return f->bytes_up + f->bytes_down; }
+
+static void query_cb(const CtFlow *f, void *ctx) {
+    FlowQuery *q = ctx;
+    if (q->has_client && (f->family != q->family || memcmp(f->src, q->addr, addr_len(q->family)) != 0)) return;
+    if (q->proto >= 0 && f->proto != q->proto) return;
+    if (q->port >= 0 && f->sport != q->port && f->dport != q->port) return;
+    q->total++;
+
+    if (!q->by_bytes) {
+        if (q->total > q->offset && q->count < q->limit) q->page[q->count++] = *f;
+        return;
+    }
+
+    /* 按字节降序保留前 offset+limit 条 (插入排序，容量固定) */
+    int cap = q->offset + q->limit;
+    if (q->count == cap && flow_bytes(f) <= flow_bytes(&q->page[cap - 1])) return;
+    int i = q->count < cap ? q->count++ : cap - 1;
+    while (i > 0 && flow_bytes(&q->page[i - 1]) < flow_bytes(f)) {
+        q->page[i] = q->page[i - 1];
+        i--;
+    }
+    q->page[i] = *f;
+}
+
+/* 非负整数查询参数: 负数返回 -1，过大截断为 INT_MAX */
+static int parse_count(const char *s) {
+    long v = strtol(s, NULL, 10);
+    if (v < 0) return -1;
+    return v > INT_MAX ? INT_MAX : (int)v;
+}
+
+static int parse_proto(const char *s) {
+    if (strcmp(s, "tcp") == 0) return IPPROTO_TCP;
+    if (strcmp(s, "udp") == 0) return IPPROTO_UDP;
+    if (strcmp(s, "icmp") == 0) return IPPROTO_ICMP;
+    if (strcmp(s, "icmpv6") == 0) return IPPROTO_ICMPV6;
+    char *end;
+    long v = strtol(s, &end, 10);
+    return *s && !*end && v >= 0 && v <= 255 ? (int)v : -2;
+}
+
+static void add_flow_json(JsonBuilder *j, const CtFlow *f) {
+    char src[INET6_ADDRSTRLEN], dst[INET6_ADDRSTRLEN], nat[INET6_ADDRSTRLEN], num[8];
+    inet_ntop(f->family, f->src, src, sizeof(src));
+    inet_ntop(f->family, f->dst, dst, sizeof(dst));
+    inet_ntop(f->family, f->nat, nat, sizeof(nat));
+
+    json_arr_obj_open(j);
+    json_add_str(j, "family", f->family == AF_INET6 ? "ipv6" : "ipv4");
+    json_add_str(j, "proto", proto_name(f->proto, num, sizeof(num)));
+    json_add_str(j, "src", src);
+    json_add_int(j, "sport", f->sport);
+    json_add_str(j, "dst", dst);
+    json_add_int(j, "dport", f->dport);
+    /* 回复方向的目的地址与原方向源地址不同即经过了 SNAT */
+    if (memcmp(f->nat, f->src, addr_len(f->family)) != 0) json_add_str(j, "nat", nat);
+    if (f->tcp_state != 0xff) json_add_str(j, "state", tcp_state_name(f->tcp_state));
+    json_add_long(j, "timeout", f->timeout);
+    json_add_long(j, "bytes_up", (long long)f->bytes_up);
+    json_add_long(j, "bytes_down", (long long)f->bytes_down);
+    json_add_long(j, "packets_up", (long long)f->packets_up);
+    json_add_long(j, "packets_down", (long long)f->packets_down);
+    json_obj_close(j);
+}
+
+void handle_conntrack_flows(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    FlowQuery q = {.proto = -1, .port = -1, .limit = 50};
+    char buf[64];
+    if (mg_http_get_var(&hm->query, "client", buf, sizeof(buf)) > 0) {
+        q.has_client = 1;
+        if (inet_pton(AF_INET, buf, q.addr) == 1) {
+            q.family = AF_INET;
+        } else if (inet_pton(AF_INET6, buf, q.addr) == 1) {
+            q.family = AF_INET6;
+        } else {
+            HTTP_ERROR(c, 400, "client 地址无效");
+            return;
+        }
+    }
+    if (mg_http_get_var(&hm->query, "proto", buf, sizeof(buf)) > 0) {
+        q.proto = parse_proto(buf);
+        if (q.proto < 0) {
+            HTTP_ERROR(c, 400, "proto 无效");
+            return;
+        }
+    }
+    if (mg_http_get_var(&hm->query, "port", buf, sizeof(buf)) > 0) {
+        q.port = atoi(buf);
+        if (q.port < 0 || q.port > 65535) {
+            HTTP_ERROR(c, 400, "port 无效");
+            return;
+        }
+    }
+    if (mg_http_get_var(&hm->query, "sort", buf, sizeof(buf)) > 0) q.by_bytes = strcmp(buf, "bytes") == 0;
+    if (mg_http_get_var(&hm->query, "offset", buf, sizeof(buf)) > 0) q.offset = parse_count(buf);
+    if (mg_http_get_var(&hm->query, "limit", buf, sizeof(buf)) > 0) q.limit = parse_count(buf);
+    /* 先限定 limit，再比较 offset，避免 offset+limit 溢出 */
+    if (q.offset < 0 || q.limit < 1 || q.limit > CONNTRACK_MAX_PAGE ||
+        (q.by_bytes && q.offset > CONNTRACK_MAX_PAGE - q.limit)) {
+        HTTP_ERROR(c, 400, "分页参数无效 (按字节排序时 offset+limit 不超过 200)");
+        return;
+    }
+
+    q.page = malloc(sizeof(CtFlow) * (size_t)(q.by_bytes ? q.offset + q.limit : q.limit));
+    if (!q.page) {
+        HTTP_ERROR(c, 500, "内存不足");
+        return;
+    }
+
+    /* 快照由汇总线程在每次 dump 后整体替换，这里只在内存中过滤，不访问 netlink */
+    pthread_mutex_lock(&g_ct_lock);
+    int enabled = g_ct.cfg.enabled;
+    for (int i = 0; enabled && i < g_ct.flow_count; i++) query_cb(&g_ct.flows[i], &q);
+    int truncated = g_ct.flows_truncated;
+    time_t updated = g_ct.last_resync;
+    pthread_mutex_unlock(&g_ct_lock);
+
+    if (!enabled) {
+        free(q.page);
+        HTTP_ERROR(c, 400, "连接跟踪未启用");
+        return;
+    }
+
+    JsonBuilder *j = json_new();
+    json_obj_open(j);
+    json_add_int(j, "total", q.total);
+    json_add_int(j, "offset", q.offset);
+    json_add_int(j, "limit", q.limit);
+    json_add_long(j, "updated", (long long)updated);
+    json_add_bool(j, "truncated", truncated);
+    json_arr_open(j, "flows");
+    for (int i = q.by_bytes ? q.offset : 0; i < q.count; i++) add_flow_json(j, &q.page[i]);
+    json_arr_close(j);
+    json_obj_close(j);
+    free(q.page);
+
+    HTTP_OK_FREE(c, json_finish(j));
+}
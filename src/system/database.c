@@ -351,6 +351,22 @@ int config_set(const char *key, const char *value) {
     return db_execute_safe(sql);
 }
 
+/* 数据库不保存空值，空字符串以 none 存储 */
+#define CONFIG_EMPTY_VALUE "none"
+
+int config_get_optional(const char *key, char *value, size_t value_size, const char *default_val) {
+    if (config_get(key, value, value_size) != 0) {
+        snprintf(value, value_size, "%s", default_val ? default_val : "");
+    } else if (strcmp(value, CONFIG_EMPTY_VALUE) == 0) {
+        value[0] = '\0';
+    }
+    return 0;
+}
+
+int config_set_optional(const char *key, const char *value) {
+    return config_set(key, value && value[0] ? value : CONFIG_EMPTY_VALUE);
+}
+
 int config_get_int(const char *key, int default_val) {
     char value[64];
     if (config_get(key, value, sizeof(value)) == 0) {
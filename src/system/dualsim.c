@@ -0,0 +1,477 @@
+/**
+ * @file dualsim.c
+ * @brief 双卡槽状态常驻缓存实现
+ */
+
+#include "dualsim.h"
+#include "airplane.h"
+#include "http_utils.h"
+#include "json_builder.h"
+#include "log.h"
+#include "metrics.h"
+#include "ofono.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define DUALSIM_CALL_TIMEOUT_MS 5000
+
+/* 单次切卡记录 */
+typedef struct {
+    char from[8];
+    char to[8];
+    int target;                 /* 目标卡槽索引 */
+    time_t started_at;
+    uint64_t start_us;
+    long switch_ms;             /* -1 进行中 */
+    long data_up_ms;            /* -1 数据连接尚未激活 */
+    int ok;
+} SwitchRecord;
+
+static const char *g_slot_names[DUALSIM_SLOTS] = {"slot1", "slot2"};
+static const char *g_slot_paths[DUALSIM_SLOTS] = {"/ril_0", "/ril_1"};
+
+static struct {
+    int ready;
+    int active;                 /* 当前数据卡槽索引，-1 未知 */
+    DualSimSlot slots[DUALSIM_SLOTS];
+    GDBusProxy *proxies[DUALSIM_SLOTS];
+    SwitchRecord history[DUALSIM_HISTORY];
+    unsigned switches;          /* 累计切卡次数 (history 按 switches % DUALSIM_HISTORY 存放) */
+    int current;                /* 进行中或等待数据连接的记录序号，-1 无 */
+} g_ds = {.active = -1, .current = -1};
+
+static pthread_mutex_t g_ds_lock = PTHREAD_MUTEX_INITIALIZER;
+static GDBusConnection *g_ds_conn = NULL;
+static guint g_ds_signal_id = 0;
+static guint g_ds_watch_id = 0;
+
+/* ==================== 内部辅助函数 ==================== */
+
+/* "/ril_0"、"/ril_0/context1" -> 0；其他路径 -> -1 */
+static int slot_index(const char *path) {
+    if (!path) return -1;
+    for (int i = 0; i < DUALSIM_SLOTS; i++) {
+        size_t n = strlen(g_slot_paths[i]);
+        if (strncmp(path, g_slot_paths[i], n) == 0 && (path[n] == '\0' || path[n] == '/')) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void copy_str(char *dst, size_t size, GVariant *v) {
+    if (!g_variant_is_of_type(v, G_VARIANT_TYPE_STRING)) return;
+    snprintf(dst, size, "%s", g_variant_get_string(v, NULL));
+}
+
+static int get_bool(GVariant *v, int *out) {
+    if (!g_variant_is_of_type(v, G_VARIANT_TYPE_BOOLEAN)) return 0;
+    *out = g_variant_get_boolean(v) ? 1 : 0;
+    return 1;
+}
+
+/* 把一个属性写入卡槽镜像 (调用方持锁或操作局部副本) */
+static void apply_prop(DualSimSlot *s, const char *iface, const char *name, GVariant *v) {
+    if (strcmp(iface, "org.ofono.Modem") == 0) {
+        if (strcmp(name, "Online") == 0) get_bool(v, &s->online);
+    } else if (strcmp(iface, "org.ofono.SimManager") == 0) {
+        if (strcmp(name, "Present") == 0) {
+            get_bool(v, &s->sim_present);
+        } else if (strcmp(name, "CardIdentifier") == 0) {
+            copy_str(s->iccid, sizeof(s->iccid), v);
+        } else if (strcmp(name, "SubscriberIdentity") == 0) {
+            copy_str(s->imsi, sizeof(s->imsi), v);
+            snprintf(s->carrier, sizeof(s->carrier), "%s",
+                     s->imsi[0] ? get_carrier_from_imsi(s->imsi) : "");
+        } else if (strcmp(name, "ServiceProviderName") == 0) {
+            copy_str(s->spn, sizeof(s->spn), v);
+        }
+    } else if (strcmp(iface, "org.ofono.NetworkRegistration") == 0) {
+        if (strcmp(name, "Status") == 0) {
+            copy_str(s->reg_status, sizeof(s->reg_status), v);
+        } else if (strcmp(name, "Technology") == 0) {
+            copy_str(s->technology, sizeof(s->technology), v);
+        } else if (strcmp(name, "Name") == 0) {
+            copy_str(s->operator_name, sizeof(s->operator_name), v);
+        }
+    } else if (strcmp(iface, OFONO_RADIO_SETTINGS) == 0) {
+        if (strcmp(name, "TechnologyPreference") == 0) copy_str(s->mode, sizeof(s->mode), v);
+    }
+}
+
+static GVariant *call_sync(const char *path, const char *iface, const char *method,
+                           const GVariantType *reply_type) {
+    GError *error = NULL;
+    GVariant *ret = g_dbus_connection_call_sync(g_ds_conn, OFONO_SERVICE, path, iface, method, NULL,
+                                                reply_type, G_DBUS_CALL_FLAGS_NONE,
+                                                DUALSIM_CALL_TIMEOUT_MS, NULL, &error);
+    if (!ret) {
+        LOG_D("[DualSim] %s %s.%s 失败: %s", path, iface, method, error ? error->message : "unknown");
+        if (error) g_error_free(error);
+    }
+    return ret;
+}
+
+/* GetProperties 并写入镜像，返回 0 成功 */
+static int load_iface(DualSimSlot *s, const char *iface) {
+    GVariant *ret = call_sync(s->path, iface, "GetProperties", G_VARIANT_TYPE("(a{sv})"));
+    if (!ret) return -1;
+
+    GVariantIter *iter = NULL;
+    const gchar *key;
+    GVariant *value;
+    g_variant_get(ret, "(a{sv})", &iter);
+    while (g_variant_iter_next(iter, "{&sv}", &key, &value)) {
+        apply_prop(s, iface, key, value);
+        g_variant_unref(value);
+    }
+    g_variant_iter_free(iter);
+    g_variant_unref(ret);
+    return 0;
+}
+
+/* 查找 internet 类型的数据上下文 */
+static void load_context(DualSimSlot *s) {
+    GVariant *ret = call_sync(s->path, "org.ofono.ConnectionManager", "GetContexts",
+                              G_VARIANT_TYPE("(a(oa{sv}))"));
+    if (!ret) return;
+
+    GVariantIter *iter = NULL;
+    const gchar *path;
+    GVariant *props;
+    g_variant_get(ret, "(a(oa{sv}))", &iter);
+    while (g_variant_iter_next(iter, "(&o@a{sv})", &path, &props)) {
+        const gchar *type = NULL;
+        gboolean active = FALSE;
+        g_variant_lookup(props, "Type", "&s", &type);
+        g_variant_lookup(props, "Active", "b", &active);
+        if (!s->context_path[0] && type && strcmp(type, "internet") == 0) {
+            snprintf(s->context_path, sizeof(s->context_path), "%s", path);
+            s->data_active = active ? 1 : 0;
+        }
+        g_variant_unref(props);
+    }
+    g_variant_iter_free(iter);
+    g_variant_unref(ret);
+}
+
+/* 重新加载一个卡槽的全部镜像 (不持锁执行 D-Bus 调用) */
+static void load_slot(int idx) {
+    DualSimSlot s;
+    memset(&s, 0, sizeof(s));
+    snprintf(s.slot, sizeof(s.slot), "%s", g_slot_names[idx]);
+    snprintf(s.path, sizeof(s.path), "%s", g_slot_paths[idx]);
+
+    if (load_iface(&s, "org.ofono.Modem") == 0) {
+        s.available = 1;
+        load_iface(&s, "org.ofono.SimManager");
+        load_iface(&s, "org.ofono.NetworkRegistration");
+        load_iface(&s, OFONO_RADIO_SETTINGS);
+        load_context(&s);
+    }
+
+    pthread_mutex_lock(&g_ds_lock);
+    g_ds.slots[idx] = s;
+    pthread_mutex_unlock(&g_ds_lock);
+}
+
+static int load_active(void) {
+    GVariant *ret = call_sync("/", "org.ofono.Manager", "GetDataCard", G_VARIANT_TYPE("(o)"));
+    if (!ret) return -1;
+
+    const gchar *path = NULL;
+    g_variant_get(ret, "(&o)", &path);
+    int idx = slot_index(path);
+    g_variant_unref(ret);
+
+    pthread_mutex_lock(&g_ds_lock);
+    g_ds.active = idx;
+    pthread_mutex_unlock(&g_ds_lock);
+    return idx >= 0 ? 0 : -1;
+}
+
+static void reload_all(void) {
+    for (int i = 0; i < DUALSIM_SLOTS; i++) load_slot(i);
+    load_active();
+}
+
+/* 持锁调用: 目标卡槽数据连接激活时结束计时 */
+static void check_data_up(void) {
+    if (g_ds.current < 0) return;
+    SwitchRecord *r = &g_ds.history[g_ds.current % DUALSIM_HISTORY];
+    if (r->switch_ms < 0 || !r->ok || r->data_up_ms >= 0) return;
+    if (g_ds.active != r->target || !g_ds.slots[r->target].data_active) return;
+
+    r->data_up_ms = (long)((metrics_now_us() - r->start_us) / 1000);
+    g_ds.current = -1;
+    LOG_I("[DualSim] 切换到 %s 后数据连接已激活，耗时 %ld ms", r->to, r->data_up_ms);
+}
+
+/* ==================== 信号回调 ==================== */
+
+static void on_property_changed(GDBusConnection *conn, const gchar *sender_name,
+                                const gchar *object_path, const gchar *interface_name,
+                                const gchar *signal_name, GVariant *parameters,
+                                gpointer user_data) {
+    (void)conn;
+    (void)sender_name;
+    (void)signal_name;
+    (void)user_data;
+
+    if (!g_variant_is_of_type(parameters, G_VARIANT_TYPE("(sv)"))) return;
+
+    const gchar *name = NULL;
+    GVariant *value = NULL;
+    g_variant_get(parameters, "(&sv)", &name, &value);
+
+    pthread_mutex_lock(&g_ds_lock);
+    if (strcmp(interface_name, "org.ofono.Manager") == 0) {
+        if (strcmp(name, "DataCard") == 0 && g_variant_is_of_type(value, G_VARIANT_TYPE_OBJECT_PATH)) {
+            g_ds.active = slot_index(g_variant_get_string(value, NULL));
+            check_data_up();
+        }
+    } else {
+        int idx = slot_index(object_path);
+        if (idx >= 0) {
+            DualSimSlot *s = &g_ds.slots[idx];
+            if (strcmp(interface_name, "org.ofono.ConnectionContext") == 0) {
+                /* 只跟踪 internet 上下文；启动时尚未建立的上下文以首个变化者为准 */
+                if (strcmp(name, "Active") == 0 &&
+                    (!s->context_path[0] || strcmp(s->context_path, object_path) == 0)) {
+                    get_bool(value, &s->data_active);
+                    check_data_up();
+                }
+            } else if (strcmp(object_path, s->path) == 0) {
+                apply_prop(s, interface_name, name, value);
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_ds_lock);
+
+    g_variant_unref(value);
+}
+
+static void on_ofono_appeared(GDBusConnection *conn, const gchar *name, const gchar *name_owner,
+                              gpointer user_data) {
+    (void)conn;
+    (void)name;
+    (void)name_owner;
+    (void)user_data;
+    reload_all();
+    LOG_I("[DualSim] oFono 已启动，卡槽状态已重新加载");
+}
+
+static void on_ofono_vanished(GDBusConnection *conn, const gchar *name, gpointer user_data) {
+    (void)conn;
+    (void)name;
+    (void)user_data;
+    pthread_mutex_lock(&g_ds_lock);
+    for (int i = 0; i < DUALSIM_SLOTS; i++) g_ds.slots[i].available = 0;
+    pthread_mutex_unlock(&g_ds_lock);
+}
+
+/* ==================== 公共接口 ==================== */
+
+int dualsim_init(void) {
+    GError *error = NULL;
+
+    if (g_ds_conn) return 0;
+
+    g_ds_conn = g_bus_get_sync(G_BUS_TYPE_SYSTEM, NULL, &error);
+    if (!g_ds_conn) {
+        LOG_E("[DualSim] 获取 D-Bus 连接失败: %s", error ? error->message : "unknown");
+        if (error) g_error_free(error);
+        return -1;
+    }
+
+    /* 两个卡槽的 AT 代理常驻，切卡时不再重建 (oFono 使用自定义 PropertyChanged 信号，代理不缓存属性) */
+    for (int i = 0; i < DUALSIM_SLOTS; i++) {
+        g_ds.proxies[i] = g_dbus_proxy_new_sync(
+            g_ds_conn, G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES | G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+            NULL, OFONO_SERVICE, g_slot_paths[i], "org.ofono.Modem", NULL, &error);
+        if (!g_ds.proxies[i]) {
+            LOG_W("[DualSim] 创建 %s 代理失败: %s", g_slot_paths[i], error ? error->message : "unknown");
+            g_clear_error(&error);
+        }
+    }
+
+    /* 一个订阅覆盖两个卡槽的所有 PropertyChanged，在回调中按路径和接口分发 */
+    g_ds_signal_id = g_dbus_connection_signal_subscribe(g_ds_conn, OFONO_SERVICE, NULL, "PropertyChanged",
+                                                        NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE,
+                                                        on_property_changed, NULL, NULL);
+
+    reload_all();
+    g_ds_watch_id = g_bus_watch_name_on_connection(g_ds_conn, OFONO_SERVICE, G_BUS_NAME_WATCHER_FLAGS_NONE,
+                                                   on_ofono_appeared, on_ofono_vanished, NULL, NULL);
+
+    pthread_mutex_lock(&g_ds_lock);
+    g_ds.ready = 1;
+    LOG_I("[DualSim] 卡槽状态缓存就绪: 当前 %s, slot1 %s, slot2 %s",
+          g_ds.active >= 0 ? g_slot_names[g_ds.active] : "unknown",
+          g_ds.slots[0].available ? "可用" : "不可用", g_ds.slots[1].available ? "可用" : "不可用");
+    pthread_mutex_unlock(&g_ds_lock);
+    return 0;
+}
+
+int dualsim_get_active(char *slot, char *ril_path) {
+    int rc = -1;
+    pthread_mutex_lock(&g_ds_lock);
+    if (g_ds.ready && g_ds.active >= 0) {
+        strcpy(slot, g_slot_names[g_ds.active]);
+        strcpy(ril_path, g_slot_paths[g_ds.active]);
+        rc = 0;
+    }
+    pthread_mutex_unlock(&g_ds_lock);
+    return rc;
+}
+
+GDBusProxy *dualsim_modem_proxy(const char *modem_path) {
+    int idx = slot_index(modem_path);
+    GDBusProxy *proxy = NULL;
+
+    if (idx < 0 || strcmp(modem_path, g_slot_paths[idx]) != 0) return NULL;
+
+    pthread_mutex_lock(&g_ds_lock);
+    GDBusProxy *p = g_ds.proxies[idx];
+    if (p && !g_dbus_connection_is_closed(g_dbus_proxy_get_connection(p))) {
+        proxy = g_object_ref(p);
+    }
+    pthread_mutex_unlock(&g_ds_lock);
+    return proxy;
+}
+
+int dualsim_get_slot(const char *modem_path, DualSimSlot *out) {
+    int idx = slot_index(modem_path);
+    int rc = -1;
+
+    if (idx < 0) return -1;
+
+    pthread_mutex_lock(&g_ds_lock);
+    if (g_ds.ready && g_ds.slots[idx].available) {
+        *out = g_ds.slots[idx];
+        rc = 0;
+    }
+    pthread_mutex_unlock(&g_ds_lock);
+    return rc;
+}
+
+void dualsim_switch_begin(const char *target_path) {
+    int idx = slot_index(target_path);
+    if (idx < 0) return;
+
+    pthread_mutex_lock(&g_ds_lock);
+    SwitchRecord *r = &g_ds.history[g_ds.switches % DUALSIM_HISTORY];
+    memset(r, 0, sizeof(*r));
+    snprintf(r->from, sizeof(r->from), "%s", g_ds.active >= 0 ? g_slot_names[g_ds.active] : "unknown");
+    snprintf(r->to, sizeof(r->to), "%s", g_slot_names[idx]);
+    r->target = idx;
+    r->started_at = time(NULL);
+    r->start_us = metrics_now_us();
+    r->switch_ms = -1;
+    r->data_up_ms = -1;
+    g_ds.current = (int)g_ds.switches;
+    g_ds.switches++;
+    pthread_mutex_unlock(&g_ds_lock);
+}
+
+long dualsim_switch_end(int ok) {
+    long ms = -1;
+
+    pthread_mutex_lock(&g_ds_lock);
+    if (g_ds.current >= 0) {
+        SwitchRecord *r = &g_ds.history[g_ds.current % DUALSIM_HISTORY];
+        r->switch_ms = (long)((metrics_now_us() - r->start_us) / 1000);
+        r->ok = ok;
+        ms = r->switch_ms;
+        if (ok) {
+            /* 不等 DataCard 信号，直接切换活动卡槽 */
+            g_ds.active = r->target;
+            check_data_up();
+        } else {
+            g_ds.current = -1;
+        }
+    }
+    pthread_mutex_unlock(&g_ds_lock);
+    return ms;
+}
+
+/* ==================== HTTP 接口 ==================== */
+
+static void add_slot_json(JsonBuilder *j, const DualSimSlot *s, int active) {
+    json_arr_obj_open(j);
+    json_add_str(j, "slot", s->slot);
+    json_add_str(j, "path", s->path);
+    json_add_bool(j, "active", active);
+    json_add_bool(j, "available", s->available);
+    json_add_bool(j, "online", s->online);
+    json_add_bool(j, "sim_present", s->sim_present);
+    json_add_str(j, "iccid", s->iccid);
+    json_add_str(j, "imsi", s->imsi);
+    json_add_str(j, "carrier", s->carrier);
+    json_add_str(j, "spn", s->spn);
+    json_add_str(j, "registration", s->reg_status);
+    json_add_str(j, "technology", s->technology);
+    json_add_str(j, "operator", s->operator_name);
+    json_add_str(j, "mode", s->mode);
+    json_add_bool(j, "data_active", s->data_active);
+    json_obj_close(j);
+}
+
+static const char *record_state(const SwitchRecord *r, time_t now) {
+    if (r->switch_ms < 0) return "switching";
+    if (!r->ok) return "failed";
+    if (r->data_up_ms >= 0) return "data_up";
+    if (now - r->started_at > DUALSIM_DATA_UP_TIMEOUT_SEC) return "timeout";
+    return "waiting_data";
+}
+
+void handle_dualsim_status(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    time_t now = time(NULL);
+
+    pthread_mutex_lock(&g_ds_lock);
+    JsonBuilder *j = json_new();
+    json_obj_open(j);
+    json_add_bool(j, "ready", g_ds.ready);
+    if (g_ds.active >= 0) {
+        json_add_str(j, "active", g_slot_names[g_ds.active]);
+    } else {
+        json_add_null(j, "active");
+    }
+
+    json_arr_open(j, "slots");
+    for (int i = 0; i < DUALSIM_SLOTS; i++) add_slot_json(j, &g_ds.slots[i], g_ds.active == i);
+    json_arr_close(j);
+
+    /* 最近的切卡记录，新的在前 */
+    json_add_long(j, "switches", (long long)g_ds.switches);
+    json_arr_open(j, "history");
+    unsigned n = g_ds.switches < DUALSIM_HISTORY ? g_ds.switches : DUALSIM_HISTORY;
+    for (unsigned k = 0; k < n; k++) {
+        const SwitchRecord *r = &g_ds.history[(g_ds.switches - 1 - k) % DUALSIM_HISTORY];
+        json_arr_obj_open(j);
+        json_add_str(j, "from", r->from);
+        json_add_str(j, "to", r->to);
+        json_add_long(j, "started_at", (long long)r->started_at);
+        json_add_str(j, "state", record_state(r, now));
+        if (r->switch_ms >= 0) {
+            json_add_long(j, "switch_ms", r->switch_ms);
+        } else {
+            json_add_null(j, "switch_ms");
+        }
+        if (r->data_up_ms >= 0) {
+            json_add_long(j, "data_up_ms", r->data_up_ms);
+        } else {
+            json_add_null(j, "data_up_ms");
+        }
+        json_obj_close(j);
+    }
+    json_arr_close(j);
+    json_obj_close(j);
+    pthread_mutex_unlock(&g_ds_lock);
+
+    HTTP_OK_FREE(c, json_finish(j));
+}
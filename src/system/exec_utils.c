@@ -10,31 +10,48 @@
 #include <unistd.h>
 #include <sys/wait.h>
 #include <signal.h>
+#include <poll.h>
+#include <time.h>
 #include "exec_utils.h"
+#include "trace.h"
 
-int run_command(char *output, size_t size, const char *cmd, ...) {
-    va_list args;
-    char *argv[32];
+/* 收集以 NULL 结尾的参数列表，argv[0] 为命令本身 */
+static int collect_argv(char *argv[32], const char *cmd, va_list args) {
     int argc = 0;
-
-    /* 构建参数数组 */
-    argv[argc++] = (char *)cmd;
-    va_start(args, cmd);
     char *arg;
+    argv[argc++] = (char *)cmd;
     while ((arg = va_arg(args, char *)) != NULL && argc < 31) {
         argv[argc++] = arg;
     }
-    va_end(args);
     argv[argc] = NULL;
+    return argc;
+}
+
+/* 执行命令并读取输出; timeout_sec > 0 时超时后杀死子进程 */
+static int run_argv(int timeout_sec, char *output, size_t size, char *argv[], int argc) {
+    const char *cmd = argv[0];
+
+    /* 追踪信息: "sh -c <脚本>" 记录脚本内容，其他记录命令和首个参数 */
+    char detail[TRACE_DETAIL_LEN];
+    if (argc >= 3 && strcmp(argv[1], "-c") == 0) {
+        snprintf(detail, sizeof(detail), "%s", argv[2]);
+    } else {
+        snprintf(detail, sizeof(detail), "%s %s", cmd, argc >= 2 ? argv[1] : "");
+    }
+    int span = trace_span_begin("exec", detail);
 
     /* 创建管道 */
     int pipefd[2];
-    if (pipe(pipefd) == -1) return -1;
+    if (pipe(pipefd) == -1) {
+        trace_span_end(span);
+        return -1;
+    }
 
     pid_t pid = fork();
     if (pid == -1) {
         close(pipefd[0]);
         close(pipefd[1]);
+        trace_span_end(span);
         return -1;
     }
 
@@ -51,10 +68,23 @@ int run_command(char *output, size_t size, const char *cmd, ...) {
     /* 父进程 */
     close(pipefd[1]);
 
-    /* 读取输出 */
+    /* 读取输出，超时则杀死子进程 (管道随之关闭) */
+    time_t deadline = timeout_sec > 0 ? time(NULL) + timeout_sec : 0;
+    int timed_out = 0;
     size_t total = 0;
     ssize_t n;
-    while (total < size - 1 && (n = read(pipefd[0], output + total, size - 1 - total)) > 0) {
+    while (total < size - 1) {
+        if (deadline) {
+            int left = (int)(deadline - time(NULL));
+            struct pollfd pfd = {pipefd[0], POLLIN, 0};
+            if (left <= 0 || poll(&pfd, 1, left * 1000) == 0) {
+                kill(pid, SIGKILL);
+                timed_out = 1;
+                break;
+            }
+        }
+        n = read(pipefd[0], output + total, size - 1 - total);
+        if (n <= 0) break;
         total += n;
     }
     output[total] = '\0';
@@ -63,23 +93,33 @@ int run_command(char *output, size_t size, const char *cmd, ...) {
     /* 等待子进程 */
     int status;
     waitpid(pid, &status, 0);
+    trace_span_end(span);
 
     /* 去除尾部空白 */
     while (total > 0 && (output[total-1] == '\n' || output[total-1] == '\r' || output[total-1] == ' ')) {
         output[--total] = '\0';
     }
 
+    if (timed_out) return -1;
     return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
 }
 
+int run_command(char *output, size_t size, const char *cmd, ...) {
+    char *argv[32];
+    va_list args;
+    va_start(args, cmd);
+    int argc = collect_argv(argv, cmd, args);
+    va_end(args);
+    return run_argv(0, output, size, argv, argc);
+}
+
 int run_command_timeout(int timeout_sec, char *output, size_t size, const char *cmd, ...) {
-    /* 简化实现：直接调用 run_command */
-    /* TODO: 实现真正的超时机制 */
+    char *argv[32];
     va_list args;
     va_start(args, cmd);
-    int ret = run_command(output, size, cmd, args);
+    int argc = collect_argv(argv, cmd, args);
     va_end(args);
-    return ret;
+    return run_argv(timeout_sec, output, size, argv, argc);
 }
 
 void device_reboot(void) {
@@ -92,6 +132,16 @@ void device_poweroff(void) {
     run_command(buf, sizeof(buf), "poweroff", NULL);
 }
 
+int valid_ifname(const char *name) {
+    for (; *name; name++) {
+        char ch = *name;
+        if (!((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') ||
+              ch == '.' || ch == '_' || ch == '-'))
+            return 0;
+    }
+    return 1;
+}
+
 int clear_cache(void) {
     char buf[64];
     run_command(buf, sizeof(buf), "sync", NULL);
@@ -0,0 +1,173 @@
+/**
+ * @file handoff.c
+ * @brief 监听套接字交接实现
+ */
+
+#include "handoff.h"
+#include "log.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern char **environ;
+
+#define HANDOFF_MAX_ARGS 32
+#define HANDOFF_MAX_ENV 128
+
+/* 启动时从环境变量取出的交接状态 */
+static struct {
+    char name[32];
+    char value[256];
+    int taken;              /* 监听 fd 已被取出 */
+} g_vars[HANDOFF_MAX_VARS];
+static int g_var_count = 0;
+
+void handoff_init(void) {
+    size_t plen = strlen(HANDOFF_ENV_PREFIX);
+    char names[HANDOFF_MAX_VARS][32];
+    int n = 0;
+
+    for (char **e = environ; *e && g_var_count < HANDOFF_MAX_VARS; e++) {
+        const char *eq = strchr(*e, '=');
+        if (!eq || strncmp(*e, HANDOFF_ENV_PREFIX, plen) != 0) continue;
+        size_t len = (size_t)(eq - *e);
+        if (len >= sizeof(g_vars[0].name)) continue;
+        memcpy(g_vars[g_var_count].name, *e, len);
+        g_vars[g_var_count].name[len] = '\0';
+        snprintf(g_vars[g_var_count].value, sizeof(g_vars[0].value), "%s", eq + 1);
+        snprintf(names[n++], sizeof(names[0]), "%s", g_vars[g_var_count].name);
+        g_var_count++;
+    }
+    /* 清除变量，避免传给本进程启动的子进程 */
+    for (int i = 0; i < n; i++) unsetenv(names[i]);
+
+    if (g_var_count > 0) LOG_I("交接启动，继承 %d 项状态", g_var_count);
+}
+
+int handoff_resumed(void) {
+    return g_var_count > 0;
+}
+
+const char *handoff_get(const char *name) {
+    for (int i = 0; i < g_var_count; i++) {
+        if (strcmp(g_vars[i].name, name) == 0) return g_vars[i].value;
+    }
+    return NULL;
+}
+
+static int is_listening_socket(int fd) {
+    struct stat st;
+    int accepting = 0;
+    socklen_t len = sizeof(accepting);
+    if (fstat(fd, &st) != 0 || !S_ISSOCK(st.st_mode)) return 0;
+    if (getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &accepting, &len) != 0) return 0;
+    return accepting;
+}
+
+int handoff_take_listen_fd(const char *name) {
+    for (int i = 0; i < g_var_count; i++) {
+        if (strcmp(g_vars[i].name, name) != 0 || g_vars[i].taken) continue;
+        g_vars[i].taken = 1;
+
+        char *end = NULL;
+        long fd = strtol(g_vars[i].value, &end, 10);
+        if (*end != '\0' || fd < 3 || fd > 65535) return -1;
+        if (!is_listening_socket((int)fd)) {
+            LOG_W("继承的 fd %ld 不是监听套接字，忽略", fd);
+            close((int)fd);
+            return -1;
+        }
+        fcntl((int)fd, F_SETFD, FD_CLOEXEC);
+        LOG_I("继承监听 fd %ld (%s)", fd, name);
+        return (int)fd;
+    }
+    return -1;
+}
+
+/* 当前可执行文件路径 (OTA 替换后 /proc/self/exe 带 " (deleted)" 后缀，取原路径即为新文件) */
+static int self_exe_path(char *path, size_t size) {
+    ssize_t n = readlink("/proc/self/exe", path, size - 1);
+    if (n <= 0) return -1;
+    path[n] = '\0';
+    const char *suffix = " (deleted)";
+    size_t slen = strlen(suffix);
+    if ((size_t)n > slen && strcmp(path + n - slen, suffix) == 0) {
+        path[n - slen] = '\0';
+    }
+    return 0;
+}
+
+/* 从 /proc/self/cmdline 还原启动参数 */
+static int self_argv(char *buf, size_t size, char **argv, int max) {
+    int fd = open("/proc/self/cmdline", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t n = read(fd, buf, size - 1);
+    close(fd);
+    if (n <= 0) return -1;
+    buf[n] = '\0';
+
+    int argc = 0;
+    for (ssize_t i = 0; i < n && argc < max - 1; i += (ssize_t)strlen(buf + i) + 1) {
+        argv[argc++] = buf + i;
+    }
+    argv[argc] = NULL;
+    return argc;
+}
+
+/* 除保留的 fd 外全部设置 FD_CLOEXEC (netlink、管道等未设置的 fd 不带入新映像) */
+static void mark_cloexec(const int *keep_fds, int keep_count) {
+    DIR *d = opendir("/proc/self/fd");
+    if (!d) return;
+    int self = dirfd(d);
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        int fd = atoi(de->d_name);
+        if (fd < 3 || fd == self) continue;
+        int keep = 0;
+        for (int i = 0; i < keep_count; i++) {
+            if (keep_fds[i] == fd) keep = 1;
+        }
+        fcntl(fd, F_SETFD, keep ? 0 : FD_CLOEXEC);
+    }
+    closedir(d);
+}
+
+int handoff_exec(const int *keep_fds, int keep_count, char *const env[]) {
+    char exe[256];
+    char cmdline[1024];
+    char *argv[HANDOFF_MAX_ARGS];
+    char *envp[HANDOFF_MAX_ENV];
+
+    if (self_exe_path(exe, sizeof(exe)) != 0 ||
+        self_argv(cmdline, sizeof(cmdline), argv, HANDOFF_MAX_ARGS) <= 0) {
+        LOG_E("无法获取自身路径或启动参数");
+        return -1;
+    }
+
+    int envc = 0;
+    for (char **e = environ; *e && envc < HANDOFF_MAX_ENV - HANDOFF_MAX_VARS - 1; e++) {
+        envp[envc++] = *e;
+    }
+    for (int i = 0; env && env[i] && i < HANDOFF_MAX_VARS; i++) {
+        envp[envc++] = env[i];
+    }
+    envp[envc] = NULL;
+
+    LOG_I("重新执行 %s", exe);
+    log_shutdown(); /* 刷写剩余日志，exec 后环形缓冲区丢失 */
+
+    mark_cloexec(keep_fds, keep_count);
+    execve(exe, argv, envp);
+
+    int err = errno;
+    for (int i = 0; i < keep_count; i++) fcntl(keep_fds[i], F_SETFD, FD_CLOEXEC);
+    /* 日志刷写线程已停止，直接写 stderr */
+    fprintf(stderr, "[handoff] execve %s 失败: %s\n", exe, strerror(err));
+    return -1;
+}
@@ -17,6 +17,7 @@
 #include "ipv6_proxy.h"
 #include "database.h"
 #include "exec_utils.h"
+#include "handoff.h"
 #include <arpa/inet.h>
 #include <errno.h>
 #include <fcntl.h>
@@ -619,6 +620,26 @@ static void cancel_send_timer(void) {
  * Webhook发送
  *============================================================================*/
 
+/* 将模板中的占位符原地替换为 value (超出缓冲区的部分截断，不使用临时缓冲) */
+static void template_replace(char *buf, size_t size, const char *key,
+                             const char *value) {
+  size_t klen = strlen(key);
+  size_t vlen = strlen(value);
+  char *p = buf;
+
+  while ((p = strstr(p, key)) != NULL) {
+    size_t pos = (size_t)(p - buf);
+    size_t tail = strlen(p + klen);
+    size_t room = size - 1 - pos;
+    size_t v = vlen < room ? vlen : room;
+    size_t t = tail < room - v ? tail : room - v;
+    memmove(p + v, p + klen, t);
+    memcpy(p, value, v);
+    p[v + t] = '\0';
+    p += v;
+  }
+}
+
 /* 带返回值的Webhook发送函数 */
 static int send_webhook_notification_with_result(const char *ipv6_addr) {
   if (strlen(g_current_config.webhook_url) == 0) {
@@ -633,22 +654,11 @@ static int send_webhook_notification_with_result(const char *ipv6_addr) {
   strncpy(body, g_current_config.webhook_body, sizeof(body) - 1);
   body[sizeof(body) - 1] = '\0';
 
-  char *p;
-  char temp[4096];
-
   /* 替换 #{ipv6} */
-  while ((p = strstr(body, "#{ipv6}")) != NULL) {
-    *p = '\0';
-    snprintf(temp, sizeof(temp), "%s%s%s", body, ipv6_addr, p + 7);
-    strncpy(body, temp, sizeof(body) - 1);
-  }
+  template_replace(body, sizeof(body), "#{ipv6}", ipv6_addr);
 
   /* 兼容性对比 #{sender} -> #{ipv6} */
-  while ((p = strstr(body, "#{sender}")) != NULL) {
-    *p = '\0';
-    snprintf(temp, sizeof(temp), "%s%s%s", body, ipv6_addr, p + 9);
-    strncpy(body, temp, sizeof(body) - 1);
-  }
+  template_replace(body, sizeof(body), "#{sender}", ipv6_addr);
 
   /* 替换 #{port} - 获取所有端口列表 */
   IPv6ProxyRule rules[IPV6_PROXY_MAX_RULES];
@@ -669,11 +679,7 @@ static int send_webhook_notification_with_result(const char *ipv6_addr) {
       }
     }
   }
-  while ((p = strstr(body, "#{port}")) != NULL) {
-    *p = '\0';
-    snprintf(temp, sizeof(temp), "%s%s%s", body, ports_str, p + 7);
-    strncpy(body, temp, sizeof(body) - 1);
-  }
+  template_replace(body, sizeof(body), "#{port}", ports_str);
 
   /* 替换 #{link} */
   char link[1024] = "";
@@ -696,22 +702,14 @@ static int send_webhook_notification_with_result(const char *ipv6_addr) {
   } else {
     snprintf(link, sizeof(link), "[%s]:port", ipv6_addr);
   }
-  while ((p = strstr(body, "#{link}")) != NULL) {
-    *p = '\0';
-    snprintf(temp, sizeof(temp), "%s%s%s", body, link, p + 7);
-    strncpy(body, temp, sizeof(body) - 1);
-  }
+  template_replace(body, sizeof(body), "#{link}", link);
 
   /* 替换 #{time} */
   char time_str[32];
   time_t now = time(NULL);
   struct tm *tm_info = localtime(&now);
   strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", tm_info);
-  while ((p = strstr(body, "#{time}")) != NULL) {
-    *p = '\0';
-    snprintf(temp, sizeof(temp), "%s%s%s", body, time_str, p + 7);
-    strncpy(body, temp, sizeof(body) - 1);
-  }
+  template_replace(body, sizeof(body), "#{time}", time_str);
 
   /* 将body写入临时文件 */
   char tmp_file[128];
@@ -727,7 +725,7 @@ static int send_webhook_notification_with_result(const char *ipv6_addr) {
   }
 
   /* 构建curl命令 */
-  char cmd[8192];
+  char cmd[4096]; /* URL(512) + headers(1024) + 固定部分，4KB 足够 */
   char headers_part[1024] = "";
 
   /* 解析自定义headers */
@@ -853,6 +851,43 @@ static void do_send_ipv6(int retry_on_fail) {
  * 初始化和清理
  *============================================================================*/
 
+/* 接管交接前导出的规则子进程 ("规则ID:PID,...")，只接管仍存活的进程 */
+static int adopt_rule_processes(const char *state) {
+  const char *p = state;
+  int id, pid, n;
+
+  while (p && *p && g_rule_count < IPV6_PROXY_MAX_RULES &&
+         sscanf(p, "%d:%d%n", &id, &pid, &n) == 2) {
+    if (pid > 0 && kill(pid, 0) == 0) {
+      g_rule_pids[g_rule_count] = pid;
+      g_rule_ids[g_rule_count] = id;
+      g_rule_count++;
+    }
+    p += n;
+    if (*p == ',') p++;
+  }
+  if (g_rule_count > 0) g_service_running = 1;
+  return g_rule_count;
+}
+
+int ipv6_proxy_handoff_state(char *buf, size_t size) {
+  size_t len = 0;
+  int count = 0;
+
+  if (!buf || size == 0) return 0;
+  buf[0] = '\0';
+  for (int i = 0; i < g_rule_count; i++) {
+    if (g_rule_pids[i] <= 0) continue;
+    int n = snprintf(buf + len, size - len, "%s%d:%d", count ? "," : "",
+                     g_rule_ids[i], (int)g_rule_pids[i]);
+    if (n < 0 || (size_t)n >= size - len) break;
+    len += (size_t)n;
+    count++;
+  }
+  buf[len] = '\0';
+  return count;
+}
+
 int ipv6_proxy_init(const char *db_path) {
   if (g_ipv6_proxy_initialized) {
     return 0;
@@ -888,8 +923,10 @@ int ipv6_proxy_init(const char *db_path) {
   /* 加载配置 */
   load_ipv6_proxy_config();
 
-  /* 处理自启动 */
-  if (g_current_config.enabled && g_current_config.auto_start) {
+  /* 交接启动: 规则子进程不受 exec 影响，直接接管，监听端口不中断 */
+  if (adopt_rule_processes(handoff_get(HANDOFF_ENV_IPV6_PROXY)) > 0) {
+    printf("[IPv6Proxy] 已接管 %d 个运行中的规则进程\n", g_rule_count);
+  } else if (g_current_config.enabled && g_current_config.auto_start) {
     printf("[IPv6Proxy] 检测到自启动配置，正在启动服务...\n");
     if (ipv6_proxy_start() == 0) {
       printf("[IPv6Proxy] 自启动成功\n");
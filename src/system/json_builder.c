@@ -1,23 +1,41 @@
 /**
  * @file json_builder.c
  * @brief JSON Builder工具库实现 - 基于mongoose mg_iobuf的动态JSON生成
+ *
+ * 缓冲区通过 arena.h 分配: HTTP 请求处理期间来自请求内存池 (扩容多为原地扩展)，
+ * 其他线程中回退到 malloc/realloc。
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "json_builder.h"
+#include "arena.h"
 
 /* 初始缓冲区大小 - 增大以减少 realloc 次数 */
 #define JSON_INIT_SIZE 4096
 
 /* ==================== 内部辅助函数 ==================== */
 
+/* 确保缓冲区还能容纳 extra 字节 (额外保留结尾 '\0' 的位置) */
+static int json_reserve(JsonBuilder *j, size_t extra) {
+    size_t need = j->buf.len + extra + 1;
+    if (need <= j->buf.size) return 0;
+
+    size_t size = j->buf.size ? j->buf.size : JSON_INIT_SIZE;
+    while (size < need) size *= 2;
+    unsigned char *p = (unsigned char *)arena_realloc(j->buf.buf, j->buf.size, size);
+    if (!p) return -1;
+    j->buf.buf = p;
+    j->buf.size = size;
+    return 0;
+}
+
 /* 添加逗号分隔符（如果不是第一个元素） */
 static void json_comma(JsonBuilder *j) {
     if (!j || j->depth < 0 || j->depth >= JSON_MAX_DEPTH) return;
-    if (!j->first[j->depth]) {
-        mg_iobuf_add(&j->buf, j->buf.len, ",", 1);
+    if (!j->first[j->depth] && json_reserve(j, 1) == 0) {
+        j->buf.buf[j->buf.len++] = ',';
     }
     j->first[j->depth] = 0;
 }
@@ -25,29 +43,38 @@ static void json_comma(JsonBuilder *j) {
 /* 添加字符串到缓冲区 */
 static void json_append(JsonBuilder *j, const char *s, size_t len) {
     if (!j || !s) return;
-    mg_iobuf_add(&j->buf, j->buf.len, s, len);
+    if (json_reserve(j, len) != 0) return;
+    memcpy(j->buf.buf + j->buf.len, s, len);
+    j->buf.len += len;
 }
 
-/* 添加格式化字符串到缓冲区 */
+/* 添加格式化字符串到缓冲区 (直接格式化到缓冲区尾部) */
 static void json_appendf(JsonBuilder *j, const char *fmt, ...) {
     if (!j || !fmt) return;
-    char tmp[4096];
     va_list ap;
     va_start(ap, fmt);
-    size_t n = (size_t)vsnprintf(tmp, sizeof(tmp), fmt, ap);
+    int n = vsnprintf((char *)j->buf.buf + j->buf.len, j->buf.size - j->buf.len, fmt, ap);
     va_end(ap);
-    if (n > 0 && n < sizeof(tmp)) {
-        mg_iobuf_add(&j->buf, j->buf.len, tmp, n);
+    if (n <= 0) return;
+    if (j->buf.len + (size_t)n >= j->buf.size) {
+        if (json_reserve(j, (size_t)n) != 0) return;
+        va_start(ap, fmt);
+        vsnprintf((char *)j->buf.buf + j->buf.len, j->buf.size - j->buf.len, fmt, ap);
+        va_end(ap);
     }
+    j->buf.len += (size_t)n;
 }
 
 /* ==================== 生命周期管理 ==================== */
 
 JsonBuilder *json_new(void) {
-    JsonBuilder *j = (JsonBuilder *)calloc(1, sizeof(JsonBuilder));
+    JsonBuilder *j = (JsonBuilder *)arena_calloc(sizeof(JsonBuilder));
     if (!j) return NULL;
     
-    mg_iobuf_init(&j->buf, JSON_INIT_SIZE, 64);
+    if (json_reserve(j, JSON_INIT_SIZE - 1) != 0) {
+        arena_free(j);
+        return NULL;
+    }
     j->depth = 0;
     for (int i = 0; i < JSON_MAX_DEPTH; i++) {
         j->first[i] = 1;
@@ -58,26 +85,20 @@ JsonBuilder *json_new(void) {
 char *json_finish(JsonBuilder *j) {
     if (!j) return NULL;
     
-    /* 确保字符串以null结尾 */
-    mg_iobuf_add(&j->buf, j->buf.len, "", 1);
-    
-    /* 复制结果 */
-    char *result = (char *)malloc(j->buf.len);
+    /* 缓冲区始终预留结尾位置，直接交给调用者，无需复制 */
+    char *result = (char *)j->buf.buf;
     if (result) {
-        memcpy(result, j->buf.buf, j->buf.len);
+        result[j->buf.len] = '\0';
     }
-    
-    /* 释放资源 */
-    mg_iobuf_free(&j->buf);
-    free(j);
+    arena_free(j);
     
     return result;
 }
 
 void json_free(JsonBuilder *j) {
     if (!j) return;
-    mg_iobuf_free(&j->buf);
-    free(j);
+    arena_free(j->buf.buf);
+    arena_free(j);
 }
 
 /* ==================== 对象操作 ==================== */
@@ -156,33 +177,22 @@ void json_add_str(JsonBuilder *j, const char *key, const char *val) {
     /* MG_ESC最坏情况：每个字符转义为\uXXXX(6字节) + 引号(2字节) */
     size_t need_size = key_len + 4 + val_len * 6 + 16;
     
-    if (need_size <= 4096) {
-        /* 小字符串使用栈缓冲区 */
-        char tmp[4096];
-        size_t n = mg_snprintf(tmp, sizeof(tmp), "\"%s\":%m", key, MG_ESC(val ? val : ""));
-        if (n > 0 && n < sizeof(tmp)) {
-            mg_iobuf_add(&j->buf, j->buf.len, tmp, n);
-        } else {
-            /* 栈缓冲区不足，回退到空值 */
-            json_appendf(j, "\"%s\":\"\"", key);
-        }
-    } else {
-        /* 大字符串使用动态分配 */
-        char *buf = (char *)malloc(need_size);
-        if (buf) {
-            size_t n = mg_snprintf(buf, need_size, "\"%s\":%m", key, MG_ESC(val ? val : ""));
-            if (n > 0 && n < need_size) {
-                mg_iobuf_add(&j->buf, j->buf.len, buf, n);
-            } else {
-                /* 缓冲区不足，添加空值 */
-                json_appendf(j, "\"%s\":\"\"", key);
-            }
-            free(buf);
-        } else {
-            /* 分配失败，添加空值 */
-            json_appendf(j, "\"%s\":\"\"", key);
+    /* 剩余空间不足以容纳最坏情况时先计算实际长度，避免按6倍扩容 */
+    if (need_size > j->buf.size - j->buf.len) {
+        need_size = mg_snprintf(NULL, 0, "\"%s\":%m", key, MG_ESC(val ? val : "")) + 1;
+    }
+    
+    /* 直接转义到缓冲区尾部，不经过临时缓冲 */
+    if (json_reserve(j, need_size) == 0) {
+        size_t n = mg_snprintf((char *)j->buf.buf + j->buf.len, j->buf.size - j->buf.len,
+                               "\"%s\":%m", key, MG_ESC(val ? val : ""));
+        if (n > 0 && n < j->buf.size - j->buf.len) {
+            j->buf.len += n;
+            return;
         }
     }
+    /* 分配失败，添加空值 */
+    json_appendf(j, "\"%s\":\"\"", key);
 }
 
 void json_add_int(JsonBuilder *j, const char *key, int val) {
@@ -237,8 +247,8 @@ void json_add_raw(JsonBuilder *j, const char *key, const char *val) {
             /* 大字符串：分开添加 */
             char key_part[256];
             snprintf(key_part, sizeof(key_part), "\"%s\":", key);
-            mg_iobuf_add(&j->buf, j->buf.len, key_part, strlen(key_part));
-            mg_iobuf_add(&j->buf, j->buf.len, val, val_len);
+            json_append(j, key_part, strlen(key_part));
+            json_append(j, val, val_len);
         }
     } else {
         json_append(j, val, val_len);
@@ -254,28 +264,19 @@ void json_arr_add_str(JsonBuilder *j, const char *val) {
     size_t val_len = val ? strlen(val) : 0;
     size_t need_size = val_len * 6 + 16;
     
-    if (need_size <= 4096) {
-        char tmp[4096];
-        size_t n = mg_snprintf(tmp, sizeof(tmp), "%m", MG_ESC(val ? val : ""));
-        if (n > 0 && n < sizeof(tmp)) {
-            mg_iobuf_add(&j->buf, j->buf.len, tmp, n);
-        } else {
-            mg_iobuf_add(&j->buf, j->buf.len, "\"\"", 2);
-        }
-    } else {
-        char *buf = (char *)malloc(need_size);
-        if (buf) {
-            size_t n = mg_snprintf(buf, need_size, "%m", MG_ESC(val ? val : ""));
-            if (n > 0 && n < need_size) {
-                mg_iobuf_add(&j->buf, j->buf.len, buf, n);
-            } else {
-                mg_iobuf_add(&j->buf, j->buf.len, "\"\"", 2);
-            }
-            free(buf);
-        } else {
-            mg_iobuf_add(&j->buf, j->buf.len, "\"\"", 2);
+    if (need_size > j->buf.size - j->buf.len) {
+        need_size = mg_snprintf(NULL, 0, "%m", MG_ESC(val ? val : "")) + 1;
+    }
+    
+    if (json_reserve(j, need_size) == 0) {
+        size_t n = mg_snprintf((char *)j->buf.buf + j->buf.len, j->buf.size - j->buf.len,
+                               "%m", MG_ESC(val ? val : ""));
+        if (n > 0 && n < j->buf.size - j->buf.len) {
+            j->buf.len += n;
+            return;
         }
     }
+    json_append(j, "\"\"", 2);
 }
 
 void json_arr_add_int(JsonBuilder *j, int val) {
@@ -0,0 +1,474 @@
+/**
+ * @file log.c
+ * @brief 分级日志模块实现
+ *
+ * 环形缓冲区采用序号锁: 写入者原子递增全局序号获得槽位，
+ * 写入期间槽位状态为奇数，完成后为偶数；读取者拷贝前后比较状态，
+ * 不一致 (正在写入或已被覆盖) 的条目直接跳过，读写双方都不加锁。
+ */
+
+#include "log.h"
+#include "database.h"
+#include "http_utils.h"
+#include "json_builder.h"
+#include "mongoose.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+
+/* printf 在本文件中保持原义，供 stdout 输出使用 */
+#ifdef printf
+#undef printf
+#endif
+
+/* 刷写线程轮询间隔 (毫秒) 与日志文件轮转大小 */
+#define LOG_FLUSH_INTERVAL_MS 500
+#define LOG_FILE_MAX_SIZE (1024 * 1024)
+
+/* 环形缓冲区条目: 只保存原始字段，前缀在读取时拼接 */
+typedef struct {
+    atomic_uint_fast64_t state;     /* 2*seq+1=写入中, 2*seq+2=已完成 */
+    int64_t time_ms;                /* 墙钟时间 (毫秒) */
+    uint8_t level;
+    uint8_t module;
+    uint16_t len;
+    char msg[LOG_MSG_LEN];
+} LogEntry;
+
+/* 读取时的条目快照 */
+typedef struct {
+    uint64_t seq;
+    int64_t time_ms;
+    int level;
+    int module;
+    char msg[LOG_MSG_LEN];
+} LogRecord;
+
+/* 输出目标 */
+typedef enum {
+    LOG_OUT_NONE = 0,
+    LOG_OUT_STDOUT,
+    LOG_OUT_FILE,
+    LOG_OUT_SYSLOG,
+} LogOutput;
+
+static LogEntry g_ring[LOG_RING_SIZE];
+static atomic_uint_fast64_t g_write_seq = 0;
+
+/* 模块注册表 */
+static char g_module_names[LOG_MAX_MODULES][24];
+static atomic_int g_module_levels[LOG_MAX_MODULES];
+static atomic_int g_module_count = 0;
+static atomic_int g_default_level = LOG_RUNTIME_DEFAULT;
+static pthread_mutex_t g_module_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* 异步刷写 */
+static LogOutput g_output = LOG_OUT_NONE;
+static char g_output_path[128] = {0};
+static pthread_t g_flush_thread;
+static volatile int g_flush_running = 0;
+static uint64_t g_flush_next = 0;   /* 下一条待刷写的序号，跨刷写线程重启保留 */
+
+static const char *g_level_names[] = {"error", "warn", "info", "debug"};
+
+/* ==================== 级别与模块 ==================== */
+
+int log_level_from_name(const char *name) {
+    if (!name) return -1;
+    for (int i = 0; i <= LOGLVL_DEBUG; i++) {
+        if (strcasecmp(name, g_level_names[i]) == 0) return i;
+    }
+    if (strcasecmp(name, "warning") == 0) return LOGLVL_WARN;
+    return -1;
+}
+
+const char *log_level_name(int level) {
+    return (level >= 0 && level <= LOGLVL_DEBUG) ? g_level_names[level] : "unknown";
+}
+
+/* 查找或注册模块，name 为模块名 (不含路径和扩展名) */
+static int module_lookup(const char *name, size_t len, int create) {
+    int count = atomic_load(&g_module_count);
+    for (int i = 0; i < count; i++) {
+        if (strlen(g_module_names[i]) == len && strncmp(g_module_names[i], name, len) == 0) {
+            return i;
+        }
+    }
+    if (!create) return -1;
+
+    pthread_mutex_lock(&g_module_lock);
+    /* 加锁后再查一次，避免并发重复注册 */
+    count = atomic_load(&g_module_count);
+    for (int i = 0; i < count; i++) {
+        if (strlen(g_module_names[i]) == len && strncmp(g_module_names[i], name, len) == 0) {
+            pthread_mutex_unlock(&g_module_lock);
+            return i;
+        }
+    }
+    int id = -1;
+    if (count < LOG_MAX_MODULES) {
+        id = count;
+        snprintf(g_module_names[id], sizeof(g_module_names[id]), "%.*s", (int)len, name);
+        atomic_store(&g_module_levels[id], atomic_load(&g_default_level));
+        atomic_store(&g_module_count, count + 1);
+    }
+    pthread_mutex_unlock(&g_module_lock);
+    return id;
+}
+
+/* 由 __FILE__ 解析模块: "system/ofono.c" -> "ofono" */
+static int module_from_file(const char *file) {
+    const char *base = strrchr(file, '/');
+    base = base ? base + 1 : file;
+    const char *dot = strrchr(base, '.');
+    size_t len = dot ? (size_t)(dot - base) : strlen(base);
+    int id = module_lookup(base, len, 1);
+    return id >= 0 ? id : 0;
+}
+
+int log_enabled(LogSite *site, int level) {
+    if (site->module < 0) site->module = module_from_file(site->file);
+    return level <= atomic_load_explicit(&g_module_levels[site->module], memory_order_relaxed);
+}
+
+int log_set_level(const char *module, int level) {
+    if (level < LOGLVL_ERROR || level > LOGLVL_DEBUG) return -1;
+
+    if (!module || strcmp(module, "*") == 0) {
+        atomic_store(&g_default_level, level);
+        int count = atomic_load(&g_module_count);
+        for (int i = 0; i < count; i++) atomic_store(&g_module_levels[i], level);
+        return 0;
+    }
+
+    int id = module_lookup(module, strlen(module), 1);
+    if (id < 0) return -1;
+    atomic_store(&g_module_levels[id], level);
+    return 0;
+}
+
+/* ==================== 写入 ==================== */
+
+void log_write(LogSite *site, int level, const char *fmt, ...) {
+    /* 先判断级别，未启用时不占用槽位、不格式化 */
+    if (!log_enabled(site, level)) return;
+
+    uint64_t seq = atomic_fetch_add(&g_write_seq, 1);
+    LogEntry *e = &g_ring[seq & (LOG_RING_SIZE - 1)];
+    atomic_store_explicit(&e->state, 2 * seq + 1, memory_order_release);
+
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    e->time_ms = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    e->level = (uint8_t)level;
+    e->module = (uint8_t)site->module;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(e->msg, sizeof(e->msg), fmt, ap);
+    va_end(ap);
+    if (n < 0) n = 0;
+    if (n >= (int)sizeof(e->msg)) n = sizeof(e->msg) - 1;
+    /* 去掉 printf 风格的行尾换行 */
+    while (n > 0 && (e->msg[n - 1] == '\n' || e->msg[n - 1] == '\r')) e->msg[--n] = '\0';
+    e->len = (uint16_t)n;
+
+    atomic_store_explicit(&e->state, 2 * seq + 2, memory_order_release);
+}
+
+/* 读取指定序号的条目，已被覆盖或正在写入返回-1 */
+static int ring_read(uint64_t seq, LogRecord *out) {
+    LogEntry *e = &g_ring[seq & (LOG_RING_SIZE - 1)];
+    uint64_t before = atomic_load_explicit(&e->state, memory_order_acquire);
+    if (before != 2 * seq + 2) return -1;
+
+    out->seq = seq;
+    out->time_ms = e->time_ms;
+    out->level = e->level;
+    out->module = e->module;
+    memcpy(out->msg, e->msg, sizeof(out->msg));
+    out->msg[sizeof(out->msg) - 1] = '\0';
+
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t after = atomic_load_explicit(&e->state, memory_order_relaxed);
+    return after == before ? 0 : -1;
+}
+
+/* 环形缓冲区中仍然有效的最早序号 */
+static uint64_t ring_oldest(uint64_t next) {
+    return next > LOG_RING_SIZE ? next - LOG_RING_SIZE : 0;
+}
+
+/* 拼接带前缀的日志行 */
+static int format_line(const LogRecord *r, char *buf, size_t size) {
+    time_t sec = (time_t)(r->time_ms / 1000);
+    struct tm tm_info;
+    localtime_r(&sec, &tm_info);
+    char ts[32];
+    strftime(ts, sizeof(ts), "%Y-%m-%d %H:%M:%S", &tm_info);
+    return snprintf(buf, size, "%s.%03d %-5s [%s] %s\n", ts, (int)(r->time_ms % 1000),
+                    log_level_name(r->level), g_module_names[r->module], r->msg);
+}
+
+/* ==================== 异步刷写 ==================== */
+
+static void flush_file_rotate(FILE **fp) {
+    struct stat st;
+    if (!*fp || fstat(fileno(*fp), &st) != 0 || st.st_size < LOG_FILE_MAX_SIZE) return;
+
+    fclose(*fp);
+    char old_path[sizeof(g_output_path) + 4];
+    snprintf(old_path, sizeof(old_path), "%s.1", g_output_path);
+    rename(g_output_path, old_path);
+    *fp = fopen(g_output_path, "a");
+}
+
+static void *flush_thread_func(void *arg) {
+    (void)arg;
+    /* 从上次刷写位置继续，log_init 之前进入环形缓冲区的启动日志也会输出 */
+    uint64_t next = g_flush_next;
+    FILE *fp = NULL;
+
+    if (g_output == LOG_OUT_FILE) fp = fopen(g_output_path, "a");
+    if (g_output == LOG_OUT_SYSLOG) openlog("ofono-server", LOG_PID, LOG_DAEMON);
+
+    while (1) {
+        int running = g_flush_running;
+        uint64_t end = atomic_load(&g_write_seq);
+        uint64_t oldest = ring_oldest(end);
+        unsigned long dropped = 0;
+
+        if (next < oldest) {
+            dropped = (unsigned long)(oldest - next);
+            next = oldest;
+        }
+
+        char line[LOG_MSG_LEN + 64];
+        if (dropped > 0) {
+            int n = snprintf(line, sizeof(line), "[log] %lu entries dropped before flush\n", dropped);
+            if (fp) fwrite(line, 1, n, fp);
+            if (g_output == LOG_OUT_STDOUT) fwrite(line, 1, n, stdout);
+            if (g_output == LOG_OUT_SYSLOG) syslog(LOG_WARNING, "%s", line);
+        }
+
+        for (; next < end; next++) {
+            LogRecord r;
+            if (ring_read(next, &r) != 0) continue;
+
+            if (g_output == LOG_OUT_SYSLOG) {
+                static const int prio[] = {LOG_ERR, LOG_WARNING, LOG_INFO, LOG_DEBUG};
+                syslog(prio[r.level & 3], "[%s] %s", g_module_names[r.module], r.msg);
+                continue;
+            }
+            int n = format_line(&r, line, sizeof(line));
+            if (n > (int)sizeof(line) - 1) n = sizeof(line) - 1;
+            if (fp) fwrite(line, 1, n, fp);
+            if (g_output == LOG_OUT_STDOUT) fwrite(line, 1, n, stdout);
+        }
+
+        if (fp) {
+            fflush(fp);
+            flush_file_rotate(&fp);
+        }
+        if (g_output == LOG_OUT_STDOUT) fflush(stdout);
+
+        g_flush_next = next;
+        if (!running) break;
+        usleep(LOG_FLUSH_INTERVAL_MS * 1000);
+    }
+
+    if (fp) fclose(fp);
+    if (g_output == LOG_OUT_SYSLOG) closelog();
+    return NULL;
+}
+
+/* 解析输出配置: "none" / "stdout" / "syslog" / "file:/path/to/log"，未配置时为 stdout */
+static LogOutput parse_output(const char *spec, char *path, size_t path_size) {
+    if (!spec || !*spec || strcmp(spec, "stdout") == 0) return LOG_OUT_STDOUT;
+    if (strcmp(spec, "none") == 0) return LOG_OUT_NONE;
+    if (strcmp(spec, "syslog") == 0) return LOG_OUT_SYSLOG;
+    if (strncmp(spec, "file:", 5) == 0 && spec[5]) {
+        snprintf(path, path_size, "%s", spec + 5);
+        return LOG_OUT_FILE;
+    }
+    return LOG_OUT_NONE;
+}
+
+static void flush_stop(void) {
+    if (!g_flush_running) return;
+    g_flush_running = 0;
+    pthread_join(g_flush_thread, NULL);
+}
+
+static int flush_start(const char *spec) {
+    flush_stop();
+    g_output = parse_output(spec, g_output_path, sizeof(g_output_path));
+    if (g_output == LOG_OUT_NONE) return 0;
+
+    g_flush_running = 1;
+    if (pthread_create(&g_flush_thread, NULL, flush_thread_func, NULL) != 0) {
+        g_flush_running = 0;
+        g_output = LOG_OUT_NONE;
+        return -1;
+    }
+    return 0;
+}
+
+/* 应用 "module=level,module=level" 形式的配置 */
+static void apply_module_levels(const char *spec) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    char *save = NULL;
+    for (char *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char *eq = strchr(tok, '=');
+        if (!eq) continue;
+        *eq = '\0';
+        int level = log_level_from_name(eq + 1);
+        if (level >= 0) log_set_level(tok, level);
+    }
+}
+
+void log_init(void) {
+    char value[256] = {0};
+
+    if (config_get("log_level", value, sizeof(value)) == 0) {
+        int level = log_level_from_name(value);
+        if (level >= 0) log_set_level(NULL, level);
+    }
+    value[0] = '\0';
+    if (config_get("log_modules", value, sizeof(value)) == 0 && value[0]) {
+        apply_module_levels(value);
+    }
+    value[0] = '\0';
+    config_get("log_output", value, sizeof(value));
+    flush_start(value);
+
+    LOG_I("日志模块初始化完成: level=%s, output=%s",
+          log_level_name(atomic_load(&g_default_level)), value[0] ? value : "stdout");
+}
+
+void log_shutdown(void) {
+    flush_stop();
+}
+
+/* ==================== HTTP API ==================== */
+
+/**
+ * GET /api/logs?since=<seq>&level=<level>&module=<name>&limit=<n>
+ * 返回 since 之后的日志 (最多 limit 条)，next 为下次轮询的 since
+ */
+static void logs_get(struct mg_connection *c, struct mg_http_message *hm) {
+    char buf[32];
+    uint64_t end = atomic_load(&g_write_seq);
+    uint64_t since = ring_oldest(end);
+    int max_level = LOGLVL_DEBUG, module = -1, limit = 200;
+
+    if (mg_http_get_var(&hm->query, "since", buf, sizeof(buf)) > 0) {
+        uint64_t v = strtoull(buf, NULL, 10);
+        if (v > since) since = v;
+    }
+    if (mg_http_get_var(&hm->query, "level", buf, sizeof(buf)) > 0) {
+        int l = log_level_from_name(buf);
+        if (l >= 0) max_level = l;
+    }
+    if (mg_http_get_var(&hm->query, "module", buf, sizeof(buf)) > 0) {
+        module = module_lookup(buf, strlen(buf), 0);
+        if (module < 0) since = end; /* 未知模块: 返回空列表 */
+    }
+    if (mg_http_get_var(&hm->query, "limit", buf, sizeof(buf)) > 0) {
+        limit = atoi(buf);
+        if (limit <= 0 || limit > LOG_RING_SIZE) limit = LOG_RING_SIZE;
+    }
+
+    JsonBuilder *j = json_new();
+    json_obj_open(j);
+    json_arr_open(j, "entries");
+
+    int count = 0;
+    uint64_t seq = since;
+    for (; seq < end && count < limit; seq++) {
+        LogRecord r;
+        if (ring_read(seq, &r) != 0) continue;
+        if (r.level > max_level || (module >= 0 && r.module != module)) continue;
+
+        json_arr_obj_open(j);
+        json_add_long(j, "seq", (long long)r.seq);
+        json_add_long(j, "time_ms", (long long)r.time_ms);
+        json_add_str(j, "level", log_level_name(r.level));
+        json_add_str(j, "module", g_module_names[r.module]);
+        json_add_str(j, "msg", r.msg);
+        json_obj_close(j);
+        count++;
+    }
+
+    json_arr_close(j);
+    json_add_long(j, "next", (long long)seq);
+    json_obj_close(j);
+    HTTP_OK_FREE(c, json_finish(j));
+}
+
+/**
+ * POST /api/logs
+ * {"level":"info", "modules":"sms=debug,ofono=warn", "output":"file:/tmp/ofono.log"}
+ * 各字段可选，设置立即生效并保存到配置
+ */
+static void logs_set(struct mg_connection *c, struct mg_http_message *hm) {
+    char *level = http_json_dup(hm->body, "$.level");
+    char *modules = http_json_dup(hm->body, "$.modules");
+    char *output = http_json_dup(hm->body, "$.output");
+    int ok = 1;
+
+    if (level) {
+        int l = log_level_from_name(level);
+        if (l < 0) {
+            ok = 0;
+        } else {
+            log_set_level(NULL, l);
+            config_set("log_level", level);
+        }
+    }
+    if (ok && modules) {
+        apply_module_levels(modules);
+        config_set("log_modules", modules);
+    }
+    if (ok && output) {
+        if (strcmp(output, "none") != 0 &&
+            parse_output(output, (char[sizeof(g_output_path)]){0}, sizeof(g_output_path)) == LOG_OUT_NONE) {
+            ok = 0;
+        } else {
+            flush_start(output);
+            config_set("log_output", output);
+        }
+    }
+
+    arena_free(level);
+    arena_free(modules);
+    arena_free(output);
+
+    if (!ok) {
+        HTTP_ERROR(c, 400, "Invalid log configuration");
+        return;
+    }
+    HTTP_SUCCESS(c, "日志配置已更新");
+}
+
+void handle_logs(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_ANY(c, hm);
+
+    if (http_is_method(hm, "GET")) {
+        logs_get(c, hm);
+    } else if (http_is_method(hm, "POST")) {
+        logs_set(c, hm);
+    } else {
+        http_method_error(c);
+    }
+}
@@ -0,0 +1,295 @@
+/**
+ * @file metrics.c
+ * @brief HTTP 路由级延迟/吞吐量指标模块实现
+ *
+ * 记录在 mongoose 事件循环线程中进行，无需加锁；
+ * 直方图为固定大小数组，内存占用与请求量无关。
+ */
+
+#include "metrics.h"
+#include "http_utils.h"
+#include "json_builder.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* 路由槽位表 */
+static RouteMetrics g_routes[METRICS_MAX_ROUTES];
+static int g_route_count = 0;
+
+/* 启动时间 (单调时钟，微秒) */
+static uint64_t g_start_us = 0;
+
+/* Prometheus 直方图导出的粗粒度桶边界 (微秒) */
+static const uint64_t g_prom_le_us[] = {
+    1000, 5000, 10000, 25000, 50000, 100000, 250000,
+    500000, 1000000, 2500000, 5000000, 10000000,
+};
+#define PROM_LE_COUNT (sizeof(g_prom_le_us) / sizeof(g_prom_le_us[0]))
+
+/* ==================== 直方图 ==================== */
+
+/* 样本值 -> 桶索引: 小于 SUB 的值线性映射，其余按最高位分组后取 SUB_BITS 位尾数 */
+static int hist_index(uint64_t v) {
+    if (v < METRICS_HIST_SUB) return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    int idx = (msb - METRICS_HIST_SUB_BITS + 1) * METRICS_HIST_SUB +
+              (int)((v >> (msb - METRICS_HIST_SUB_BITS)) & (METRICS_HIST_SUB - 1));
+    return idx < METRICS_HIST_BUCKETS ? idx : METRICS_HIST_BUCKETS - 1;
+}
+
+uint64_t metrics_hist_bucket_upper(int idx) {
+    if (idx < METRICS_HIST_SUB) return (uint64_t)idx + 1;
+    int group = idx / METRICS_HIST_SUB;
+    int sub = idx % METRICS_HIST_SUB;
+    return (uint64_t)(METRICS_HIST_SUB + sub + 1) << (group - 1);
+}
+
+void metrics_hist_record(LatencyHist *h, uint64_t value) {
+    if (!h) return;
+    h->buckets[hist_index(value)]++;
+    h->count++;
+    h->sum += value;
+    if (value > h->max) h->max = value;
+}
+
+uint64_t metrics_hist_percentile(const LatencyHist *h, double q) {
+    if (!h || h->count == 0) return 0;
+    if (q <= 0.0) q = 0.0;
+    if (q >= 1.0) return h->max;
+
+    uint64_t target = (uint64_t)(q * (double)h->count + 0.5);
+    if (target == 0) target = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < METRICS_HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= target) {
+            uint64_t upper = metrics_hist_bucket_upper(i);
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+/* ==================== 路由指标 ==================== */
+
+uint64_t metrics_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+int metrics_register_route(const char *name) {
+    if (!name) return -1;
+    if (g_start_us == 0) g_start_us = metrics_now_us();
+
+    for (int i = 0; i < g_route_count; i++) {
+        if (strcmp(g_routes[i].name, name) == 0) return i;
+    }
+    if (g_route_count >= METRICS_MAX_ROUTES) return -1;
+
+    memset(&g_routes[g_route_count], 0, sizeof(RouteMetrics));
+    g_routes[g_route_count].name = name;
+    return g_route_count++;
+}
+
+void metrics_record(int slot, int status, size_t req_bytes, size_t resp_bytes,
+                    uint64_t elapsed_us) {
+    if (slot < 0 || slot >= g_route_count) return;
+    RouteMetrics *m = &g_routes[slot];
+
+    int cls = status / 100;
+    m->status[(cls >= 1 && cls <= 5) ? cls : 0]++;
+    m->req_bytes += req_bytes;
+    m->resp_bytes += resp_bytes;
+    metrics_hist_record(&m->latency, elapsed_us);
+}
+
+void metrics_record_arena(int slot, size_t allocs, size_t bytes) {
+    if (slot < 0 || slot >= g_route_count) return;
+    RouteMetrics *m = &g_routes[slot];
+
+    m->arena_allocs += allocs;
+    m->arena_bytes += bytes;
+    if (bytes > m->arena_peak) m->arena_peak = bytes > UINT32_MAX ? UINT32_MAX : (uint32_t)bytes;
+}
+
+int metrics_parse_status(const char *buf, size_t len) {
+    /* "HTTP/1.1 200 ..." - 状态码位于第一个空格之后 */
+    if (!buf || len < 12 || memcmp(buf, "HTTP/", 5) != 0) return 0;
+    const char *sp = memchr(buf, ' ', len < 16 ? len : 16);
+    if (!sp || (size_t)(sp - buf) + 4 > len) return 0;
+
+    int code = 0;
+    for (int i = 1; i <= 3; i++) {
+        if (sp[i] < '0' || sp[i] > '9') return 0;
+        code = code * 10 + (sp[i] - '0');
+    }
+    return code;
+}
+
+/* ==================== 导出 ==================== */
+
+void metrics_appendf(struct mg_iobuf *io, const char *fmt, ...) {
+    char tmp[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(tmp, sizeof(tmp), fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        mg_iobuf_add(io, io->len, tmp, (size_t)n < sizeof(tmp) ? (size_t)n : sizeof(tmp) - 1);
+    }
+}
+
+static void metrics_render_prometheus(struct mg_iobuf *io) {
+    static const char *classes[6] = {"other", "1xx", "2xx", "3xx", "4xx", "5xx"};
+
+    metrics_appendf(io, "# HELP ofono_http_requests_total HTTP requests by route and status class.\n");
+    metrics_appendf(io, "# TYPE ofono_http_requests_total counter\n");
+    for (int i = 0; i < g_route_count; i++) {
+        RouteMetrics *m = &g_routes[i];
+        if (m->latency.count == 0) continue;
+        for (int s = 0; s < 6; s++) {
+            if (m->status[s] == 0) continue;
+            metrics_appendf(io, "ofono_http_requests_total{route=\"%s\",code=\"%s\"} %llu\n",
+                            m->name, classes[s], (unsigned long long)m->status[s]);
+        }
+    }
+
+    metrics_appendf(io, "# HELP ofono_http_request_bytes_total HTTP request bytes received.\n");
+    metrics_appendf(io, "# TYPE ofono_http_request_bytes_total counter\n");
+    for (int i = 0; i < g_route_count; i++) {
+        RouteMetrics *m = &g_routes[i];
+        if (m->latency.count == 0) continue;
+        metrics_appendf(io, "ofono_http_request_bytes_total{route=\"%s\"} %llu\n",
+                        m->name, (unsigned long long)m->req_bytes);
+    }
+
+    metrics_appendf(io, "# HELP ofono_http_response_bytes_total HTTP response bytes sent.\n");
+    metrics_appendf(io, "# TYPE ofono_http_response_bytes_total counter\n");
+    for (int i = 0; i < g_route_count; i++) {
+        RouteMetrics *m = &g_routes[i];
+        if (m->latency.count == 0) continue;
+        metrics_appendf(io, "ofono_http_response_bytes_total{route=\"%s\"} %llu\n",
+                        m->name, (unsigned long long)m->resp_bytes);
+    }
+
+    metrics_appendf(io, "# HELP ofono_http_arena_allocations_total Request arena allocations.\n");
+    metrics_appendf(io, "# TYPE ofono_http_arena_allocations_total counter\n");
+    for (int i = 0; i < g_route_count; i++) {
+        RouteMetrics *m = &g_routes[i];
+        if (m->latency.count == 0) continue;
+        metrics_appendf(io, "ofono_http_arena_allocations_total{route=\"%s\"} %llu\n",
+                        m->name, (unsigned long long)m->arena_allocs);
+    }
+
+    metrics_appendf(io, "# HELP ofono_http_arena_peak_bytes Largest request arena usage.\n");
+    metrics_appendf(io, "# TYPE ofono_http_arena_peak_bytes gauge\n");
+    for (int i = 0; i < g_route_count; i++) {
+        RouteMetrics *m = &g_routes[i];
+        if (m->latency.count == 0) continue;
+        metrics_appendf(io, "ofono_http_arena_peak_bytes{route=\"%s\"} %u\n",
+                        m->name, (unsigned)m->arena_peak);
+    }
+
+    metrics_appendf(io, "# HELP ofono_http_request_duration_seconds HTTP handler latency.\n");
+    metrics_appendf(io, "# TYPE ofono_http_request_duration_seconds histogram\n");
+    for (int i = 0; i < g_route_count; i++) {
+        RouteMetrics *m = &g_routes[i];
+        const LatencyHist *h = &m->latency;
+        if (h->count == 0) continue;
+
+        /* 细粒度桶折算为粗粒度累计桶: 上界不超过 le 的桶计入 */
+        uint64_t cumulative = 0;
+        int b = 0;
+        for (size_t k = 0; k < PROM_LE_COUNT; k++) {
+            while (b < METRICS_HIST_BUCKETS && metrics_hist_bucket_upper(b) <= g_prom_le_us[k]) {
+                cumulative += h->buckets[b++];
+            }
+            metrics_appendf(io, "ofono_http_request_duration_seconds_bucket{route=\"%s\",le=\"%g\"} %llu\n",
+                            m->name, (double)g_prom_le_us[k] / 1e6, (unsigned long long)cumulative);
+        }
+        metrics_appendf(io, "ofono_http_request_duration_seconds_bucket{route=\"%s\",le=\"+Inf\"} %llu\n",
+                        m->name, (unsigned long long)h->count);
+        metrics_appendf(io, "ofono_http_request_duration_seconds_sum{route=\"%s\"} %.6f\n",
+                        m->name, (double)h->sum / 1e6);
+        metrics_appendf(io, "ofono_http_request_duration_seconds_count{route=\"%s\"} %llu\n",
+                        m->name, (unsigned long long)h->count);
+    }
+}
+
+static char *metrics_render_json(void) {
+    JsonBuilder *j = json_new();
+    if (!j) return NULL;
+
+    json_obj_open(j);
+    json_add_long(j, "uptime_s", (long long)((metrics_now_us() - g_start_us) / 1000000ULL));
+    json_arr_open(j, "routes");
+    for (int i = 0; i < g_route_count; i++) {
+        RouteMetrics *m = &g_routes[i];
+        const LatencyHist *h = &m->latency;
+        if (h->count == 0) continue;
+
+        json_arr_obj_open(j);
+        json_add_str(j, "route", m->name);
+        json_add_long(j, "count", (long long)h->count);
+        json_key_obj_open(j, "status");
+        json_add_long(j, "1xx", (long long)m->status[1]);
+        json_add_long(j, "2xx", (long long)m->status[2]);
+        json_add_long(j, "3xx", (long long)m->status[3]);
+        json_add_long(j, "4xx", (long long)m->status[4]);
+        json_add_long(j, "5xx", (long long)m->status[5]);
+        json_obj_close(j);
+        json_add_long(j, "req_bytes", (long long)m->req_bytes);
+        json_add_long(j, "resp_bytes", (long long)m->resp_bytes);
+        json_key_obj_open(j, "latency_us");
+        json_add_long(j, "avg", (long long)(h->sum / h->count));
+        json_add_long(j, "p50", (long long)metrics_hist_percentile(h, 0.50));
+        json_add_long(j, "p90", (long long)metrics_hist_percentile(h, 0.90));
+        json_add_long(j, "p99", (long long)metrics_hist_percentile(h, 0.99));
+        json_add_long(j, "max", (long long)h->max);
+        json_obj_close(j);
+        json_key_obj_open(j, "arena");
+        json_add_long(j, "allocs", (long long)m->arena_allocs);
+        json_add_long(j, "avg_bytes", (long long)(m->arena_bytes / h->count));
+        json_add_long(j, "peak_bytes", (long long)m->arena_peak);
+        json_obj_close(j);
+        json_obj_close(j);
+    }
+    json_arr_close(j);
+    json_obj_close(j);
+    return json_finish(j);
+}
+
+/**
+ * GET /api/metrics
+ * 默认输出 Prometheus 文本格式，?format=json 输出 JSON 摘要
+ */
+void handle_metrics(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    char format[16] = {0};
+    mg_http_get_var(&hm->query, "format", format, sizeof(format));
+
+    if (strcmp(format, "json") == 0) {
+        char *json = metrics_render_json();
+        if (!json) {
+            HTTP_ERROR(c, 500, "Out of memory");
+            return;
+        }
+        HTTP_OK_FREE(c, json);
+        return;
+    }
+
+    struct mg_iobuf io = {0};
+    mg_iobuf_init(&io, 4096, 1024);
+    metrics_render_prometheus(&io);
+    mg_http_reply(c, 200,
+                  "Content-Type: text/plain; version=0.0.4\r\n"
+                  "Access-Control-Allow-Origin: *\r\n",
+                  "%.*s", (int)io.len, io.len ? (char *)io.buf : "");
+    mg_iobuf_free(&io);
+}
@@ -10,6 +10,7 @@
 #include "modem.h"
 #include "sysinfo.h"
 #include "ofono.h"
+#include "dualsim.h"
 
 /* 有效的网络模式 */
 static const char *valid_modes[] = {"lte_only", "nr_5g_only", "nr_5g_lte_auto", "nsa_only", NULL};
@@ -83,6 +84,7 @@ extern int ofono_is_initialized(void);
 int switch_slot(const char *slot) {
     char target_ril[16], other_ril[16];
     char new_slot[16], new_ril[32];
+    DualSimSlot target, other;
 
     if (!ofono_is_initialized() || !is_valid_slot(slot)) {
         return -1;
@@ -96,38 +98,49 @@ int switch_slot(const char *slot) {
         strcpy(other_ril, "/ril_0");
     }
 
+    /* 两个卡槽的属性镜像常驻，已处于目标状态的步骤直接跳过 */
+    int mirrored = dualsim_get_slot(target_ril, &target) == 0 &&
+                   dualsim_get_slot(other_ril, &other) == 0;
+    dualsim_switch_begin(target_ril);
+
     /* 步骤1: 把当前卡槽设置为 LTE only (mode=5) */
-    ofono_network_set_mode_sync(other_ril, MODE_LTE_ONLY, OFONO_TIMEOUT_MS);
-    usleep(500 * 1000);  /* 500ms */
+    if (!mirrored || strcmp(other.mode, ofono_get_mode_name(MODE_LTE_ONLY)) != 0) {
+        ofono_network_set_mode_sync(other_ril, MODE_LTE_ONLY, OFONO_TIMEOUT_MS);
+        usleep(500 * 1000);  /* 500ms */
+    }
 
     /* 步骤2: 设置当前 ril 在线状态为 0 (关闭) */
-    ofono_modem_set_online(other_ril, 0, OFONO_TIMEOUT_MS);
+    if (!mirrored || other.online) {
+        ofono_modem_set_online(other_ril, 0, OFONO_TIMEOUT_MS);
+    }
 
     /* 步骤3: 设置目标 ril 在线状态为 1 (开启) */
-    ofono_modem_set_online(target_ril, 1, OFONO_TIMEOUT_MS);
+    if (!mirrored || !target.online) {
+        ofono_modem_set_online(target_ril, 1, OFONO_TIMEOUT_MS);
+    }
 
     /* 步骤4: 设置数据卡为目标 ril */
     if (ofono_set_datacard(target_ril) == 0) {
+        dualsim_switch_end(0);
         return -1;
     }
 
-    /* 等待系统状态更新 */
-    sleep(1);
-
     /* 步骤5: 把目标卡槽设置为 auto 模式 (mode=9) */
-    ofono_network_set_mode_sync(target_ril, MODE_NR_5G_LTE_AUTO, OFONO_TIMEOUT_MS);
-
-    /* 验证切换结果 */
-    if (get_current_slot(new_slot, new_ril) != 0) {
-        return -1;
+    if (!mirrored || strcmp(target.mode, ofono_get_mode_name(MODE_NR_5G_LTE_AUTO)) != 0) {
+        ofono_network_set_mode_sync(target_ril, MODE_NR_5G_LTE_AUTO, OFONO_TIMEOUT_MS);
     }
 
-    /* 步骤6: 重启数据连接监听（切换到新卡槽） */
-    if (ofono_is_data_monitor_running()) {
-        printf("[Modem] 切卡完成，重启数据连接监听...\n");
-        ofono_stop_data_monitor();
-        ofono_start_data_monitor();
+    /* 缓存未就绪时等待系统状态更新并验证切换结果；
+     * 否则活动卡槽直接切换，数据连接监听按当前数据卡过滤信号，无需重启 */
+    if (!mirrored) {
+        sleep(1);
+        if (get_current_slot(new_slot, new_ril) != 0) {
+            dualsim_switch_end(0);
+            return -1;
+        }
     }
 
+    long ms = dualsim_switch_end(1);
+    printf("[Modem] 已切换到 %s，耗时 %ld ms\n", slot, ms);
     return 0;
 }
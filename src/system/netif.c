@@ -26,8 +26,8 @@ static pthread_mutex_t g_monitors_lock = PTHREAD_MUTEX_INITIALIZER;
 /**
  * 解析ifconfig输出获取接口列表
  */
-static int parse_ifconfig_output(const char *output, NetInterface *interfaces,
-                                 int max_count) {
+int parse_ifconfig_output(const char *output, NetInterface *interfaces,
+                          int max_count) {
   int count = 0;
   const char *p = output;
   NetInterface *iface = NULL;
@@ -217,11 +217,8 @@ static void *vnstat_reader_thread(void *arg) {
     stats.seconds = (int)mg_json_get_long(json, "$.seconds", 0);
 
     /* RX数据 */
-    char *ratestr = mg_json_get_str(json, "$.rx.ratestring");
-    if (ratestr) {
-      strncpy(stats.rx.ratestring, ratestr, sizeof(stats.rx.ratestring) - 1);
-      free(ratestr);
-    }
+    http_json_get_str(json, "$.rx.ratestring", stats.rx.ratestring,
+                      sizeof(stats.rx.ratestring));
     stats.rx.bytespersecond = mg_json_get_long(json, "$.rx.bytespersecond", 0);
     stats.rx.packetspersecond =
         mg_json_get_long(json, "$.rx.packetspersecond", 0);
@@ -231,11 +228,8 @@ static void *vnstat_reader_thread(void *arg) {
     stats.rx.totalpackets = mg_json_get_long(json, "$.rx.totalpackets", 0);
 
     /* TX数据 */
-    ratestr = mg_json_get_str(json, "$.tx.ratestring");
-    if (ratestr) {
-      strncpy(stats.tx.ratestring, ratestr, sizeof(stats.tx.ratestring) - 1);
-      free(ratestr);
-    }
+    http_json_get_str(json, "$.tx.ratestring", stats.tx.ratestring,
+                      sizeof(stats.tx.ratestring));
     stats.tx.bytespersecond = mg_json_get_long(json, "$.tx.bytespersecond", 0);
     stats.tx.packetspersecond =
         mg_json_get_long(json, "$.tx.packetspersecond", 0);
@@ -537,11 +531,7 @@ void handle_netif_stats(struct mg_connection *c, struct mg_http_message *hm) {
   HTTP_CHECK_POST(c, hm);
 
   char ifname[32] = {0};
-  char *ifname_str = mg_json_get_str(hm->body, "$.interface");
-  if (ifname_str) {
-    strncpy(ifname, ifname_str, sizeof(ifname) - 1);
-    free(ifname_str);
-  }
+  http_json_get_str(hm->body, "$.interface", ifname, sizeof(ifname));
 
   if (strlen(ifname) == 0) {
     HTTP_ERROR(c, 400, "interface参数不能为空");
@@ -619,11 +609,7 @@ void handle_netif_monitor(struct mg_connection *c, struct mg_http_message *hm) {
     char ifname[32] = {0};
     int enabled = 0;
 
-    char *ifname_str = mg_json_get_str(hm->body, "$.interface");
-    if (ifname_str) {
-      strncpy(ifname, ifname_str, sizeof(ifname) - 1);
-      free(ifname_str);
-    }
+    http_json_get_str(hm->body, "$.interface", ifname, sizeof(ifname));
 
     int val = 0;
     if (mg_json_get_bool(hm->body, "$.enabled", &val)) {
@@ -10,9 +10,14 @@
 
 #include "ofono.h"
 #include "dbus_core.h"
+#include "dualsim.h"
+#include "log.h"
 #include "sysinfo.h"
+#include "telemetry.h"
+#include "trace.h"
 #include <pthread.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -39,6 +44,49 @@ static char g_modem_path[64] =
 
 /* ==================== 内部辅助函数 ==================== */
 
+/*
+ * 同步 D-Bus 调用的追踪封装：参数与 GLib 原函数一致，
+ * 在请求追踪中记录方法名/接口名及耗时
+ */
+static GVariant *dbus_proxy_call(GDBusProxy *proxy, const gchar *method,
+                                 GVariant *parameters, GDBusCallFlags flags,
+                                 gint timeout_msec, GCancellable *cancellable,
+                                 GError **error) {
+  int span = trace_span_begin("dbus.call", method);
+  GVariant *ret = g_dbus_proxy_call_sync(proxy, method, parameters, flags,
+                                         timeout_msec, cancellable, error);
+  trace_span_end(span);
+  return ret;
+}
+
+static GVariant *dbus_connection_call(
+    GDBusConnection *connection, const gchar *bus_name,
+    const gchar *object_path, const gchar *interface_name,
+    const gchar *method_name, GVariant *parameters,
+    const GVariantType *reply_type, GDBusCallFlags flags, gint timeout_msec,
+    GCancellable *cancellable, GError **error) {
+  int span = trace_span_begin("dbus.call", method_name);
+  GVariant *ret = g_dbus_connection_call_sync(
+      connection, bus_name, object_path, interface_name, method_name,
+      parameters, reply_type, flags, timeout_msec, cancellable, error);
+  trace_span_end(span);
+  return ret;
+}
+
+static GDBusProxy *dbus_proxy_new(GDBusConnection *connection,
+                                  GDBusProxyFlags flags,
+                                  GDBusInterfaceInfo *info, const gchar *name,
+                                  const gchar *object_path,
+                                  const gchar *interface_name,
+                                  GCancellable *cancellable, GError **error) {
+  int span = trace_span_begin("dbus.proxy", interface_name);
+  GDBusProxy *proxy =
+      g_dbus_proxy_new_sync(connection, flags, info, name, object_path,
+                            interface_name, cancellable, error);
+  trace_span_end(span);
+  return proxy;
+}
+
 /**
  * 动态获取当前 modem 路径（每次实时查询 oFono DataCard）
  * 切卡后自动返回正确的 /ril_0 或 /ril_1
@@ -133,9 +181,9 @@ int init_dbus(void) {
   }
 
   /* 创建 oFono Modem 代理对象 */
-  g_modem_proxy = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE,
-                                        NULL, OFONO_SERVICE, modem_path,
-                                        OFONO_MODEM_IFACE, NULL, &error);
+  g_modem_proxy = dbus_proxy_new(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE,
+                                 NULL, OFONO_SERVICE, modem_path,
+                                 OFONO_MODEM_IFACE, NULL, &error);
 
   if (!g_modem_proxy) {
     set_error("创建 oFono Modem 代理失败: %s",
@@ -183,17 +231,27 @@ int execute_at(const char *command, char **result) {
     return -1;
   }
 
+  /*
+   * 获取互斥锁，确保串行执行；D-Bus 初始化与 proxy 重建也在锁内完成，
+   * 避免后台线程并发调用时互相释放对方正在使用的 g_modem_proxy
+   */
+  int lock_span = trace_span_begin("at.lock", command);
+  pthread_mutex_lock(&g_at_mutex);
+  trace_span_end(lock_span);
+
   /* 检查 D-Bus 是否已初始化 */
   if (!is_dbus_initialized()) {
     printf("D-Bus 未初始化，尝试初始化...\n");
     if (init_dbus() != 0) {
+      pthread_mutex_unlock(&g_at_mutex);
       return -1;
     }
   }
 
-  /* 动态检测 modem 路径变化，切卡后自动重建 proxy */
+  /* 优先使用双卡缓存中常驻的 proxy；缓存未就绪时检测路径变化并重建 proxy */
   const char *current_path = get_current_modem_path();
-  if (g_modem_proxy) {
+  GDBusProxy *proxy = dualsim_modem_proxy(current_path);
+  if (!proxy && g_modem_proxy) {
     const gchar *proxy_path = g_dbus_proxy_get_object_path(g_modem_proxy);
     if (proxy_path && strcmp(proxy_path, current_path) != 0) {
       printf("[AT] 检测到 modem 路径变化: %s -> %s，重建 proxy...\n",
@@ -201,52 +259,57 @@ int execute_at(const char *command, char **result) {
       g_object_unref(g_modem_proxy);
       g_modem_proxy = NULL;
       GError *perr = NULL;
-      g_modem_proxy = g_dbus_proxy_new_sync(
+      g_modem_proxy = dbus_proxy_new(
           g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, OFONO_SERVICE,
           current_path, OFONO_MODEM_IFACE, NULL, &perr);
       if (!g_modem_proxy) {
         printf("[AT] 重建 proxy 失败: %s\n", perr ? perr->message : "unknown");
         if (perr)
           g_error_free(perr);
+        pthread_mutex_unlock(&g_at_mutex);
         return -1;
       }
       printf("[AT] proxy 重建成功 (路径: %s)\n", current_path);
     }
   }
+  if (!proxy) {
+    proxy = g_object_ref(g_modem_proxy);
+  }
 
-  /* 获取互斥锁，确保串行执行 */
-  pthread_mutex_lock(&g_at_mutex);
+  int cmd_span = trace_span_begin("at.cmd", command);
 
-  printf("准备发送 AT 命令: %s\n", command);
+  LOG_D("准备发送 AT 命令: %s", command);
 
   /* 重试逻辑 */
   for (retry = 0; retry <= MAX_RETRIES; retry++) {
     error = NULL;
 
     /* 调用 oFono 的 SendAtcmd 方法 */
-    ret = g_dbus_proxy_call_sync(
-        g_modem_proxy, "SendAtcmd", g_variant_new("(s)", command),
+    ret = dbus_proxy_call(
+        proxy, "SendAtcmd", g_variant_new("(s)", command),
         G_DBUS_CALL_FLAGS_NONE, AT_COMMAND_TIMEOUT, NULL, &error);
 
     if (!ret) {
-      printf("调用 SendAtcmd 失败 (尝试 %d/%d) (%s): %s\n", retry + 1,
-             MAX_RETRIES + 1, command, error ? error->message : "unknown");
+      LOG_W("调用 SendAtcmd 失败 (尝试 %d/%d) (%s): %s", retry + 1,
+            MAX_RETRIES + 1, command, error ? error->message : "unknown");
 
       /* 检测连接关闭错误 */
       if (error && strstr(error->message, "connection closed")) {
-        printf("检测到连接关闭，尝试重新初始化 D-Bus...\n");
+        LOG_W("检测到连接关闭，尝试重新初始化 D-Bus...");
         g_error_free(error);
         close_dbus();
         if (init_dbus() != 0) {
           set_error("重新初始化 D-Bus 失败");
           break;
         }
+        g_object_unref(proxy);
+        proxy = g_object_ref(g_modem_proxy);
         continue;
       }
 
       /* 检测操作进行中错误 */
       if (error && strstr(error->message, "Operation already in progress")) {
-        printf("检测到 'Operation already in progress'，500ms 后重试...\n");
+        LOG_D("检测到 'Operation already in progress'，500ms 后重试...");
         g_error_free(error);
         g_usleep(500000); /* 500ms */
         continue;
@@ -265,7 +328,7 @@ int execute_at(const char *command, char **result) {
     if (res_str) {
       *result = g_strdup(res_str);
       g_strstrip(*result);
-      printf("AT 命令 (%s) 响应: %s\n", command, *result);
+      LOG_D("AT 命令 (%s) 响应: %s", command, *result);
       rc = 0;
     } else {
       set_error("空响应");
@@ -275,7 +338,9 @@ int execute_at(const char *command, char **result) {
     break;
   }
 
+  trace_span_end(cmd_span);
   pthread_mutex_unlock(&g_at_mutex);
+  g_object_unref(proxy);
   return rc;
 }
 
@@ -307,9 +372,9 @@ int ofono_network_get_mode_sync(const char *modem_path, char *buffer, int size,
     return -1;
   }
 
-  proxy = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-                                OFONO_SERVICE, modem_path, OFONO_RADIO_SETTINGS,
-                                NULL, &error);
+  proxy = dbus_proxy_new(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
+                         OFONO_SERVICE, modem_path, OFONO_RADIO_SETTINGS,
+                         NULL, &error);
 
   if (!proxy) {
     if (error)
@@ -318,8 +383,8 @@ int ofono_network_get_mode_sync(const char *modem_path, char *buffer, int size,
   }
 
   result =
-      g_dbus_proxy_call_sync(proxy, "GetProperties", NULL,
-                             G_DBUS_CALL_FLAGS_NONE, timeout_ms, NULL, &error);
+      dbus_proxy_call(proxy, "GetProperties", NULL,
+                      G_DBUS_CALL_FLAGS_NONE, timeout_ms, NULL, &error);
 
   if (!result) {
     if (error)
@@ -365,7 +430,7 @@ char *ofono_get_datacard(void) {
     return NULL;
   }
 
-  result = g_dbus_connection_call_sync(
+  result = dbus_connection_call(
       g_dbus_conn, OFONO_SERVICE, "/", "org.ofono.Manager", "GetDataCard", NULL,
       G_VARIANT_TYPE("(o)"), G_DBUS_CALL_FLAGS_NONE, 5000, NULL, &error);
 
@@ -424,9 +489,9 @@ int ofono_network_set_mode_sync(const char *modem_path, int mode,
     return -2;
   }
 
-  proxy = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-                                OFONO_SERVICE, modem_path, OFONO_RADIO_SETTINGS,
-                                NULL, &error);
+  proxy = dbus_proxy_new(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
+                         OFONO_SERVICE, modem_path, OFONO_RADIO_SETTINGS,
+                         NULL, &error);
 
   if (!proxy) {
     if (error)
@@ -435,10 +500,10 @@ int ofono_network_set_mode_sync(const char *modem_path, int mode,
   }
 
   result =
-      g_dbus_proxy_call_sync(proxy, "SetProperty",
-                             g_variant_new("(sv)", "TechnologyPreference",
+      dbus_proxy_call(proxy, "SetProperty",
+                      g_variant_new("(sv)", "TechnologyPreference",
                                            g_variant_new_string(mode_str)),
-                             G_DBUS_CALL_FLAGS_NONE, timeout_ms, NULL, &error);
+                      G_DBUS_CALL_FLAGS_NONE, timeout_ms, NULL, &error);
 
   if (!result) {
     if (error)
@@ -461,9 +526,9 @@ int ofono_modem_set_online(const char *modem_path, int online, int timeout_ms) {
     return -1;
   }
 
-  proxy = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-                                OFONO_SERVICE, modem_path, "org.ofono.Modem",
-                                NULL, &error);
+  proxy = dbus_proxy_new(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
+                         OFONO_SERVICE, modem_path, "org.ofono.Modem",
+                         NULL, &error);
 
   if (!proxy) {
     if (error)
@@ -471,7 +536,7 @@ int ofono_modem_set_online(const char *modem_path, int online, int timeout_ms) {
     return -2;
   }
 
-  result = g_dbus_proxy_call_sync(
+  result = dbus_proxy_call(
       proxy, "SetProperty",
       g_variant_new("(sv)", "Online",
                     g_variant_new_boolean(online ? TRUE : FALSE)),
@@ -497,7 +562,7 @@ int ofono_set_datacard(const char *modem_path) {
     return 0;
   }
 
-  result = g_dbus_connection_call_sync(
+  result = dbus_connection_call(
       g_dbus_conn, OFONO_SERVICE, "/", "org.ofono.Manager", "SetDataCard",
       g_variant_new("(o)", modem_path), NULL, G_DBUS_CALL_FLAGS_NONE, 5000,
       NULL, &error);
@@ -523,9 +588,9 @@ int ofono_network_get_signal_strength(const char *modem_path, int *strength,
     return -1;
   }
 
-  proxy = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-                                OFONO_SERVICE, modem_path,
-                                "org.ofono.NetworkRegistration", NULL, &error);
+  proxy = dbus_proxy_new(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
+                         OFONO_SERVICE, modem_path,
+                         "org.ofono.NetworkRegistration", NULL, &error);
 
   if (!proxy) {
     if (error)
@@ -534,8 +599,8 @@ int ofono_network_get_signal_strength(const char *modem_path, int *strength,
   }
 
   result =
-      g_dbus_proxy_call_sync(proxy, "GetProperties", NULL,
-                             G_DBUS_CALL_FLAGS_NONE, timeout_ms, NULL, &error);
+      dbus_proxy_call(proxy, "GetProperties", NULL,
+                      G_DBUS_CALL_FLAGS_NONE, timeout_ms, NULL, &error);
 
   if (!result) {
     if (error)
@@ -584,6 +649,344 @@ int ofono_network_get_signal_strength(const char *modem_path, int *strength,
 #define DEFAULT_CONTEXT_PATH "/ril_0/context2"
 #define DEFAULT_MODEM_PATH "/ril_0"
 
+/* ==================== Context 缓存 ==================== */
+
+/*
+ * 各 modem 的 ConnectionContext 列表及属性缓存：首次访问某个 modem 时调用一次
+ * GetContexts，之后由 ConnectionManager.ContextAdded / ContextRemoved 和
+ * ConnectionContext.PropertyChanged 信号维护，oFono 退出或连接重建时整体失效。
+ * 本进程写入成功的属性在应答回调中直接更新缓存，不依赖信号到达的先后。
+ */
+#define CTX_CACHE_MAX (MAX_APN_CONTEXTS * 2)
+#define CTX_CACHE_MODEMS 4
+
+typedef struct {
+  char modem[32];
+  ApnContext ctx;
+} CachedContext;
+
+static struct {
+  GDBusConnection *conn; /* 订阅所在的连接 */
+  guint signal_ids[3];
+  guint watch_id;
+  char loaded[CTX_CACHE_MODEMS][32]; /* 已加载的 modem 路径 */
+  CachedContext items[CTX_CACHE_MAX];
+  int count;
+} g_ctx_cache;
+static pthread_mutex_t g_ctx_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* 属性名 -> ApnContext 中的字符串字段 */
+static char *ctx_str_field(ApnContext *ctx, const char *name, size_t *size) {
+  static const struct {
+    const char *name;
+    size_t offset;
+    size_t size;
+  } fields[] = {
+      {"Name", offsetof(ApnContext, name), APN_STRING_SIZE},
+      {"AccessPointName", offsetof(ApnContext, apn), APN_STRING_SIZE},
+      {"Protocol", offsetof(ApnContext, protocol), 32},
+      {"Username", offsetof(ApnContext, username), APN_STRING_SIZE},
+      {"Password", offsetof(ApnContext, password), APN_STRING_SIZE},
+      {"AuthenticationMethod", offsetof(ApnContext, auth_method), 32},
+      {"Type", offsetof(ApnContext, context_type), 32},
+  };
+  for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+    if (strcmp(fields[i].name, name) == 0) {
+      *size = fields[i].size;
+      return (char *)ctx + fields[i].offset;
+    }
+  }
+  return NULL;
+}
+
+static void ctx_apply_prop(ApnContext *ctx, const char *name, GVariant *value) {
+  size_t size;
+  char *field;
+
+  if (g_strcmp0(name, "Active") == 0 &&
+      g_variant_is_of_type(value, G_VARIANT_TYPE_BOOLEAN)) {
+    ctx->active = g_variant_get_boolean(value) ? 1 : 0;
+  } else if ((field = ctx_str_field(ctx, name, &size)) != NULL &&
+             g_variant_is_of_type(value, G_VARIANT_TYPE_STRING)) {
+    snprintf(field, size, "%s", g_variant_get_string(value, NULL));
+  }
+}
+
+/* 由 GetContexts / ContextAdded 的属性字典填充 (缺省值与原逐项解析一致) */
+static void ctx_fill(ApnContext *ctx, const char *path, GVariant *props) {
+  GVariantIter iter;
+  const gchar *key;
+  GVariant *value;
+
+  memset(ctx, 0, sizeof(*ctx));
+  snprintf(ctx->path, sizeof(ctx->path), "%s", path);
+  strcpy(ctx->name, "Internet");
+  strcpy(ctx->protocol, "ip");
+  strcpy(ctx->auth_method, "chap");
+
+  g_variant_iter_init(&iter, props);
+  while (g_variant_iter_next(&iter, "{&sv}", &key, &value)) {
+    ctx_apply_prop(ctx, key, value);
+    g_variant_unref(value);
+  }
+}
+
+/* 以下 ctx_* 辅助函数调用方持有 g_ctx_lock */
+static CachedContext *ctx_find(const char *path) {
+  for (int i = 0; i < g_ctx_cache.count; i++) {
+    if (strcmp(g_ctx_cache.items[i].ctx.path, path) == 0) {
+      return &g_ctx_cache.items[i];
+    }
+  }
+  return NULL;
+}
+
+static void ctx_remove(const char *path) {
+  CachedContext *item = ctx_find(path);
+  if (item) {
+    *item = g_ctx_cache.items[--g_ctx_cache.count];
+  }
+}
+
+static void ctx_add(const char *modem, const char *path, GVariant *props) {
+  CachedContext *item = ctx_find(path);
+  if (!item) {
+    if (g_ctx_cache.count >= CTX_CACHE_MAX) {
+      return;
+    }
+    item = &g_ctx_cache.items[g_ctx_cache.count++];
+  }
+  snprintf(item->modem, sizeof(item->modem), "%s", modem);
+  ctx_fill(&item->ctx, path, props);
+}
+
+static int ctx_is_loaded(const char *modem) {
+  for (int i = 0; i < CTX_CACHE_MODEMS; i++) {
+    if (strcmp(g_ctx_cache.loaded[i], modem) == 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void ctx_clear(void) {
+  g_ctx_cache.count = 0;
+  memset(g_ctx_cache.loaded, 0, sizeof(g_ctx_cache.loaded));
+}
+
+/* 更新单个属性 (信号回调及本进程写入成功后调用) */
+static void ctx_cache_update(const char *path, const char *name,
+                             GVariant *value) {
+  pthread_mutex_lock(&g_ctx_lock);
+  CachedContext *item = ctx_find(path);
+  if (item) {
+    ctx_apply_prop(&item->ctx, name, value);
+  }
+  pthread_mutex_unlock(&g_ctx_lock);
+}
+
+static void on_ctx_added(GDBusConnection *conn, const gchar *sender_name,
+                         const gchar *object_path, const gchar *interface_name,
+                         const gchar *signal_name, GVariant *parameters,
+                         gpointer user_data) {
+  (void)conn;
+  (void)sender_name;
+  (void)interface_name;
+  (void)signal_name;
+  (void)user_data;
+
+  if (!g_variant_is_of_type(parameters, G_VARIANT_TYPE("(oa{sv})"))) {
+    return;
+  }
+  const gchar *path = NULL;
+  GVariant *props = NULL;
+  g_variant_get(parameters, "(&o@a{sv})", &path, &props);
+
+  pthread_mutex_lock(&g_ctx_lock);
+  if (ctx_is_loaded(object_path)) {
+    ctx_add(object_path, path, props);
+  }
+  pthread_mutex_unlock(&g_ctx_lock);
+  g_variant_unref(props);
+}
+
+static void on_ctx_removed(GDBusConnection *conn, const gchar *sender_name,
+                           const gchar *object_path,
+                           const gchar *interface_name,
+                           const gchar *signal_name, GVariant *parameters,
+                           gpointer user_data) {
+  (void)conn;
+  (void)sender_name;
+  (void)object_path;
+  (void)interface_name;
+  (void)signal_name;
+  (void)user_data;
+
+  if (!g_variant_is_of_type(parameters, G_VARIANT_TYPE("(o)"))) {
+    return;
+  }
+  const gchar *path = NULL;
+  g_variant_get(parameters, "(&o)", &path);
+
+  pthread_mutex_lock(&g_ctx_lock);
+  ctx_remove(path);
+  pthread_mutex_unlock(&g_ctx_lock);
+}
+
+static void on_ctx_property_changed(GDBusConnection *conn,
+                                    const gchar *sender_name,
+                                    const gchar *object_path,
+                                    const gchar *interface_name,
+                                    const gchar *signal_name,
+                                    GVariant *parameters, gpointer user_data) {
+  (void)conn;
+  (void)sender_name;
+  (void)interface_name;
+  (void)signal_name;
+  (void)user_data;
+
+  if (!g_variant_is_of_type(parameters, G_VARIANT_TYPE("(sv)"))) {
+    return;
+  }
+  const gchar *name = NULL;
+  GVariant *value = NULL;
+  g_variant_get(parameters, "(&sv)", &name, &value);
+  ctx_cache_update(object_path, name, value);
+  g_variant_unref(value);
+}
+
+static void on_ctx_ofono_vanished(GDBusConnection *conn, const gchar *name,
+                                  gpointer user_data) {
+  (void)conn;
+  (void)name;
+  (void)user_data;
+
+  pthread_mutex_lock(&g_ctx_lock);
+  ctx_clear();
+  pthread_mutex_unlock(&g_ctx_lock);
+}
+
+/* 在当前 D-Bus 连接上订阅信号；连接重建后旧订阅失效，重新订阅并清空缓存 */
+static void ctx_cache_subscribe(void) {
+  pthread_mutex_lock(&g_ctx_lock);
+  if (g_ctx_cache.conn == g_dbus_conn) {
+    pthread_mutex_unlock(&g_ctx_lock);
+    return;
+  }
+
+  if (g_ctx_cache.conn) {
+    for (int i = 0; i < 3; i++) {
+      g_dbus_connection_signal_unsubscribe(g_ctx_cache.conn,
+                                           g_ctx_cache.signal_ids[i]);
+    }
+    g_bus_unwatch_name(g_ctx_cache.watch_id);
+    g_object_unref(g_ctx_cache.conn);
+  }
+  ctx_clear();
+
+  g_ctx_cache.conn = g_object_ref(g_dbus_conn);
+  g_ctx_cache.signal_ids[0] = g_dbus_connection_signal_subscribe(
+      g_dbus_conn, OFONO_SERVICE, OFONO_CONNECTION_MANAGER, "ContextAdded",
+      NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE, on_ctx_added, NULL, NULL);
+  g_ctx_cache.signal_ids[1] = g_dbus_connection_signal_subscribe(
+      g_dbus_conn, OFONO_SERVICE, OFONO_CONNECTION_MANAGER, "ContextRemoved",
+      NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE, on_ctx_removed, NULL, NULL);
+  g_ctx_cache.signal_ids[2] = g_dbus_connection_signal_subscribe(
+      g_dbus_conn, OFONO_SERVICE, OFONO_CONNECTION_CONTEXT, "PropertyChanged",
+      NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE, on_ctx_property_changed, NULL,
+      NULL);
+  g_ctx_cache.watch_id = g_bus_watch_name_on_connection(
+      g_dbus_conn, OFONO_SERVICE, G_BUS_NAME_WATCHER_FLAGS_NONE, NULL,
+      on_ctx_ofono_vanished, NULL, NULL);
+  pthread_mutex_unlock(&g_ctx_lock);
+}
+
+/* 确保 modem 的 context 列表已加载，返回 0 成功 */
+static int ctx_cache_load(const char *modem) {
+  GError *error = NULL;
+
+  ctx_cache_subscribe();
+
+  pthread_mutex_lock(&g_ctx_lock);
+  int loaded = ctx_is_loaded(modem);
+  pthread_mutex_unlock(&g_ctx_lock);
+  if (loaded) {
+    return 0;
+  }
+
+  /* 先订阅后加载，加载期间的增删由信号补齐 */
+  GVariant *result = dbus_connection_call(
+      g_dbus_conn, OFONO_SERVICE, modem, OFONO_CONNECTION_MANAGER,
+      "GetContexts", NULL, G_VARIANT_TYPE("(a(oa{sv}))"),
+      G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS, NULL, &error);
+  if (!result) {
+    if (error)
+      g_error_free(error);
+    return -1;
+  }
+
+  GVariantIter *iter = NULL;
+  const gchar *path;
+  GVariant *props;
+
+  pthread_mutex_lock(&g_ctx_lock);
+  for (int i = g_ctx_cache.count - 1; i >= 0; i--) {
+    if (strcmp(g_ctx_cache.items[i].modem, modem) == 0) {
+      g_ctx_cache.items[i] = g_ctx_cache.items[--g_ctx_cache.count];
+    }
+  }
+  g_variant_get(result, "(a(oa{sv}))", &iter);
+  while (g_variant_iter_next(iter, "(&o@a{sv})", &path, &props)) {
+    ctx_add(modem, path, props);
+    g_variant_unref(props);
+  }
+  g_variant_iter_free(iter);
+
+  int slot = 0;
+  while (slot < CTX_CACHE_MODEMS - 1 && g_ctx_cache.loaded[slot][0]) {
+    slot++;
+  }
+  snprintf(g_ctx_cache.loaded[slot], sizeof(g_ctx_cache.loaded[slot]), "%s",
+           modem);
+  pthread_mutex_unlock(&g_ctx_lock);
+
+  g_variant_unref(result);
+  return 0;
+}
+
+/* 缓存中 context 的 Active 状态，未缓存返回 -1 */
+static int ctx_cache_active(const char *path) {
+  int active = -1;
+  pthread_mutex_lock(&g_ctx_lock);
+  CachedContext *item = ctx_find(path);
+  if (item) {
+    active = item->ctx.active;
+  }
+  pthread_mutex_unlock(&g_ctx_lock);
+  return active;
+}
+
+/* 过滤掉缓存中已是目标值的属性，返回需要写入的数量 */
+static int ctx_cache_diff(const char *path, const char *const *names,
+                          const char *const *values, int count,
+                          const char **out_names, const char **out_values) {
+  int n = 0;
+  pthread_mutex_lock(&g_ctx_lock);
+  CachedContext *item = ctx_find(path);
+  for (int i = 0; i < count; i++) {
+    size_t size;
+    const char *field = item ? ctx_str_field(&item->ctx, names[i], &size) : NULL;
+    if (field && strcmp(field, values[i]) == 0) {
+      continue;
+    }
+    out_names[n] = names[i];
+    out_values[n] = values[i];
+    n++;
+  }
+  pthread_mutex_unlock(&g_ctx_lock);
+  return n;
+}
+
 /**
  * 动态查找第一个有效的 internet 类型 context 路径
  * 遍历所有 context，优先返回配置了 APN 的 internet 类型 context
@@ -593,108 +996,46 @@ int ofono_network_get_signal_strength(const char *modem_path, int *strength,
  * @return 0 成功，-1 失败
  */
 static int find_internet_context_path(char *path_buf, size_t buf_size) {
-  GError *error = NULL;
-  GVariant *result = NULL;
-  GDBusProxy *proxy = NULL;
-  int found = 0;
-  char first_internet_path[256] = {0};
+  const char *modem;
+  const char *first_internet_path = NULL;
+  const char *found = NULL;
 
   if (!path_buf || buf_size == 0 || !ensure_connection()) {
     return -1;
   }
 
-  /* 创建 ConnectionManager 代理 */
-  proxy = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-                                OFONO_SERVICE, get_current_modem_path(),
-                                OFONO_CONNECTION_MANAGER, NULL, &error);
-
-  if (!proxy) {
-    if (error)
-      g_error_free(error);
+  modem = get_current_modem_path();
+  if (ctx_cache_load(modem) != 0) {
     /* 回退到默认路径 */
     strncpy(path_buf, DEFAULT_CONTEXT_PATH, buf_size - 1);
     return 0;
   }
 
-  /* 调用 GetContexts 获取所有 context */
-  result =
-      g_dbus_proxy_call_sync(proxy, "GetContexts", NULL, G_DBUS_CALL_FLAGS_NONE,
-                             OFONO_TIMEOUT_MS, NULL, &error);
-
-  if (!result) {
-    if (error)
-      g_error_free(error);
-    g_object_unref(proxy);
-    strncpy(path_buf, DEFAULT_CONTEXT_PATH, buf_size - 1);
-    return 0;
-  }
-
-  /* 解析返回的 a(oa{sv}) 数组 */
-  GVariant *array = g_variant_get_child_value(result, 0);
-  GVariantIter iter;
-  GVariant *child;
-
-  g_variant_iter_init(&iter, array);
-  while ((child = g_variant_iter_next_value(&iter)) != NULL) {
-    const gchar *path = NULL;
-    GVariant *props = NULL;
-
-    g_variant_get(child, "(&o@a{sv})", &path, &props);
-
-    if (props && path) {
-      /* 获取 Type 属性 */
-      GVariant *type_var =
-          g_variant_lookup_value(props, "Type", G_VARIANT_TYPE_STRING);
-      const gchar *context_type =
-          type_var ? g_variant_get_string(type_var, NULL) : "";
-
-      if (g_strcmp0(context_type, "internet") == 0) {
-        /* 获取 AccessPointName 属性 */
-        GVariant *apn_var = g_variant_lookup_value(props, "AccessPointName",
-                                                   G_VARIANT_TYPE_STRING);
-        const gchar *apn = apn_var ? g_variant_get_string(apn_var, NULL) : "";
-
-        /* 记录第一个 internet context */
-        if (first_internet_path[0] == '\0') {
-          strncpy(first_internet_path, path, sizeof(first_internet_path) - 1);
-        }
-
-        /* 优先返回配置了 APN 的 context */
-        if (apn && apn[0] != '\0') {
-          strncpy(path_buf, path, buf_size - 1);
-          found = 1;
-          if (apn_var)
-            g_variant_unref(apn_var);
-          if (type_var)
-            g_variant_unref(type_var);
-          g_variant_unref(props);
-          g_variant_unref(child);
-          break;
-        }
+  pthread_mutex_lock(&g_ctx_lock);
+  for (int i = 0; i < g_ctx_cache.count && !found; i++) {
+    const CachedContext *item = &g_ctx_cache.items[i];
+    if (strcmp(item->modem, modem) != 0 ||
+        strcmp(item->ctx.context_type, "internet") != 0) {
+      continue;
+    }
 
-        if (apn_var)
-          g_variant_unref(apn_var);
-      }
+    /* 记录第一个 internet context */
+    if (!first_internet_path) {
+      first_internet_path = item->ctx.path;
+    }
 
-      if (type_var)
-        g_variant_unref(type_var);
-      g_variant_unref(props);
+    /* 优先返回配置了 APN 的 context */
+    if (item->ctx.apn[0] != '\0') {
+      found = item->ctx.path;
     }
-    g_variant_unref(child);
   }
 
-  g_variant_unref(array);
-  g_variant_unref(result);
-  g_object_unref(proxy);
-
   /* 如果没找到配置了 APN 的，使用第一个 internet context */
   if (!found) {
-    if (first_internet_path[0] != '\0') {
-      strncpy(path_buf, first_internet_path, buf_size - 1);
-    } else {
-      strncpy(path_buf, DEFAULT_CONTEXT_PATH, buf_size - 1);
-    }
+    found = first_internet_path ? first_internet_path : DEFAULT_CONTEXT_PATH;
   }
+  strncpy(path_buf, found, buf_size - 1);
+  pthread_mutex_unlock(&g_ctx_lock);
 
   return 0;
 }
@@ -715,9 +1056,9 @@ int ofono_get_data_status(int *active) {
     return -1;
   }
 
-  proxy = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-                                OFONO_SERVICE, context_path,
-                                OFONO_CONNECTION_CONTEXT, NULL, &error);
+  proxy = dbus_proxy_new(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
+                         OFONO_SERVICE, context_path,
+                         OFONO_CONNECTION_CONTEXT, NULL, &error);
 
   if (!proxy) {
     if (error)
@@ -725,9 +1066,9 @@ int ofono_get_data_status(int *active) {
     return -2;
   }
 
-  result = g_dbus_proxy_call_sync(proxy, "GetProperties", NULL,
-                                  G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS,
-                                  NULL, &error);
+  result = dbus_proxy_call(proxy, "GetProperties", NULL,
+                           G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS,
+                           NULL, &error);
 
   if (!result) {
     if (error)
@@ -773,9 +1114,9 @@ int ofono_set_data_status(int active) {
     return -1;
   }
 
-  proxy = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-                                OFONO_SERVICE, context_path,
-                                OFONO_CONNECTION_CONTEXT, NULL, &error);
+  proxy = dbus_proxy_new(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
+                         OFONO_SERVICE, context_path,
+                         OFONO_CONNECTION_CONTEXT, NULL, &error);
 
   if (!proxy) {
     if (error)
@@ -783,7 +1124,7 @@ int ofono_set_data_status(int active) {
     return -2;
   }
 
-  result = g_dbus_proxy_call_sync(
+  result = dbus_proxy_call(
       proxy, "SetProperty",
       g_variant_new("(sv)", "Active",
                     g_variant_new_boolean(active ? TRUE : FALSE)),
@@ -829,9 +1170,9 @@ int ofono_get_roaming_status(int *roaming_allowed, int *is_roaming) {
   *is_roaming = 0;
 
   /* 1. 获取 ConnectionManager 的 RoamingAllowed 属性 */
-  proxy = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-                                OFONO_SERVICE, get_current_modem_path(),
-                                OFONO_CONNECTION_MANAGER, NULL, &error);
+  proxy = dbus_proxy_new(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
+                         OFONO_SERVICE, get_current_modem_path(),
+                         OFONO_CONNECTION_MANAGER, NULL, &error);
 
   if (!proxy) {
     if (error)
@@ -839,9 +1180,9 @@ int ofono_get_roaming_status(int *roaming_allowed, int *is_roaming) {
     return -2;
   }
 
-  result = g_dbus_proxy_call_sync(proxy, "GetProperties", NULL,
-                                  G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS,
-                                  NULL, &error);
+  result = dbus_proxy_call(proxy, "GetProperties", NULL,
+                           G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS,
+                           NULL, &error);
 
   if (result) {
     GVariant *props = g_variant_get_child_value(result, 0);
@@ -871,9 +1212,9 @@ int ofono_get_roaming_status(int *roaming_allowed, int *is_roaming) {
   g_object_unref(proxy);
 
   /* 2. 获取 NetworkRegistration 的 Status 属性判断是否漫游中 */
-  proxy = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-                                OFONO_SERVICE, get_current_modem_path(),
-                                OFONO_NETWORK_REGISTRATION, NULL, &error);
+  proxy = dbus_proxy_new(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
+                         OFONO_SERVICE, get_current_modem_path(),
+                         OFONO_NETWORK_REGISTRATION, NULL, &error);
 
   if (!proxy) {
     if (error)
@@ -881,9 +1222,9 @@ int ofono_get_roaming_status(int *roaming_allowed, int *is_roaming) {
     return ret; /* 返回已获取的 roaming_allowed */
   }
 
-  result = g_dbus_proxy_call_sync(proxy, "GetProperties", NULL,
-                                  G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS,
-                                  NULL, &error);
+  result = dbus_proxy_call(proxy, "GetProperties", NULL,
+                           G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS,
+                           NULL, &error);
 
   if (result) {
     GVariant *props = g_variant_get_child_value(result, 0);
@@ -923,9 +1264,9 @@ int ofono_set_roaming_allowed(int allowed) {
     return -1;
   }
 
-  proxy = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-                                OFONO_SERVICE, get_current_modem_path(),
-                                OFONO_CONNECTION_MANAGER, NULL, &error);
+  proxy = dbus_proxy_new(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
+                         OFONO_SERVICE, get_current_modem_path(),
+                         OFONO_CONNECTION_MANAGER, NULL, &error);
 
   if (!proxy) {
     if (error)
@@ -933,7 +1274,7 @@ int ofono_set_roaming_allowed(int allowed) {
     return -2;
   }
 
-  result = g_dbus_proxy_call_sync(
+  result = dbus_proxy_call(
       proxy, "SetProperty",
       g_variant_new("(sv)", "RoamingAllowed",
                     g_variant_new_boolean(allowed ? TRUE : FALSE)),
@@ -954,284 +1295,243 @@ int ofono_set_roaming_allowed(int allowed) {
 /* ==================== APN 管理 API ==================== */
 
 int ofono_get_all_apn_contexts(ApnContext *contexts, int max_count) {
-  GError *error = NULL;
-  GVariant *result = NULL;
-  GDBusProxy *proxy = NULL;
+  const char *modem;
   int count = 0;
 
   if (!contexts || max_count <= 0 || !ensure_connection()) {
     return -1;
   }
 
-  /* 创建 ConnectionManager 代理 */
-  proxy = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-                                OFONO_SERVICE, get_current_modem_path(),
-                                OFONO_CONNECTION_MANAGER, NULL, &error);
+  modem = get_current_modem_path();
+  if (ctx_cache_load(modem) != 0) {
+    return -3;
+  }
 
-  if (!proxy) {
-    if (error)
-      g_error_free(error);
-    return -2;
+  /* 只返回 internet 类型 */
+  pthread_mutex_lock(&g_ctx_lock);
+  for (int i = 0; i < g_ctx_cache.count && count < max_count; i++) {
+    const CachedContext *item = &g_ctx_cache.items[i];
+    if (strcmp(item->modem, modem) == 0 &&
+        strcmp(item->ctx.context_type, "internet") == 0) {
+      contexts[count++] = item->ctx;
+    }
   }
+  pthread_mutex_unlock(&g_ctx_lock);
 
-  /* 调用 GetContexts */
-  result =
-      g_dbus_proxy_call_sync(proxy, "GetContexts", NULL, G_DBUS_CALL_FLAGS_NONE,
-                             OFONO_TIMEOUT_MS, NULL, &error);
+  return count;
+}
 
-  if (!result) {
+/* 一组并发 SetProperty 调用的共同完成状态 */
+typedef struct {
+  int pending;
+  int failed;
+} PropBatch;
+
+typedef struct {
+  PropBatch *batch;
+  char path[APN_STRING_SIZE];
+  char name[32];
+  GVariant *value;
+} PropCall;
+
+static void on_context_property_set(GObject *source, GAsyncResult *res,
+                                    gpointer user_data) {
+  PropCall *call = user_data;
+  GError *error = NULL;
+  GVariant *ret =
+      g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res, &error);
+
+  if (ret) {
+    g_variant_unref(ret);
+    ctx_cache_update(call->path, call->name, call->value);
+  } else {
+    LOG_W("设置 %s %s 失败: %s", call->path, call->name,
+          error ? error->message : "unknown");
     if (error)
       g_error_free(error);
-    g_object_unref(proxy);
-    return -3;
+    call->batch->failed++;
   }
 
-  /* 解析返回的 a(oa{sv}) 数组 */
-  GVariant *array = g_variant_get_child_value(result, 0);
-  GVariantIter iter;
-  GVariant *child;
-
-  g_variant_iter_init(&iter, array);
-  while ((child = g_variant_iter_next_value(&iter)) != NULL &&
-         count < max_count) {
-    const gchar *path = NULL;
-    GVariant *props = NULL;
-
-    g_variant_get(child, "(&o@a{sv})", &path, &props);
-
-    if (props) {
-      /* 获取 Type 属性 */
-      GVariant *type_var =
-          g_variant_lookup_value(props, "Type", G_VARIANT_TYPE_STRING);
-      const gchar *context_type =
-          type_var ? g_variant_get_string(type_var, NULL) : "";
-
-      /* 只处理 internet 类型 */
-      if (g_strcmp0(context_type, "internet") == 0) {
-        ApnContext *ctx = &contexts[count];
-        memset(ctx, 0, sizeof(ApnContext));
-
-        /* 复制路径 */
-        strncpy(ctx->path, path, APN_STRING_SIZE - 1);
-        strncpy(ctx->context_type, context_type, sizeof(ctx->context_type) - 1);
-
-        /* 获取各属性 */
-        GVariant *v;
-
-        v = g_variant_lookup_value(props, "Name", G_VARIANT_TYPE_STRING);
-        if (v) {
-          strncpy(ctx->name, g_variant_get_string(v, NULL),
-                  APN_STRING_SIZE - 1);
-          g_variant_unref(v);
-        } else {
-          strcpy(ctx->name, "Internet");
-        }
+  call->batch->pending--;
+  g_variant_unref(call->value);
+  g_free(call);
+}
 
-        v = g_variant_lookup_value(props, "Active", G_VARIANT_TYPE_BOOLEAN);
-        if (v) {
-          ctx->active = g_variant_get_boolean(v) ? 1 : 0;
-          g_variant_unref(v);
-        }
+/*
+ * 并发写入 context 的字符串属性：跳过缓存中已是目标值的属性，
+ * 其余全部异步发出后在私有 GMainContext 中等待全部应答
+ */
+static int set_context_properties(const char *context_path,
+                                  const char *const *names,
+                                  const char *const *values, int count) {
+  const char *todo_names[8];
+  const char *todo_values[8];
+  PropBatch batch = {0, 0};
+
+  if (count > 8) {
+    return -1;
+  }
 
-        v = g_variant_lookup_value(props, "AccessPointName",
-                                   G_VARIANT_TYPE_STRING);
-        if (v) {
-          strncpy(ctx->apn, g_variant_get_string(v, NULL), APN_STRING_SIZE - 1);
-          g_variant_unref(v);
-        }
+  int n = ctx_cache_diff(context_path, names, values, count, todo_names,
+                         todo_values);
+  if (n == 0) {
+    return 0;
+  }
 
-        v = g_variant_lookup_value(props, "Protocol", G_VARIANT_TYPE_STRING);
-        if (v) {
-          strncpy(ctx->protocol, g_variant_get_string(v, NULL),
-                  sizeof(ctx->protocol) - 1);
-          g_variant_unref(v);
-        } else {
-          strcpy(ctx->protocol, "ip");
-        }
+  int span = trace_span_begin("dbus.batch", context_path);
+  GMainContext *ctx = g_main_context_new();
+  g_main_context_push_thread_default(ctx);
 
-        v = g_variant_lookup_value(props, "Username", G_VARIANT_TYPE_STRING);
-        if (v) {
-          strncpy(ctx->username, g_variant_get_string(v, NULL),
-                  APN_STRING_SIZE - 1);
-          g_variant_unref(v);
-        }
+  for (int i = 0; i < n; i++) {
+    PropCall *call = g_new0(PropCall, 1);
+    call->batch = &batch;
+    snprintf(call->path, sizeof(call->path), "%s", context_path);
+    snprintf(call->name, sizeof(call->name), "%s", todo_names[i]);
+    call->value = g_variant_ref_sink(g_variant_new_string(todo_values[i]));
+    batch.pending++;
+    g_dbus_connection_call(g_dbus_conn, OFONO_SERVICE, context_path,
+                           OFONO_CONNECTION_CONTEXT, "SetProperty",
+                           g_variant_new("(sv)", todo_names[i], call->value),
+                           NULL, G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS,
+                           NULL, on_context_property_set, call);
+  }
 
-        v = g_variant_lookup_value(props, "Password", G_VARIANT_TYPE_STRING);
-        if (v) {
-          strncpy(ctx->password, g_variant_get_string(v, NULL),
-                  APN_STRING_SIZE - 1);
-          g_variant_unref(v);
-        }
+  while (batch.pending > 0) {
+    g_main_context_iteration(ctx, TRUE);
+  }
 
-        v = g_variant_lookup_value(props, "AuthenticationMethod",
-                                   G_VARIANT_TYPE_STRING);
-        if (v) {
-          strncpy(ctx->auth_method, g_variant_get_string(v, NULL),
-                  sizeof(ctx->auth_method) - 1);
-          g_variant_unref(v);
-        } else {
-          strcpy(ctx->auth_method, "chap");
-        }
+  g_main_context_pop_thread_default(ctx);
+  g_main_context_unref(ctx);
+  trace_span_end(span);
 
-        count++;
-      }
+  return batch.failed ? -3 : 0;
+}
 
-      if (type_var)
-        g_variant_unref(type_var);
-      g_variant_unref(props);
-    }
-    g_variant_unref(child);
+int ofono_set_context_properties(const char *context_path,
+                                 const char *const *names,
+                                 const char *const *values, int count) {
+  if (!context_path || count < 0 || !ensure_connection()) {
+    return -1;
   }
-
-  g_variant_unref(array);
-  g_variant_unref(result);
-  g_object_unref(proxy);
-
-  return count;
+  return set_context_properties(context_path, names, values, count);
 }
 
 int ofono_set_apn_property(const char *context_path, const char *property,
                            const char *value) {
-  GError *error = NULL;
-  GVariant *result = NULL;
-  GDBusProxy *proxy = NULL;
-
-  if (!context_path || !property || !value || !ensure_connection()) {
+  if (!property || !value) {
     return -1;
   }
-
-  proxy = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-                                OFONO_SERVICE, context_path,
-                                OFONO_CONNECTION_CONTEXT, NULL, &error);
-
-  if (!proxy) {
-    if (error)
-      g_error_free(error);
-    return -2;
-  }
-
-  result = g_dbus_proxy_call_sync(
-      proxy, "SetProperty",
-      g_variant_new("(sv)", property, g_variant_new_string(value)),
-      G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS, NULL, &error);
-
-  if (!result) {
-    if (error)
-      g_error_free(error);
-    g_object_unref(proxy);
-    return -3;
-  }
-
-  g_variant_unref(result);
-  g_object_unref(proxy);
-  return 0;
+  return ofono_set_context_properties(context_path, &property, &value, 1);
 }
 
-int ofono_set_apn_properties(const char *context_path, const char *apn,
-                             const char *protocol, const char *username,
-                             const char *password, const char *auth_method) {
+/* 查询 context 是否激活：优先读缓存，未缓存时调用 GetProperties */
+static int query_context_active(const char *context_path) {
   GError *error = NULL;
   GVariant *result = NULL;
-  GDBusProxy *proxy = NULL;
-  int was_active = 0;
-
-  if (!context_path || !ensure_connection()) {
-    return -1;
-  }
-
-  /* 1. 检查 context 是否激活 */
-  proxy = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-                                OFONO_SERVICE, context_path,
-                                OFONO_CONNECTION_CONTEXT, NULL, &error);
+  int active = ctx_cache_active(context_path);
 
-  if (!proxy) {
-    if (error)
-      g_error_free(error);
-    return -2;
+  if (active >= 0) {
+    return active;
   }
 
-  result = g_dbus_proxy_call_sync(proxy, "GetProperties", NULL,
-                                  G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS,
-                                  NULL, &error);
+  active = 0;
+  result = dbus_connection_call(
+      g_dbus_conn, OFONO_SERVICE, context_path, OFONO_CONNECTION_CONTEXT,
+      "GetProperties", NULL, G_VARIANT_TYPE("(a{sv})"),
+      G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS, NULL, &error);
 
   if (result) {
     GVariant *props = g_variant_get_child_value(result, 0);
     GVariant *active_var =
         g_variant_lookup_value(props, "Active", G_VARIANT_TYPE_BOOLEAN);
     if (active_var) {
-      was_active = g_variant_get_boolean(active_var) ? 1 : 0;
+      active = g_variant_get_boolean(active_var) ? 1 : 0;
       g_variant_unref(active_var);
     }
     g_variant_unref(props);
     g_variant_unref(result);
-  } else {
-    if (error) {
-      g_error_free(error);
-      error = NULL;
-    }
+  } else if (error) {
+    g_error_free(error);
   }
+  return active;
+}
 
-  g_object_unref(proxy);
+/* 同步设置 context 的 Active 并更新缓存 */
+static void set_context_active(const char *context_path, int active) {
+  GError *error = NULL;
+  GVariant *value = g_variant_ref_sink(g_variant_new_boolean(active));
+  GVariant *result = dbus_connection_call(
+      g_dbus_conn, OFONO_SERVICE, context_path, OFONO_CONNECTION_CONTEXT,
+      "SetProperty", g_variant_new("(sv)", "Active", value), NULL,
+      G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS, NULL, &error);
 
-  /* 2. 如果激活中，先关闭 */
-  if (was_active) {
-    proxy = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-                                  OFONO_SERVICE, context_path,
-                                  OFONO_CONNECTION_CONTEXT, NULL, &error);
-    if (proxy) {
-      result = g_dbus_proxy_call_sync(
-          proxy, "SetProperty",
-          g_variant_new("(sv)", "Active", g_variant_new_boolean(FALSE)),
-          G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS, NULL, &error);
-      if (result)
-        g_variant_unref(result);
-      if (error) {
-        g_error_free(error);
-        error = NULL;
-      }
-      g_object_unref(proxy);
-    }
-    /* 等待状态稳定 */
-    g_usleep(500000); /* 500ms */
+  if (result) {
+    g_variant_unref(result);
+    ctx_cache_update(context_path, "Active", value);
+  }
+  if (error)
+    g_error_free(error);
+  g_variant_unref(value);
+}
+
+int ofono_set_apn_properties(const char *context_path, const char *apn,
+                             const char *protocol, const char *username,
+                             const char *password, const char *auth_method) {
+  const char *names[5], *values[5];
+  const char *todo_names[5], *todo_values[5];
+  int count = 0;
+
+  if (!context_path || !ensure_connection()) {
+    return -1;
   }
 
-  /* 3. 设置各属性 */
+  /* 1. 收集要修改的属性 (NULL 表示不修改)，过滤掉已是目标值的 */
   if (apn) {
-    ofono_set_apn_property(context_path, "AccessPointName", apn);
+    names[count] = "AccessPointName";
+    values[count++] = apn;
   }
   if (protocol) {
-    ofono_set_apn_property(context_path, "Protocol", protocol);
+    names[count] = "Protocol";
+    values[count++] = protocol;
   }
   if (username) {
-    ofono_set_apn_property(context_path, "Username", username);
+    names[count] = "Username";
+    values[count++] = username;
   }
   if (password) {
-    ofono_set_apn_property(context_path, "Password", password);
+    names[count] = "Password";
+    values[count++] = password;
   }
   if (auth_method) {
-    ofono_set_apn_property(context_path, "AuthenticationMethod", auth_method);
+    names[count] = "AuthenticationMethod";
+    values[count++] = auth_method;
+  }
+
+  int n = ctx_cache_diff(context_path, names, values, count, todo_names,
+                         todo_values);
+  if (n == 0) {
+    /* 全部已是目标值，无需断开数据连接 */
+    return 0;
+  }
+
+  /* 2. 如果激活中，先关闭 */
+  int was_active = query_context_active(context_path);
+  if (was_active) {
+    set_context_active(context_path, 0);
+    /* 等待状态稳定 */
+    g_usleep(500000); /* 500ms */
   }
 
+  /* 3. 并发设置有变化的属性 */
+  int ret = set_context_properties(context_path, todo_names, todo_values, n);
+
   /* 4. 如果之前是激活状态，重新激活 */
   if (was_active) {
     g_usleep(500000); /* 500ms */
-    proxy = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-                                  OFONO_SERVICE, context_path,
-                                  OFONO_CONNECTION_CONTEXT, NULL, &error);
-    if (proxy) {
-      result = g_dbus_proxy_call_sync(
-          proxy, "SetProperty",
-          g_variant_new("(sv)", "Active", g_variant_new_boolean(TRUE)),
-          G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS, NULL, &error);
-      if (result)
-        g_variant_unref(result);
-      if (error)
-        g_error_free(error);
-      g_object_unref(proxy);
-    }
+    set_context_active(context_path, 1);
   }
 
-  return 0;
+  return ret;
 }
 
 /* ==================== NetworkMonitor API ==================== */
@@ -1251,9 +1551,9 @@ int ofono_get_serving_cell_tech(char *tech, int size) {
   tech[0] = '\0';
 
   /* 创建 NetworkMonitor 代理 */
-  proxy = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-                                OFONO_SERVICE, get_current_modem_path(),
-                                OFONO_NETWORK_MONITOR, NULL, &error);
+  proxy = dbus_proxy_new(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
+                         OFONO_SERVICE, get_current_modem_path(),
+                         OFONO_NETWORK_MONITOR, NULL, &error);
 
   if (!proxy) {
     if (error)
@@ -1262,9 +1562,9 @@ int ofono_get_serving_cell_tech(char *tech, int size) {
   }
 
   /* 调用 GetServingCellInformation */
-  result = g_dbus_proxy_call_sync(proxy, "GetServingCellInformation", NULL,
-                                  G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS,
-                                  NULL, &error);
+  result = dbus_proxy_call(proxy, "GetServingCellInformation", NULL,
+                           G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS,
+                           NULL, &error);
 
   if (!result) {
     if (error)
@@ -1324,9 +1624,9 @@ int ofono_get_serving_cell_info(char *tech, int tech_size, int *band) {
   *band = 0;
 
   /* 创建 NetworkMonitor 代理 */
-  proxy = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-                                OFONO_SERVICE, get_current_modem_path(),
-                                OFONO_NETWORK_MONITOR, NULL, &error);
+  proxy = dbus_proxy_new(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
+                         OFONO_SERVICE, get_current_modem_path(),
+                         OFONO_NETWORK_MONITOR, NULL, &error);
 
   if (!proxy) {
     if (error)
@@ -1335,9 +1635,9 @@ int ofono_get_serving_cell_info(char *tech, int tech_size, int *band) {
   }
 
   /* 调用 GetServingCellInformation */
-  result = g_dbus_proxy_call_sync(proxy, "GetServingCellInformation", NULL,
-                                  G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS,
-                                  NULL, &error);
+  result = dbus_proxy_call(proxy, "GetServingCellInformation", NULL,
+                           G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS,
+                           NULL, &error);
 
   if (!result) {
     if (error)
@@ -1411,9 +1711,9 @@ int ofono_get_network_status(char *status, int size) {
 
   status[0] = '\0';
 
-  proxy = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-                                OFONO_SERVICE, get_current_modem_path(),
-                                OFONO_NETWORK_REGISTRATION, NULL, &error);
+  proxy = dbus_proxy_new(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
+                         OFONO_SERVICE, get_current_modem_path(),
+                         OFONO_NETWORK_REGISTRATION, NULL, &error);
 
   if (!proxy) {
     if (error)
@@ -1421,9 +1721,9 @@ int ofono_get_network_status(char *status, int size) {
     return -2;
   }
 
-  result = g_dbus_proxy_call_sync(proxy, "GetProperties", NULL,
-                                  G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS,
-                                  NULL, &error);
+  result = dbus_proxy_call(proxy, "GetProperties", NULL,
+                           G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS,
+                           NULL, &error);
 
   if (!result) {
     if (error)
@@ -1463,6 +1763,13 @@ int ofono_get_network_status(char *status, int size) {
 /**
  * 检查并恢复数据连接
  */
+/* 暂停自动恢复的调用方计数 (射频配置事务期间由调用方自行恢复连接) */
+static volatile int g_data_restore_hold = 0;
+
+void ofono_hold_data_restore(int hold) {
+  __sync_fetch_and_add(&g_data_restore_hold, hold ? 1 : -1);
+}
+
 int ofono_check_and_restore_data(char *result, int size) {
   char net_status[64] = {0};
   char context_path[256] = {0};
@@ -1472,6 +1779,11 @@ int ofono_check_and_restore_data(char *result, int size) {
     return -1;
   }
 
+  if (g_data_restore_hold > 0) {
+    snprintf(result, size, "射频配置进行中，暂不恢复");
+    return 0;
+  }
+
   /* 1. 检查网络注册状态 */
   if (ofono_get_network_status(net_status, sizeof(net_status)) != 0) {
     snprintf(result, size, "无法获取网络状态");
@@ -1496,9 +1808,9 @@ int ofono_check_and_restore_data(char *result, int size) {
   GDBusProxy *proxy = NULL;
   char apn[128] = {0};
 
-  proxy = g_dbus_proxy_new_sync(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
-                                OFONO_SERVICE, context_path,
-                                OFONO_CONNECTION_CONTEXT, NULL, &error);
+  proxy = dbus_proxy_new(g_dbus_conn, G_DBUS_PROXY_FLAGS_NONE, NULL,
+                         OFONO_SERVICE, context_path,
+                         OFONO_CONNECTION_CONTEXT, NULL, &error);
 
   if (!proxy) {
     if (error)
@@ -1507,9 +1819,9 @@ int ofono_check_and_restore_data(char *result, int size) {
     return -1;
   }
 
-  ctx_result = g_dbus_proxy_call_sync(proxy, "GetProperties", NULL,
-                                      G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS,
-                                      NULL, &error);
+  ctx_result = dbus_proxy_call(proxy, "GetProperties", NULL,
+                               G_DBUS_CALL_FLAGS_NONE, OFONO_TIMEOUT_MS,
+                               NULL, &error);
 
   if (!ctx_result) {
     if (error)
@@ -1699,6 +2011,7 @@ static void on_context_property_changed(
     gboolean active = g_variant_get_boolean(prop_value);
     printf("[DataMonitor] Context %s Active 变化: %s\n", object_path,
            active ? "true" : "false");
+    telemetry_update_data_state(active);
 
     if (!active) {
       /* 数据连接断开，使用 g_timeout_add 延迟恢复（非阻塞） */
@@ -1728,7 +2041,6 @@ static void on_network_property_changed(
 
   (void)conn;
   (void)sender_name;
-  (void)object_path;
   (void)interface_name;
   (void)signal_name;
   (void)user_data;
@@ -1747,6 +2059,14 @@ static void on_network_property_changed(
     return;
   }
 
+  /* 订阅覆盖两个卡槽，只处理当前数据卡 */
+  char slot[16], ril_path[32];
+  if (get_current_slot(slot, ril_path) == 0 &&
+      g_strcmp0(object_path, ril_path) != 0) {
+    g_variant_unref(prop_value);
+    return;
+  }
+
   /* 只关注 Status 属性 */
   if (g_strcmp0(prop_name, "Status") == 0) {
     const gchar *status = g_variant_get_string(prop_value, NULL);
@@ -1801,30 +2121,10 @@ static void on_manager_property_changed(
   if (g_strcmp0(prop_name, "DataCard") == 0) {
     const gchar *new_datacard = g_variant_get_string(prop_value, NULL);
     printf("[DataMonitor] 检测到切卡: %s\n", new_datacard);
+    telemetry_update_modem(NULL, new_datacard);
 
-    /* 动态检测方案：不再 close_dbus/init_dbus，所有函数已自动使用
-     * get_current_modem_path() 获取正确路径，无需重建连接 */
-    printf("[DataMonitor] modem 路径将在下次调用时自动切换到: %s\n",
-           new_datacard);
-
-    /* 重新订阅信号（使用新的卡槽路径） */
-    printf("[DataMonitor] 重新订阅信号...\n");
-
-    /* 先取消旧的 NetworkRegistration 订阅 */
-    if (g_network_signal_id > 0 && g_monitor_dbus_conn) {
-      g_dbus_connection_signal_unsubscribe(g_monitor_dbus_conn,
-                                           g_network_signal_id);
-      g_network_signal_id = 0;
-    }
-
-    /* 重新订阅 NetworkRegistration 信号（使用新路径） */
-    g_network_signal_id = g_dbus_connection_signal_subscribe(
-        g_monitor_dbus_conn, OFONO_SERVICE, "org.ofono.NetworkRegistration",
-        "PropertyChanged", new_datacard, /* 使用新的卡槽路径 */
-        NULL, G_DBUS_SIGNAL_FLAGS_NONE, on_network_property_changed, NULL,
-        NULL);
-    printf("[DataMonitor] NetworkRegistration 信号重新订阅 ID: %u (路径: %s)\n",
-           g_network_signal_id, new_datacard);
+    /* modem 路径和 AT proxy 由双卡缓存维护，NetworkRegistration
+     * 订阅覆盖两个卡槽，切卡后无需重建连接或重新订阅 */
 
     /* 等待一小段时间让 oFono 内部状态同步 */
     usleep(300000); /* 300ms */
@@ -1855,7 +2155,7 @@ static void subscribe_data_monitor_signals(void) {
   unsubscribe_data_monitor_signals();
 
   /* 添加 D-Bus match 规则 - ConnectionContext PropertyChanged */
-  result = g_dbus_connection_call_sync(
+  result = dbus_connection_call(
       g_monitor_dbus_conn, "org.freedesktop.DBus", "/org/freedesktop/DBus",
       "org.freedesktop.DBus", "AddMatch",
       g_variant_new("(s)", "type='signal',interface='org.ofono."
@@ -1874,7 +2174,7 @@ static void subscribe_data_monitor_signals(void) {
   }
 
   /* 添加 D-Bus match 规则 - NetworkRegistration PropertyChanged */
-  result = g_dbus_connection_call_sync(
+  result = dbus_connection_call(
       g_monitor_dbus_conn, "org.freedesktop.DBus", "/org/freedesktop/DBus",
       "org.freedesktop.DBus", "AddMatch",
       g_variant_new("(s)", "type='signal',interface='org.ofono."
@@ -1900,27 +2200,16 @@ static void subscribe_data_monitor_signals(void) {
   printf("[DataMonitor] ConnectionContext 信号订阅 ID: %u\n",
          g_context_signal_id);
 
-  /* 动态获取当前卡槽路径 */
-  char slot[16], ril_path[32];
-  const char *modem_path = DEFAULT_MODEM_PATH;
-  if (get_current_slot(slot, ril_path) == 0 &&
-      strcmp(ril_path, "unknown") != 0) {
-    modem_path = ril_path;
-    printf("[DataMonitor] 使用当前卡槽: %s (%s)\n", slot, modem_path);
-  } else {
-    printf("[DataMonitor] 使用默认卡槽: %s\n", modem_path);
-  }
-
-  /* 订阅 NetworkRegistration PropertyChanged 信号 */
+  /* 订阅 NetworkRegistration PropertyChanged 信号 (两个卡槽，回调中按当前数据卡过滤) */
   g_network_signal_id = g_dbus_connection_signal_subscribe(
       g_monitor_dbus_conn, OFONO_SERVICE, "org.ofono.NetworkRegistration",
-      "PropertyChanged", modem_path, NULL, G_DBUS_SIGNAL_FLAGS_NONE,
+      "PropertyChanged", NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE,
       on_network_property_changed, NULL, NULL);
   printf("[DataMonitor] NetworkRegistration 信号订阅 ID: %u\n",
          g_network_signal_id);
 
   /* 添加 D-Bus match 规则 - Manager PropertyChanged (监听切卡) */
-  result = g_dbus_connection_call_sync(
+  result = dbus_connection_call(
       g_monitor_dbus_conn, "org.freedesktop.DBus", "/org/freedesktop/DBus",
       "org.freedesktop.DBus", "AddMatch",
       g_variant_new("(s)", "type='signal',interface='org.ofono.Manager',member="
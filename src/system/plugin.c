@@ -12,6 +12,7 @@
 #include <errno.h>
 #include "mongoose.h"
 #include "plugin.h"
+#include "lib/arena.h"
 #include "lib/json_builder.h"
 
 /* 危险命令黑名单 */
@@ -208,7 +209,7 @@ int get_plugin_list(char *json_output, size_t size) {
     if (result) {
         strncpy(json_output, result, size - 1);
         json_output[size - 1] = '\0';
-        free(result);
+        arena_free(result);
     } else {
         snprintf(json_output, size, "[]");
     }
@@ -0,0 +1,305 @@
+/**
+ * @file push.c
+ * @brief 仪表盘状态 WebSocket 推送实现
+ */
+
+#include "push.h"
+#include "arena.h"
+#include "auth.h"
+#include "http_utils.h"
+#include "json_builder.h"
+#include "log.h"
+#include "metrics.h"
+#include "telemetry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 订阅者 (仅在事件循环线程中访问) */
+typedef struct {
+    struct mg_connection *c;    /* NULL=空闲槽位 */
+    char *last;                 /* 最后一次发送的完整状态 */
+    uint64_t version;           /* 已发送的消息序号 */
+} PushSubscriber;
+
+static PushSubscriber g_subs[PUSH_MAX_SUBSCRIBERS];
+static uint64_t g_next_us = 0;
+
+static struct {
+    uint64_t full_messages;
+    uint64_t patches;
+    uint64_t skipped;           /* 发送缓冲区积压而跳过的轮次 */
+    uint64_t sent_bytes;        /* 实际发送的消息字节 */
+    uint64_t baseline_bytes;    /* 每轮向每个订阅者重发完整状态所需的字节 */
+} g_stats;
+
+/* ==================== 增量计算 ==================== */
+
+/* 在 JSON 对象中查找键 (key 含引号，与 mg_json_next 返回的形式一致) */
+static int json_find(struct mg_str obj, struct mg_str key, struct mg_str *val) {
+    size_t ofs = 0;
+    struct mg_str k, v;
+    while ((ofs = mg_json_next(obj, ofs, &k, &v)) > 0) {
+        if (k.len == key.len && memcmp(k.buf, key.buf, k.len) == 0) {
+            if (val) *val = v;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* 以原始 JSON 文本添加键值 (key 含引号) */
+static void json_add_span(JsonBuilder *j, struct mg_str key, struct mg_str val) {
+    char k[64];
+    snprintf(k, sizeof(k), "%.*s", key.len > 2 ? (int)key.len - 2 : 0, key.buf + 1);
+    char *v = arena_strndup(val.buf, val.len);
+    if (v) json_add_raw(j, k, v);
+    arena_free(v);
+}
+
+static void json_add_null_key(JsonBuilder *j, struct mg_str key) {
+    char k[64];
+    snprintf(k, sizeof(k), "%.*s", key.len > 2 ? (int)key.len - 2 : 0, key.buf + 1);
+    json_add_null(j, k);
+}
+
+/*
+ * 写入 cur 相对 last 的增量: 逐个数据段比较字段原文，
+ * 变化的字段原样输出，消失的字段/数据段输出 null，非对象的数据段整体替换
+ * @return 变化的字段数
+ */
+static int build_patch(JsonBuilder *j, struct mg_str last, struct mg_str cur) {
+    int changed = 0;
+    size_t ofs = 0;
+    struct mg_str rkey, rval, lval;
+
+    while ((ofs = mg_json_next(cur, ofs, &rkey, &rval)) > 0) {
+        int found = json_find(last, rkey, &lval);
+        if (found && lval.len == rval.len && memcmp(lval.buf, rval.buf, rval.len) == 0) {
+            continue;
+        }
+        if (!found || rval.buf[0] != '{' || lval.buf[0] != '{') {
+            json_add_span(j, rkey, rval);
+            changed++;
+            continue;
+        }
+
+        char res[64];
+        snprintf(res, sizeof(res), "%.*s", (int)rkey.len - 2, rkey.buf + 1);
+        json_key_obj_open(j, res);
+        size_t fofs = 0;
+        struct mg_str fkey, fval, old;
+        while ((fofs = mg_json_next(rval, fofs, &fkey, &fval)) > 0) {
+            if (json_find(lval, fkey, &old) && old.len == fval.len &&
+                memcmp(old.buf, fval.buf, fval.len) == 0) {
+                continue;
+            }
+            json_add_span(j, fkey, fval);
+            changed++;
+        }
+        fofs = 0;
+        while ((fofs = mg_json_next(lval, fofs, &fkey, NULL)) > 0) {
+            if (!json_find(rval, fkey, NULL)) {
+                json_add_null_key(j, fkey);
+                changed++;
+            }
+        }
+        json_obj_close(j);
+    }
+
+    ofs = 0;
+    while ((ofs = mg_json_next(last, ofs, &rkey, NULL)) > 0) {
+        if (!json_find(cur, rkey, NULL)) {
+            json_add_null_key(j, rkey);
+            changed++;
+        }
+    }
+    return changed;
+}
+
+/* ==================== 订阅者 ==================== */
+
+static PushSubscriber *push_find(struct mg_connection *c) {
+    for (int i = 0; i < PUSH_MAX_SUBSCRIBERS; i++) {
+        if (g_subs[i].c == c) return &g_subs[i];
+    }
+    return NULL;
+}
+
+static void push_send(PushSubscriber *s, const char *type, const char *data) {
+    char *msg = mg_mprintf("{\"type\":\"%s\",\"v\":%llu,\"data\":%s}", type,
+                           (unsigned long long)(s->version + 1), data);
+    if (!msg) return;
+    size_t len = strlen(msg);
+    mg_ws_send(s->c, msg, len, WEBSOCKET_OP_TEXT);
+    free(msg);
+    s->version++;
+    g_stats.sent_bytes += len;
+}
+
+/* 发送完整快照并以其作为后续增量的基准 */
+static void push_send_full(PushSubscriber *s, const char *snapshot) {
+    char *copy = strdup(snapshot);
+    if (!copy) return;
+    push_send(s, "full", snapshot);
+    free(s->last);
+    s->last = copy;
+    g_stats.full_messages++;
+}
+
+/* 推送一轮: 每个订阅者与自己上次发送的状态比较 */
+static void push_tick(void) {
+    char *snapshot = telemetry_dashboard_json();
+    if (!snapshot) return;
+    struct mg_str cur = mg_str(snapshot);
+    /* 基准: 每轮完整重发 ({"type":"full","v":N,"data":...} 的固定部分按 32 字节计) */
+    size_t full_len = cur.len + 32;
+
+    for (int i = 0; i < PUSH_MAX_SUBSCRIBERS; i++) {
+        PushSubscriber *s = &g_subs[i];
+        if (!s->c) continue;
+        g_stats.baseline_bytes += full_len;
+
+        if (s->c->send.len > PUSH_MAX_BACKLOG) {
+            g_stats.skipped++;
+            continue;
+        }
+        if (!s->last) {
+            push_send_full(s, snapshot);
+            continue;
+        }
+        if (strcmp(s->last, snapshot) == 0) continue;
+
+        JsonBuilder *j = json_new();
+        json_obj_open(j);
+        int changed = build_patch(j, mg_str(s->last), cur);
+        json_obj_close(j);
+        char *patch = json_finish(j);
+        if (changed > 0 && patch) {
+            push_send(s, "patch", patch);
+            g_stats.patches++;
+        }
+        arena_free(patch);
+
+        char *copy = strdup(snapshot);
+        if (copy) {
+            free(s->last);
+            s->last = copy;
+        }
+    }
+    arena_free(snapshot);
+}
+
+void push_poll(void) {
+    uint64_t now = metrics_now_us();
+    if (now < g_next_us) return;
+    g_next_us = now + (uint64_t)PUSH_INTERVAL_MS * 1000;
+
+    for (int i = 0; i < PUSH_MAX_SUBSCRIBERS; i++) {
+        if (g_subs[i].c) {
+            push_tick();
+            return;
+        }
+    }
+}
+
+void push_on_event(struct mg_connection *c, int ev, void *ev_data) {
+    if (ev == MG_EV_WS_MSG) {
+        struct mg_ws_message *wm = (struct mg_ws_message *)ev_data;
+        PushSubscriber *s = push_find(c);
+        if (s && mg_strcmp(wm->data, mg_str("resync")) == 0) {
+            char *snapshot = telemetry_dashboard_json();
+            if (snapshot) push_send_full(s, snapshot);
+            arena_free(snapshot);
+        }
+    } else if (ev == MG_EV_CLOSE) {
+        PushSubscriber *s = push_find(c);
+        if (s) {
+            free(s->last);
+            memset(s, 0, sizeof(*s));
+        }
+    }
+}
+
+/* ==================== API ==================== */
+
+void handle_push_ws(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    /* 浏览器用 POST /api/ws/ticket 换取的一次性票据，其他客户端可直接用 Authorization 头 */
+    char ticket[AUTH_TOKEN_SIZE] = {0};
+    char token[AUTH_TOKEN_SIZE] = {0};
+    struct mg_str *auth = mg_http_get_header(hm, "Authorization");
+    int ok;
+    if (mg_http_get_var(&hm->query, "ticket", ticket, sizeof(ticket)) > 0) {
+        ok = auth_ticket_consume(ticket) == 0;
+    } else {
+        if (auth && auth->len > 7 && auth->len - 7 < sizeof(token) && strncmp(auth->buf, "Bearer ", 7) == 0) {
+            memcpy(token, auth->buf + 7, auth->len - 7);
+        }
+        ok = token[0] != '\0' && auth_verify_token(token) == 0;
+    }
+    if (!ok) {
+        HTTP_JSON(c, 401, "{\"status\":\"error\",\"message\":\"未授权，请先登录\"}");
+        return;
+    }
+
+    PushSubscriber *s = push_find(NULL);
+    if (!s) {
+        HTTP_ERROR(c, 503, "订阅者过多");
+        return;
+    }
+
+    mg_ws_upgrade(c, hm, NULL);
+    s->c = c;
+    s->version = 0;
+    char *snapshot = telemetry_dashboard_json();
+    if (snapshot) push_send_full(s, snapshot);
+    arena_free(snapshot);
+    LOG_I("推送订阅者已连接 (conn %lu)", c->id);
+}
+
+void handle_push_ticket(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_POST(c, hm);
+
+    char ticket[AUTH_TOKEN_SIZE];
+    if (auth_ticket_issue(ticket, sizeof(ticket)) != 0) {
+        HTTP_ERROR(c, 500, "生成票据失败");
+        return;
+    }
+
+    JsonBuilder *j = json_new();
+    json_obj_open(j);
+    json_add_str(j, "ticket", ticket);
+    json_add_int(j, "expires_in", AUTH_TICKET_EXPIRE_SECONDS);
+    json_obj_close(j);
+    HTTP_OK_FREE(c, json_finish(j));
+}
+
+void handle_push_stats(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    int subscribers = 0;
+    for (int i = 0; i < PUSH_MAX_SUBSCRIBERS; i++) {
+        if (g_subs[i].c) subscribers++;
+    }
+    uint64_t saved = g_stats.baseline_bytes > g_stats.sent_bytes
+                         ? g_stats.baseline_bytes - g_stats.sent_bytes
+                         : 0;
+
+    JsonBuilder *j = json_new();
+    json_obj_open(j);
+    json_add_int(j, "subscribers", subscribers);
+    json_add_int(j, "interval_ms", PUSH_INTERVAL_MS);
+    json_add_long(j, "full_messages", (long long)g_stats.full_messages);
+    json_add_long(j, "patches", (long long)g_stats.patches);
+    json_add_long(j, "skipped_backlog", (long long)g_stats.skipped);
+    json_add_long(j, "sent_bytes", (long long)g_stats.sent_bytes);
+    json_add_long(j, "full_resend_bytes", (long long)g_stats.baseline_bytes);
+    json_add_long(j, "saved_bytes", (long long)saved);
+    json_add_double(j, "saved_pct",
+                    g_stats.baseline_bytes ? 100.0 * (double)saved / (double)g_stats.baseline_bytes
+                                           : 0.0);
+    json_obj_close(j);
+    HTTP_OK_FREE(c, json_finish(j));
+}
@@ -0,0 +1,634 @@
+/**
+ * @file qos.c
+ * @brief 热点客户端带宽整形实现
+ */
+
+#include "qos.h"
+#include "database.h"
+#include "exec_utils.h"
+#include "http_utils.h"
+#include "json_builder.h"
+#include "log.h"
+#include "metrics.h"
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* 客户端槽位 i 对应的类 1:(QOS_CLASS_BASE + i)，过滤器 800::(QOS_CLASS_BASE + i) */
+#define QOS_CLASS_BASE 0x10
+#define QOS_CLASS_DEFAULT 0xfff
+
+/* 读取 tc 输出的缓冲区大小 */
+#define QOS_OUTPUT_SIZE (16 * 1024)
+
+typedef struct {
+    char ip[16];
+    int down_kbit;              /* 0=不限速 */
+    int up_kbit;
+} QosClient;
+
+/* 配置 */
+typedef struct {
+    int enabled;
+    char lan_iface[16];
+    char wan_iface[16];
+    char ifb_iface[16];         /* 空=不做按客户端的上行整形 */
+    int down_kbit;              /* 总下行速率，0=不限 */
+    int up_kbit;                /* 总上行速率，0=不限 (此时不整形 WAN 口) */
+    char leaf[16];
+    QosClient clients[QOS_MAX_CLIENTS];
+    int client_count;
+} QosConfig;
+
+/* 已下发到内核的一棵 HTB 树 */
+typedef struct {
+    char dev[16];
+    int present;                /* 根队列已创建 */
+    int broken;                 /* 上次下发失败，下次整棵重建 */
+    int total_kbit;
+    char leaf[16];
+    struct {
+        int used;
+        char ip[16];
+        int ceil_kbit;
+    } slots[QOS_MAX_CLIENTS];
+} QosTree;
+
+enum { TREE_DOWN, TREE_UP, TREE_WAN, TREE_COUNT };
+
+/* tc 批处理命令 */
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+    int lines;
+} TcBatch;
+
+static struct {
+    QosConfig cfg;
+    QosTree trees[TREE_COUNT];
+    char ingress_dev[16];       /* 已挂载 ingress 重定向的 LAN 接口 */
+    char ingress_ifb[16];
+    int last_commands;
+    long last_apply_ms;
+    time_t last_apply;
+    char last_error[160];
+} g_qos;
+
+static pthread_mutex_t g_qos_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const QosConfig QOS_DEFAULTS = {
+    .enabled = 0,
+    .lan_iface = "br0",
+    .wan_iface = "sipa_eth0",
+    .ifb_iface = "ifb0",
+    .down_kbit = 0,
+    .up_kbit = 0,
+    .leaf = "fq_codel",
+};
+
+static const char *const LEAF_NAMES[] = {"fq_codel", "cake", "sfq", "pfifo"};
+
+/* ==================== 配置存储 ==================== */
+
+static void create_table(void) {
+    db_execute_safe("CREATE TABLE IF NOT EXISTS qos_clients ("
+                    "ip TEXT PRIMARY KEY,"
+                    "down_kbit INTEGER DEFAULT 0,"
+                    "up_kbit INTEGER DEFAULT 0"
+                    ");");
+}
+
+static void load_str(const char *key, char *dst, size_t size, const char *def) {
+    if (config_get(key, dst, size) != 0) snprintf(dst, size, "%s", def);
+}
+
+/* ifb_iface 为空表示不做上行整形 */
+static void load_config(QosConfig *cfg) {
+    const QosConfig *d = &QOS_DEFAULTS;
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->enabled = config_get_int("qos_enabled", d->enabled);
+    load_str("qos_lan_iface", cfg->lan_iface, sizeof(cfg->lan_iface), d->lan_iface);
+    load_str("qos_wan_iface", cfg->wan_iface, sizeof(cfg->wan_iface), d->wan_iface);
+    config_get_optional("qos_ifb_iface", cfg->ifb_iface, sizeof(cfg->ifb_iface), d->ifb_iface);
+    cfg->down_kbit = config_get_int("qos_down_kbit", d->down_kbit);
+    cfg->up_kbit = config_get_int("qos_up_kbit", d->up_kbit);
+    load_str("qos_leaf", cfg->leaf, sizeof(cfg->leaf), d->leaf);
+
+    char rows[QOS_MAX_CLIENTS * 48];
+    if (db_query_rows("SELECT ip, down_kbit, up_kbit FROM qos_clients ORDER BY rowid;", "|", rows,
+                      sizeof(rows)) != 0)
+        return;
+    char *save = NULL;
+    for (char *line = strtok_r(rows, "\n", &save); line && cfg->client_count < QOS_MAX_CLIENTS;
+         line = strtok_r(NULL, "\n", &save)) {
+        QosClient *cl = &cfg->clients[cfg->client_count];
+        if (sscanf(line, "%15[^|]|%d|%d", cl->ip, &cl->down_kbit, &cl->up_kbit) == 3) cfg->client_count++;
+    }
+}
+
+static void save_config(const QosConfig *cfg) {
+    config_set_int("qos_enabled", cfg->enabled);
+    config_set("qos_lan_iface", cfg->lan_iface);
+    config_set("qos_wan_iface", cfg->wan_iface);
+    config_set_optional("qos_ifb_iface", cfg->ifb_iface);
+    config_set_int("qos_down_kbit", cfg->down_kbit);
+    config_set_int("qos_up_kbit", cfg->up_kbit);
+    config_set("qos_leaf", cfg->leaf);
+
+    /* 客户端列表整体替换，IP 已校验，无需转义 */
+    char sql[QOS_MAX_CLIENTS * 96 + 128];
+    size_t len = (size_t)snprintf(sql, sizeof(sql), "BEGIN; DELETE FROM qos_clients;");
+    for (int i = 0; i < cfg->client_count; i++) {
+        const QosClient *cl = &cfg->clients[i];
+        len += (size_t)snprintf(sql + len, sizeof(sql) - len,
+                                " INSERT INTO qos_clients (ip, down_kbit, up_kbit) VALUES ('%s', %d, %d);",
+                                cl->ip, cl->down_kbit, cl->up_kbit);
+    }
+    snprintf(sql + len, sizeof(sql) - len, " COMMIT;");
+    db_execute_safe(sql);
+}
+
+/* ==================== 批处理 ==================== */
+
+static void batch_add(TcBatch *b, const char *fmt, ...) {
+    char line[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= sizeof(line)) return;
+
+    if (b->len + (size_t)n + 2 > b->cap) {
+        size_t cap = b->cap ? b->cap * 2 : 4096;
+        char *p = realloc(b->buf, cap);
+        if (!p) return;
+        b->buf = p;
+        b->cap = cap;
+    }
+    memcpy(b->buf + b->len, line, (size_t)n);
+    b->len += (size_t)n;
+    b->buf[b->len++] = '\n';
+    b->buf[b->len] = '\0';
+    b->lines++;
+}
+
+static const char *leaf_spec(const char *leaf) {
+    if (strcmp(leaf, "cake") == 0) return "cake unlimited besteffort";
+    if (strcmp(leaf, "sfq") == 0) return "sfq perturb 10";
+    if (strcmp(leaf, "pfifo") == 0) return "pfifo limit 1000";
+    return "fq_codel";
+}
+
+/* tc qdisc show 的输出中是否有 "qdisc <kind> <handle> dev <dev> <where>" */
+static int kernel_has_qdisc(const char *shown, const char *kind, const char *dev, const char *where) {
+    char pat[80];
+    snprintf(pat, sizeof(pat), "qdisc %s dev %s %s", kind, dev, where);
+    return strstr(shown, pat) != NULL;
+}
+
+/* 同一 quantum、相同保证速率，空闲带宽在积压的类之间平分 */
+static void emit_class(TcBatch *b, const char *dev, const char *parent, int minor, int ceil_kbit) {
+    int rate = QOS_GUARANTEE_KBIT < ceil_kbit ? QOS_GUARANTEE_KBIT : ceil_kbit;
+    batch_add(b, "class replace dev %s parent %s classid 1:%x htb rate %dkbit ceil %dkbit quantum 1514", dev,
+              parent, minor, rate, ceil_kbit);
+}
+
+/* 根据内核中的实际状态修正记录: 接口被重建或上次失败时整棵重建 */
+static void tree_sync(QosTree *t, const char *shown, TcBatch *b) {
+    if (!t->present) return;
+    int exists = kernel_has_qdisc(shown, "htb 1:", t->dev, "root");
+    if (t->broken && exists) batch_add(b, "qdisc del dev %s root", t->dev);
+    if (t->broken || !exists) {
+        char dev[sizeof(t->dev)];
+        strcpy(dev, t->dev);
+        memset(t, 0, sizeof(*t));
+        strcpy(t->dev, dev);
+    }
+}
+
+static void tree_remove(QosTree *t, TcBatch *b) {
+    if (t->present) batch_add(b, "qdisc del dev %s root", t->dev);
+    memset(t, 0, sizeof(*t));
+}
+
+static int tree_create(QosTree *t, const char *dev, int default_minor, TcBatch *b) {
+    if (t->present && strcmp(t->dev, dev) != 0) tree_remove(t, b);
+    if (t->present) return 0;
+    memset(t, 0, sizeof(*t));
+    snprintf(t->dev, sizeof(t->dev), "%s", dev);
+    t->present = 1;
+    t->total_kbit = -1;
+    batch_add(b, "qdisc replace dev %s root handle 1: htb default %x", dev, default_minor);
+    return 1;
+}
+
+static int client_ceil(int kbit, int total) { return kbit > 0 && kbit < total ? kbit : total; }
+
+/* 下行 (upload=0，按目的 IP) 或上行 (upload=1，按源 IP) 的客户端树 */
+static void plan_client_tree(QosTree *t, const char *dev, const QosConfig *cfg, int upload, TcBatch *b) {
+    if (!dev[0]) {
+        tree_remove(t, b);
+        return;
+    }
+
+    int total = (upload ? cfg->up_kbit : cfg->down_kbit);
+    if (total <= 0) total = QOS_UNLIMITED_KBIT;
+    const char *leaf = leaf_spec(cfg->leaf);
+    tree_create(t, dev, QOS_CLASS_DEFAULT, b);
+
+    if (t->total_kbit != total) {
+        batch_add(b, "class replace dev %s parent 1: classid 1:1 htb rate %dkbit ceil %dkbit quantum 1514", dev,
+                  total, total);
+        emit_class(b, dev, "1:1", QOS_CLASS_DEFAULT, total);
+    }
+    int leaf_changed = strcmp(t->leaf, cfg->leaf) != 0;
+    if (leaf_changed) {
+        batch_add(b, "qdisc replace dev %s parent 1:%x handle %x: %s", dev, QOS_CLASS_DEFAULT, QOS_CLASS_DEFAULT,
+                  leaf);
+    }
+
+    /* 先删除不再列出的客户端，腾出的槽位可被新客户端复用 */
+    for (int s = 0; s < QOS_MAX_CLIENTS; s++) {
+        if (!t->slots[s].used) continue;
+        int keep = 0;
+        for (int k = 0; k < cfg->client_count; k++) {
+            if (strcmp(cfg->clients[k].ip, t->slots[s].ip) == 0) keep = 1;
+        }
+        if (keep) continue;
+        batch_add(b, "filter del dev %s parent 1: protocol ip prio 1 handle 800::%x u32", dev, QOS_CLASS_BASE + s);
+        batch_add(b, "class del dev %s classid 1:%x", dev, QOS_CLASS_BASE + s);
+        t->slots[s].used = 0;
+    }
+
+    for (int k = 0; k < cfg->client_count; k++) {
+        const QosClient *cl = &cfg->clients[k];
+        int ceil = client_ceil(upload ? cl->up_kbit : cl->down_kbit, total);
+        int s = -1, added = 0;
+        for (int i = 0; i < QOS_MAX_CLIENTS && s < 0; i++) {
+            if (t->slots[i].used && strcmp(t->slots[i].ip, cl->ip) == 0) s = i;
+        }
+        for (int i = 0; i < QOS_MAX_CLIENTS && s < 0; i++) {
+            if (!t->slots[i].used) {
+                s = i;
+                added = 1;
+            }
+        }
+        if (s < 0) break;
+
+        int minor = QOS_CLASS_BASE + s;
+        if (added || t->slots[s].ceil_kbit != ceil) emit_class(b, dev, "1:1", minor, ceil);
+        if (added || leaf_changed) batch_add(b, "qdisc replace dev %s parent 1:%x handle %x: %s", dev, minor, minor, leaf);
+        if (added) {
+            batch_add(b, "filter replace dev %s parent 1: protocol ip prio 1 handle 800::%x u32 match ip %s %s/32 flowid 1:%x",
+                      dev, minor, upload ? "src" : "dst", cl->ip, minor);
+        }
+        t->slots[s].used = 1;
+        t->slots[s].ceil_kbit = ceil;
+        snprintf(t->slots[s].ip, sizeof(t->slots[s].ip), "%s", cl->ip);
+    }
+
+    t->total_kbit = total;
+    snprintf(t->leaf, sizeof(t->leaf), "%s", cfg->leaf);
+}
+
+/* WAN 出方向: 按总上行速率整形，把排队留在本机 */
+static void plan_wan_tree(QosTree *t, const QosConfig *cfg, TcBatch *b) {
+    if (!cfg->wan_iface[0] || cfg->up_kbit <= 0) {
+        tree_remove(t, b);
+        return;
+    }
+    tree_create(t, cfg->wan_iface, 1, b);
+    if (t->total_kbit != cfg->up_kbit) {
+        batch_add(b, "class replace dev %s parent 1: classid 1:1 htb rate %dkbit ceil %dkbit quantum 1514",
+                  cfg->wan_iface, cfg->up_kbit, cfg->up_kbit);
+        t->total_kbit = cfg->up_kbit;
+    }
+    if (strcmp(t->leaf, cfg->leaf) != 0) {
+        batch_add(b, "qdisc replace dev %s parent 1:1 handle 10: %s", cfg->wan_iface, leaf_spec(cfg->leaf));
+        snprintf(t->leaf, sizeof(t->leaf), "%s", cfg->leaf);
+    }
+}
+
+/* LAN 入方向整体重定向到 IFB，上行在 IFB 的出方向整形 */
+static void plan_ingress(const QosConfig *cfg, const char *shown, TcBatch *b) {
+    const char *lan = cfg->enabled && cfg->ifb_iface[0] ? cfg->lan_iface : "";
+    int exists = g_qos.ingress_dev[0] && kernel_has_qdisc(shown, "ingress ffff:", g_qos.ingress_dev, "parent");
+
+    if (exists && (strcmp(g_qos.ingress_dev, lan) != 0 || strcmp(g_qos.ingress_ifb, cfg->ifb_iface) != 0)) {
+        batch_add(b, "qdisc del dev %s ingress", g_qos.ingress_dev);
+        exists = 0;
+    }
+    if (!exists) g_qos.ingress_dev[0] = '\0';
+    if (!lan[0] || exists) return;
+
+    char out[256];
+    run_command(out, sizeof(out), "ip", "link", "add", cfg->ifb_iface, "type", "ifb", NULL);
+    run_command(out, sizeof(out), "ip", "link", "set", cfg->ifb_iface, "up", NULL);
+    batch_add(b, "qdisc replace dev %s handle ffff: ingress", lan);
+    batch_add(b, "filter replace dev %s parent ffff: protocol ip prio 1 handle 800::1 u32 match u32 0 0 "
+                 "action mirred egress redirect dev %s", lan, cfg->ifb_iface);
+    snprintf(g_qos.ingress_dev, sizeof(g_qos.ingress_dev), "%s", lan);
+    snprintf(g_qos.ingress_ifb, sizeof(g_qos.ingress_ifb), "%s", cfg->ifb_iface);
+}
+
+/* 计算当前配置与已下发状态的差异并一次执行 (调用方持有锁)，返回 0 成功 */
+static int apply_locked(void) {
+    const QosConfig *cfg = &g_qos.cfg;
+    uint64_t start = metrics_now_us();
+    TcBatch b = {0};
+    char *out = malloc(QOS_OUTPUT_SIZE);
+    if (!out) return -1;
+
+    run_command(out, QOS_OUTPUT_SIZE, "tc", "qdisc", "show", NULL);
+    for (int i = 0; i < TREE_COUNT; i++) tree_sync(&g_qos.trees[i], out, &b);
+
+    plan_ingress(cfg, out, &b);
+    if (cfg->enabled) {
+        plan_client_tree(&g_qos.trees[TREE_DOWN], cfg->lan_iface, cfg, 0, &b);
+        plan_client_tree(&g_qos.trees[TREE_UP], cfg->ifb_iface, cfg, 1, &b);
+        plan_wan_tree(&g_qos.trees[TREE_WAN], cfg, &b);
+    } else {
+        for (int i = 0; i < TREE_COUNT; i++) tree_remove(&g_qos.trees[i], &b);
+    }
+
+    int ret = 0;
+    g_qos.last_error[0] = '\0';
+    if (b.lines > 0) {
+        /* 独占创建的随机文件名: 不跟随预先放置的符号链接，并发应用互不覆盖 */
+        char path[] = QOS_BATCH_TEMPLATE;
+        int fd = mkstemp(path);
+        FILE *fp = fd >= 0 ? fdopen(fd, "w") : NULL;
+        int written = 0;
+        if (fp) {
+            written = fputs(b.buf, fp) >= 0;
+            if (fclose(fp) != 0) written = 0;
+        } else if (fd >= 0) {
+            close(fd);
+        }
+        if (written) {
+            ret = run_command(out, QOS_OUTPUT_SIZE, "tc", "-force", "-batch", path, NULL);
+        } else {
+            snprintf(out, QOS_OUTPUT_SIZE, "无法写入 tc 批处理文件");
+            ret = -1;
+        }
+        if (fd >= 0) unlink(path);
+    }
+
+    if (ret != 0) {
+        /* 只保留第一条错误；状态不确定的树下次整棵重建 */
+        char *nl = strchr(out, '\n');
+        if (nl) *nl = '\0';
+        snprintf(g_qos.last_error, sizeof(g_qos.last_error), "%s", out[0] ? out : "tc 执行失败");
+        for (int i = 0; i < TREE_COUNT; i++) g_qos.trees[i].broken = g_qos.trees[i].present;
+        g_qos.ingress_dev[0] = '\0';
+        LOG_W("QoS: 下发失败: %s", g_qos.last_error);
+    }
+
+    g_qos.last_commands = b.lines;
+    g_qos.last_apply_ms = (long)((metrics_now_us() - start) / 1000);
+    g_qos.last_apply = time(NULL);
+    LOG_I("QoS: 下发 %d 条命令, 耗时 %ldms", b.lines, g_qos.last_apply_ms);
+    free(b.buf);
+    free(out);
+    return ret == 0 ? 0 : -1;
+}
+
+/* ==================== API ==================== */
+
+int qos_init(void) {
+    create_table();
+    pthread_mutex_lock(&g_qos_lock);
+    load_config(&g_qos.cfg);
+    if (g_qos.cfg.enabled) apply_locked();
+    pthread_mutex_unlock(&g_qos_lock);
+    return 0;
+}
+
+/* 解析 tc -s class show 的输出: 按类号记录发送字节和丢包 */
+typedef struct {
+    unsigned long long bytes;
+    unsigned long long dropped;
+} QosClassStats;
+
+static void read_class_stats(const char *dev, QosClassStats *stats, int count) {
+    memset(stats, 0, sizeof(QosClassStats) * (size_t)count);
+    if (!dev[0]) return;
+
+    char *out = malloc(QOS_OUTPUT_SIZE);
+    if (!out) return;
+    if (run_command(out, QOS_OUTPUT_SIZE, "tc", "-s", "class", "show", "dev", dev, NULL) == 0) {
+        int minor = -1;
+        char *save = NULL;
+        for (char *line = strtok_r(out, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+            unsigned int m;
+            unsigned long long bytes, dropped;
+            if (sscanf(line, "class htb 1:%x", &m) == 1) {
+                minor = m == QOS_CLASS_DEFAULT ? count - 1 : (int)m - QOS_CLASS_BASE;
+            } else if (minor >= 0 && minor < count &&
+                       sscanf(line, " Sent %llu bytes %*u pkt (dropped %llu", &bytes, &dropped) == 2) {
+                stats[minor].bytes = bytes;
+                stats[minor].dropped = dropped;
+                minor = -1;
+            }
+        }
+    }
+    free(out);
+}
+
+/* 客户端在树中的槽位 */
+static int tree_slot(const QosTree *t, const char *ip) {
+    for (int s = 0; s < QOS_MAX_CLIENTS; s++) {
+        if (t->slots[s].used && strcmp(t->slots[s].ip, ip) == 0) return s;
+    }
+    return -1;
+}
+
+static void add_class_stats(JsonBuilder *j, const char *key, const QosClassStats *st) {
+    json_key_obj_open(j, key);
+    json_add_long(j, "bytes", (long long)st->bytes);
+    json_add_long(j, "dropped", (long long)st->dropped);
+    json_obj_close(j);
+}
+
+void handle_qos_status(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    /* 持锁只复制状态，tc 在锁外执行，不阻塞同时进行的下发 */
+    pthread_mutex_lock(&g_qos_lock);
+    QosConfig snap_cfg = g_qos.cfg;
+    QosTree snap_down = g_qos.trees[TREE_DOWN];
+    QosTree snap_up = g_qos.trees[TREE_UP];
+    int wan_tree = g_qos.trees[TREE_WAN].present;
+    int last_commands = g_qos.last_commands;
+    long last_apply_ms = g_qos.last_apply_ms;
+    time_t last_apply = g_qos.last_apply;
+    char last_error[sizeof(g_qos.last_error)];
+    memcpy(last_error, g_qos.last_error, sizeof(last_error));
+    pthread_mutex_unlock(&g_qos_lock);
+
+    /* 最后一项为默认类 */
+    QosClassStats down[QOS_MAX_CLIENTS + 1], up[QOS_MAX_CLIENTS + 1];
+    read_class_stats(snap_down.present ? snap_down.dev : "", down, QOS_MAX_CLIENTS + 1);
+    read_class_stats(snap_up.present ? snap_up.dev : "", up, QOS_MAX_CLIENTS + 1);
+
+    const QosConfig *cfg = &snap_cfg;
+    JsonBuilder *j = json_new();
+    json_obj_open(j);
+
+    json_key_obj_open(j, "config");
+    json_add_bool(j, "enabled", cfg->enabled);
+    json_add_str(j, "lan_iface", cfg->lan_iface);
+    json_add_str(j, "wan_iface", cfg->wan_iface);
+    json_add_str(j, "ifb_iface", cfg->ifb_iface);
+    json_add_int(j, "down_kbit", cfg->down_kbit);
+    json_add_int(j, "up_kbit", cfg->up_kbit);
+    json_add_str(j, "leaf", cfg->leaf);
+    json_obj_close(j);
+
+    json_key_obj_open(j, "state");
+    json_add_long(j, "last_apply", (long long)last_apply);
+    json_add_long(j, "last_apply_ms", last_apply_ms);
+    json_add_int(j, "last_commands", last_commands);
+    json_add_str(j, "last_error", last_error);
+    json_add_bool(j, "download_tree", snap_down.present);
+    json_add_bool(j, "upload_tree", snap_up.present);
+    json_add_bool(j, "wan_tree", wan_tree);
+    json_obj_close(j);
+
+    json_arr_open(j, "clients");
+    for (int i = 0; i < cfg->client_count; i++) {
+        const QosClient *cl = &cfg->clients[i];
+        int ds = tree_slot(&snap_down, cl->ip);
+        int us = tree_slot(&snap_up, cl->ip);
+        json_arr_obj_open(j);
+        json_add_str(j, "ip", cl->ip);
+        json_add_int(j, "down_kbit", cl->down_kbit);
+        json_add_int(j, "up_kbit", cl->up_kbit);
+        if (ds >= 0) add_class_stats(j, "download", &down[ds]);
+        if (us >= 0) add_class_stats(j, "upload", &up[us]);
+        json_obj_close(j);
+    }
+    json_arr_close(j);
+
+    json_key_obj_open(j, "others");
+    add_class_stats(j, "download", &down[QOS_MAX_CLIENTS]);
+    add_class_stats(j, "upload", &up[QOS_MAX_CLIENTS]);
+    json_obj_close(j);
+
+    json_obj_close(j);
+    HTTP_OK_FREE(c, json_finish(j));
+}
+
+/* 解析 clients 数组，返回错误信息，成功返回NULL */
+static const char *parse_clients(struct mg_str body, QosConfig *cfg) {
+    int len;
+    int ofs = mg_json_get(body, "$.clients", &len);
+    struct mg_str arr = mg_str_n(body.buf + ofs, (size_t)len);
+    size_t pos = 0;
+    struct mg_str key, val;
+    struct in_addr addr;
+
+    if (arr.buf[0] != '[') return "clients 必须为数组";
+    cfg->client_count = 0;
+    while ((pos = mg_json_next(arr, pos, &key, &val)) > 0) {
+        if (cfg->client_count >= QOS_MAX_CLIENTS) return "客户端数量过多";
+        QosClient *cl = &cfg->clients[cfg->client_count];
+        if (!http_json_get_str(val, "$.ip", cl->ip, sizeof(cl->ip)) || inet_pton(AF_INET, cl->ip, &addr) != 1)
+            return "客户端 IP 无效";
+        cl->down_kbit = (int)mg_json_get_long(val, "$.down_kbit", 0);
+        cl->up_kbit = (int)mg_json_get_long(val, "$.up_kbit", 0);
+        if (cl->down_kbit < 0 || cl->up_kbit < 0 || cl->down_kbit > QOS_UNLIMITED_KBIT ||
+            cl->up_kbit > QOS_UNLIMITED_KBIT)
+            return "客户端速率无效";
+        /* 统一为点分十进制，便于比较 */
+        inet_ntop(AF_INET, &addr, cl->ip, sizeof(cl->ip));
+        for (int k = 0; k < cfg->client_count; k++) {
+            if (strcmp(cfg->clients[k].ip, cl->ip) == 0) return "客户端 IP 重复";
+        }
+        cfg->client_count++;
+    }
+    return NULL;
+}
+
+void handle_qos_config(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_POST(c, hm);
+
+    pthread_mutex_lock(&g_qos_lock);
+    QosConfig cfg = g_qos.cfg;
+    pthread_mutex_unlock(&g_qos_lock);
+
+    bool b;
+    if (mg_json_get_bool(hm->body, "$.enabled", &b)) cfg.enabled = b;
+    cfg.down_kbit = (int)mg_json_get_long(hm->body, "$.down_kbit", cfg.down_kbit);
+    cfg.up_kbit = (int)mg_json_get_long(hm->body, "$.up_kbit", cfg.up_kbit);
+
+    struct {
+        const char *path;
+        char *dst;
+        size_t size;
+    } names[] = {
+        {"$.lan_iface", cfg.lan_iface, sizeof(cfg.lan_iface)},
+        {"$.wan_iface", cfg.wan_iface, sizeof(cfg.wan_iface)},
+        {"$.ifb_iface", cfg.ifb_iface, sizeof(cfg.ifb_iface)},
+    };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        char buf[64];
+        if (!http_json_get_str(hm->body, names[i].path, buf, sizeof(buf))) continue;
+        if (strlen(buf) >= names[i].size || !valid_ifname(buf)) {
+            HTTP_ERROR(c, 400, "接口名无效");
+            return;
+        }
+        strcpy(names[i].dst, buf);
+    }
+
+    char leaf[16];
+    if (http_json_get_str(hm->body, "$.leaf", leaf, sizeof(leaf))) {
+        int ok = 0;
+        for (size_t i = 0; i < sizeof(LEAF_NAMES) / sizeof(LEAF_NAMES[0]); i++) {
+            if (strcmp(leaf, LEAF_NAMES[i]) == 0) ok = 1;
+        }
+        if (!ok) {
+            HTTP_ERROR(c, 400, "leaf 必须为 fq_codel、cake、sfq 或 pfifo");
+            return;
+        }
+        strcpy(cfg.leaf, leaf);
+    }
+
+    int len;
+    if (mg_json_get(hm->body, "$.clients", &len) >= 0) {
+        const char *msg = parse_clients(hm->body, &cfg);
+        if (msg) {
+            HTTP_ERROR(c, 400, msg);
+            return;
+        }
+    }
+
+    if (cfg.down_kbit < 0 || cfg.up_kbit < 0 || cfg.down_kbit > QOS_UNLIMITED_KBIT ||
+        cfg.up_kbit > QOS_UNLIMITED_KBIT || !cfg.lan_iface[0] ||
+        (cfg.ifb_iface[0] && strcmp(cfg.ifb_iface, cfg.lan_iface) == 0)) {
+        HTTP_ERROR(c, 400, "参数无效");
+        return;
+    }
+
+    pthread_mutex_lock(&g_qos_lock);
+    g_qos.cfg = cfg;
+    save_config(&cfg);
+    int ret = apply_locked();
+
+    JsonBuilder *j = json_new();
+    json_obj_open(j);
+    json_add_str(j, "status", ret == 0 ? "success" : "error");
+    json_add_int(j, "commands", g_qos.last_commands);
+    json_add_long(j, "apply_ms", g_qos.last_apply_ms);
+    json_add_str(j, "error", g_qos.last_error);
+    json_obj_close(j);
+    pthread_mutex_unlock(&g_qos_lock);
+
+    HTTP_JSON_FREE(c, ret == 0 ? 200 : 500, json_finish(j));
+}
@@ -0,0 +1,533 @@
+/**
+ * @file radiocfg.c
+ * @brief 射频配置事务实现
+ */
+
+#include "radiocfg.h"
+#include "advanced.h"
+#include "apn.h"
+#include "bandscan.h"
+#include "cellsel.h"
+#include "http_utils.h"
+#include "json_builder.h"
+#include "log.h"
+#include "metrics.h"
+#include "modem.h"
+#include "ofono.h"
+#include "sysinfo.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* APN 属性上限 (AccessPointName/Protocol/Username/Password/AuthenticationMethod) */
+#define RADIOCFG_APN_PROPS 5
+
+/* 期望的 APN 属性 (has_* 为 0 的字段保持不变) */
+typedef struct {
+    char apn[APN_STRING_SIZE];
+    char protocol[32];
+    char username[APN_STRING_SIZE];
+    char password[APN_STRING_SIZE];
+    char auth_method[32];
+    int has_apn, has_protocol, has_username, has_password, has_auth_method;
+} ApnWant;
+
+/* 期望状态及与当前状态比较后的差异 */
+typedef struct {
+    char ril_path[32];
+    int data_active;                /* 事务开始前数据连接是否激活 */
+
+    int has_mode;
+    char mode[32];
+    int mode_code;
+
+    int has_bands;
+    BandLockMask bands;
+
+    int has_cell;
+    int cell_lock;                  /* 0=解除锁定 */
+    int cell_5g;
+    int arfcn;
+    int pci;
+
+    int has_apn;
+    int template_id;                /* >0 时成功后保存为手动 APN 模式 */
+    char apn_path[APN_STRING_SIZE];
+    struct {
+        const char *prop;
+        char value[APN_STRING_SIZE];
+    } apn_props[RADIOCFG_APN_PROPS];
+    int apn_prop_count;
+} RadioPlan;
+
+typedef enum {
+    OP_DATA_DOWN,
+    OP_RADIO_OFF,
+    OP_BANDS,
+    OP_CELL,
+    OP_APN,
+    OP_MODE,
+    OP_RADIO_ON,
+    OP_DATA_UP,
+} RadioOpType;
+
+static const char *const OP_NAMES[] = {"data_down", "radio_off", "bands", "cell",
+                                       "apn",       "mode",      "radio_on", "data_up"};
+
+typedef struct {
+    RadioOpType type;
+    char detail[96];
+    const char *status;             /* pending/running/done/failed/skipped */
+    long duration_ms;
+} RadioOp;
+
+typedef enum { TXN_IDLE = 0, TXN_RUNNING, TXN_DONE, TXN_FAILED } TxnState;
+
+static const char *const TXN_STATE_NAMES[] = {"idle", "running", "done", "failed"};
+
+static struct {
+    TxnState state;
+    RadioPlan plan;
+    RadioOp ops[RADIOCFG_MAX_OPS];
+    int count;
+    int radio_cycles;
+    long downtime_ms;               /* -1=未测量 (连接原本未激活或尚未恢复) */
+    time_t started;
+    time_t finished;
+    char message[128];
+} g_txn;
+
+static pthread_mutex_t g_txn_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int radiocfg_running(void) {
+    pthread_mutex_lock(&g_txn_lock);
+    int running = g_txn.state == TXN_RUNNING;
+    pthread_mutex_unlock(&g_txn_lock);
+    return running;
+}
+
+/* ==================== 计划 ==================== */
+
+static void plan_add(RadioOp *ops, int *count, RadioOpType type, const char *detail) {
+    if (*count >= RADIOCFG_MAX_OPS) return;
+    RadioOp *op = &ops[(*count)++];
+    op->type = type;
+    snprintf(op->detail, sizeof(op->detail), "%s", detail ? detail : "");
+    op->status = "pending";
+    op->duration_ms = 0;
+}
+
+/* 比较 APN 属性，只记录有变化的 */
+static void apn_diff(RadioPlan *p, const char *prop, int has, const char *want, const char *have) {
+    if (!has || strcmp(want, have) == 0 || p->apn_prop_count >= RADIOCFG_APN_PROPS) return;
+    p->apn_props[p->apn_prop_count].prop = prop;
+    snprintf(p->apn_props[p->apn_prop_count].value, APN_STRING_SIZE, "%s", want);
+    p->apn_prop_count++;
+}
+
+/*
+ * 查询当前状态，去掉无变化的项并生成步骤
+ * @return 步骤数，unchanged 中记录被跳过的项
+ */
+static int plan_build(RadioPlan *p, const ApnWant *w, RadioOp *ops, char *unchanged,
+                      size_t unchanged_size) {
+    int count = 0;
+    unchanged[0] = '\0';
+
+    if (p->has_mode) {
+        char cur[64] = {0};
+        const char *want = ofono_get_mode_name(p->mode_code);
+        if (ofono_network_get_mode_sync(p->ril_path, cur, sizeof(cur), OFONO_TIMEOUT_MS) == 0 && want &&
+            strcmp(cur, want) == 0) {
+            p->has_mode = 0;
+            snprintf(unchanged + strlen(unchanged), unchanged_size - strlen(unchanged), "mode,");
+        }
+    }
+
+    if (p->has_bands) {
+        BandLockMask cur;
+        if (advanced_get_band_lock(&cur) == 0 && memcmp(&cur, &p->bands, sizeof(cur)) == 0) {
+            p->has_bands = 0;
+            snprintf(unchanged + strlen(unchanged), unchanged_size - strlen(unchanged), "bands,");
+        }
+    }
+
+    if (p->has_cell) {
+        int lock, is_5g, arfcn, pci;
+        if (advanced_get_cell_lock(&lock, &is_5g, &arfcn, &pci) == 0 && lock == (p->cell_lock ? 1 : 0) &&
+            (!lock || (is_5g == (p->cell_5g ? 1 : 0) && arfcn == p->arfcn && pci == p->pci))) {
+            p->has_cell = 0;
+            snprintf(unchanged + strlen(unchanged), unchanged_size - strlen(unchanged), "cell,");
+        }
+    }
+
+    if (p->has_apn) {
+        ApnContext *ctx = calloc(MAX_APN_CONTEXTS, sizeof(ApnContext));
+        int n = ctx ? ofono_get_all_apn_contexts(ctx, MAX_APN_CONTEXTS) : 0;
+        const ApnContext *target = NULL;
+        for (int i = 0; i < n && !target; i++) {
+            if (strcmp(ctx[i].context_type, "internet") == 0) target = &ctx[i];
+        }
+        if (!target && n > 0) target = &ctx[0];
+        if (target) {
+            snprintf(p->apn_path, sizeof(p->apn_path), "%s", target->path);
+            apn_diff(p, "AccessPointName", w->has_apn, w->apn, target->apn);
+            apn_diff(p, "Protocol", w->has_protocol, w->protocol, target->protocol);
+            apn_diff(p, "Username", w->has_username, w->username, target->username);
+            apn_diff(p, "Password", w->has_password, w->password, target->password);
+            apn_diff(p, "AuthenticationMethod", w->has_auth_method, w->auth_method, target->auth_method);
+        }
+        free(ctx);
+        if (!target || p->apn_prop_count == 0) {
+            /* 没有可写的 context 时由调用方报错；属性均相同则跳过 */
+            if (target) {
+                snprintf(unchanged + strlen(unchanged), unchanged_size - strlen(unchanged), "apn,");
+            }
+            p->has_apn = target ? 0 : -1;
+        }
+    }
+
+    int cycle = p->has_bands || p->has_cell;
+    int disrupt = cycle || p->has_apn > 0 || p->has_mode;
+    if (disrupt) {
+        int active = 0;
+        p->data_active = ofono_get_data_status(&active) == 0 && active;
+    }
+
+    char detail[96];
+    if (p->data_active && (cycle || p->has_apn > 0)) plan_add(ops, &count, OP_DATA_DOWN, NULL);
+    if (cycle) plan_add(ops, &count, OP_RADIO_OFF, NULL);
+    if (p->has_bands) {
+        snprintf(detail, sizeof(detail), "4G TDD=%d FDD=%d, 5G FDD=%d TDD=%d", p->bands.tdd4g,
+                 p->bands.fdd4g, p->bands.fdd5g, p->bands.tdd5g);
+        plan_add(ops, &count, OP_BANDS, detail);
+    }
+    if (p->has_cell) {
+        if (p->cell_lock) {
+            snprintf(detail, sizeof(detail), "%s %d/%d", p->cell_5g ? "5G" : "4G", p->arfcn, p->pci);
+        } else {
+            snprintf(detail, sizeof(detail), "unlock");
+        }
+        plan_add(ops, &count, OP_CELL, detail);
+    }
+    if (p->has_apn > 0) {
+        detail[0] = '\0';
+        for (int i = 0; i < p->apn_prop_count; i++) {
+            size_t len = strlen(detail);
+            snprintf(detail + len, sizeof(detail) - len, "%s%s", i ? "," : "", p->apn_props[i].prop);
+        }
+        plan_add(ops, &count, OP_APN, detail);
+    }
+    if (p->has_mode) plan_add(ops, &count, OP_MODE, p->mode);
+    if (cycle) plan_add(ops, &count, OP_RADIO_ON, NULL);
+    if (p->data_active && disrupt) plan_add(ops, &count, OP_DATA_UP, NULL);
+
+    size_t len = strlen(unchanged);
+    if (len > 0) unchanged[len - 1] = '\0';
+    return count;
+}
+
+/* ==================== 执行 ==================== */
+
+/* 等待数据连接恢复，超时返回 -1 */
+static int wait_data_up(void) {
+    uint64_t deadline = metrics_now_us() + (uint64_t)RADIOCFG_RECONNECT_TIMEOUT_SEC * 1000000;
+    uint64_t next_kick = 0;
+
+    while (metrics_now_us() < deadline) {
+        int active = 0;
+        if (ofono_get_data_status(&active) == 0 && active) return 0;
+        /* 注册完成前激活会失败，每 5 秒重试一次 */
+        if (metrics_now_us() >= next_kick) {
+            ofono_set_data_status(1);
+            next_kick = metrics_now_us() + 5000000;
+        }
+        usleep(200000);
+    }
+    return -1;
+}
+
+static int run_op(const RadioPlan *p, RadioOpType type) {
+    switch (type) {
+    case OP_DATA_DOWN:
+        return ofono_set_data_status(0) == 0 ? 0 : -1;
+    case OP_RADIO_OFF:
+        return advanced_radio_off();
+    case OP_BANDS:
+        return advanced_write_band_lock(&p->bands);
+    case OP_CELL:
+        return advanced_write_cell_lock(p->cell_lock, p->cell_5g, p->arfcn, p->pci);
+    case OP_APN: {
+        const char *names[RADIOCFG_APN_PROPS], *values[RADIOCFG_APN_PROPS];
+        for (int i = 0; i < p->apn_prop_count; i++) {
+            names[i] = p->apn_props[i].prop;
+            values[i] = p->apn_props[i].value;
+        }
+        if (ofono_set_context_properties(p->apn_path, names, values, p->apn_prop_count) != 0) return -1;
+        if (p->template_id > 0) {
+            ApnConfig cfg = {0};
+            apn_get_config(&cfg);
+            apn_set_mode(APN_MODE_MANUAL, p->template_id, cfg.auto_start);
+        }
+        return 0;
+    }
+    case OP_MODE:
+        return ofono_network_set_mode_sync(p->ril_path, p->mode_code, OFONO_TIMEOUT_MS) == 0 ? 0 : -1;
+    case OP_RADIO_ON:
+        advanced_radio_on();
+        return 0;
+    case OP_DATA_UP:
+        return wait_data_up();
+    }
+    return -1;
+}
+
+static void *radiocfg_thread(void *arg) {
+    (void)arg;
+    RadioPlan plan = g_txn.plan;
+    uint64_t down_since = 0;
+    int failed = 0, radio_off_failed = 0;
+
+    ofono_hold_data_restore(1);
+    for (int i = 0; i < g_txn.count; i++) {
+        RadioOp *op = &g_txn.ops[i];
+
+        /* 关闭射频失败时不写入需要离线的配置，但仍恢复连接 */
+        if (radio_off_failed && (op->type == OP_BANDS || op->type == OP_CELL || op->type == OP_RADIO_ON)) {
+            pthread_mutex_lock(&g_txn_lock);
+            op->status = "skipped";
+            pthread_mutex_unlock(&g_txn_lock);
+            continue;
+        }
+
+        pthread_mutex_lock(&g_txn_lock);
+        op->status = "running";
+        pthread_mutex_unlock(&g_txn_lock);
+
+        uint64_t start = metrics_now_us();
+        if (down_since == 0 && plan.data_active &&
+            (op->type == OP_DATA_DOWN || op->type == OP_RADIO_OFF || op->type == OP_MODE)) {
+            down_since = start;
+        }
+        if (op->type == OP_DATA_UP) ofono_hold_data_restore(0);
+        int ret = run_op(&plan, op->type);
+        uint64_t end = metrics_now_us();
+        LOG_I("射频配置: %s %s%s (%lu ms)", OP_NAMES[op->type], op->detail, ret == 0 ? "" : " 失败",
+              (unsigned long)((end - start) / 1000));
+
+        pthread_mutex_lock(&g_txn_lock);
+        op->status = ret == 0 ? "done" : "failed";
+        op->duration_ms = (long)((end - start) / 1000);
+        if (op->type == OP_RADIO_ON) g_txn.radio_cycles++;
+        if (op->type == OP_DATA_UP && ret == 0 && down_since) g_txn.downtime_ms = (long)((end - down_since) / 1000);
+        pthread_mutex_unlock(&g_txn_lock);
+
+        if (ret != 0) {
+            failed = 1;
+            if (op->type == OP_RADIO_OFF) radio_off_failed = 1;
+        }
+    }
+    if (g_txn.count == 0 || g_txn.ops[g_txn.count - 1].type != OP_DATA_UP) ofono_hold_data_restore(0);
+
+    pthread_mutex_lock(&g_txn_lock);
+    g_txn.state = failed ? TXN_FAILED : TXN_DONE;
+    g_txn.finished = time(NULL);
+    snprintf(g_txn.message, sizeof(g_txn.message), "%s", failed ? "部分步骤失败" : "配置已应用");
+    pthread_mutex_unlock(&g_txn_lock);
+    return NULL;
+}
+
+/* ==================== API ==================== */
+
+/* 解析请求体，失败时返回错误信息 */
+static const char *parse_request(struct mg_str body, RadioPlan *p, ApnWant *w) {
+    int len = 0, ofs;
+
+    memset(p, 0, sizeof(*p));
+    memset(w, 0, sizeof(*w));
+
+    if (http_json_get_str(body, "$.mode", p->mode, sizeof(p->mode))) {
+        if (!is_valid_network_mode(p->mode)) return "Invalid mode value";
+        p->has_mode = 1;
+        p->mode_code = get_network_mode_code(p->mode);
+    }
+
+    if ((ofs = mg_json_get(body, "$.bands", &len)) >= 0) {
+        struct mg_str arr = mg_str_n(body.buf + ofs, (size_t)len);
+        char names[32][32];
+        int count = 0;
+        size_t pos = 0;
+        struct mg_str key, val;
+        if (arr.buf[0] != '[') return "bands 必须为数组";
+        while ((pos = mg_json_next(arr, pos, &key, &val)) > 0) {
+            if (count >= 32 || val.len < 2 || val.len - 2 >= sizeof(names[0]) || val.buf[0] != '"')
+                return "bands 格式错误";
+            snprintf(names[count], sizeof(names[count]), "%.*s", (int)val.len - 2, val.buf + 1);
+            count++;
+        }
+        if (advanced_band_mask_from_names(names, count, &p->bands) != count) return "包含未知频段";
+        p->has_bands = 1;
+    }
+
+    if ((ofs = mg_json_get(body, "$.cell", &len)) >= 0) {
+        p->has_cell = 1;
+        if (len == 4 && strncmp(body.buf + ofs, "null", 4) == 0) {
+            p->cell_lock = 0;
+        } else {
+            char tech[32] = {0};
+            http_json_get_str(body, "$.cell.technology", tech, sizeof(tech));
+            p->cell_lock = 1;
+            p->cell_5g = strstr(tech, "5G") || strstr(tech, "NR") || strstr(tech, "5g") || strstr(tech, "nr");
+            p->arfcn = (int)mg_json_get_long(body, "$.cell.arfcn", 0);
+            p->pci = (int)mg_json_get_long(body, "$.cell.pci", -1);
+            if (p->arfcn <= 0 || p->pci < 0) return "cell 需要 arfcn 和 pci";
+        }
+    }
+
+    if (mg_json_get(body, "$.apn", &len) >= 0) {
+        p->has_apn = 1;
+        p->template_id = (int)mg_json_get_long(body, "$.apn.template_id", 0);
+        if (p->template_id > 0) {
+            ApnTemplate tpl;
+            if (apn_template_get(p->template_id, &tpl) != 0) return "APN 模板不存在";
+            /* 与 apply_apn_to_ofono 一致: 模板中为空的用户名/密码不覆盖 */
+            snprintf(w->apn, sizeof(w->apn), "%s", tpl.apn);
+            snprintf(w->protocol, sizeof(w->protocol), "%s", tpl.protocol);
+            snprintf(w->username, sizeof(w->username), "%s", tpl.username);
+            snprintf(w->password, sizeof(w->password), "%s", tpl.password);
+            snprintf(w->auth_method, sizeof(w->auth_method), "%s", tpl.auth_method);
+            w->has_apn = w->has_protocol = w->has_auth_method = 1;
+            w->has_username = tpl.username[0] != '\0';
+            w->has_password = tpl.password[0] != '\0';
+        } else {
+            w->has_apn = http_json_get_str(body, "$.apn.apn", w->apn, sizeof(w->apn));
+            w->has_protocol = http_json_get_str(body, "$.apn.protocol", w->protocol, sizeof(w->protocol));
+            w->has_username = http_json_get_str(body, "$.apn.username", w->username, sizeof(w->username));
+            w->has_password = http_json_get_str(body, "$.apn.password", w->password, sizeof(w->password));
+            w->has_auth_method =
+                http_json_get_str(body, "$.apn.auth_method", w->auth_method, sizeof(w->auth_method));
+            if (!(w->has_apn || w->has_protocol || w->has_username || w->has_password || w->has_auth_method))
+                return "apn 需要 template_id 或至少一个属性";
+        }
+    }
+
+    if (!p->has_mode && !p->has_bands && !p->has_cell && !p->has_apn) return "没有需要应用的配置";
+    return NULL;
+}
+
+static void add_ops_json(JsonBuilder *j, const RadioOp *ops, int count, int with_result) {
+    json_arr_open(j, "ops");
+    for (int i = 0; i < count; i++) {
+        json_arr_obj_open(j);
+        json_add_str(j, "name", OP_NAMES[ops[i].type]);
+        json_add_str(j, "detail", ops[i].detail);
+        if (with_result) {
+            json_add_str(j, "status", ops[i].status);
+            json_add_long(j, "duration_ms", ops[i].duration_ms);
+        }
+        json_obj_close(j);
+    }
+    json_arr_close(j);
+}
+
+void handle_radio_apply(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_POST(c, hm);
+
+    RadioPlan plan;
+    ApnWant want;
+    const char *err = parse_request(hm->body, &plan, &want);
+    if (err) {
+        HTTP_ERROR(c, 400, err);
+        return;
+    }
+    if (plan.has_cell && cellsel_auto_lock_enabled()) {
+        HTTP_ERROR(c, 409, "自动选择小区已启用");
+        return;
+    }
+    if (bandscan_running() || radiocfg_running()) {
+        HTTP_ERROR(c, 409, "射频配置或频段扫描进行中");
+        return;
+    }
+
+    char slot[16];
+    if (get_current_slot(slot, plan.ril_path) != 0 || strcmp(plan.ril_path, "unknown") == 0) {
+        snprintf(plan.ril_path, sizeof(plan.ril_path), "/ril_0");
+    }
+
+    RadioOp ops[RADIOCFG_MAX_OPS];
+    char unchanged[64];
+    int count = plan_build(&plan, &want, ops, unchanged, sizeof(unchanged));
+    if (plan.has_apn < 0) {
+        HTTP_ERROR(c, 500, "未找到可用的 APN Context");
+        return;
+    }
+
+    int cycles = 0;
+    for (int i = 0; i < count; i++) cycles += ops[i].type == OP_RADIO_ON;
+
+    bool dry_run = false;
+    mg_json_get_bool(hm->body, "$.dry_run", &dry_run);
+    if (!dry_run && count > 0) {
+        pthread_mutex_lock(&g_txn_lock);
+        if (g_txn.state == TXN_RUNNING) {
+            pthread_mutex_unlock(&g_txn_lock);
+            HTTP_ERROR(c, 409, "射频配置或频段扫描进行中");
+            return;
+        }
+        memset(&g_txn, 0, sizeof(g_txn));
+        g_txn.plan = plan;
+        memcpy(g_txn.ops, ops, sizeof(RadioOp) * count);
+        g_txn.count = count;
+        g_txn.downtime_ms = -1;
+        g_txn.started = time(NULL);
+        g_txn.state = TXN_RUNNING;
+
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, radiocfg_thread, NULL) != 0) {
+            g_txn.state = TXN_FAILED;
+            snprintf(g_txn.message, sizeof(g_txn.message), "创建线程失败");
+            pthread_mutex_unlock(&g_txn_lock);
+            HTTP_ERROR(c, 500, "创建线程失败");
+            return;
+        }
+        pthread_detach(tid);
+        pthread_mutex_unlock(&g_txn_lock);
+    }
+
+    JsonBuilder *j = json_new();
+    json_obj_open(j);
+    json_add_bool(j, "success", 1);
+    json_add_bool(j, "dry_run", dry_run);
+    json_add_bool(j, "started", !dry_run && count > 0);
+    json_add_str(j, "unchanged", unchanged);
+    json_add_int(j, "radio_cycles", cycles);
+    add_ops_json(j, ops, count, 0);
+    json_obj_close(j);
+    HTTP_OK_FREE(c, json_finish(j));
+}
+
+void handle_radio_apply_status(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    pthread_mutex_lock(&g_txn_lock);
+    JsonBuilder *j = json_new();
+    json_obj_open(j);
+    json_add_str(j, "state", TXN_STATE_NAMES[g_txn.state]);
+    json_add_long(j, "started", (long long)g_txn.started);
+    json_add_long(j, "finished", (long long)g_txn.finished);
+    json_add_str(j, "message", g_txn.message);
+    json_add_int(j, "radio_cycles", g_txn.radio_cycles);
+    if (g_txn.downtime_ms >= 0) {
+        json_add_long(j, "downtime_ms", g_txn.downtime_ms);
+    } else {
+        json_add_null(j, "downtime_ms");
+    }
+    add_ops_json(j, g_txn.ops, g_txn.count, 1);
+    json_obj_close(j);
+    pthread_mutex_unlock(&g_txn_lock);
+
+    HTTP_OK_FREE(c, json_finish(j));
+}
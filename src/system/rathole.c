@@ -13,6 +13,7 @@
 #include "rathole.h"
 #include "database.h"
 #include "exec_utils.h"
+#include "handoff.h"
 #include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
@@ -123,13 +124,17 @@ int rathole_init(const char *db_path) {
   /* 加载配置 */
   load_rathole_config();
 
-  /* 处理自启动 */
+  /* 处理自启动 (交接启动时 rathole 进程仍在运行，沿用而不重启) */
   if (g_current_config.enabled && g_current_config.auto_start) {
-    printf("[Rathole] 检测到自启动配置，正在启动服务...\n");
-    if (rathole_start() == 0) {
-      printf("[Rathole] 自启动成功\n");
+    if (handoff_resumed() && rathole_get_status(NULL) == 1) {
+      printf("[Rathole] 交接启动，沿用运行中的进程\n");
     } else {
-      printf("[Rathole] 自启动失败\n");
+      printf("[Rathole] 检测到自启动配置，正在启动服务...\n");
+      if (rathole_start() == 0) {
+        printf("[Rathole] 自启动成功\n");
+      } else {
+        printf("[Rathole] 自启动失败\n");
+      }
     }
   }
 
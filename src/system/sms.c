@@ -11,6 +11,7 @@
 #include "sms.h"
 #include "database.h"
 #include "exec_utils.h"
+#include "log.h"
 
 /* 短信模块专用互斥锁 */
 static pthread_mutex_t g_sms_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -54,7 +55,7 @@ static void on_ofono_vanished(GDBusConnection *conn, const gchar *name, gpointer
 static void apply_sms_fix_on_init(void);
 
 /* Hex解码函数 - 将hex字符串解码为原始字节 */
-static void hex_decode(const char *hex, char *out, size_t out_size) {
+void hex_decode(const char *hex, char *out, size_t out_size) {
     size_t i = 0, j = 0;
     size_t hex_len = strlen(hex);
     
@@ -213,7 +214,7 @@ static void on_incoming_message(GDBusConnection *conn, const gchar *sender_name,
     (void)conn; (void)sender_name; (void)object_path;
     (void)interface_name; (void)signal_name; (void)user_data;
     
-    printf("[SMS] 收到新短信信号! path=%s\n", object_path);
+    LOG_I("收到新短信信号: path=%s", object_path);
     
     if (!g_variant_is_of_type(parameters, G_VARIANT_TYPE("(sa{sv})"))) {
         printf("[SMS] 短信信号参数类型不匹配\n");
@@ -239,7 +240,7 @@ static void on_incoming_message(GDBusConnection *conn, const gchar *sender_name,
         g_variant_unref(sender_var);
     }
     
-    printf("[SMS] 新短信 - 发件人: %s, 内容: %s\n", sender, content);
+    LOG_D("新短信 - 发件人: %s, 内容: %s", sender, content);
     
     /* 保存到数据库 */
     time_t now = time(NULL);
@@ -258,6 +259,25 @@ static void on_incoming_message(GDBusConnection *conn, const gchar *sender_name,
     g_variant_unref(props);
 }
 
+/* 将模板中的占位符原地替换为 value (超出缓冲区的部分截断，不使用临时缓冲) */
+static void template_replace(char *buf, size_t size, const char *key, const char *value) {
+    size_t klen = strlen(key);
+    size_t vlen = strlen(value);
+    char *p = buf;
+    
+    while ((p = strstr(p, key)) != NULL) {
+        size_t pos = (size_t)(p - buf);
+        size_t tail = strlen(p + klen);
+        size_t room = size - 1 - pos;
+        size_t v = vlen < room ? vlen : room;
+        size_t t = tail < room - v ? tail : room - v;
+        memmove(p + v, p + klen, t);
+        memcpy(p, value, v);
+        p[v + t] = '\0';
+        p += v;
+    }
+}
+
 /* 发送Webhook通知 */
 static void send_webhook_notification_ext(const SmsMessage *msg, int force) {
     if (!force && (!g_webhook_config.enabled || strlen(g_webhook_config.url) == 0)) {
@@ -277,32 +297,18 @@ static void send_webhook_notification_ext(const SmsMessage *msg, int force) {
     body[sizeof(body) - 1] = '\0';
     
     /* 简单的变量替换 */
-    char *p;
-    char temp[4096];
     
     /* 替换 #{sender} */
-    while ((p = strstr(body, "#{sender}")) != NULL) {
-        *p = '\0';
-        snprintf(temp, sizeof(temp), "%s%s%s", body, msg->sender, p + 9);
-        strncpy(body, temp, sizeof(body) - 1);
-    }
+    template_replace(body, sizeof(body), "#{sender}", msg->sender);
     
     /* 替换 #{content} */
-    while ((p = strstr(body, "#{content}")) != NULL) {
-        *p = '\0';
-        snprintf(temp, sizeof(temp), "%s%s%s", body, msg->content, p + 10);
-        strncpy(body, temp, sizeof(body) - 1);
-    }
+    template_replace(body, sizeof(body), "#{content}", msg->content);
     
     /* 替换 #{time} */
     char time_str[32];
     struct tm *tm_info = localtime(&msg->timestamp);
     strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", tm_info);
-    while ((p = strstr(body, "#{time}")) != NULL) {
-        *p = '\0';
-        snprintf(temp, sizeof(temp), "%s%s%s", body, time_str, p + 7);
-        strncpy(body, temp, sizeof(body) - 1);
-    }
+    template_replace(body, sizeof(body), "#{time}", time_str);
     
     /* 将body写入临时文件，避免shell转义问题 */
     const char *tmp_file = "/tmp/webhook_body.json";
@@ -317,7 +323,7 @@ static void send_webhook_notification_ext(const SmsMessage *msg, int force) {
     }
     
     /* 构建curl命令 */
-    char cmd[8192];
+    char cmd[4096]; /* URL(512) + headers(1024) + 固定部分，4KB 足够 */
     char headers_part[1024] = "";
     
     /* 解析自定义headers */
@@ -377,7 +383,7 @@ static void send_webhook_notification_ext(const SmsMessage *msg, int force) {
     /* 判断是否成功 */
     int result = (strlen(response) > 0 && strstr(response, "curl:") == NULL) ? 1 : 0;
     
-    printf("[SMS] Webhook响应: %s\n", response);
+    LOG_D("Webhook响应: %s", response);
     
     /* 记录日志 */
     add_webhook_log(msg->sender, body, response, result);
@@ -396,7 +402,7 @@ int sms_init(const char *db_path) {
         return 0;
     }
     
-    printf("[SMS] 初始化短信模块\n");
+    LOG_I("初始化短信模块");
     
     /* 初始化数据库模块 */
     if (db_init(db_path) != 0) {
@@ -440,7 +446,7 @@ int sms_init(const char *db_path) {
     subscribe_sms_signal();
     g_ofono_available = 1;  /* 假设oFono可用，后续会通过监控更新 */
     
-    printf("[SMS] 短信模块初始化成功\n");
+    LOG_I("短信模块初始化成功");
     g_sms_initialized = 1;
     return 0;
 }
@@ -484,7 +490,7 @@ int sms_send(const char *recipient, const char *content, char *result_path, size
         return -1;
     }
     
-    printf("[SMS] 发送短信到 %s: %s\n", recipient, content);
+    LOG_D("发送短信到 %s: %s", recipient, content);
     
     /* 调用 org.ofono.MessageManager.SendMessage */
     result = g_dbus_connection_call_sync(
@@ -502,7 +508,7 @@ int sms_send(const char *recipient, const char *content, char *result_path, size
     );
     
     if (!result) {
-        printf("[SMS] 发送短信失败: %s\n", error ? error->message : "未知错误");
+        LOG_W("发送短信失败: %s", error ? error->message : "未知错误");
         if (error) g_error_free(error);
         return -1;
     }
@@ -525,12 +531,13 @@ int sms_send(const char *recipient, const char *content, char *result_path, size
     return 0;
 }
 
-/* 获取短信列表 - 使用hex编码避免特殊字符问题，兼容无JSON扩展的SQLite */
-int sms_get_list(SmsMessage *messages, int max_count) {
+/* 遍历短信列表 - 使用hex编码避免特殊字符问题，兼容无JSON扩展的SQLite */
+int sms_foreach(int max_count, SmsListCallback cb, void *ctx) {
     char sql[512];
     char *output = NULL;
+    SmsMessage msg;
     
-    if (!messages || max_count <= 0) return -1;
+    if (!cb || max_count <= 0) return -1;
     
     /* 分配大缓冲区 */
     output = (char *)malloc(256 * 1024);
@@ -589,15 +596,16 @@ int sms_get_list(SmsMessage *messages, int max_count) {
         }
         
         if (field_count >= 5) {
-            messages[count].id = atoi(fields[0]);
-            strncpy(messages[count].sender, fields[1], sizeof(messages[count].sender) - 1);
-            messages[count].sender[sizeof(messages[count].sender) - 1] = '\0';
+            msg.id = atoi(fields[0]);
+            strncpy(msg.sender, fields[1], sizeof(msg.sender) - 1);
+            msg.sender[sizeof(msg.sender) - 1] = '\0';
             
             /* hex解码content */
-            hex_decode(fields[2], messages[count].content, sizeof(messages[count].content));
+            hex_decode(fields[2], msg.content, sizeof(msg.content));
             
-            messages[count].timestamp = (time_t)atol(fields[3]);
-            messages[count].is_read = atoi(fields[4]);
+            msg.timestamp = (time_t)atol(fields[3]);
+            msg.is_read = atoi(fields[4]);
+            cb(&msg, ctx);
             count++;
         }
         
@@ -901,12 +909,13 @@ int sms_delete_sent(int id) {
     return ret;
 }
 
-/* 获取发送记录列表 - 使用hex编码避免特殊字符问题，兼容无JSON扩展的SQLite */
-int sms_get_sent_list(SentSmsMessage *messages, int max_count) {
+/* 遍历发送记录列表 - 使用hex编码避免特殊字符问题，兼容无JSON扩展的SQLite */
+int sms_foreach_sent(int max_count, SentSmsListCallback cb, void *ctx) {
     char sql[512];
     char *output = NULL;
+    SentSmsMessage msg;
     
-    if (!messages || max_count <= 0) return -1;
+    if (!cb || max_count <= 0) return -1;
     
     /* 分配大缓冲区 */
     output = (char *)malloc(256 * 1024);
@@ -965,16 +974,17 @@ int sms_get_sent_list(SentSmsMessage *messages, int max_count) {
         }
         
         if (field_count >= 5) {
-            messages[count].id = atoi(fields[0]);
-            strncpy(messages[count].recipient, fields[1], sizeof(messages[count].recipient) - 1);
-            messages[count].recipient[sizeof(messages[count].recipient) - 1] = '\0';
+            msg.id = atoi(fields[0]);
+            strncpy(msg.recipient, fields[1], sizeof(msg.recipient) - 1);
+            msg.recipient[sizeof(msg.recipient) - 1] = '\0';
             
             /* hex解码content */
-            hex_decode(fields[2], messages[count].content, sizeof(messages[count].content));
+            hex_decode(fields[2], msg.content, sizeof(msg.content));
             
-            messages[count].timestamp = (time_t)atol(fields[3]);
-            strncpy(messages[count].status, fields[4], sizeof(messages[count].status) - 1);
-            messages[count].status[sizeof(messages[count].status) - 1] = '\0';
+            msg.timestamp = (time_t)atol(fields[3]);
+            strncpy(msg.status, fields[4], sizeof(msg.status) - 1);
+            msg.status[sizeof(msg.status) - 1] = '\0';
+            cb(&msg, ctx);
             count++;
         }
         
@@ -1088,42 +1098,9 @@ static void add_webhook_log(const char *sender, const char *request, const char
     printf("[SMS] Webhook日志已添加, ID=%d, 结果=%d\n", g_webhook_log_id, result);
 }
 
-/* JSON字符串转义工具 */
-static void json_escape(char *dest, const char *src, size_t dest_size) {
-    if (!dest || !src || dest_size == 0) return;
-    
-    size_t i = 0, j = 0;
-    while (src[i] && j < dest_size - 1) {
-        unsigned char c = (unsigned char)src[i];
-        if (c == '"') {
-            if (j + 2 < dest_size) { dest[j++] = '\\'; dest[j++] = '"'; } else break;
-        } else if (c == '\\') {
-            if (j + 2 < dest_size) { dest[j++] = '\\'; dest[j++] = '\\'; } else break;
-        } else if (c == '\b') {
-            if (j + 2 < dest_size) { dest[j++] = '\\'; dest[j++] = 'b'; } else break;
-        } else if (c == '\f') {
-            if (j + 2 < dest_size) { dest[j++] = '\\'; dest[j++] = 'f'; } else break;
-        } else if (c == '\n') {
-            if (j + 2 < dest_size) { dest[j++] = '\\'; dest[j++] = 'n'; } else break;
-        } else if (c == '\r') {
-            if (j + 2 < dest_size) { dest[j++] = '\\'; dest[j++] = 'r'; } else break;
-        } else if (c == '\t') {
-            if (j + 2 < dest_size) { dest[j++] = '\\'; dest[j++] = 't'; } else break;
-        } else if (c < 32) {
-            if (j + 6 < dest_size) {
-                j += snprintf(dest + j, 7, "\\u%04x", c);
-            } else break;
-        } else {
-            dest[j++] = c;
-        }
-        i++;
-    }
-    dest[j] = '\0';
-}
-
-/* 获取Webhook发送日志 */
-int sms_get_webhook_logs(char *json_output, size_t size, int max_count) {
-    if (!json_output || size == 0) {
+/* 遍历Webhook发送日志 (从最新的开始) */
+int sms_foreach_webhook_log(int max_count, SmsWebhookLogCallback cb, void *ctx) {
+    if (!cb) {
         return -1;
     }
     
@@ -1133,14 +1110,9 @@ int sms_get_webhook_logs(char *json_output, size_t size, int max_count) {
     
     pthread_mutex_lock(&g_webhook_log_mutex);
     
-    int offset = 0;
-    offset += snprintf(json_output + offset, size - offset, "[");
-    
     int count = (g_webhook_log_count < max_count) ? g_webhook_log_count : max_count;
-    int first = 1;
     
-    /* 从最新的日志开始输出 */
-    for (int i = 0; i < count && offset < (int)size - 10; i++) {
+    for (int i = 0; i < count; i++) {
         int idx;
         if (g_webhook_log_count <= MAX_WEBHOOK_LOGS) {
             idx = g_webhook_log_count - 1 - i;
@@ -1149,30 +1121,9 @@ int sms_get_webhook_logs(char *json_output, size_t size, int max_count) {
         }
         
         if (idx < 0) break;
-        
-        if (!first) offset += snprintf(json_output + offset, size - offset, ",");
-        first = 0;
-        
-        char escaped_req[3072] = "";
-        char escaped_resp[3072] = "";
-        
-        json_escape(escaped_req, g_webhook_logs[idx].request, sizeof(escaped_req));
-        json_escape(escaped_resp, g_webhook_logs[idx].response, sizeof(escaped_resp));
-        
-        offset += snprintf(json_output + offset, size - offset,
-            "{\"id\":%d,\"sender\":\"%s\",\"request\":\"%s\",\"response\":\"%s\",\"result\":%d,\"created_at\":%ld}",
-            g_webhook_logs[idx].id,
-            g_webhook_logs[idx].sender,
-            escaped_req,
-            escaped_resp,
-            g_webhook_logs[idx].result,
-            (long)g_webhook_logs[idx].created_at);
-            
-        if (offset >= (int)size - 10) break;
+        cb(&g_webhook_logs[idx], ctx);
     }
     
-    offset += snprintf(json_output + offset, size - offset, "]");
-    
     pthread_mutex_unlock(&g_webhook_log_mutex);
     
     return 0;
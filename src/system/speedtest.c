@@ -0,0 +1,604 @@
+/**
+ * @file speedtest.c
+ * @brief 设备端吞吐量测速实现
+ */
+
+#include "speedtest.h"
+#include "bandscan.h"
+#include "database.h"
+#include "feature.h"
+#include "http_utils.h"
+#include "json_builder.h"
+#include "log.h"
+#include "metrics.h"
+#include "radiocfg.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+/* 单个方向允许的失败连接数 (未收发任何数据即关闭) = 流数 × 该值，用尽后提前结束 */
+#define SPEEDTEST_MAX_FAILURES 4
+
+/* 配置 */
+typedef struct {
+    char download_url[256];
+    char upload_url[256];
+    int streams;
+    int warmup_sec;
+    int duration_sec;
+} SpeedTestConfig;
+
+enum { DIR_DOWNLOAD, DIR_UPLOAD, DIR_COUNT };
+
+static const char *const DIR_NAMES[DIR_COUNT] = {"download", "upload"};
+
+/* 单条流 */
+typedef struct {
+    struct mg_connection *c;
+    int header_done;            /* 下载: 响应头已跳过 */
+    size_t header_skip;         /* 上传: 尚未扣除的请求头字节 */
+    uint64_t remaining;         /* 上传: 尚未放入发送缓冲区的请求体字节 */
+    uint64_t bytes;             /* 本条连接计入的字节 */
+} SpeedStream;
+
+/* 单个方向的结果 */
+typedef struct {
+    int ran;
+    double mbps;                /* 稳态窗口吞吐 */
+    uint64_t bytes;             /* 整个阶段的字节数 (含预热) */
+    uint64_t window_bytes;
+    double window_sec;
+    double cpu_pct;             /* 窗口内进程 CPU 占用 (100% = 一个核) */
+    double cpu_us_per_mb;       /* 每 MB 数据消耗的 CPU 时间 (微秒) */
+    int connects;
+    int errors;
+    char error[96];
+    float samples[SPEEDTEST_MAX_SAMPLES];   /* 逐段速率 (Mbps) */
+    int sample_count;
+} SpeedResult;
+
+static struct {
+    SpeedTestConfig cfg;
+    struct mg_mgr *mgr;
+    int running;
+    const char *state;          /* idle / running / done / failed / cancelled */
+    int run_dir[DIR_COUNT];     /* 本次测速包含的方向 */
+    int dir;                    /* 当前方向 */
+    time_t started;
+    time_t finished;
+    SpeedStream streams[SPEEDTEST_MAX_STREAMS];
+    uint64_t bytes;             /* 当前方向累计字节 */
+    int failures;               /* 当前方向的失败连接数 */
+    uint64_t window_at_us;      /* 预热结束 (计划) */
+    uint64_t end_at_us;         /* 窗口结束 (计划) */
+    int window_open;
+    uint64_t window_us;         /* 窗口实际开始时间 */
+    uint64_t window_bytes0;
+    uint64_t window_cpu0;
+    uint64_t sample_us;
+    uint64_t sample_bytes;
+    SpeedResult result[DIR_COUNT];
+} g_st = {.state = "idle"};
+
+static const SpeedTestConfig SPEEDTEST_DEFAULTS = {
+    .download_url = "",
+    .upload_url = "",
+    .streams = 4,
+    .warmup_sec = 2,
+    .duration_sec = 10,
+};
+
+/* 后台线程的下行测速请求 (speedtest_probe_download)，由 speedtest_poll 在空闲时接手 */
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    char url[256];
+    int seconds;
+    int pending;                /* 等待事件循环开始 */
+    int active;                 /* 当前测速由该请求发起 */
+    int done;
+    double kbps;
+    SpeedTestConfig saved;      /* 测速结束后恢复的配置 */
+} g_probe = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+
+/* 上传内容: 随机字节，避免被链路压缩 */
+static uint8_t g_payload[16 * 1024];
+static int g_payload_ready;
+
+/* ==================== 配置存储 ==================== */
+
+static void load_config(SpeedTestConfig *cfg) {
+    const SpeedTestConfig *d = &SPEEDTEST_DEFAULTS;
+    if (config_get("speedtest_download_url", cfg->download_url, sizeof(cfg->download_url)) != 0)
+        strcpy(cfg->download_url, d->download_url);
+    if (config_get("speedtest_upload_url", cfg->upload_url, sizeof(cfg->upload_url)) != 0)
+        strcpy(cfg->upload_url, d->upload_url);
+    cfg->streams = config_get_int("speedtest_streams", d->streams);
+    cfg->warmup_sec = config_get_int("speedtest_warmup_sec", d->warmup_sec);
+    cfg->duration_sec = config_get_int("speedtest_duration_sec", d->duration_sec);
+}
+
+static void save_config(const SpeedTestConfig *cfg) {
+    config_set("speedtest_download_url", cfg->download_url);
+    config_set("speedtest_upload_url", cfg->upload_url);
+    config_set_int("speedtest_streams", cfg->streams);
+    config_set_int("speedtest_warmup_sec", cfg->warmup_sec);
+    config_set_int("speedtest_duration_sec", cfg->duration_sec);
+}
+
+/* ==================== 流 ==================== */
+
+static uint64_t cpu_time_us(void) {
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+    return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000 +
+           (uint64_t)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+}
+
+static const char *dir_url(int dir) {
+    return dir == DIR_DOWNLOAD ? g_st.cfg.download_url : g_st.cfg.upload_url;
+}
+
+static void count_bytes(SpeedStream *s, uint64_t n) {
+    s->bytes += n;
+    g_st.bytes += n;
+    g_st.result[g_st.dir].bytes += n;
+}
+
+static void stream_error(const char *msg) {
+    SpeedResult *r = &g_st.result[g_st.dir];
+    r->errors++;
+    snprintf(r->error, sizeof(r->error), "%s", msg);
+}
+
+/* 上传: 发送缓冲区低于一次写入量时补充请求体 */
+static void upload_fill(struct mg_connection *c, SpeedStream *s) {
+    while (s->remaining > 0 && c->send.len < SPEEDTEST_IO_SIZE) {
+        size_t n = s->remaining < sizeof(g_payload) ? (size_t)s->remaining : sizeof(g_payload);
+        if (!mg_send(c, g_payload, n)) break;
+        s->remaining -= n;
+    }
+}
+
+static void send_request(struct mg_connection *c, SpeedStream *s) {
+    const char *url = dir_url(g_st.dir);
+    struct mg_str host = mg_url_host(url);
+
+    if (g_st.dir == DIR_DOWNLOAD) {
+        mg_printf(c, "GET %s HTTP/1.1\r\nHost: %.*s\r\nAccept-Encoding: identity\r\nConnection: close\r\n\r\n",
+                  mg_url_uri(url), (int)host.len, host.buf);
+        return;
+    }
+
+    size_t before = c->send.len;
+    mg_printf(c, "POST %s HTTP/1.1\r\nHost: %.*s\r\nContent-Type: application/octet-stream\r\n"
+                 "Content-Length: %llu\r\nConnection: close\r\n\r\n",
+              mg_url_uri(url), (int)host.len, host.buf, (unsigned long long)SPEEDTEST_UPLOAD_BYTES);
+    s->header_skip = c->send.len - before;
+    s->remaining = SPEEDTEST_UPLOAD_BYTES;
+    upload_fill(c, s);
+}
+
+/* 下载: 跳过响应头并检查状态码，随后只计响应体 */
+static void download_read(struct mg_connection *c, SpeedStream *s) {
+    size_t body = c->recv.len;
+    if (!s->header_done) {
+        int hl = mg_http_get_request_len(c->recv.buf, c->recv.len);
+        if (hl == 0 && c->recv.len < 8192) return;     /* 响应头未收全 */
+        struct mg_http_message hm;
+        int status = hl > 0 && mg_http_parse((char *)c->recv.buf, c->recv.len, &hm) > 0 ? mg_http_status(&hm) : 0;
+        if (status < 200 || status > 299) {
+            char msg[48];
+            snprintf(msg, sizeof(msg), status ? "HTTP %d" : "无效的 HTTP 响应", status);
+            stream_error(msg);
+            c->recv.len = 0;
+            c->is_closing = 1;
+            return;
+        }
+        s->header_done = 1;
+        body -= (size_t)hl;
+    }
+    count_bytes(s, body);
+    c->recv.len = 0;
+}
+
+static void stream_fn(struct mg_connection *c, int ev, void *ev_data) {
+    SpeedStream *s = (SpeedStream *)c->fn_data;
+
+    /* 已结束的阶段留下的连接: 丢弃数据，等待关闭 */
+    if (s->c != c) {
+        if (ev == MG_EV_READ) c->recv.len = 0;
+        return;
+    }
+
+    switch (ev) {
+    case MG_EV_CONNECT:
+        if (mg_url_is_ssl(dir_url(g_st.dir))) {
+            /* 只用于测量吞吐，不传输敏感数据，设备上没有 CA 证书库，不校验证书 */
+            struct mg_tls_opts opts;
+            memset(&opts, 0, sizeof(opts));
+            opts.skip_verification = 1;
+            mg_tls_init(c, &opts);
+        }
+        /* 一次读满 SPEEDTEST_IO_SIZE，读出后立即丢弃，缓冲区不再增长 */
+        mg_iobuf_resize(&c->recv, SPEEDTEST_IO_SIZE);
+        send_request(c, s);
+        break;
+    case MG_EV_READ:
+        if (g_st.dir == DIR_DOWNLOAD) {
+            download_read(c, s);
+        } else {
+            c->recv.len = 0;
+        }
+        break;
+    case MG_EV_WRITE:
+        if (g_st.dir == DIR_UPLOAD) {
+            size_t n = (size_t)*(long *)ev_data;
+            size_t skip = n < s->header_skip ? n : s->header_skip;
+            s->header_skip -= skip;
+            count_bytes(s, n - skip);
+            upload_fill(c, s);
+        }
+        break;
+    case MG_EV_ERROR:
+        stream_error((const char *)ev_data);
+        break;
+    case MG_EV_CLOSE:
+        if (s->bytes == 0) g_st.failures++;
+        s->c = NULL;
+        break;
+    default:
+        break;
+    }
+}
+
+static void open_stream(SpeedStream *s) {
+    SpeedResult *r = &g_st.result[g_st.dir];
+    memset(s, 0, sizeof(*s));
+    r->connects++;
+    s->c = mg_connect(g_st.mgr, dir_url(g_st.dir), stream_fn, s);
+    if (!s->c) {
+        stream_error("创建连接失败");
+        g_st.failures++;
+    }
+}
+
+static void close_streams(void) {
+    for (int i = 0; i < SPEEDTEST_MAX_STREAMS; i++) {
+        if (g_st.streams[i].c) g_st.streams[i].c->is_closing = 1;
+        g_st.streams[i].c = NULL;
+    }
+}
+
+/* ==================== 状态机 ==================== */
+
+static void start_dir(int dir) {
+    uint64_t now = metrics_now_us();
+    SpeedResult *r = &g_st.result[dir];
+
+    memset(r, 0, sizeof(*r));
+    r->ran = 1;
+    g_st.dir = dir;
+    g_st.bytes = 0;
+    g_st.failures = 0;
+    g_st.window_open = 0;
+    g_st.window_at_us = now + (uint64_t)g_st.cfg.warmup_sec * 1000000;
+    g_st.end_at_us = g_st.window_at_us + (uint64_t)g_st.cfg.duration_sec * 1000000;
+    for (int i = 0; i < g_st.cfg.streams; i++) open_stream(&g_st.streams[i]);
+}
+
+static void finish(const char *state) {
+    close_streams();
+    g_st.running = 0;
+    g_st.state = state;
+    g_st.finished = time(NULL);
+
+    pthread_mutex_lock(&g_probe.lock);
+    if (g_probe.active) {
+        const SpeedResult *r = &g_st.result[DIR_DOWNLOAD];
+        g_probe.kbps = strcmp(state, "cancelled") != 0 && r->window_bytes > 0 ? r->mbps * 1000 : -1;
+        g_probe.active = 0;
+        g_probe.done = 1;
+        g_st.cfg = g_probe.saved;
+        pthread_cond_broadcast(&g_probe.cond);
+    }
+    pthread_mutex_unlock(&g_probe.lock);
+}
+
+/* 下一个要执行的方向，没有则返回 -1 */
+static int next_dir(int after) {
+    for (int d = after + 1; d < DIR_COUNT; d++) {
+        if (g_st.run_dir[d]) return d;
+    }
+    return -1;
+}
+
+static void finish_dir(uint64_t now) {
+    SpeedResult *r = &g_st.result[g_st.dir];
+    close_streams();
+
+    if (g_st.window_open && now > g_st.window_us) {
+        r->window_sec = (double)(now - g_st.window_us) / 1e6;
+        r->window_bytes = g_st.bytes - g_st.window_bytes0;
+        r->mbps = (double)r->window_bytes * 8 / r->window_sec / 1e6;
+        if (r->window_bytes > 0) {
+            uint64_t cpu = cpu_time_us() - g_st.window_cpu0;
+            r->cpu_pct = (double)cpu / (double)(now - g_st.window_us) * 100;
+            r->cpu_us_per_mb = (double)cpu / ((double)r->window_bytes / 1e6);
+        }
+    }
+    if (r->window_bytes == 0 && !r->error[0]) snprintf(r->error, sizeof(r->error), "稳态窗口内没有数据");
+    LOG_I("测速: %s %.2f Mbps (窗口 %.1fs, %llu 字节, CPU %.1f%%, 连接 %d 次, 错误 %d)",
+          DIR_NAMES[g_st.dir], r->mbps, r->window_sec, (unsigned long long)r->window_bytes, r->cpu_pct,
+          r->connects, r->errors);
+
+    int next = next_dir(g_st.dir);
+    if (next >= 0) {
+        start_dir(next);
+        return;
+    }
+
+    int ok = 0;
+    for (int d = 0; d < DIR_COUNT; d++) {
+        if (g_st.run_dir[d] && g_st.result[d].window_bytes > 0) ok = 1;
+    }
+    finish(ok ? "done" : "failed");
+}
+
+static void start_run(struct mg_mgr *mgr, const int run_dir[DIR_COUNT]) {
+    memset(g_st.result, 0, sizeof(g_st.result));
+    memcpy(g_st.run_dir, run_dir, sizeof(g_st.run_dir));
+    g_st.mgr = mgr;
+    g_st.running = 1;
+    g_st.state = "running";
+    g_st.started = time(NULL);
+    g_st.finished = 0;
+    start_dir(next_dir(-1));
+}
+
+/* 空闲时接手后台线程的下行测速请求，沿用已保存的流数和预热时长 */
+static void probe_poll(struct mg_mgr *mgr) {
+    pthread_mutex_lock(&g_probe.lock);
+    if (g_probe.pending) {
+        static const int run_dir[DIR_COUNT] = {[DIR_DOWNLOAD] = 1};
+        g_probe.pending = 0;
+        g_probe.active = 1;
+        g_probe.saved = g_st.cfg;
+        snprintf(g_st.cfg.download_url, sizeof(g_st.cfg.download_url), "%s", g_probe.url);
+        g_st.cfg.duration_sec = g_probe.seconds;
+        LOG_I("测速: 开始 (后台下行, %d 条流, 预热 %ds, 窗口 %ds)", g_st.cfg.streams, g_st.cfg.warmup_sec,
+              g_st.cfg.duration_sec);
+        start_run(mgr, run_dir);
+    }
+    pthread_mutex_unlock(&g_probe.lock);
+}
+
+void speedtest_poll(struct mg_mgr *mgr) {
+    if (!g_st.running) {
+        probe_poll(mgr);
+        return;
+    }
+
+    uint64_t now = metrics_now_us();
+    SpeedResult *r = &g_st.result[g_st.dir];
+
+    if (!g_st.window_open && now >= g_st.window_at_us) {
+        g_st.window_open = 1;
+        g_st.window_us = now;
+        g_st.window_bytes0 = g_st.bytes;
+        g_st.window_cpu0 = cpu_time_us();
+        g_st.sample_us = now;
+        g_st.sample_bytes = g_st.bytes;
+    }
+
+    if (g_st.window_open && now - g_st.sample_us >= (uint64_t)SPEEDTEST_SAMPLE_MS * 1000) {
+        if (r->sample_count < SPEEDTEST_MAX_SAMPLES) {
+            r->samples[r->sample_count++] =
+                (float)((double)(g_st.bytes - g_st.sample_bytes) * 8 / (double)(now - g_st.sample_us));
+        }
+        g_st.sample_us = now;
+        g_st.sample_bytes = g_st.bytes;
+    }
+
+    if (now >= g_st.end_at_us) {
+        finish_dir(now);
+        return;
+    }
+
+    /* 服务器发送完有限大小的响应或提前关闭时重连，保持并行流数量 */
+    int active = 0;
+    for (int i = 0; i < g_st.cfg.streams; i++) {
+        if (!g_st.streams[i].c && g_st.failures < g_st.cfg.streams * SPEEDTEST_MAX_FAILURES) {
+            open_stream(&g_st.streams[i]);
+        }
+        if (g_st.streams[i].c) active++;
+    }
+    if (active == 0) {
+        /* 失败次数用尽，提前结束该方向 */
+        finish_dir(now);
+    }
+}
+
+/* ==================== API ==================== */
+
+int speedtest_init(void) {
+    load_config(&g_st.cfg);
+    return 0;
+}
+
+int speedtest_running(void) { return g_st.running; }
+
+static void add_result_json(JsonBuilder *j, int dir) {
+    const SpeedResult *r = &g_st.result[dir];
+    if (!r->ran) {
+        json_add_null(j, DIR_NAMES[dir]);
+        return;
+    }
+
+    json_key_obj_open(j, DIR_NAMES[dir]);
+    json_add_bool(j, "active", g_st.running && g_st.dir == dir);
+    json_add_double(j, "mbps", r->mbps);
+    json_add_long(j, "bytes", (long long)r->bytes);
+    json_add_long(j, "window_bytes", (long long)r->window_bytes);
+    json_add_double(j, "window_sec", r->window_sec);
+    json_add_double(j, "cpu_pct", r->cpu_pct);
+    json_add_double(j, "cpu_us_per_mb", r->cpu_us_per_mb);
+    json_add_int(j, "connects", r->connects);
+    json_add_int(j, "errors", r->errors);
+    json_add_str(j, "error", r->error);
+    json_arr_open(j, "samples");
+    for (int i = 0; i < r->sample_count; i++) {
+        char buf[24];
+        snprintf(buf, sizeof(buf), "%.2f", r->samples[i]);
+        json_add_raw(j, NULL, buf);
+    }
+    json_arr_close(j);
+    json_obj_close(j);
+}
+
+void handle_speedtest_status(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    JsonBuilder *j = json_new();
+    json_obj_open(j);
+
+    json_key_obj_open(j, "config");
+    json_add_str(j, "download_url", g_st.cfg.download_url);
+    json_add_str(j, "upload_url", g_st.cfg.upload_url);
+    json_add_int(j, "streams", g_st.cfg.streams);
+    json_add_int(j, "warmup_sec", g_st.cfg.warmup_sec);
+    json_add_int(j, "duration_sec", g_st.cfg.duration_sec);
+    json_obj_close(j);
+
+    json_add_str(j, "state", g_st.state);
+    if (g_st.running) {
+        json_add_str(j, "phase", DIR_NAMES[g_st.dir]);
+        json_add_str(j, "stage", g_st.window_open ? "measure" : "warmup");
+    }
+    json_add_long(j, "started", (long long)g_st.started);
+    json_add_long(j, "finished", (long long)g_st.finished);
+    for (int d = 0; d < DIR_COUNT; d++) add_result_json(j, d);
+
+    json_obj_close(j);
+    HTTP_OK_FREE(c, json_finish(j));
+}
+
+const char *speedtest_check_url(const char *url) {
+    if (!url[0]) return NULL;
+    if (strncmp(url, "http://", 7) != 0 && strncmp(url, "https://", 8) != 0)
+        return "地址必须以 http:// 或 https:// 开头";
+    if (mg_url_host(url).len == 0) return "地址缺少主机名";
+    if (!FEATURE_TLS && mg_url_is_ssl(url)) return "当前版本未启用 HTTPS";
+    /* 地址经 sqlite3 命令行写入数据库，拒绝引号、shell 展开字符和控制字符 */
+    for (const char *p = url; *p; p++) {
+        if (strchr("'\"\\$`", *p) || (unsigned char)*p < 0x20) return "地址包含非法字符";
+    }
+    return NULL;
+}
+
+void handle_speedtest_start(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_POST(c, hm);
+
+    bool cancel = false;
+    if (mg_json_get_bool(hm->body, "$.cancel", &cancel) && cancel) {
+        if (!g_st.running) {
+            HTTP_ERROR(c, 409, "没有进行中的测速");
+            return;
+        }
+        finish("cancelled");
+        LOG_I("测速: 已取消");
+        HTTP_SUCCESS(c, "测速已取消");
+        return;
+    }
+
+    if (g_st.running) {
+        HTTP_ERROR(c, 409, "测速进行中");
+        return;
+    }
+    if (bandscan_running() || radiocfg_running()) {
+        HTTP_ERROR(c, 409, "射频配置或频段扫描进行中");
+        return;
+    }
+
+    SpeedTestConfig cfg = g_st.cfg;
+    char url[sizeof(cfg.download_url)];
+    if (http_json_get_str(hm->body, "$.download_url", url, sizeof(url))) strcpy(cfg.download_url, url);
+    if (http_json_get_str(hm->body, "$.upload_url", url, sizeof(url))) strcpy(cfg.upload_url, url);
+    cfg.streams = (int)mg_json_get_long(hm->body, "$.streams", cfg.streams);
+    cfg.warmup_sec = (int)mg_json_get_long(hm->body, "$.warmup_sec", cfg.warmup_sec);
+    cfg.duration_sec = (int)mg_json_get_long(hm->body, "$.duration_sec", cfg.duration_sec);
+
+    char direction[16] = "both";
+    http_json_get_str(hm->body, "$.direction", direction, sizeof(direction));
+    int run_dir[DIR_COUNT] = {0};
+    if (strcmp(direction, "both") == 0 || strcmp(direction, "download") == 0) run_dir[DIR_DOWNLOAD] = 1;
+    if (strcmp(direction, "both") == 0 || strcmp(direction, "upload") == 0) run_dir[DIR_UPLOAD] = 1;
+    if (!run_dir[DIR_DOWNLOAD] && !run_dir[DIR_UPLOAD]) {
+        HTTP_ERROR(c, 400, "direction 必须为 both、download 或 upload");
+        return;
+    }
+
+    const char *msg = speedtest_check_url(cfg.download_url);
+    if (!msg) msg = speedtest_check_url(cfg.upload_url);
+    if (!msg && run_dir[DIR_DOWNLOAD] && !cfg.download_url[0]) msg = "未配置 download_url";
+    if (!msg && run_dir[DIR_UPLOAD] && !cfg.upload_url[0]) msg = "未配置 upload_url";
+    if (!msg && (cfg.streams < 1 || cfg.streams > SPEEDTEST_MAX_STREAMS || cfg.warmup_sec < 0 ||
+                 cfg.warmup_sec > 30 || cfg.duration_sec < 1 || cfg.duration_sec > SPEEDTEST_MAX_DURATION))
+        msg = "参数无效";
+    if (msg) {
+        HTTP_ERROR(c, 400, msg);
+        return;
+    }
+
+    if (!g_payload_ready) {
+        uint32_t x = 2463534242u;
+        for (size_t i = 0; i < sizeof(g_payload); i++) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            g_payload[i] = (uint8_t)x;
+        }
+        g_payload_ready = 1;
+    }
+
+    g_st.cfg = cfg;
+    save_config(&cfg);
+    LOG_I("测速: 开始 (%s, %d 条流, 预热 %ds, 窗口 %ds)", direction, cfg.streams, cfg.warmup_sec,
+          cfg.duration_sec);
+    start_run(c->mgr, run_dir);
+
+    HTTP_SUCCESS(c, "测速已开始");
+}
+
+double speedtest_probe_download(const char *url, int seconds) {
+    double kbps = -1;
+
+    pthread_mutex_lock(&g_probe.lock);
+    if (g_probe.pending || g_probe.active) {
+        pthread_mutex_unlock(&g_probe.lock);
+        return -1;
+    }
+    snprintf(g_probe.url, sizeof(g_probe.url), "%s", url);
+    g_probe.seconds = seconds;
+    g_probe.pending = 1;
+    g_probe.done = 0;
+
+    /* 预热不超过 30 秒，再留出等待手动测速结束和连接收尾的余量 */
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += seconds + 30 + SPEEDTEST_PROBE_SLACK_SEC;
+    while (!g_probe.done) {
+        if (pthread_cond_timedwait(&g_probe.cond, &g_probe.lock, &deadline) != 0) break;
+    }
+    if (g_probe.done) {
+        kbps = g_probe.kbps;
+    } else if (g_probe.pending) {
+        /* 一直未轮到 (手动测速占用)，撤回请求 */
+        g_probe.pending = 0;
+    }
+    pthread_mutex_unlock(&g_probe.lock);
+    return kbps;
+}
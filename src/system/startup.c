@@ -0,0 +1,207 @@
+/**
+ * @file startup.c
+ * @brief 启动阶段计时与并行模块初始化实现
+ */
+
+#include "startup.h"
+#include "feature.h"
+#include "http_utils.h"
+#include "json_builder.h"
+#include "log.h"
+#include "metrics.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 单个步骤的计时记录 */
+typedef struct {
+    const char *group;
+    const char *name;
+    uint64_t start_us;          /* 相对进程启动 */
+    uint64_t dur_us;
+    int ret;
+    int done;
+} StartupPhase;
+
+static StartupPhase g_phases[STARTUP_MAX_PHASES];
+static int g_phase_count = 0;
+static pthread_mutex_t g_phase_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t g_t0_us = 0;            /* 进程启动 (单调时钟) */
+static uint64_t g_ready_us = 0;         /* 就绪时间 (相对进程启动) */
+static atomic_int g_pending = 0;        /* 未完成的非后台组数 */
+static atomic_int g_started = 0;        /* 是否已调用 startup_run_groups */
+
+void startup_init(void) {
+    g_t0_us = metrics_now_us();
+}
+
+static uint64_t since_start_us(void) {
+    return metrics_now_us() - g_t0_us;
+}
+
+static int phase_begin(const char *group, const char *name) {
+    pthread_mutex_lock(&g_phase_lock);
+    int idx = g_phase_count < STARTUP_MAX_PHASES ? g_phase_count++ : -1;
+    if (idx >= 0) {
+        g_phases[idx].group = group;
+        g_phases[idx].name = name;
+        g_phases[idx].start_us = since_start_us();
+        g_phases[idx].dur_us = 0;
+        g_phases[idx].ret = 0;
+        g_phases[idx].done = 0;
+    }
+    pthread_mutex_unlock(&g_phase_lock);
+    return idx;
+}
+
+static void phase_end(int idx, int ret) {
+    if (idx < 0) return;
+    pthread_mutex_lock(&g_phase_lock);
+    StartupPhase *p = &g_phases[idx];
+    p->dur_us = since_start_us() - p->start_us;
+    p->ret = ret;
+    p->done = 1;
+    uint64_t dur_us = p->dur_us;
+    pthread_mutex_unlock(&g_phase_lock);
+
+    if (ret != 0) {
+        LOG_W("%s/%s 初始化失败 (%.1f ms)", p->group, p->name, dur_us / 1000.0);
+    } else {
+        LOG_I("%s/%s 初始化完成 (%.1f ms)", p->group, p->name, dur_us / 1000.0);
+    }
+}
+
+int startup_run_step(const char *group, const StartupStep *step) {
+    if (!step || !step->fn) return -1;
+    int idx = phase_begin(group, step->name);
+    int ret = step->fn();
+    phase_end(idx, ret);
+    return ret;
+}
+
+void startup_mark(const char *name) {
+    int idx = phase_begin("main", name);
+    if (idx < 0) return;
+    pthread_mutex_lock(&g_phase_lock);
+    uint64_t at_us = g_phases[idx].start_us;
+    g_phases[idx].dur_us = at_us;
+    g_phases[idx].start_us = 0;
+    g_phases[idx].done = 1;
+    pthread_mutex_unlock(&g_phase_lock);
+    LOG_I("启动 %.1f ms 后: %s", at_us / 1000.0, name);
+}
+
+static void run_group(const StartupGroup *g) {
+    for (int i = 0; i < g->count; i++) {
+        startup_run_step(g->name, &g->steps[i]);
+    }
+    if (!g->background && atomic_fetch_sub(&g_pending, 1) == 1) {
+        g_ready_us = since_start_us();
+        LOG_I("所有模块初始化完成，启动耗时 %.1f ms", g_ready_us / 1000.0);
+    }
+}
+
+static void *group_thread(void *arg) {
+    run_group((const StartupGroup *)arg);
+    return NULL;
+}
+
+int startup_run_groups(const StartupGroup *groups, int count) {
+    int pending = 0;
+    for (int i = 0; i < count; i++) {
+        if (!groups[i].background) pending++;
+    }
+    atomic_store(&g_pending, pending);
+    atomic_store(&g_started, 1);
+    if (pending == 0) g_ready_us = since_start_us();
+
+    int rc = 0;
+    for (int i = 0; i < count; i++) {
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, group_thread, (void *)&groups[i]) != 0) {
+            LOG_W("创建初始化线程失败，同步执行: %s", groups[i].name);
+            run_group(&groups[i]);
+            rc = -1;
+            continue;
+        }
+        pthread_detach(tid);
+    }
+    return rc;
+}
+
+int startup_ready(void) {
+    return atomic_load(&g_started) && atomic_load(&g_pending) == 0;
+}
+
+/* ==================== HTTP API ==================== */
+
+/* 当前进程常驻内存 (KB)，读取失败返回-1 */
+static long process_rss_kb(void) {
+    FILE *fp = fopen("/proc/self/status", "r");
+    if (!fp) return -1;
+    char line[128];
+    long kb = -1;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "VmRSS: %ld", &kb) == 1) break;
+    }
+    fclose(fp);
+    return kb;
+}
+
+/**
+ * GET /api/startup - 启动状态及各初始化步骤耗时 (无需认证，供前端轮询就绪状态)
+ */
+void handle_startup(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    int ready = startup_ready();
+
+    JsonBuilder *j = json_new();
+    json_obj_open(j);
+    json_add_str(j, "status", ready ? "ready" : "warming_up");
+    json_add_double(j, "uptime_ms", since_start_us() / 1000.0);
+    if (ready) {
+        json_add_double(j, "ready_ms", g_ready_us / 1000.0);
+    } else {
+        json_add_null(j, "ready_ms");
+    }
+    json_add_str(j, "profile", FEATURE_PROFILE);
+    json_add_long(j, "rss_kb", process_rss_kb());
+
+    json_key_obj_open(j, "features");
+    json_add_bool(j, "rathole", FEATURE_RATHOLE);
+    json_add_bool(j, "ipv6_proxy", FEATURE_IPV6_PROXY);
+    json_add_bool(j, "phone_case", FEATURE_PHONE_CASE);
+    json_add_bool(j, "plugin", FEATURE_PLUGIN);
+    json_add_bool(j, "usb_mode", FEATURE_USB_MODE);
+    json_add_bool(j, "update", FEATURE_UPDATE);
+    json_add_bool(j, "tls", FEATURE_TLS);
+    json_obj_close(j);
+
+    json_arr_open(j, "phases");
+
+    pthread_mutex_lock(&g_phase_lock);
+    for (int i = 0; i < g_phase_count; i++) {
+        const StartupPhase *p = &g_phases[i];
+        json_arr_obj_open(j);
+        json_add_str(j, "group", p->group);
+        json_add_str(j, "name", p->name);
+        json_add_double(j, "start_ms", p->start_us / 1000.0);
+        if (p->done) {
+            json_add_double(j, "duration_ms", p->dur_us / 1000.0);
+            json_add_bool(j, "ok", p->ret == 0);
+        } else {
+            json_add_null(j, "duration_ms");
+            json_add_str(j, "state", "running");
+        }
+        json_obj_close(j);
+    }
+    pthread_mutex_unlock(&g_phase_lock);
+
+    json_arr_close(j);
+    json_obj_close(j);
+    HTTP_OK_FREE(c, json_finish(j));
+}
@@ -3,6 +3,7 @@
  * @brief System information implementation (Go: system/sysinfo.go)
  */
 
+#include <dirent.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,6 +12,7 @@
 #include <glib.h>
 #include "sysinfo.h"
 #include "dbus_core.h"
+#include "dualsim.h"
 #include "exec_utils.h"
 #include "ofono.h"
 
@@ -73,6 +75,11 @@ int get_serial(char *serial, size_t size) {
 }
 
 int get_current_slot(char *slot, char *ril_path) {
+    /* 双卡缓存由 DataCard 信号维护，就绪后无需查询 oFono */
+    if (dualsim_get_active(slot, ril_path) == 0) {
+        return 0;
+    }
+
     strcpy(slot, "unknown");
     strcpy(ril_path, "unknown");
 
@@ -120,15 +127,30 @@ int get_signal_strength(char *strength, size_t size) {
 }
 
 double get_thermal_temp(void) {
-    char output[64];
-    if (run_command(output, sizeof(output), "sh", "-c",
-        "cat /sys/class/thermal/thermal_zone*/temp | awk '{sum+=$1} END {printf \"%.2f\", sum/NR/1000}'",
-        NULL) != 0) {
-        return -1;
+    /* 直接读取 sysfs，避免为 cat|awk 管道 fork 进程 */
+    DIR *dir = opendir("/sys/class/thermal");
+    if (!dir) return -1;
+
+    struct dirent *entry;
+    double sum = 0;
+    int count = 0;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "thermal_zone", 12) != 0) continue;
+
+        char path[300];
+        snprintf(path, sizeof(path), "/sys/class/thermal/%s/temp", entry->d_name);
+        FILE *f = fopen(path, "r");
+        if (!f) continue;
+        long milli;
+        if (fscanf(f, "%ld", &milli) == 1) {
+            sum += milli / 1000.0;
+            count++;
+        }
+        fclose(f);
     }
-    double temp;
-    if (sscanf(output, "%lf", &temp) == 1) return temp;
-    return -1;
+    closedir(dir);
+
+    return count > 0 ? sum / count : -1;
 }
 
 
@@ -213,13 +235,19 @@ int get_system_info(SystemInfo *info) {
     /* IMEI */
     get_imei(info->imei, sizeof(info->imei));
 
-    /* ICCID */
-    get_iccid(info->iccid, sizeof(info->iccid));
+    /* ICCID、IMSI 和运营商: 优先使用按卡槽缓存的 SIM 信息，缓存缺失时查询 AT */
+    DualSimSlot sim;
+    if (dualsim_get_slot(ril_path, &sim) == 0 && sim.iccid[0] && sim.imsi[0]) {
+        snprintf(info->iccid, sizeof(info->iccid), "%s", sim.iccid);
+        snprintf(info->imsi, sizeof(info->imsi), "%s", sim.imsi);
+        snprintf(info->carrier, sizeof(info->carrier), "%s", sim.carrier);
+    } else {
+        get_iccid(info->iccid, sizeof(info->iccid));
 
-    /* IMSI 和运营商 */
-    if (get_imsi(info->imsi, sizeof(info->imsi)) == 0) {
-        const char *carrier = get_carrier_from_imsi(info->imsi);
-        strncpy(info->carrier, carrier, sizeof(info->carrier) - 1);
+        if (get_imsi(info->imsi, sizeof(info->imsi)) == 0) {
+            const char *carrier = get_carrier_from_imsi(info->imsi);
+            strncpy(info->carrier, carrier, sizeof(info->carrier) - 1);
+        }
     }
 
     /* 飞行模式 */
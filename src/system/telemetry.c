@@ -0,0 +1,670 @@
+/**
+ * @file telemetry.c
+ * @brief 设备遥测缓存与 Prometheus/OpenMetrics 导出实现
+ */
+
+#include "telemetry.h"
+#include "auth.h"
+#include "charge.h"
+#include "database.h"
+#include "http_utils.h"
+#include "json_builder.h"
+#include "log.h"
+#include "metrics.h"
+#include "ofono.h"
+#include "sysinfo.h"
+#include "traffic.h"
+#include <glib.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sysinfo.h>
+#include <time.h>
+
+/* 网络接口计数器 */
+typedef struct {
+    char name[32];
+    unsigned long long rx_bytes;
+    unsigned long long tx_bytes;
+    double rx_rate;             /* 字节/秒 (与上次采样比较，首次为 0) */
+    double tx_rate;
+} IfaceCounters;
+
+/* 遥测缓存 */
+typedef struct {
+    /* 无线参数 */
+    ServingCell cell;
+    time_t radio_updated;       /* 0=从未更新 */
+    const char *radio_source;   /* 最近一次更新的来源，见 telemetry_source() */
+    char slot[16];
+    char modem_path[32];
+
+    /* 数据连接 */
+    int data_active;
+    time_t data_updated;
+    const char *data_source;
+
+    /* 系统 */
+    double cpu_usage;
+    double thermal_temp;
+    unsigned long total_ram;    /* MB */
+    unsigned long free_ram;     /* MB */
+    long uptime;
+    int battery_capacity;
+    int battery_charging;
+    IfaceCounters ifaces[TELEMETRY_MAX_IFACES];
+    int iface_count;
+    time_t system_updated;
+    const char *system_source;
+
+    /* 累计流量 (vnstat) */
+    long long traffic_rx;
+    long long traffic_tx;
+    time_t traffic_updated;
+    const char *traffic_source;
+
+    /* WAN 探测 (最近一轮) */
+    int wan_targets;
+    int wan_reachable;
+    double wan_rtt_ms;
+    double wan_jitter_ms;
+    double wan_loss_pct;
+    time_t wan_updated;
+    const char *wan_source;
+} TelemetryState;
+
+static TelemetryState g_state = {
+    .slot = "unknown",
+    .modem_path = "unknown",
+    .thermal_temp = -1,
+    .battery_capacity = -1,
+};
+static pthread_mutex_t g_state_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int g_radio_interval = TELEMETRY_RADIO_INTERVAL_DEFAULT;
+static int g_ticks_since_radio = 0;
+
+/* 无线参数刷新线程是否在运行 (同一时刻最多一个，受 g_state_lock 保护) */
+static int g_radio_running = 0;
+
+/* 系统采样的上次基线 (CPU、接口计数器)，定时器和 /api/dashboard 刷新共用 */
+static pthread_mutex_t g_sample_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long long g_cpu_prev_total = 0;
+static unsigned long long g_cpu_prev_idle = 0;
+static IfaceCounters g_iface_prev[TELEMETRY_MAX_IFACES];
+static int g_iface_prev_count = 0;
+static gint64 g_iface_prev_us = 0;
+
+/*
+ * 更新来源标签: 后台定时器 ("timer")、/api/dashboard 按 max_age 刷新 ("refresh")，
+ * 其余为模块在正常工作路径上发布 ("event"，如 /api/current_band、数据连接看门狗)
+ */
+static __thread const char *t_source = NULL;
+
+static const char *telemetry_source(void) {
+    return t_source ? t_source : "event";
+}
+
+/* ==================== 发布接口 ==================== */
+
+void telemetry_update_radio(const ServingCell *cell) {
+    if (!cell) return;
+    pthread_mutex_lock(&g_state_lock);
+    g_state.cell = *cell;
+    g_state.radio_updated = time(NULL);
+    g_state.radio_source = telemetry_source();
+    pthread_mutex_unlock(&g_state_lock);
+}
+
+void telemetry_update_data_state(int active) {
+    pthread_mutex_lock(&g_state_lock);
+    g_state.data_active = active ? 1 : 0;
+    g_state.data_updated = time(NULL);
+    g_state.data_source = telemetry_source();
+    pthread_mutex_unlock(&g_state_lock);
+}
+
+void telemetry_update_traffic(long long rx, long long tx) {
+    pthread_mutex_lock(&g_state_lock);
+    g_state.traffic_rx = rx;
+    g_state.traffic_tx = tx;
+    g_state.traffic_updated = time(NULL);
+    g_state.traffic_source = telemetry_source();
+    pthread_mutex_unlock(&g_state_lock);
+}
+
+void telemetry_update_wan(int targets, int reachable, double rtt_ms, double jitter_ms,
+                          double loss_pct) {
+    pthread_mutex_lock(&g_state_lock);
+    g_state.wan_targets = targets;
+    g_state.wan_reachable = reachable;
+    g_state.wan_rtt_ms = rtt_ms;
+    g_state.wan_jitter_ms = jitter_ms;
+    g_state.wan_loss_pct = loss_pct;
+    g_state.wan_updated = time(NULL);
+    g_state.wan_source = telemetry_source();
+    pthread_mutex_unlock(&g_state_lock);
+}
+
+void telemetry_update_modem(const char *slot, const char *modem_path) {
+    if (!modem_path || !*modem_path) return;
+    pthread_mutex_lock(&g_state_lock);
+    snprintf(g_state.modem_path, sizeof(g_state.modem_path), "%s", modem_path);
+    if (slot) {
+        snprintf(g_state.slot, sizeof(g_state.slot), "%s", slot);
+    } else if (strstr(modem_path, "/ril_0")) {
+        strcpy(g_state.slot, "slot1");
+    } else if (strstr(modem_path, "/ril_1")) {
+        strcpy(g_state.slot, "slot2");
+    }
+    pthread_mutex_unlock(&g_state_lock);
+}
+
+/* ==================== 后台采样 ==================== */
+
+/* 读取 /proc/stat 计算两次采样间的 CPU 使用率 */
+static double sample_cpu_usage(void) {
+    char buf[256];
+    unsigned long long v[8] = {0};
+
+    FILE *f = fopen("/proc/stat", "r");
+    if (!f) return 0;
+    char *line = fgets(buf, sizeof(buf), f);
+    fclose(f);
+    if (!line) return 0;
+
+    int n = sscanf(buf, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+                   &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]);
+    if (n < 4) return 0;
+
+    unsigned long long total = 0;
+    for (int i = 0; i < n; i++) total += v[i];
+    unsigned long long idle = v[3] + v[4]; /* idle + iowait */
+
+    double usage = 0;
+    if (g_cpu_prev_total > 0 && total > g_cpu_prev_total) {
+        unsigned long long dt = total - g_cpu_prev_total;
+        unsigned long long di = idle - g_cpu_prev_idle;
+        usage = 100.0 * (double)(dt - di) / (double)dt;
+    }
+    g_cpu_prev_total = total;
+    g_cpu_prev_idle = idle;
+    return usage;
+}
+
+/* 读取 /proc/net/dev 接口计数器 */
+static int sample_iface_counters(IfaceCounters *out, int max_count) {
+    char line[512];
+    int count = 0;
+
+    FILE *f = fopen("/proc/net/dev", "r");
+    if (!f) return 0;
+
+    while (fgets(line, sizeof(line), f) && count < max_count) {
+        char *colon = strchr(line, ':');
+        if (!colon) continue; /* 跳过表头 */
+        *colon = '\0';
+
+        char *name = line;
+        while (*name == ' ') name++;
+        if (strcmp(name, "lo") == 0) continue;
+
+        unsigned long long rx = 0, tx = 0, skip;
+        /* rx: bytes packets errs drop fifo frame compressed multicast; tx: bytes ... */
+        if (sscanf(colon + 1, "%llu %llu %llu %llu %llu %llu %llu %llu %llu",
+                   &rx, &skip, &skip, &skip, &skip, &skip, &skip, &skip, &tx) != 9) {
+            continue;
+        }
+        snprintf(out[count].name, sizeof(out[count].name), "%.31s", name);
+        out[count].rx_bytes = rx;
+        out[count].tx_bytes = tx;
+        count++;
+    }
+    fclose(f);
+    return count;
+}
+
+/* 按接口名与上次采样比较，计算收发速率 (调用者持有 g_sample_lock) */
+static void compute_iface_rates(IfaceCounters *ifaces, int count) {
+    gint64 now_us = g_get_monotonic_time();
+    double dt = g_iface_prev_us > 0 ? (double)(now_us - g_iface_prev_us) / 1e6 : 0;
+
+    for (int i = 0; i < count; i++) {
+        ifaces[i].rx_rate = 0;
+        ifaces[i].tx_rate = 0;
+        for (int k = 0; dt > 0 && k < g_iface_prev_count; k++) {
+            const IfaceCounters *p = &g_iface_prev[k];
+            if (strcmp(p->name, ifaces[i].name) != 0) continue;
+            if (ifaces[i].rx_bytes >= p->rx_bytes)
+                ifaces[i].rx_rate = (double)(ifaces[i].rx_bytes - p->rx_bytes) / dt;
+            if (ifaces[i].tx_bytes >= p->tx_bytes)
+                ifaces[i].tx_rate = (double)(ifaces[i].tx_bytes - p->tx_bytes) / dt;
+            break;
+        }
+    }
+    memcpy(g_iface_prev, ifaces, sizeof(IfaceCounters) * count);
+    g_iface_prev_count = count;
+    g_iface_prev_us = now_us;
+}
+
+/* 采样系统参数 (/proc、/sys，均为廉价来源) 并写入缓存 */
+static void refresh_system(void) {
+    IfaceCounters ifaces[TELEMETRY_MAX_IFACES];
+    struct sysinfo si;
+
+    pthread_mutex_lock(&g_sample_lock);
+    int iface_count = sample_iface_counters(ifaces, TELEMETRY_MAX_IFACES);
+    compute_iface_rates(ifaces, iface_count);
+    double cpu = sample_cpu_usage();
+    pthread_mutex_unlock(&g_sample_lock);
+
+    double temp = get_thermal_temp();
+    int capacity = -1, charging = 0;
+    charge_get_battery_status(&capacity, &charging);
+    if (sysinfo(&si) != 0) memset(&si, 0, sizeof(si));
+
+    pthread_mutex_lock(&g_state_lock);
+    memcpy(g_state.ifaces, ifaces, sizeof(IfaceCounters) * iface_count);
+    g_state.iface_count = iface_count;
+    g_state.cpu_usage = cpu;
+    g_state.thermal_temp = temp;
+    g_state.total_ram = (unsigned long)((unsigned long long)si.totalram * si.mem_unit / (1024 * 1024));
+    g_state.free_ram = (unsigned long)((unsigned long long)si.freeram * si.mem_unit / (1024 * 1024));
+    g_state.uptime = si.uptime;
+    g_state.battery_capacity = capacity;
+    g_state.battery_charging = charging;
+    g_state.system_updated = time(NULL);
+    g_state.system_source = telemetry_source();
+    pthread_mutex_unlock(&g_state_lock);
+}
+
+/* 刷新卡槽与数据连接状态 (D-Bus) */
+static void refresh_modem(void) {
+    char slot[16], ril_path[32];
+    if (get_current_slot(slot, ril_path) == 0 && strcmp(ril_path, "unknown") != 0) {
+        telemetry_update_modem(slot, ril_path);
+    }
+
+    int active = 0;
+    if (ofono_get_data_status(&active) == 0) {
+        telemetry_update_data_state(active);
+    }
+}
+
+/* 刷新无线参数 (AT + D-Bus，按 telemetry_radio_interval 限频) */
+static void refresh_radio(void) {
+    refresh_modem();
+
+    ServingCell cell;
+    advanced_get_serving_cell(&cell); /* 成功时内部发布到缓存 */
+}
+
+/* 后台刷新无线参数: AT/D-Bus 调用可能阻塞数秒，不占用主循环线程，结果经缓存发布 */
+static void *radio_thread(void *arg) {
+    (void)arg;
+    t_source = "timer";
+    refresh_radio();
+    t_source = NULL;
+
+    pthread_mutex_lock(&g_state_lock);
+    g_radio_running = 0;
+    pthread_mutex_unlock(&g_state_lock);
+    return NULL;
+}
+
+/* 启动刷新线程 (上一轮尚未结束时跳过) */
+static void start_radio_refresh(void) {
+    pthread_mutex_lock(&g_state_lock);
+    if (!g_radio_running) {
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, radio_thread, NULL) != 0) {
+            LOG_W("遥测: 创建无线参数刷新线程失败");
+        } else {
+            pthread_detach(tid);
+            g_radio_running = 1;
+        }
+    }
+    pthread_mutex_unlock(&g_state_lock);
+}
+
+static gboolean telemetry_tick(gpointer user_data) {
+    (void)user_data;
+
+    t_source = "timer";
+    refresh_system();
+
+    pthread_mutex_lock(&g_state_lock);
+    time_t radio_updated = g_state.radio_updated;
+    pthread_mutex_unlock(&g_state_lock);
+
+    /* 仅当最近没有其他路径 (如 /api/current_band) 更新过无线参数时才主动查询 */
+    if (g_radio_interval > 0) {
+        g_ticks_since_radio += TELEMETRY_TICK_SEC;
+        if (g_ticks_since_radio >= g_radio_interval) {
+            g_ticks_since_radio = 0;
+            if (radio_updated == 0 || time(NULL) - radio_updated >= g_radio_interval) {
+                start_radio_refresh();
+            }
+        }
+    }
+    t_source = NULL;
+
+    return G_SOURCE_CONTINUE;
+}
+
+void telemetry_init(void) {
+    g_radio_interval = config_get_int("telemetry_radio_interval",
+                                      TELEMETRY_RADIO_INTERVAL_DEFAULT);
+    if (g_radio_interval < 0) g_radio_interval = 0;
+
+    /* 首次采样立即执行，建立 CPU 基线；无线参数在第一个刷新周期获取 */
+    telemetry_tick(NULL);
+    g_timeout_add_seconds(TELEMETRY_TICK_SEC, telemetry_tick, NULL);
+    printf("[telemetry] 初始化完成，无线参数刷新间隔 %d 秒\n", g_radio_interval);
+}
+
+/* ==================== 导出 ==================== */
+
+static void metric_header(struct mg_iobuf *io, const char *name, const char *type,
+                          const char *help) {
+    metrics_appendf(io, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/* 转义标签值中的反斜杠、双引号和换行 (Prometheus/OpenMetrics 文本格式要求) */
+static const char *label_escape(char *out, size_t size, const char *in) {
+    size_t n = 0;
+    for (; in && *in && n + 2 < size; in++) {
+        char ch = *in;
+        if (ch == '\\' || ch == '"' || ch == '\n') {
+            out[n++] = '\\';
+            ch = ch == '\n' ? 'n' : ch;
+        }
+        out[n++] = ch;
+    }
+    out[n] = '\0';
+    return out;
+}
+
+static void render_metrics(struct mg_iobuf *io, const TelemetryState *s, int openmetrics) {
+    time_t now = time(NULL);
+    char labels[192], slot[40], modem[72], esc[72];
+    snprintf(labels, sizeof(labels), "slot=\"%s\",modem=\"%s\"",
+             label_escape(slot, sizeof(slot), s->slot),
+             label_escape(modem, sizeof(modem), s->modem_path));
+
+    if (s->radio_updated > 0) {
+        const char *rat = strncmp(s->cell.net_type, "5G", 2) == 0 ? "nr" : "lte";
+
+        /* OpenMetrics 使用 info 类型 (族名不带 _info 后缀)；Prometheus 文本格式按惯例为值恒为 1 的 gauge */
+        metric_header(io, openmetrics ? "ofono_radio" : "ofono_radio_info",
+                      openmetrics ? "info" : "gauge", "Serving cell identity.");
+        metrics_appendf(io, "ofono_radio_info{%s,rat=\"%s\",band=\"%s\",pci=\"%d\",arfcn=\"%d\"} 1\n",
+                        labels, rat, label_escape(esc, sizeof(esc), s->cell.band), s->cell.pci,
+                        s->cell.arfcn);
+        metric_header(io, "ofono_radio_rsrp_dbm", "gauge", "Serving cell RSRP.");
+        metrics_appendf(io, "ofono_radio_rsrp_dbm{%s} %.2f\n", labels, s->cell.rsrp);
+        metric_header(io, "ofono_radio_rsrq_db", "gauge", "Serving cell RSRQ.");
+        metrics_appendf(io, "ofono_radio_rsrq_db{%s} %.2f\n", labels, s->cell.rsrq);
+        metric_header(io, "ofono_radio_sinr_db", "gauge", "Serving cell SINR.");
+        metrics_appendf(io, "ofono_radio_sinr_db{%s} %.2f\n", labels, s->cell.sinr);
+        metric_header(io, "ofono_radio_sample_age_seconds", "gauge",
+                      "Seconds since the radio values were sampled.");
+        metrics_appendf(io, "ofono_radio_sample_age_seconds{%s} %ld\n", labels,
+                        (long)(now - s->radio_updated));
+    }
+
+    if (s->data_updated > 0) {
+        metric_header(io, "ofono_data_connected", "gauge", "Data context active (1) or not (0).");
+        metrics_appendf(io, "ofono_data_connected{%s} %d\n", labels, s->data_active);
+    }
+
+    if (s->iface_count > 0) {
+        /* OpenMetrics 的计数器族名不带 _total 后缀，样本名带 */
+        metric_header(io, openmetrics ? "ofono_net_receive_bytes" : "ofono_net_receive_bytes_total",
+                      "counter", "Interface bytes received.");
+        for (int i = 0; i < s->iface_count; i++) {
+            metrics_appendf(io, "ofono_net_receive_bytes_total{interface=\"%s\"} %llu\n",
+                            label_escape(esc, sizeof(esc), s->ifaces[i].name), s->ifaces[i].rx_bytes);
+        }
+        metric_header(io, openmetrics ? "ofono_net_transmit_bytes" : "ofono_net_transmit_bytes_total",
+                      "counter", "Interface bytes transmitted.");
+        for (int i = 0; i < s->iface_count; i++) {
+            metrics_appendf(io, "ofono_net_transmit_bytes_total{interface=\"%s\"} %llu\n",
+                            label_escape(esc, sizeof(esc), s->ifaces[i].name), s->ifaces[i].tx_bytes);
+        }
+    }
+
+    if (s->battery_capacity >= 0) {
+        metric_header(io, "ofono_battery_capacity_percent", "gauge", "Battery charge level.");
+        metrics_appendf(io, "ofono_battery_capacity_percent %d\n", s->battery_capacity);
+        metric_header(io, "ofono_battery_charging", "gauge", "Battery charging (1) or not (0).");
+        metrics_appendf(io, "ofono_battery_charging %d\n", s->battery_charging);
+    }
+
+    if (s->thermal_temp >= 0) {
+        metric_header(io, "ofono_thermal_celsius", "gauge", "Average thermal zone temperature.");
+        metrics_appendf(io, "ofono_thermal_celsius %.2f\n", s->thermal_temp);
+    }
+
+    if (s->system_updated > 0) {
+        metric_header(io, "ofono_cpu_usage_percent", "gauge", "CPU usage over the last sample period.");
+        metrics_appendf(io, "ofono_cpu_usage_percent %.2f\n", s->cpu_usage);
+    }
+
+    if (s->wan_updated > 0) {
+        metric_header(io, "ofono_wan_rtt_ms", "gauge", "Mean probe RTT of reachable targets, last round.");
+        metrics_appendf(io, "ofono_wan_rtt_ms %.3f\n", s->wan_rtt_ms);
+        metric_header(io, "ofono_wan_jitter_ms", "gauge", "Mean smoothed probe jitter of reachable targets.");
+        metrics_appendf(io, "ofono_wan_jitter_ms %.3f\n", s->wan_jitter_ms);
+        metric_header(io, "ofono_wan_loss_percent", "gauge", "Probe loss over all targets, last round.");
+        metrics_appendf(io, "ofono_wan_loss_percent %.2f\n", s->wan_loss_pct);
+        metric_header(io, "ofono_wan_reachable_targets", "gauge", "Targets that answered in the last round.");
+        metrics_appendf(io, "ofono_wan_reachable_targets %d\n", s->wan_reachable);
+    }
+
+    if (openmetrics) metrics_appendf(io, "# EOF\n");
+}
+
+/* Authorization: Bearer 携带的抓取令牌是否有效 (只比较内存副本，不访问数据库) */
+static int scrape_authorized(struct mg_http_message *hm) {
+    struct mg_str *auth = mg_http_get_header(hm, "Authorization");
+    char token[AUTH_TOKEN_SIZE];
+
+    if (!auth || auth->len <= 7 || strncmp(auth->buf, "Bearer ", 7) != 0) return 0;
+    if (auth->len - 7 >= sizeof(token)) return 0;
+    memcpy(token, auth->buf + 7, auth->len - 7);
+    token[auth->len - 7] = '\0';
+    return auth_verify_scrape_token(token) == 0;
+}
+
+/**
+ * GET /metrics (需抓取令牌: 标签含卡槽与服务小区标识)
+ * 只读内存缓存；Accept 含 application/openmetrics-text 时输出 OpenMetrics
+ */
+void handle_telemetry_metrics(struct mg_connection *c, struct mg_http_message *hm) {
+    if (hm->method.len != 3 || memcmp(hm->method.buf, "GET", 3) != 0) {
+        mg_http_reply(c, 405, "", "Method not allowed\n");
+        return;
+    }
+    if (!scrape_authorized(hm)) {
+        mg_http_reply(c, 401, "WWW-Authenticate: Bearer\r\n", "Unauthorized\n");
+        return;
+    }
+
+    struct mg_str *accept = mg_http_get_header(hm, "Accept");
+    int openmetrics = accept && mg_match(*accept, mg_str("#application/openmetrics-text#"), NULL);
+
+    TelemetryState snapshot;
+    pthread_mutex_lock(&g_state_lock);
+    snapshot = g_state;
+    pthread_mutex_unlock(&g_state_lock);
+
+    struct mg_iobuf io = {0};
+    mg_iobuf_init(&io, 2048, 512);
+    render_metrics(&io, &snapshot, openmetrics);
+    mg_http_reply(c, 200,
+                  openmetrics ? "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+                              : "Content-Type: text/plain; version=0.0.4\r\n",
+                  "%.*s", (int)io.len, io.len ? (char *)io.buf : "");
+    mg_iobuf_free(&io);
+}
+
+/* ==================== 仪表盘快照 ==================== */
+
+/*
+ * 数据段的新鲜度: source 为更新来源；
+ * 请求中输出 age (距上次更新的秒数，-1=从未更新)，
+ * 推送中输出 updated (更新时间戳，0=从未更新)，使未变化的数据段在增量中保持不变
+ */
+static void add_freshness(JsonBuilder *j, time_t now, time_t updated, const char *source,
+                          int push) {
+    if (push)
+        json_add_long(j, "updated", (long long)updated);
+    else
+        json_add_long(j, "age", updated > 0 ? (long long)(now - updated) : -1);
+    json_add_str(j, "source", updated > 0 && source ? source : "none");
+}
+
+/* 数据段是否早于 max_age 秒 (max_age < 0 表示不刷新) */
+static int is_stale(time_t now, time_t updated, long max_age) {
+    return max_age >= 0 && (updated == 0 || now - updated > max_age);
+}
+
+/* 输出仪表盘快照 (push=1 时用于推送，见 add_freshness) */
+static void render_dashboard(JsonBuilder *j, const TelemetryState *s, time_t now, int push) {
+    json_obj_open(j);
+    if (!push) json_add_long(j, "time", (long long)now);
+
+    json_key_obj_open(j, "system");
+    add_freshness(j, now, s->system_updated, s->system_source, push);
+    json_add_double(j, "cpu_usage", s->cpu_usage);
+    json_add_double(j, "thermal_temp", s->thermal_temp);
+    json_add_ulong(j, "total_ram", s->total_ram);
+    json_add_ulong(j, "free_ram", s->free_ram);
+    json_add_long(j, "uptime", s->uptime);
+    json_obj_close(j);
+
+    json_key_obj_open(j, "battery");
+    add_freshness(j, now, s->system_updated, s->system_source, push);
+    json_add_int(j, "capacity", s->battery_capacity);
+    json_add_bool(j, "charging", s->battery_charging);
+    json_obj_close(j);
+
+    json_key_obj_open(j, "radio");
+    add_freshness(j, now, s->radio_updated, s->radio_source, push);
+    json_add_str(j, "network_type", s->cell.net_type);
+    json_add_str(j, "band", s->cell.band);
+    json_add_int(j, "arfcn", s->cell.arfcn);
+    json_add_int(j, "pci", s->cell.pci);
+    json_add_double(j, "rsrp", s->cell.rsrp);
+    json_add_double(j, "rsrq", s->cell.rsrq);
+    json_add_double(j, "sinr", s->cell.sinr);
+    json_obj_close(j);
+
+    json_key_obj_open(j, "modem");
+    add_freshness(j, now, s->data_updated, s->data_source, push);
+    json_add_str(j, "slot", s->slot);
+    json_add_str(j, "modem_path", s->modem_path);
+    json_add_bool(j, "data_active", s->data_active);
+    json_obj_close(j);
+
+    json_key_obj_open(j, "traffic");
+    add_freshness(j, now, s->traffic_updated, s->traffic_source, push);
+    json_add_long(j, "rx", s->traffic_rx);
+    json_add_long(j, "tx", s->traffic_tx);
+    json_add_long(j, "total", s->traffic_rx + s->traffic_tx);
+    json_obj_close(j);
+
+    json_key_obj_open(j, "wan");
+    add_freshness(j, now, s->wan_updated, s->wan_source, push);
+    json_add_int(j, "targets", s->wan_targets);
+    json_add_int(j, "reachable", s->wan_reachable);
+    json_add_double(j, "rtt_ms", s->wan_rtt_ms);
+    json_add_double(j, "jitter_ms", s->wan_jitter_ms);
+    json_add_double(j, "loss_pct", s->wan_loss_pct);
+    json_obj_close(j);
+
+    json_key_obj_open(j, "interfaces");
+    add_freshness(j, now, s->system_updated, s->system_source, push);
+    json_arr_open(j, "items");
+    for (int i = 0; i < s->iface_count; i++) {
+        json_arr_obj_open(j);
+        json_add_str(j, "name", s->ifaces[i].name);
+        json_add_long(j, "rx_bytes", (long long)s->ifaces[i].rx_bytes);
+        json_add_long(j, "tx_bytes", (long long)s->ifaces[i].tx_bytes);
+        json_add_double(j, "rx_rate", s->ifaces[i].rx_rate);
+        json_add_double(j, "tx_rate", s->ifaces[i].tx_rate);
+        json_obj_close(j);
+    }
+    json_arr_close(j);
+    json_obj_close(j);
+
+    json_obj_close(j);
+}
+
+char *telemetry_dashboard_json(void) {
+    TelemetryState s;
+    pthread_mutex_lock(&g_state_lock);
+    s = g_state;
+    pthread_mutex_unlock(&g_state_lock);
+
+    JsonBuilder *j = json_new();
+    render_dashboard(j, &s, time(NULL), 1);
+    return json_finish(j);
+}
+
+/**
+ * GET /api/dashboard[?max_age=秒]
+ * 系统监控页所需数据的内存快照；指定 max_age 时只刷新早于该值的数据段
+ */
+void handle_telemetry_dashboard(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    char buf[16];
+    long max_age = -1;
+    if (mg_http_get_var(&hm->query, "max_age", buf, sizeof(buf)) > 0) {
+        max_age = strtol(buf, NULL, 10);
+        if (max_age < 0) max_age = 0;
+    }
+
+    TelemetryState s;
+    pthread_mutex_lock(&g_state_lock);
+    s = g_state;
+    pthread_mutex_unlock(&g_state_lock);
+
+    if (max_age >= 0) {
+        time_t now = time(NULL);
+        int refreshed = 0;
+        t_source = "refresh";
+        if (is_stale(now, s.system_updated, max_age)) {
+            refresh_system();
+            refreshed = 1;
+        }
+        if (is_stale(now, s.data_updated, max_age)) {
+            refresh_modem();
+            refreshed = 1;
+        }
+        if (is_stale(now, s.radio_updated, max_age)) {
+            ServingCell cell;
+            advanced_get_serving_cell(&cell);
+            refreshed = 1;
+        }
+        if (is_stale(now, s.traffic_updated, max_age)) {
+            long long rx, tx;
+            traffic_get_total(&rx, &tx);
+            refreshed = 1;
+        }
+        t_source = NULL;
+
+        if (refreshed) {
+            pthread_mutex_lock(&g_state_lock);
+            s = g_state;
+            pthread_mutex_unlock(&g_state_lock);
+        }
+    }
+
+    JsonBuilder *j = json_new();
+    render_dashboard(j, &s, time(NULL), 0);
+    HTTP_OK_FREE(c, json_finish(j));
+}
@@ -0,0 +1,222 @@
+/**
+ * @file tls.c
+ * @brief HTTPS 监听实现
+ */
+
+#include "tls.h"
+#include "exec_utils.h"
+#include "http_utils.h"
+#include "json_builder.h"
+#include "log.h"
+#include "metrics.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* prime256v1 曲线 OID (1.2.840.10045.3.1.7) 的 DER 编码 */
+static const unsigned char P256_OID[] = {0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x03, 0x01, 0x07};
+
+/* 证书/私钥 DER (启动线程写入后只读) */
+static struct mg_str g_cert_der;
+static struct mg_str g_key_der;
+static atomic_int g_available = 0;
+
+/* 每条 HTTPS 连接的状态，保存在 c->data */
+typedef struct {
+    uint64_t accept_us;
+    uint32_t requests;
+    uint8_t handshaken;
+} TlsConnState;
+
+/* 握手统计 (仅在事件循环线程中访问) */
+static struct {
+    char port[16];
+    uint64_t accepts;
+    uint64_t handshakes;
+    uint64_t failures;          /* 握手完成前断开 */
+    uint64_t active;
+    uint64_t requests;
+    LatencyHist handshake;      /* accept 到握手完成 (微秒，含网络往返) */
+} g_stats;
+
+/* ==================== 证书加载 ==================== */
+
+static int der_contains(struct mg_str der, const unsigned char *pat, size_t len) {
+    for (size_t i = 0; i + len <= der.len; i++) {
+        if (memcmp(der.buf + i, pat, len) == 0) return 1;
+    }
+    return 0;
+}
+
+/* PEM 中指定标签的块解码为 DER；不是 PEM 时按 DER 原样使用 */
+static int pem_to_der(struct mg_str pem, const char *label, struct mg_str *der) {
+    char begin[64], end[64];
+    snprintf(begin, sizeof(begin), "-----BEGIN %s-----", label);
+    snprintf(end, sizeof(end), "-----END %s-----", label);
+
+    const char *b = strstr(pem.buf, begin);
+    if (!b) {
+        if (strstr(pem.buf, "-----BEGIN ")) return -1;
+        *der = mg_strdup(pem);
+        return der->buf ? 0 : -1;
+    }
+    b += strlen(begin);
+    const char *e = strstr(b, end);
+    if (!e) return -1;
+
+    char *buf = malloc((size_t)(e - b) + 1);
+    if (!buf) return -1;
+    size_t n = 0;
+    for (const char *p = b; p < e; p++) {
+        if (*p != ' ' && *p != '\r' && *p != '\n' && *p != '\t') buf[n++] = *p;
+    }
+    size_t m = mg_base64_decode(buf, n, buf, n + 1);
+    if (m == 0) {
+        free(buf);
+        return -1;
+    }
+    der->buf = buf;
+    der->len = m;
+    return 0;
+}
+
+static int tls_load_file(const char *path, const char *label, struct mg_str *der) {
+    struct mg_str data = mg_file_read(&mg_fs_posix, path);
+    if (data.buf == NULL) return -1;
+    int ret = pem_to_der(data, label, der);
+    free((void *)data.buf);
+    return ret;
+}
+
+/* 生成 P-256 私钥和 10 年有效期的自签名证书 */
+static int tls_generate(void) {
+    char output[512];
+
+    if (run_command_timeout(30, output, sizeof(output), "openssl", "ecparam", "-name", "prime256v1",
+                            "-genkey", "-noout", "-out", TLS_KEY_FILE, NULL) != 0) {
+        LOG_W("生成 TLS 私钥失败: %s", output);
+        return -1;
+    }
+    chmod(TLS_KEY_FILE, 0600);
+    if (run_command_timeout(30, output, sizeof(output), "openssl", "req", "-new", "-x509", "-sha256",
+                            "-days", "3650", "-subj", "/CN=ofono-server", "-key", TLS_KEY_FILE,
+                            "-out", TLS_CERT_FILE, NULL) != 0) {
+        LOG_W("生成自签名证书失败: %s", output);
+        unlink(TLS_KEY_FILE);
+        return -1;
+    }
+    LOG_I("已生成自签名证书 %s", TLS_CERT_FILE);
+    return 0;
+}
+
+int tls_init(void) {
+    struct mg_str cert = {NULL, 0}, key = {NULL, 0};
+
+    if (access(TLS_CERT_FILE, R_OK) != 0 || access(TLS_KEY_FILE, R_OK) != 0) {
+        if (tls_generate() != 0) {
+            LOG_W("缺少 %s/%s 且无法生成，HTTPS 未启用", TLS_CERT_FILE, TLS_KEY_FILE);
+            return -1;
+        }
+    }
+
+    if (tls_load_file(TLS_CERT_FILE, "CERTIFICATE", &cert) != 0 ||
+        tls_load_file(TLS_KEY_FILE, "EC PRIVATE KEY", &key) != 0) {
+        LOG_W("读取证书或私钥失败 (私钥需为 EC PRIVATE KEY 格式)，HTTPS 未启用");
+        goto fail;
+    }
+
+    /* 内置 TLS 栈只实现了 P-256 ECDSA，其他曲线/RSA 证书握手会失败 */
+    if (key.len < 39 || memcmp(key.buf + 2, "\x02\x01\x01\x04\x20", 5) != 0 ||
+        !der_contains(cert, P256_OID, sizeof(P256_OID))) {
+        LOG_W("证书不是 ECDSA P-256 (prime256v1)，HTTPS 未启用");
+        goto fail;
+    }
+
+    g_cert_der = cert;
+    g_key_der = key;
+    atomic_store(&g_available, 1);
+    LOG_I("TLS 证书已加载 (%lu 字节)", (unsigned long)cert.len);
+    return 0;
+
+fail:
+    free((void *)cert.buf);
+    free((void *)key.buf);
+    return -1;
+}
+
+int tls_available(void) {
+    return atomic_load(&g_available);
+}
+
+void tls_set_listening(const char *port) {
+    snprintf(g_stats.port, sizeof(g_stats.port), "%s", port ? port : "");
+}
+
+/* ==================== 连接事件 ==================== */
+
+void tls_on_event(struct mg_connection *c, int ev) {
+    TlsConnState *st = (TlsConnState *)c->data;
+
+    if (ev == MG_EV_ACCEPT) {
+        struct mg_tls_opts opts;
+        memset(&opts, 0, sizeof(opts));
+        opts.cert = g_cert_der;
+        opts.key = g_key_der;
+        memset(st, 0, sizeof(*st));
+        st->accept_us = metrics_now_us();
+        g_stats.accepts++;
+        g_stats.active++;
+        mg_tls_init(c, &opts);
+        return;
+    }
+
+    /* 内置 TLS 栈在服务端握手完成时不发 MG_EV_TLS_HS，以 is_tls_hs 清零为准 */
+    if (c->is_accepted && !st->handshaken && c->tls != NULL && !c->is_tls_hs) {
+        st->handshaken = 1;
+        g_stats.handshakes++;
+        metrics_hist_record(&g_stats.handshake, metrics_now_us() - st->accept_us);
+    }
+
+    if (ev == MG_EV_HTTP_MSG) {
+        st->requests++;
+        g_stats.requests++;
+    } else if (ev == MG_EV_CLOSE && c->is_accepted) {
+        if (g_stats.active > 0) g_stats.active--;
+        if (!st->handshaken) g_stats.failures++;
+    }
+}
+
+/* ==================== API ==================== */
+
+void handle_tls_stats(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    const LatencyHist *h = &g_stats.handshake;
+    JsonBuilder *j = json_new();
+    json_obj_open(j);
+    json_add_bool(j, "available", tls_available());
+    json_add_bool(j, "listening", g_stats.port[0] != '\0');
+    json_add_str(j, "port", g_stats.port);
+    json_add_str(j, "cert_file", TLS_CERT_FILE);
+    json_add_bool(j, "session_resumption", 0);
+    json_add_long(j, "accepts", (long long)g_stats.accepts);
+    json_add_long(j, "handshakes", (long long)g_stats.handshakes);
+    json_add_long(j, "handshake_failures", (long long)g_stats.failures);
+    json_add_long(j, "active_connections", (long long)g_stats.active);
+    json_add_long(j, "requests", (long long)g_stats.requests);
+    /* 轮询客户端复用连接时该值远大于 1，接近 1 说明每个请求都在重新握手 */
+    json_add_double(j, "requests_per_handshake",
+                    g_stats.handshakes ? (double)g_stats.requests / (double)g_stats.handshakes : 0.0);
+    json_key_obj_open(j, "handshake_ms");
+    json_add_double(j, "avg", h->count ? (double)h->sum / (double)h->count / 1000.0 : 0.0);
+    json_add_double(j, "p50", metrics_hist_percentile(h, 0.50) / 1000.0);
+    json_add_double(j, "p90", metrics_hist_percentile(h, 0.90) / 1000.0);
+    json_add_double(j, "p99", metrics_hist_percentile(h, 0.99) / 1000.0);
+    json_add_double(j, "max", h->max / 1000.0);
+    json_obj_close(j);
+    json_obj_close(j);
+    HTTP_OK_FREE(c, json_finish(j));
+}
@@ -0,0 +1,175 @@
+/**
+ * @file trace.c
+ * @brief 轻量级请求追踪实现
+ */
+
+#include "trace.h"
+#include "database.h"
+#include "http_utils.h"
+#include "json_builder.h"
+#include "metrics.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 当前线程正在记录的追踪 (NULL 表示不记录) */
+static __thread Trace *t_active = NULL;
+
+/* 慢请求环形缓冲区 */
+static Trace g_ring[TRACE_RING_SIZE];
+static int g_ring_next = 0;
+static int g_ring_count = 0;
+static pthread_mutex_t g_ring_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int g_slow_ms = TRACE_SLOW_MS_DEFAULT;
+
+void trace_init(void) {
+    g_slow_ms = config_get_int("trace_slow_ms", TRACE_SLOW_MS_DEFAULT);
+    if (g_slow_ms < 0) g_slow_ms = 0;
+}
+
+void trace_begin(Trace *t, struct mg_str method, struct mg_str uri) {
+    if (!t) return;
+    t->start_us = metrics_now_us();
+    t->wall_time = time(NULL);
+    t->total_us = 0;
+    t->status = 0;
+    t->span_count = 0;
+    t->dropped = 0;
+    t->depth = 0;
+    snprintf(t->method, sizeof(t->method), "%.*s", (int)method.len, method.buf);
+    snprintf(t->uri, sizeof(t->uri), "%.*s", (int)uri.len, uri.buf);
+    t_active = t;
+}
+
+void trace_end(Trace *t, int status) {
+    if (!t) return;
+    if (t_active == t) t_active = NULL;
+
+    uint64_t elapsed = metrics_now_us() - t->start_us;
+    t->total_us = elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+    t->status = status;
+
+    if (t->total_us < (uint32_t)g_slow_ms * 1000U) return;
+
+    /* 只复制已使用的片段 */
+    pthread_mutex_lock(&g_ring_lock);
+    Trace *slot = &g_ring[g_ring_next];
+    memcpy(slot, t, offsetof(Trace, spans) + sizeof(TraceSpan) * t->span_count);
+    g_ring_next = (g_ring_next + 1) % TRACE_RING_SIZE;
+    if (g_ring_count < TRACE_RING_SIZE) g_ring_count++;
+    pthread_mutex_unlock(&g_ring_lock);
+}
+
+int trace_span_begin(const char *name, const char *detail) {
+    Trace *t = t_active;
+    if (!t) return -1;
+    if (t->span_count >= TRACE_MAX_SPANS) {
+        t->dropped++;
+        return -1;
+    }
+
+    int idx = t->span_count++;
+    TraceSpan *s = &t->spans[idx];
+    s->name = name;
+    snprintf(s->detail, sizeof(s->detail), "%s", detail ? detail : "");
+    s->start_us = (uint32_t)(metrics_now_us() - t->start_us);
+    s->dur_us = 0;
+    s->depth = (uint8_t)t->depth++;
+    return idx;
+}
+
+void trace_span_end(int span) {
+    Trace *t = t_active;
+    if (!t || span < 0 || span >= t->span_count) return;
+
+    TraceSpan *s = &t->spans[span];
+    uint32_t now = (uint32_t)(metrics_now_us() - t->start_us);
+    s->dur_us = now - s->start_us;
+    if (t->depth > 0) t->depth--;
+}
+
+/* ==================== HTTP API ==================== */
+
+static char *traces_to_json(void) {
+    JsonBuilder *j = json_new();
+    if (!j) return NULL;
+
+    json_obj_open(j);
+    json_add_int(j, "slow_ms", g_slow_ms);
+    json_arr_open(j, "traces");
+
+    pthread_mutex_lock(&g_ring_lock);
+    /* 最新的在前 */
+    for (int n = 0; n < g_ring_count; n++) {
+        int idx = (g_ring_next - 1 - n + TRACE_RING_SIZE) % TRACE_RING_SIZE;
+        const Trace *t = &g_ring[idx];
+
+        char time_str[32];
+        struct tm tm_info;
+        localtime_r(&t->wall_time, &tm_info);
+        strftime(time_str, sizeof(time_str), "%Y-%m-%dT%H:%M:%S", &tm_info);
+
+        json_arr_obj_open(j);
+        json_add_str(j, "method", t->method);
+        json_add_str(j, "uri", t->uri);
+        json_add_str(j, "time", time_str);
+        json_add_double(j, "total_ms", t->total_us / 1000.0);
+        json_add_int(j, "status", t->status);
+        json_add_int(j, "dropped", t->dropped);
+        json_arr_open(j, "spans");
+        for (int i = 0; i < t->span_count; i++) {
+            const TraceSpan *s = &t->spans[i];
+            json_arr_obj_open(j);
+            json_add_str(j, "name", s->name);
+            json_add_str(j, "detail", s->detail);
+            json_add_long(j, "start_us", s->start_us);
+            json_add_long(j, "dur_us", s->dur_us);
+            json_add_int(j, "depth", s->depth);
+            json_obj_close(j);
+        }
+        json_arr_close(j);
+        json_obj_close(j);
+    }
+    pthread_mutex_unlock(&g_ring_lock);
+
+    json_arr_close(j);
+    json_obj_close(j);
+    return json_finish(j);
+}
+
+/**
+ * GET  /api/debug/traces - 查看最近的慢请求追踪
+ * POST /api/debug/traces - 设置慢请求阈值 {"slow_ms": 500}
+ * DELETE /api/debug/traces - 清空环形缓冲区
+ */
+void handle_debug_traces(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_ANY(c, hm);
+
+    if (http_is_method(hm, "GET")) {
+        char *json = traces_to_json();
+        if (!json) {
+            HTTP_ERROR(c, 500, "Out of memory");
+            return;
+        }
+        HTTP_OK_FREE(c, json);
+    } else if (http_is_method(hm, "POST")) {
+        long slow_ms = mg_json_get_long(hm->body, "$.slow_ms", -1);
+        if (slow_ms < 0) {
+            HTTP_ERROR(c, 400, "slow_ms is required");
+            return;
+        }
+        g_slow_ms = (int)slow_ms;
+        config_set_int("trace_slow_ms", g_slow_ms);
+        HTTP_SUCCESS(c, "慢请求阈值已更新");
+    } else if (http_is_method(hm, "DELETE")) {
+        pthread_mutex_lock(&g_ring_lock);
+        g_ring_next = 0;
+        g_ring_count = 0;
+        pthread_mutex_unlock(&g_ring_lock);
+        HTTP_SUCCESS(c, "追踪记录已清空");
+    } else {
+        http_method_error(c);
+    }
+}
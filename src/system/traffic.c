@@ -17,6 +17,7 @@
 #include "airplane.h"  /* 飞行模式控制 */
 #include "http_utils.h"
 #include "json_builder.h"
+#include "telemetry.h"
 
 #define VNSTAT_DB "/var/lib/vnstat/vnstat.db"
 #define NETWORK_IFACE "sipa_eth0"
@@ -46,20 +47,22 @@ static void save_traffic_config(TrafficConfig *config) {
 
 
 /* 从 vnstat 获取流量数据 */
-static void get_traffic_from_vnstat(long long *rx, long long *tx) {
+int traffic_get_total(long long *rx, long long *tx) {
     char output[4096];
     *rx = 0;
     *tx = 0;
 
     if (run_command(output, sizeof(output), "/home/root/6677/vnstat", 
                     "-i", NETWORK_IFACE, "--json", NULL) != 0) {
-        return;
+        return -1;
     }
 
     /* 使用mongoose JSON API解析 */
     struct mg_str json = mg_str(output);
     *rx = mg_json_get_long(json, "$.interfaces[0].traffic.total.rx", 0);
     *tx = mg_json_get_long(json, "$.interfaces[0].traffic.total.tx", 0);
+    telemetry_update_traffic(*rx, *tx);
+    return 0;
 }
 
 /* 格式化字节数 */
@@ -87,7 +90,7 @@ static void *flow_control_thread_func(void *arg) {
         }
 
         long long rx, tx;
-        get_traffic_from_vnstat(&rx, &tx);
+        traffic_get_total(&rx, &tx);
         long long total = rx + tx;
 
         if (total >= config.much) {
@@ -133,7 +136,7 @@ void handle_get_traffic_total(struct mg_connection *c, struct mg_http_message *h
     HTTP_CHECK_GET(c, hm);
 
     long long rx, tx;
-    get_traffic_from_vnstat(&rx, &tx);
+    traffic_get_total(&rx, &tx);
 
     char rx_str[32], tx_str[32], total_str[32];
     format_bytes(rx, rx_str, sizeof(rx_str));
@@ -11,6 +11,7 @@
 #include <sys/wait.h>
 #include "update.h"
 #include "exec_utils.h"
+#include "http_utils.h"
 #include "mongoose.h"
 
 /* 获取当前版本 */
@@ -125,25 +126,13 @@ int update_check_version(const char *check_url, update_info_t *info) {
     struct mg_str json = mg_str(output);
     
     /* 提取version字段 */
-    char *version = mg_json_get_str(json, "$.version");
-    if (version) {
-        strncpy(info->version, version, sizeof(info->version) - 1);
-        free(version);
-    }
+    http_json_get_str(json, "$.version", info->version, sizeof(info->version));
     
     /* 提取url字段 */
-    char *url = mg_json_get_str(json, "$.url");
-    if (url) {
-        strncpy(info->url, url, sizeof(info->url) - 1);
-        free(url);
-    }
+    http_json_get_str(json, "$.url", info->url, sizeof(info->url));
     
     /* 提取changelog字段 */
-    char *changelog = mg_json_get_str(json, "$.changelog");
-    if (changelog) {
-        strncpy(info->changelog, changelog, sizeof(info->changelog) - 1);
-        free(changelog);
-    }
+    http_json_get_str(json, "$.changelog", info->changelog, sizeof(info->changelog));
     
     /* 提取size字段 */
     info->size = (size_t)mg_json_get_long(json, "$.size", 0);
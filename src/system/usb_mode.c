@@ -6,7 +6,8 @@
  * 临时模式写入 /mnt/data/mode_tmp.cfg
  * 永久模式写入 /mnt/data/mode.cfg 并删除临时文件
  * 
- * 热切换功能通过 configfs 实现，无需重启
+ * 热切换功能通过 configfs 实现，无需重启: 按当前 configfs 状态与目标模式的差异
+ * 生成最小的操作计划并逐步执行，每步耗时写入日志并可通过 GET /api/usb-advance 查看
  */
 
 #include <stdio.h>
@@ -16,10 +17,16 @@
 #include <dirent.h>
 #include <sys/stat.h>
 #include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <strings.h>
+#include <time.h>
 #include "mongoose.h"
 #include "usb_mode.h"
+#include "exec_utils.h"
 #include "http_utils.h"
 #include "json_builder.h"
+#include "log.h"
 
 /* USB 模式配置结构 */
 typedef struct {
@@ -167,11 +174,7 @@ void handle_usb_mode_set(struct mg_connection *c, struct mg_http_message *hm) {
     int bval = 0;
     
     /* 解析JSON参数 */
-    char *mode_val = mg_json_get_str(hm->body, "$.mode");
-    if (mode_val) {
-        strncpy(mode_str, mode_val, sizeof(mode_str) - 1);
-        free(mode_val);
-    }
+    http_json_get_str(hm->body, "$.mode", mode_str, sizeof(mode_str));
     
     if (mg_json_get_bool(hm->body, "$.permanent", &bval)) {
         permanent = bval;
@@ -229,25 +232,125 @@ void handle_usb_mode_set(struct mg_connection *c, struct mg_http_message *hm) {
 
 /* ==================== USB 热切换实现 ==================== */
 
+/*
+ * 热切换按"计划"执行: 先读取 configfs 当前状态，与目标模式的功能集合做差异，
+ * 只生成必要的操作 (只写值不同的属性、只增删变化的链接和功能目录)，
+ * 再逐步执行并记录每步耗时。UDC 只在有 configfs 变更时解绑，
+ * 解绑前完成不影响链路的准备工作 (新功能目录、adbd 启动)，
+ * 绑定后以短间隔轮询网络接口代替固定延时，以缩短 USB 链路中断时间。
+ */
+
+/* 附加功能链接 f2-f9 (f1 为主网络功能) */
+static const char *const usb_extra_links[] = {
+    "gser.gs2", /* f2: AT 指令通道 */
+    "gser.gs0", /* f3: 诊断通道 */
+    "vser.gs0", /* f4: 虚拟串口/IQ 日志 */
+    "gser.gs3", /* f5 */
+    "ffs.adb",  /* f6: Android Debug Bridge */
+    "gser.gs4", /* f7-f9: 更多串口通道 */
+    "gser.gs5",
+    "gser.gs6",
+};
+
+/* 网络功能目录，切换时删除目标以外的 (否则 u_ether 网卡名 usbN 会顺延) */
+static const char *const usb_net_functions[] = {
+    "ncm.gs0", "ncm.gs1", "ncm.gs2", "ncm.gs3",
+    "ecm.gs0", "ecm.gs1", "ecm.gs2", "ecm.gs3",
+    "rndis.gs4", "mbim.gs0",
+};
+
+typedef enum {
+    USB_OP_MKDIR,
+    USB_OP_START_ADBD,
+    USB_OP_UDC_UNBIND,
+    USB_OP_UNLINK,
+    USB_OP_RMDIR,
+    USB_OP_WRITE,
+    USB_OP_SYMLINK,
+    USB_OP_WAIT_FFS,
+    USB_OP_UDC_BIND,
+    USB_OP_WAIT_NETDEV,
+    USB_OP_NETWORK,
+} UsbOp;
+
+static const char *const usb_op_names[] = {
+    "mkdir", "start_adbd", "udc_unbind", "unlink", "rmdir", "write",
+    "symlink", "wait_ffs", "udc_bind", "wait_netdev", "network",
+};
+
+/* 计划中的一步 (路径为真实路径，执行时加根目录前缀) */
+typedef struct {
+    UsbOp op;
+    int optional;       /* 目标文件不存在时跳过 */
+    int critical;       /* 失败时中止，直接跳到 UDC 绑定 */
+    char path[128];
+    char value[64];
+    long dur_us;
+    int ret;
+} UsbStep;
+
+typedef struct {
+    int mode;
+    UsbStep steps[USB_PLAN_MAX_STEPS];
+    int count;
+    char udc[64];
+    char iface[16];
+    time_t time;
+    long total_us;
+    long outage_us;     /* UDC 解绑到网络接口配置完成 */
+    int ret;
+} UsbPlan;
+
+static struct {
+    int switching;
+    UsbPlan last;       /* 最近一次执行的计划 */
+} g_usb;
+
+static pthread_mutex_t g_usb_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* 测试用的假根目录 (环境变量 USB_MODE_ROOT)，未设置时为真实系统 */
+static const char *usb_root(void) {
+    const char *root = getenv(USB_MODE_ROOT_ENV);
+    return root ? root : "";
+}
+
+static const char *rooted(const char *path, char *buf, size_t size) {
+    snprintf(buf, size, "%s%s", usb_root(), path);
+    return buf;
+}
+
+static long elapsed_us(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000L + (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
 /* 写入 sysfs 文件 */
 static int write_sysfs(const char *path, const char *value) {
-    FILE *f = fopen(path, "w");
+    char full[256];
+    FILE *f = fopen(rooted(path, full, sizeof(full)), "w");
     if (!f) {
-        printf("[usb_mode] 无法写入 %s: %s\n", path, strerror(errno));
+        printf("[usb_mode] 无法写入 %s: %s\n", full, strerror(errno));
         return -1;
     }
     fprintf(f, "%s", value);
-    fclose(f);
+    /* configfs/sysfs 的写入错误在 fclose 刷新时才返回 */
+    if (fclose(f) != 0) {
+        printf("[usb_mode] 写入 %s 失败: %s\n", full, strerror(errno));
+        return -1;
+    }
     return 0;
 }
 
 /* 读取 sysfs 文件 */
 static int read_sysfs(const char *path, char *buf, size_t size) {
-    FILE *f = fopen(path, "r");
+    char full[256];
+    FILE *f = fopen(rooted(path, full, sizeof(full)), "r");
     if (!f) return -1;
     if (fgets(buf, size, f) == NULL) {
         fclose(f);
-        return -1;
+        buf[0] = '\0';
+        return 0;
     }
     fclose(f);
     /* 去除换行符 */
@@ -256,223 +359,322 @@ static int read_sysfs(const char *path, char *buf, size_t size) {
     return 0;
 }
 
-/* 执行系统命令 */
-static int run_cmd(const char *cmd) {
-    printf("[usb_mode] 执行: %s\n", cmd);
-    return system(cmd);
+static int path_exists(const char *path) {
+    char full[256];
+    return access(rooted(path, full, sizeof(full)), F_OK) == 0;
 }
 
-/* 停止 adbd 服务 */
-static void stop_adbd(void) {
-    run_cmd("killall adbd 2>/dev/null");
-    usleep(100000); /* 100ms */
+/* 获取 UDC 名称 */
+static void get_udc_name(char *buf, size_t size) {
+    char full[256];
+    snprintf(buf, size, "%s", DEFAULT_UDC);
+    DIR *dir = opendir(rooted("/sys/class/udc", full, sizeof(full)));
+    if (!dir) return;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] != '.') {
+            snprintf(buf, size, "%.*s", (int)size - 1, entry->d_name);
+            break;
+        }
+    }
+    closedir(dir);
 }
 
-/* 启动 adbd 服务 */
-static void start_adbd(void) {
-    run_cmd("/usr/bin/adbd-init &");
-    usleep(500000); /* 500ms 等待 functionfs 挂载 */
+static UsbStep *plan_add(UsbPlan *plan, UsbOp op, const char *path, const char *value) {
+    if (plan->count >= USB_PLAN_MAX_STEPS) return NULL;
+    UsbStep *s = &plan->steps[plan->count++];
+    memset(s, 0, sizeof(*s));
+    s->op = op;
+    snprintf(s->path, sizeof(s->path), "%.127s", path ? path : "");
+    snprintf(s->value, sizeof(s->value), "%.63s", value ? value : "");
+    return s;
 }
 
-/* 获取 UDC 名称 */
-static const char* get_udc_name(void) {
-    static char udc_name[64] = {0};
-    DIR *dir = opendir("/sys/class/udc");
-    if (dir) {
-        struct dirent *entry;
-        while ((entry = readdir(dir)) != NULL) {
-            if (entry->d_name[0] != '.') {
-                strncpy(udc_name, entry->d_name, sizeof(udc_name) - 1);
-                break;
-            }
-        }
-        closedir(dir);
-    }
-    return strlen(udc_name) > 0 ? udc_name : DEFAULT_UDC;
+/* 属性值与目标不同时才写入 */
+static void plan_write(UsbPlan *plan, const char *path, const char *value, int optional) {
+    char cur[64];
+    if (read_sysfs(path, cur, sizeof(cur)) == 0 && strcasecmp(cur, value) == 0) return;
+    if (optional && !path_exists(path)) return;
+    UsbStep *s = plan_add(plan, USB_OP_WRITE, path, value);
+    if (s) s->optional = optional;
 }
 
-/* 删除 configs/b.1 下的所有符号链接 */
-static void remove_function_links(void) {
-    DIR *dir = opendir(USB_CONFIG_PATH);
-    if (!dir) return;
-    
+/* 读取 configs/b.1 下的链接: 链接名 -> 目标功能名 */
+typedef struct {
+    char name[16];
+    char func[32];
+} UsbLink;
+
+static int read_links(UsbLink *links, int max) {
+    char dir_path[256], path[512], target[256];
+    DIR *dir = opendir(rooted(USB_CONFIG_PATH, dir_path, sizeof(dir_path)));
+    if (!dir) return 0;
+
+    int n = 0;
     struct dirent *entry;
-    char path[256];
-    while ((entry = readdir(dir)) != NULL) {
+    while ((entry = readdir(dir)) != NULL && n < max) {
         if (entry->d_name[0] == '.') continue;
-        snprintf(path, sizeof(path), "%s/%s", USB_CONFIG_PATH, entry->d_name);
-        struct stat st;
-        if (lstat(path, &st) == 0 && S_ISLNK(st.st_mode)) {
-            unlink(path);
-            printf("[usb_mode] 删除链接: %s\n", path);
-        }
+        snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name);
+        ssize_t len = readlink(path, target, sizeof(target) - 1);
+        if (len < 0) continue;
+        target[len] = '\0';
+        const char *base = strrchr(target, '/');
+        snprintf(links[n].name, sizeof(links[n].name), "%.15s", entry->d_name);
+        snprintf(links[n].func, sizeof(links[n].func), "%.31s", base ? base + 1 : target);
+        n++;
     }
     closedir(dir);
+    return n;
 }
 
-/* 删除 functions 目录下的功能 */
-static void remove_cdc_functions(void) {
-    const char *funcs[] = {
-        "ncm.gs0", "ncm.gs1", "ncm.gs2", "ncm.gs3",
-        "ecm.gs0", "ecm.gs1", "ecm.gs2", "ecm.gs3",
-        "rndis.gs4", "mbim.gs0", NULL
-    };
-    char path[256];
-    for (int i = 0; funcs[i]; i++) {
-        snprintf(path, sizeof(path), "%s/%s", USB_FUNCTIONS_PATH, funcs[i]);
-        rmdir(path); /* 只能删除空目录 */
-    }
-}
-
-/* 创建 gser/vser 功能目录 */
-static void create_gser_functions(void) {
-    const char *gsers[] = {
-        "vser.gs0", "ffs.adb",
-        "gser.gs0", "gser.gs1", "gser.gs2", "gser.gs3",
-        "gser.gs4", "gser.gs5", "gser.gs6", "gser.gs7", NULL
-    };
-    char path[256];
-    for (int i = 0; gsers[i]; i++) {
-        snprintf(path, sizeof(path), "%s/%s", USB_FUNCTIONS_PATH, gsers[i]);
-        if (access(path, F_OK) != 0) {
-            mkdir(path, 0755);
+/* 链接名 fN 对应的目标功能，不属于目标集合返回 NULL */
+static const char *target_link_func(const UsbModeConfig *cfg, const char *name) {
+    int idx;
+    char extra;
+    if (sscanf(name, "f%d%c", &idx, &extra) != 1) return NULL;
+    if (idx == 1) return cfg->functions;
+    if (idx >= 2 && idx < 2 + (int)(sizeof(usb_extra_links) / sizeof(usb_extra_links[0])))
+        return usb_extra_links[idx - 2];
+    return NULL;
+}
+
+/* 根据 configfs 当前状态计算切换到 mode 的计划 */
+static void plan_build(int mode, UsbPlan *plan) {
+    const UsbModeConfig *cfg = &usb_mode_configs[mode];
+    char path[128], cur[64];
+    int n_extra = (int)(sizeof(usb_extra_links) / sizeof(usb_extra_links[0]));
+
+    memset(plan, 0, sizeof(*plan));
+    plan->mode = mode;
+    plan->time = time(NULL);
+    /* 提前缓存 UDC 名称，避免解绑后读取为空 */
+    get_udc_name(plan->udc, sizeof(plan->udc));
+    int bound = read_sysfs(USB_UDC_PATH, cur, sizeof(cur)) == 0 && cur[0] && strcmp(cur, "none") != 0;
+
+    /* 阶段 1 (链路仍在): 创建缺少的功能目录；functionfs 未就绪时启动 adbd，与后续操作并行 */
+    int new_net = 0;
+    for (int i = -1; i < n_extra; i++) {
+        const char *func = i < 0 ? cfg->functions : usb_extra_links[i];
+        snprintf(path, sizeof(path), "%s/%s", USB_FUNCTIONS_PATH, func);
+        if (path_exists(path)) continue;
+        UsbStep *s = plan_add(plan, USB_OP_MKDIR, path, NULL);
+        if (s && i < 0) {
+            s->critical = 1;
+            new_net = 1;
         }
     }
-}
+    int adbd = !path_exists(USB_FFS_READY_PATH);
+    if (adbd) plan_add(plan, USB_OP_START_ADBD, NULL, NULL);
+    int prepared = plan->count;
 
-/* 等待 functionfs 挂载完成 */
-static int wait_for_functionfs(void) {
-    const char *ffs_ep0 = "/dev/usb-ffs/adb/ep0";
-    for (int i = 0; i < 50; i++) {  /* 最多等待 5 秒 */
-        if (access(ffs_ep0, F_OK) == 0) {
-            usleep(200000);  /* 额外等待 adbd 打开 ep0 */
-            return 0;
+    /* 阶段 2 (需要解绑): 链接、网络功能目录、描述符属性 */
+    UsbLink links[32];
+    int n_links = read_links(links, 32);
+    int have[16] = {0};
+    for (int i = 0; i < n_links; i++) {
+        const char *want = target_link_func(cfg, links[i].name);
+        if (want && strcmp(want, links[i].func) == 0) {
+            have[atoi(links[i].name + 1)] = 1;
+            continue;
         }
-        usleep(100000);  /* 100ms */
+        snprintf(path, sizeof(path), "%s/%.15s", USB_CONFIG_PATH, links[i].name);
+        plan_add(plan, USB_OP_UNLINK, path, links[i].func);
+    }
+    for (size_t i = 0; i < sizeof(usb_net_functions) / sizeof(usb_net_functions[0]); i++) {
+        if (strcmp(usb_net_functions[i], cfg->functions) == 0) continue;
+        snprintf(path, sizeof(path), "%s/%s", USB_FUNCTIONS_PATH, usb_net_functions[i]);
+        if (path_exists(path)) plan_add(plan, USB_OP_RMDIR, path, NULL);
     }
-    printf("[usb_mode] 警告: functionfs 挂载超时，继续执行\n");
-    return -1;  /* 超时但继续 */
-}
 
-/* 启用 SFP 硬件转发加速 */
-static void enable_sfp_acceleration(void) {
-    write_sysfs("/proc/net/sfp/enable", "1");
-    write_sysfs("/proc/net/sfp/tether_scheme", "1");
+    /* 网络功能的 MAC 只能在未链接时修改 */
+    snprintf(path, sizeof(path), "%s/%s/dev_addr", USB_FUNCTIONS_PATH, cfg->functions);
+    if (new_net || !have[1]) {
+        UsbStep *s = plan_add(plan, USB_OP_WRITE, path, "cc:e8:ac:c0:00:00");
+        if (s) s->optional = 1;
+        snprintf(path, sizeof(path), "%s/%s/host_addr", USB_FUNCTIONS_PATH, cfg->functions);
+        s = plan_add(plan, USB_OP_WRITE, path, "cc:e8:ac:c0:00:01");
+        if (s) s->optional = 1;
+    }
+
+    if (cfg->pamu3_protocol) plan_write(plan, PAMU3_PROTOCOL_PATH, cfg->pamu3_protocol, 1);
+    plan_write(plan, PAMU3_MAX_DL_PKTS_PATH, "7", 1);
+    plan_write(plan, USB_GADGET_PATH "/idVendor", cfg->vid, 0);
+    plan_write(plan, USB_GADGET_PATH "/idProduct", cfg->pid, 0);
+    plan_write(plan, USB_GADGET_PATH "/bcdDevice", cfg->bcd_device, 0);
+    plan_write(plan, USB_GADGET_PATH "/bDeviceClass", "0x00", 0);
+    plan_write(plan, USB_CONFIG_PATH "/strings/0x409/configuration", cfg->configuration, 0);
+    plan_write(plan, USB_CONFIG_PATH "/MaxPower", "500", 0);
+    plan_write(plan, USB_CONFIG_PATH "/bmAttributes", "0xc0", 0);
+
+    for (int i = 1; i <= 1 + n_extra; i++) {
+        if (have[i]) continue;
+        char name[8];
+        snprintf(name, sizeof(name), "f%d", i);
+        snprintf(path, sizeof(path), "%s/%s", USB_CONFIG_PATH, name);
+        UsbStep *s = plan_add(plan, USB_OP_SYMLINK, path, target_link_func(cfg, name));
+        if (s && i == 1) s->critical = 1;
+    }
+
+    /* 有 configfs 变更时先解绑 UDC，插入到阶段 2 之前 */
+    int changed = plan->count > prepared;
+    if (changed && bound && plan->count < USB_PLAN_MAX_STEPS) {
+        memmove(&plan->steps[prepared + 1], &plan->steps[prepared],
+                sizeof(UsbStep) * (size_t)(plan->count - prepared));
+        plan->count++;
+        memset(&plan->steps[prepared], 0, sizeof(UsbStep));
+        plan->steps[prepared].op = USB_OP_UDC_UNBIND;
+        snprintf(plan->steps[prepared].path, sizeof(plan->steps[prepared].path), "%s", USB_UDC_PATH);
+        snprintf(plan->steps[prepared].value, sizeof(plan->steps[prepared].value), "none");
+    }
+
+    /* 阶段 3: 等待 functionfs，绑定 UDC，等待网络接口并配置 */
+    if (adbd) plan_add(plan, USB_OP_WAIT_FFS, USB_FFS_READY_PATH, NULL);
+    plan_write(plan, "/sys/module/slog_bridge/parameters/log_transport", "1", 1);
+    if (changed || !bound) plan_add(plan, USB_OP_UDC_BIND, USB_UDC_PATH, plan->udc);
+    plan_add(plan, USB_OP_WAIT_NETDEV, "/sys/class/net/usb0|/sys/class/net/rndis0", NULL);
+    plan_add(plan, USB_OP_NETWORK, NULL, NULL);
+    plan_write(plan, "/proc/net/sfp/enable", "1", 1);
+    plan_write(plan, "/proc/net/sfp/tether_scheme", "1", 1);
 }
 
-/* 创建功能目录 */
-static int create_function_dir(const char *func_name) {
-    char path[256];
-    snprintf(path, sizeof(path), "%s/%s", USB_FUNCTIONS_PATH, func_name);
-    if (access(path, F_OK) != 0) {
-        if (mkdir(path, 0755) != 0) {
-            printf("[usb_mode] 创建功能目录失败: %s\n", path);
-            return -1;
+/* 依次检查 "|" 分隔的多个路径，任一出现即返回其序号，超时返回 -1 */
+static int wait_any(const char *paths, int timeout_ms) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (;;) {
+        char list[128];
+        snprintf(list, sizeof(list), "%s", paths);
+        int idx = 0;
+        char *save = NULL;
+        for (char *p = strtok_r(list, "|", &save); p; p = strtok_r(NULL, "|", &save), idx++) {
+            if (path_exists(p)) return idx;
         }
+        if (elapsed_us(&start) >= timeout_ms * 1000L) return -1;
+        usleep(USB_WAIT_POLL_MS * 1000);
     }
-    return 0;
 }
 
-/* 创建符号链接 */
-static int create_function_link(const char *func_name, const char *link_name) {
-    char target[256], link_path[256];
-    snprintf(target, sizeof(target), "%s/%s", USB_FUNCTIONS_PATH, func_name);
-    snprintf(link_path, sizeof(link_path), "%s/%s", USB_CONFIG_PATH, link_name);
-    
-    if (symlink(target, link_path) != 0) {
-        printf("[usb_mode] 创建链接失败: %s -> %s\n", link_path, target);
-        return -1;
-    }
-    printf("[usb_mode] 创建链接: %s -> %s\n", link_path, target);
-    return 0;
+static void start_adbd(void) {
+    char out[128];
+    run_command(out, sizeof(out), "killall", "adbd", NULL);
+    /* 后台启动，输出重定向避免占住管道 */
+    run_command(out, sizeof(out), "/bin/sh", "-c", "/usr/bin/adbd-init >/dev/null 2>&1 &", NULL);
 }
 
-/* 配置 USB 网络接口 */
-static void configure_usb_network(void) {
-    /* 等待接口出现 */
-    usleep(500000);
-    
-    /* 1. 配置 connman gadget tethering */
-    run_cmd("connmanctl tether gadget off 2>/dev/null");
-    usleep(100000);
-    run_cmd("connmanctl disable gadget 2>/dev/null");
-    usleep(200000);
-    run_cmd("connmanctl enable gadget 2>/dev/null");
-    usleep(100000);
-    run_cmd("connmanctl tether gadget on 2>/dev/null");
-    usleep(300000);
-    
-    /* 2. 查找并配置 USB 网络接口 */
-    const char *ifaces[] = {"usb0", "rndis0", NULL};
-    char cmd[256];
-    
-    for (int retry = 0; retry < 5; retry++) {
-        for (int i = 0; ifaces[i]; i++) {
-            char path[128];
-            snprintf(path, sizeof(path), "/sys/class/net/%s", ifaces[i]);
-            if (access(path, F_OK) == 0) {
-                /* 设置 IP 地址和子网掩码 */
-                snprintf(cmd, sizeof(cmd), "ifconfig %s %s netmask 255.255.255.0", 
-                         ifaces[i], USB_INTERFACE_IP);
-                run_cmd(cmd);
-                
-                /* 设置 MAC 地址 */
-                snprintf(cmd, sizeof(cmd), "ifconfig %s hw ether %s", 
-                         ifaces[i], USB_INTERFACE_MAC);
-                run_cmd(cmd);
-                
-                /* 启动接口 */
-                snprintf(cmd, sizeof(cmd), "ip link set dev %s up", ifaces[i]);
-                run_cmd(cmd);
-                
-                /* 配置 iptables NAT */
-                run_cmd("iptables -t nat -A POSTROUTING -o rmnet_data0 -j MASQUERADE 2>/dev/null");
-                snprintf(cmd, sizeof(cmd), "iptables -A FORWARD -i %s -j ACCEPT 2>/dev/null", ifaces[i]);
-                run_cmd(cmd);
-                
-                goto network_done;
-            }
-        }
-        usleep(1000000);  /* 等待 1 秒后重试 */
+/* 配置 USB 网络接口: connman 共享、地址、MAC (不同时才改)、NAT 规则 (不存在时才加) */
+static int configure_usb_network(const char *iface) {
+    char out[256], addr[64], path[128];
+
+    run_command(out, sizeof(out), "connmanctl", "tether", "gadget", "off", NULL);
+    run_command(out, sizeof(out), "connmanctl", "disable", "gadget", NULL);
+    run_command(out, sizeof(out), "connmanctl", "enable", "gadget", NULL);
+    run_command(out, sizeof(out), "connmanctl", "tether", "gadget", "on", NULL);
+
+    snprintf(addr, sizeof(addr), "%s/24", USB_INTERFACE_IP);
+    int ret = run_command(out, sizeof(out), "ip", "addr", "replace", addr, "dev", iface, NULL);
+    snprintf(path, sizeof(path), "/sys/class/net/%s/address", iface);
+    if (read_sysfs(path, addr, sizeof(addr)) != 0 || strcasecmp(addr, USB_INTERFACE_MAC) != 0) {
+        run_command(out, sizeof(out), "ip", "link", "set", "dev", iface, "down", NULL);
+        run_command(out, sizeof(out), "ip", "link", "set", "dev", iface, "address", USB_INTERFACE_MAC, NULL);
+    }
+    if (run_command(out, sizeof(out), "ip", "link", "set", "dev", iface, "up", NULL) != 0) ret = -1;
+
+    if (run_command(out, sizeof(out), "iptables", "-t", "nat", "-C", "POSTROUTING", "-o", "rmnet_data0", "-j",
+                    "MASQUERADE", NULL) != 0)
+        run_command(out, sizeof(out), "iptables", "-t", "nat", "-A", "POSTROUTING", "-o", "rmnet_data0", "-j",
+                    "MASQUERADE", NULL);
+    if (run_command(out, sizeof(out), "iptables", "-C", "FORWARD", "-i", iface, "-j", "ACCEPT", NULL) != 0)
+        run_command(out, sizeof(out), "iptables", "-A", "FORWARD", "-i", iface, "-j", "ACCEPT", NULL);
+
+    /* 关闭 sipa_usb0 接口（避免冲突），标记配置完成 */
+    run_command(out, sizeof(out), "ip", "link", "set", "dev", "sipa_usb0", "down", NULL);
+    FILE *f = fopen("/tmp/sipa_usb0_ok", "w");
+    if (f) fclose(f);
+    return ret;
+}
+
+static int exec_step(UsbPlan *plan, UsbStep *s) {
+    char full[256], target[256];
+    const char *root = usb_root();
+
+    switch (s->op) {
+    case USB_OP_MKDIR:
+        return mkdir(rooted(s->path, full, sizeof(full)), 0755) == 0 || errno == EEXIST ? 0 : -1;
+    case USB_OP_RMDIR:
+        return rmdir(rooted(s->path, full, sizeof(full)));
+    case USB_OP_UNLINK:
+        return unlink(rooted(s->path, full, sizeof(full)));
+    case USB_OP_SYMLINK:
+        snprintf(target, sizeof(target), "%s%s/%s", root, USB_FUNCTIONS_PATH, s->value);
+        return symlink(target, rooted(s->path, full, sizeof(full)));
+    case USB_OP_WRITE:
+    case USB_OP_UDC_UNBIND:
+    case USB_OP_UDC_BIND:
+        if (s->optional && !path_exists(s->path)) return 0;
+        return write_sysfs(s->path, s->value);
+    case USB_OP_START_ADBD:
+        if (!root[0]) start_adbd();
+        return 0;
+    case USB_OP_WAIT_FFS:
+        return wait_any(s->path, 5000) >= 0 ? 0 : -1;
+    case USB_OP_WAIT_NETDEV: {
+        int idx = wait_any(s->path, 5000);
+        if (idx < 0) return -1;
+        snprintf(plan->iface, sizeof(plan->iface), "%s", idx == 0 ? "usb0" : "rndis0");
+        return 0;
+    }
+    case USB_OP_NETWORK:
+        /* 测试根目录下不执行外部命令 */
+        if (root[0] || !plan->iface[0]) return 0;
+        return configure_usb_network(plan->iface);
     }
-    
-network_done:
-    /* 3. 关闭 sipa_usb0 接口（避免冲突） */
-    run_cmd("ifconfig sipa_usb0 down 2>/dev/null");
-    
-    /* 4. 启用 SFP 硬件转发加速 */
-    enable_sfp_acceleration();
-    
-    /* 5. 标记配置完成 */
-    run_cmd("touch /tmp/sipa_usb0_ok");
+    return -1;
 }
 
-/* 创建多功能模式的符号链接 (f1-f9) */
-static int create_multi_function_links(const UsbModeConfig *cfg) {
-    /* f1: 主网络功能 (ncm/ecm/rndis) */
-    if (create_function_link(cfg->functions, "f1") != 0) return -1;
-    
-    /* f2: gser.gs2 (AT 指令通道) */
-    create_function_link("gser.gs2", "f2");
-    
-    /* f3: gser.gs0 (诊断通道) */
-    create_function_link("gser.gs0", "f3");
-    
-    /* f4: vser.gs0 (虚拟串口/IQ 日志) */
-    create_function_link("vser.gs0", "f4");
-    
-    /* f5: gser.gs3 */
-    create_function_link("gser.gs3", "f5");
-    
-    /* f6: ffs.adb (Android Debug Bridge) */
-    create_function_link("ffs.adb", "f6");
-    
-    /* f7-f9: 更多串口通道 */
-    create_function_link("gser.gs4", "f7");
-    create_function_link("gser.gs5", "f8");
-    create_function_link("gser.gs6", "f9");
-    
-    return 0;
+/* 执行计划，返回 0 成功；关键步骤失败时跳过其余变更，仍尝试重新绑定 UDC */
+static int plan_execute(UsbPlan *plan) {
+    struct timespec start, step_start, outage_start;
+    int ret = 0, outage = 0, skip = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (int i = 0; i < plan->count; i++) {
+        UsbStep *s = &plan->steps[i];
+        if (skip && s->op != USB_OP_UDC_BIND && s->op != USB_OP_WAIT_NETDEV && s->op != USB_OP_NETWORK) {
+            s->ret = -1;
+            continue;
+        }
+        if (s->op == USB_OP_UDC_UNBIND) {
+            clock_gettime(CLOCK_MONOTONIC, &outage_start);
+            outage = 1;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &step_start);
+        s->ret = exec_step(plan, s);
+        if (s->ret != 0 && s->op == USB_OP_UDC_BIND && !usb_root()[0]) {
+            /* functionfs 未就绪时绑定会失败: 重启 adbd 后重试一次 */
+            LOG_W("USB切换: 绑定 UDC 失败，重启 adbd 后重试");
+            start_adbd();
+            wait_any(USB_FFS_READY_PATH, 5000);
+            s->ret = exec_step(plan, s);
+        }
+        s->dur_us = elapsed_us(&step_start);
+
+        LOG_I("USB切换: [%d/%d] %s %s%s%s %.1fms%s", i + 1, plan->count, usb_op_names[s->op], s->path,
+              s->value[0] ? " = " : "", s->value, s->dur_us / 1000.0, s->ret == 0 ? "" : " 失败");
+        if (s->ret != 0 && s->critical) {
+            ret = -2;
+            skip = 1;
+        }
+        if (s->ret != 0 && (s->op == USB_OP_UDC_BIND || s->op == USB_OP_WAIT_NETDEV)) ret = -3;
+        if (outage && s->op == USB_OP_NETWORK) {
+            plan->outage_us = elapsed_us(&outage_start);
+            outage = 0;
+        }
+    }
+    if (outage) plan->outage_us = elapsed_us(&outage_start);
+    plan->total_us = elapsed_us(&start);
+    plan->ret = ret;
+    return ret;
 }
 
 /* USB 模式热切换 */
@@ -481,148 +683,171 @@ int usb_mode_switch_advanced(int mode) {
         printf("[usb_mode] 无效模式: %d\n", mode);
         return -1;
     }
-    
-    const UsbModeConfig *cfg = &usb_mode_configs[mode];
-    /* 提前缓存 UDC 名称，避免禁用后读取为空 */
-    const char *udc_name = get_udc_name();
-    char path[256];
-    
-    printf("[usb_mode] 开始热切换到模式 %d (%s)\n", mode, cfg->configuration);
-    
-    /* 1. 停止 adbd */
-    stop_adbd();
-    
-    /* 2. 禁用 UDC */
-    write_sysfs(USB_UDC_PATH, "none");
-    usleep(100000);
-    
-    /* 3. 删除所有链接和功能 */
-    remove_function_links();
-    remove_cdc_functions();
-    
-    /* 4. 设置 IPA 协议 */
-    if (cfg->pamu3_protocol && access(PAMU3_PROTOCOL_PATH, F_OK) == 0) {
-        write_sysfs(PAMU3_PROTOCOL_PATH, cfg->pamu3_protocol);
-    }
-    
-    /* 5. 设置 max_dl_pkts (下行包批量数) */
-    write_sysfs("/sys/devices/platform/soc/soc:ipa/2b300000.pamu3/max_dl_pkts", "7");
-    
-    /* 6. 设置 VID/PID */
-    snprintf(path, sizeof(path), "%s/idVendor", USB_GADGET_PATH);
-    write_sysfs(path, cfg->vid);
-    snprintf(path, sizeof(path), "%s/idProduct", USB_GADGET_PATH);
-    write_sysfs(path, cfg->pid);
-    snprintf(path, sizeof(path), "%s/bcdDevice", USB_GADGET_PATH);
-    write_sysfs(path, cfg->bcd_device);
-    snprintf(path, sizeof(path), "%s/bDeviceClass", USB_GADGET_PATH);
-    write_sysfs(path, "0");
-    
-    /* 7. 设置配置描述符 */
-    snprintf(path, sizeof(path), "%s/strings/0x409/configuration", USB_CONFIG_PATH);
-    write_sysfs(path, cfg->configuration);
-    snprintf(path, sizeof(path), "%s/MaxPower", USB_CONFIG_PATH);
-    write_sysfs(path, "500");
-    snprintf(path, sizeof(path), "%s/bmAttributes", USB_CONFIG_PATH);
-    write_sysfs(path, "0xc0");
-    
-    /* 8. 创建主功能目录 */
-    if (create_function_dir(cfg->functions) != 0) {
-        return -2;
-    }
-    
-    /* 9. 创建 gser/vser 功能目录 */
-    create_gser_functions();
-    
-    /* 10. 设置 MAC 地址 */
-    snprintf(path, sizeof(path), "%s/%s/dev_addr", USB_FUNCTIONS_PATH, cfg->functions);
-    if (access(path, F_OK) == 0) {
-        write_sysfs(path, "cc:e8:ac:c0:00:00");
-    }
-    snprintf(path, sizeof(path), "%s/%s/host_addr", USB_FUNCTIONS_PATH, cfg->functions);
-    if (access(path, F_OK) == 0) {
-        write_sysfs(path, "cc:e8:ac:c0:00:01");
-    }
-    
-    /* 11. 创建多功能链接 (f1-f9) */
-    if (create_multi_function_links(cfg) != 0) {
-        return -3;
-    }
-    
-    /* 12. 启动 adbd */
-    start_adbd();
-    
-    /* 13. 等待 functionfs 挂载完成 */
-    wait_for_functionfs();
-    
-    /* 14. 设置日志传输 */
-    write_sysfs("/sys/module/slog_bridge/parameters/log_transport", "1");
-    
-    /* 15. 启用 UDC */
-    write_sysfs(USB_UDC_PATH, udc_name);
-    
-    /* 16. 等待 USB 枚举 */
-    usleep(1000000); /* 1s */
-    
-    /* 17. 配置网络接口 */
-    configure_usb_network();
-    
-    printf("[usb_mode] 热切换完成: %s\n", cfg->configuration);
-    return 0;
+
+    static UsbPlan plan;    /* 只由切换线程使用，g_usb.switching 保证串行 */
+    plan_build(mode, &plan);
+    LOG_I("USB切换: 开始切换到模式 %d (%s)，计划 %d 步", mode, usb_mode_configs[mode].configuration, plan.count);
+
+    int ret = plan_execute(&plan);
+    LOG_I("USB切换: 完成 %s，总耗时 %.1fms，链路中断 %.1fms%s", usb_mode_configs[mode].configuration,
+          plan.total_us / 1000.0, plan.outage_us / 1000.0, ret == 0 ? "" : " (有失败步骤)");
+
+    pthread_mutex_lock(&g_usb_lock);
+    g_usb.last = plan;
+    pthread_mutex_unlock(&g_usb_lock);
+    return ret;
 }
 
 /* 获取当前硬件 USB 模式 */
 int usb_mode_get_current_hardware(void) {
     char vid[32] = {0}, pid[32] = {0};
-    char path[256];
-    
-    snprintf(path, sizeof(path), "%s/idVendor", USB_GADGET_PATH);
-    if (read_sysfs(path, vid, sizeof(vid)) != 0) return -1;
-    
-    snprintf(path, sizeof(path), "%s/idProduct", USB_GADGET_PATH);
-    if (read_sysfs(path, pid, sizeof(pid)) != 0) return -1;
-    
+
+    if (read_sysfs(USB_GADGET_PATH "/idVendor", vid, sizeof(vid)) != 0) return -1;
+    if (read_sysfs(USB_GADGET_PATH "/idProduct", pid, sizeof(pid)) != 0) return -1;
+
     /* 根据 VID:PID 判断模式 */
-    if (strcmp(vid, "0x1782") == 0) {
-        if (strcmp(pid, "0x4040") == 0) return 1; /* NCM */
-        if (strcmp(pid, "0x4039") == 0) return 2; /* ECM */
-        if (strcmp(pid, "0x4038") == 0) return 3; /* RNDIS */
+    for (int mode = USB_MODE_CDC_NCM; mode <= USB_MODE_RNDIS; mode++) {
+        if (strcmp(vid, usb_mode_configs[mode].vid) == 0 && strcmp(pid, usb_mode_configs[mode].pid) == 0)
+            return mode;
     }
     return -1;
 }
 
-/* POST /api/usb-advance - USB 热切换 */
+static void add_plan_json(JsonBuilder *j, const UsbPlan *plan, int executed) {
+    json_add_int(j, "mode_value", plan->mode);
+    json_add_str(j, "mode", usb_mode_name(plan->mode));
+    json_add_long(j, "time", (long long)plan->time);
+    if (executed) {
+        json_add_int(j, "ret", plan->ret);
+        json_add_str(j, "iface", plan->iface);
+        json_add_double(j, "total_ms", plan->total_us / 1000.0);
+        json_add_double(j, "outage_ms", plan->outage_us / 1000.0);
+    }
+    json_arr_open(j, "steps");
+    for (int i = 0; i < plan->count; i++) {
+        const UsbStep *s = &plan->steps[i];
+        json_arr_obj_open(j);
+        json_add_str(j, "op", usb_op_names[s->op]);
+        if (s->path[0]) json_add_str(j, "path", s->path);
+        if (s->value[0]) json_add_str(j, "value", s->value);
+        if (executed) {
+            json_add_double(j, "ms", s->dur_us / 1000.0);
+            json_add_bool(j, "ok", s->ret == 0);
+        }
+        json_obj_close(j);
+    }
+    json_arr_close(j);
+}
+
+/* GET /api/usb-advance - 最近一次热切换的计划和每步耗时 */
+void handle_usb_advance_status(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    JsonBuilder *j = json_new();
+    json_obj_open(j);
+    json_add_int(j, "Code", 0);
+    json_add_str(j, "Error", "");
+    json_key_obj_open(j, "Data");
+    pthread_mutex_lock(&g_usb_lock);
+    json_add_bool(j, "switching", g_usb.switching);
+    if (g_usb.last.mode) {
+        json_key_obj_open(j, "last");
+        add_plan_json(j, &g_usb.last, 1);
+        json_obj_close(j);
+    }
+    pthread_mutex_unlock(&g_usb_lock);
+    json_obj_close(j);
+    json_obj_close(j);
+
+    HTTP_OK_FREE(c, json_finish(j));
+}
+
+static void *usb_switch_thread(void *arg) {
+    int mode = (int)(intptr_t)arg;
+
+    /* 等待响应发送完成: 切换过程中 USB 连接会断开 */
+    usleep(200000);
+    int ret = usb_mode_switch_advanced(mode);
+    if (ret != 0) {
+        printf("[usb_mode] 热切换失败: %d\n", ret);
+    }
+
+    pthread_mutex_lock(&g_usb_lock);
+    g_usb.switching = 0;
+    pthread_mutex_unlock(&g_usb_lock);
+    return NULL;
+}
+
+static void usb_advance_error(struct mg_connection *c, const char *msg) {
+    JsonBuilder *j = json_new();
+    json_obj_open(j);
+    json_add_int(j, "Code", 1);
+    json_add_str(j, "Error", msg);
+    json_add_null(j, "Data");
+    json_obj_close(j);
+    HTTP_OK_FREE(c, json_finish(j));
+}
+
+/* POST /api/usb-advance - USB 热切换，{"mode":1, "dry_run":true} 只返回计划 */
 void handle_usb_advance(struct mg_connection *c, struct mg_http_message *hm) {
     HTTP_CHECK_POST(c, hm);
-    
+
     double mode_val = 0;
     if (!mg_json_get_num(hm->body, "$.mode", &mode_val)) {
-        JsonBuilder *j = json_new();
-        json_obj_open(j);
-        json_add_int(j, "Code", 1);
-        json_add_str(j, "Error", "mode参数不能为空");
-        json_add_null(j, "Data");
-        json_obj_close(j);
-        HTTP_OK_FREE(c, json_finish(j));
+        usb_advance_error(c, "mode参数不能为空");
         return;
     }
-    
+
     int mode = (int)mode_val;
     if (mode < 1 || mode > 3) {
+        usb_advance_error(c, "无效模式，支持: 1=NCM, 2=ECM, 3=RNDIS");
+        return;
+    }
+
+    bool dry_run = false;
+    mg_json_get_bool(hm->body, "$.dry_run", &dry_run);
+    if (dry_run) {
+        UsbPlan *plan = malloc(sizeof(UsbPlan));
+        if (!plan) {
+            usb_advance_error(c, "内存不足");
+            return;
+        }
+        plan_build(mode, plan);
         JsonBuilder *j = json_new();
         json_obj_open(j);
-        json_add_int(j, "Code", 1);
-        json_add_str(j, "Error", "无效模式，支持: 1=NCM, 2=ECM, 3=RNDIS");
-        json_add_null(j, "Data");
+        json_add_int(j, "Code", 0);
+        json_add_str(j, "Error", "");
+        json_key_obj_open(j, "Data");
+        add_plan_json(j, plan, 0);
+        json_obj_close(j);
         json_obj_close(j);
+        free(plan);
         HTTP_OK_FREE(c, json_finish(j));
         return;
     }
-    
-    /* 先发送成功响应，再执行USB切换
-     * 因为USB切换过程中会断开USB连接，如果先切换再响应，
-     * HTTP响应无法发送到客户端，前端会显示失败
+
+    pthread_mutex_lock(&g_usb_lock);
+    int busy = g_usb.switching;
+    g_usb.switching = 1;
+    pthread_mutex_unlock(&g_usb_lock);
+    if (busy) {
+        usb_advance_error(c, "USB模式切换进行中");
+        return;
+    }
+
+    /* 切换在后台线程执行，事件循环先把响应发出去
+     * (USB切换过程中会断开USB连接，如果先切换再响应，前端会显示失败)
      */
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, usb_switch_thread, (void *)(intptr_t)mode) != 0) {
+        pthread_mutex_lock(&g_usb_lock);
+        g_usb.switching = 0;
+        pthread_mutex_unlock(&g_usb_lock);
+        usb_advance_error(c, "创建切换线程失败");
+        return;
+    }
+    pthread_detach(tid);
+
     JsonBuilder *j = json_new();
     json_obj_open(j);
     json_add_int(j, "Code", 0);
@@ -633,16 +858,7 @@ void handle_usb_advance(struct mg_connection *c, struct mg_http_message *hm) {
     json_add_str(j, "message", "USB模式切换中，请稍候...");
     json_obj_close(j);
     json_obj_close(j);
-    
+
     HTTP_OK_FREE(c, json_finish(j));
     c->is_draining = 1;  /* 标记连接即将关闭，确保响应发送完成 */
-    
-    /* 等待响应发送完成 */
-    usleep(200000);  /* 200ms */
-    
-    /* 执行USB热切换 */
-    int ret = usb_mode_switch_advanced(mode);
-    if (ret != 0) {
-        printf("[usb_mode] 热切换失败: %d\n", ret);
-    }
 }
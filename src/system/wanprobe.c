@@ -0,0 +1,645 @@
+/**
+ * @file wanprobe.c
+ * @brief WAN 链路探测实现
+ */
+
+#include "wanprobe.h"
+#include "arena.h"
+#include "database.h"
+#include "exec_utils.h"
+#include "http_utils.h"
+#include "json_builder.h"
+#include "log.h"
+#include "metrics.h"
+#include "telemetry.h"
+#include "worker.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <netinet/ip_icmp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+/* 配置 */
+typedef struct {
+    int enabled;
+    int interval_sec;
+    int count;
+    int timeout_ms;
+    char iface[32];                 /* 空=不绑定接口 */
+    char targets[WANPROBE_MAX_TARGETS * 64];    /* 逗号分隔 */
+} WanProbeConfig;
+
+enum { PROBE_ICMP, PROBE_TCP };
+
+/* 探测地址 (探测线程在锁外使用的副本) */
+typedef struct {
+    char spec[64];                  /* icmp:HOST / tcp:HOST:PORT */
+    int proto;
+    struct sockaddr_in addr;
+} ProbeDest;
+
+/* 单轮汇总 */
+typedef struct {
+    time_t time;
+    uint16_t sent;
+    uint16_t received;
+    uint32_t rtt_avg_us;
+    uint32_t rtt_max_us;
+    uint32_t jitter_us;
+} ProbeRound;
+
+/* 目标统计 */
+typedef struct {
+    ProbeDest dest;
+    LatencyHist hist;
+    uint64_t sent;
+    uint64_t received;
+    uint64_t last_us;
+    uint64_t min_us;
+    double jitter_us;               /* RFC 3550: J += (|D| - J) / 16 */
+    int have_prev;
+    char last_error[64];
+    ProbeRound history[WANPROBE_HISTORY];
+    int history_next;
+    int history_count;
+} ProbeTarget;
+
+static struct {
+    WanProbeConfig cfg;
+    unsigned generation;            /* 目标列表变化或重置时递增，丢弃进行中的一轮 */
+    unsigned rounds;
+    time_t last_round;
+    ProbeTarget targets[WANPROBE_MAX_TARGETS];
+    int target_count;
+} g_wp;
+
+static pthread_mutex_t g_wp_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* 探测线程 (受 g_wp_lock 保护) */
+static void *wanprobe_thread(void *arg);
+static int wanprobe_wanted(void) { return g_wp.cfg.enabled; }
+static Worker g_wp_worker = WORKER_INIT("WAN探测", wanprobe_thread, wanprobe_wanted);
+
+static const WanProbeConfig WANPROBE_DEFAULTS = {
+    .enabled = 0,
+    .interval_sec = 10,
+    .count = 3,
+    .timeout_ms = 1000,
+    .iface = "sipa_eth0",
+    .targets = "icmp:223.5.5.5,icmp:119.29.29.29,tcp:223.5.5.5:53",
+};
+
+/* ==================== 目标解析 ==================== */
+
+/* 解析 icmp:HOST / tcp:HOST:PORT，HOST 为 IPv4 地址 */
+static int parse_target(const char *spec, ProbeDest *d) {
+    char host[48];
+    int port = 0;
+    const char *rest;
+
+    memset(d, 0, sizeof(*d));
+    if (strlen(spec) >= sizeof(d->spec)) return -1;
+    if (strncmp(spec, "icmp:", 5) == 0) {
+        d->proto = PROBE_ICMP;
+        rest = spec + 5;
+        if (strlen(rest) >= sizeof(host)) return -1;
+        strcpy(host, rest);
+    } else if (strncmp(spec, "tcp:", 4) == 0) {
+        d->proto = PROBE_TCP;
+        rest = spec + 4;
+        const char *colon = strrchr(rest, ':');
+        if (!colon || (size_t)(colon - rest) >= sizeof(host)) return -1;
+        snprintf(host, sizeof(host), "%.*s", (int)(colon - rest), rest);
+        char *end;
+        long p = strtol(colon + 1, &end, 10);
+        if (*end || p < 1 || p > 65535) return -1;
+        port = (int)p;
+    } else {
+        return -1;
+    }
+
+    d->addr.sin_family = AF_INET;
+    d->addr.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, host, &d->addr.sin_addr) != 1) return -1;
+    strcpy(d->spec, spec);
+    return 0;
+}
+
+/* 按新的目标列表重建 g_wp.targets，同名目标保留已有统计 (调用方持有锁) */
+static void set_targets_locked(const ProbeDest *dests, int count, int reset) {
+    ProbeTarget *old = malloc(sizeof(g_wp.targets));
+    if (!old) return;
+    memcpy(old, g_wp.targets, sizeof(g_wp.targets));
+    int old_count = g_wp.target_count;
+
+    memset(g_wp.targets, 0, sizeof(g_wp.targets));
+    for (int i = 0; i < count; i++) {
+        int found = -1;
+        for (int k = 0; !reset && k < old_count; k++) {
+            if (strcmp(old[k].dest.spec, dests[i].spec) == 0) {
+                found = k;
+                break;
+            }
+        }
+        if (found >= 0) g_wp.targets[i] = old[found];
+        g_wp.targets[i].dest = dests[i];
+    }
+    g_wp.target_count = count;
+    g_wp.generation++;
+    free(old);
+}
+
+/* 从配置字符串加载目标，格式错误的条目跳过 (调用方持有锁) */
+static void load_targets_locked(int reset) {
+    ProbeDest dests[WANPROBE_MAX_TARGETS];
+    int count = 0;
+    char list[sizeof(g_wp.cfg.targets)];
+    char *save = NULL;
+
+    snprintf(list, sizeof(list), "%s", g_wp.cfg.targets);
+    for (char *tok = strtok_r(list, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        if (count >= WANPROBE_MAX_TARGETS) break;
+        if (parse_target(tok, &dests[count]) != 0) {
+            LOG_W("WAN探测: 忽略无效目标 %s", tok);
+            continue;
+        }
+        count++;
+    }
+    set_targets_locked(dests, count, reset);
+}
+
+/* ==================== 配置存储 ==================== */
+
+/* iface 为空表示不绑定接口 */
+static void load_config(WanProbeConfig *cfg) {
+    const WanProbeConfig *d = &WANPROBE_DEFAULTS;
+    cfg->enabled = config_get_int("wanprobe_enabled", d->enabled);
+    cfg->interval_sec = config_get_int("wanprobe_interval_sec", d->interval_sec);
+    cfg->count = config_get_int("wanprobe_count", d->count);
+    cfg->timeout_ms = config_get_int("wanprobe_timeout_ms", d->timeout_ms);
+    config_get_optional("wanprobe_iface", cfg->iface, sizeof(cfg->iface), d->iface);
+    if (config_get("wanprobe_targets", cfg->targets, sizeof(cfg->targets)) != 0) {
+        strcpy(cfg->targets, d->targets);
+    }
+}
+
+static void save_config(const WanProbeConfig *cfg) {
+    config_set_int("wanprobe_enabled", cfg->enabled);
+    config_set_int("wanprobe_interval_sec", cfg->interval_sec);
+    config_set_int("wanprobe_count", cfg->count);
+    config_set_int("wanprobe_timeout_ms", cfg->timeout_ms);
+    config_set_optional("wanprobe_iface", cfg->iface);
+    config_set("wanprobe_targets", cfg->targets);
+}
+
+/* ==================== 探测 ==================== */
+
+static int bind_iface(int fd, const char *iface, char *err, size_t err_size) {
+    if (!iface[0]) return 0;
+    if (setsockopt(fd, SOL_SOCKET, SO_BINDTODEVICE, iface, (socklen_t)strlen(iface) + 1) != 0) {
+        snprintf(err, err_size, "bind %s: %s", iface, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static uint16_t icmp_checksum(const void *data, size_t len) {
+    const uint8_t *p = data;
+    uint32_t sum = 0;
+    for (; len > 1; p += 2, len -= 2) sum += (uint32_t)(p[0] << 8 | p[1]);
+    if (len) sum += (uint32_t)(p[0] << 8);
+    while (sum >> 16) sum = (sum & 0xffff) + (sum >> 16);
+    return htons((uint16_t)~sum);
+}
+
+/*
+ * 打开 ICMP 套接字: 数据报套接字 (net.ipv4.ping_group_range 允许时无需特权，
+ * 标识符由内核分配并按套接字过滤应答)，不可用时退回原始套接字
+ */
+static int open_icmp_socket(int *raw) {
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, IPPROTO_ICMP);
+    *raw = 0;
+    if (fd < 0) {
+        fd = socket(AF_INET, SOCK_RAW | SOCK_CLOEXEC, IPPROTO_ICMP);
+        *raw = 1;
+    }
+    return fd;
+}
+
+/* 发送一个 Echo 并等待对应的应答，返回 RTT (微秒)，超时或失败返回 -1 */
+static int64_t icmp_echo(int fd, int raw, const ProbeDest *d, uint16_t ident, uint16_t seq,
+                         int timeout_ms, char *err, size_t err_size) {
+    struct {
+        struct icmphdr hdr;
+        uint64_t stamp;
+    } pkt;
+    memset(&pkt, 0, sizeof(pkt));
+    pkt.hdr.type = ICMP_ECHO;
+    pkt.hdr.un.echo.id = htons(ident);
+    pkt.hdr.un.echo.sequence = htons(seq);
+
+    uint64_t start = metrics_now_us();
+    pkt.stamp = start;
+    pkt.hdr.checksum = icmp_checksum(&pkt, sizeof(pkt));
+    if (sendto(fd, &pkt, sizeof(pkt), 0, (const struct sockaddr *)&d->addr, sizeof(d->addr)) < 0) {
+        snprintf(err, err_size, "send: %s", strerror(errno));
+        return -1;
+    }
+
+    uint64_t deadline = start + (uint64_t)timeout_ms * 1000;
+    uint8_t buf[256];
+    for (;;) {
+        uint64_t now = metrics_now_us();
+        if (now >= deadline) break;
+        struct pollfd pfd = {.fd = fd, .events = POLLIN};
+        if (poll(&pfd, 1, (int)((deadline - now + 999) / 1000)) <= 0) continue;
+
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) continue;
+        const uint8_t *p = buf;
+        if (raw) {
+            /* 原始套接字收到的数据含 IP 头，且会收到本机所有 ICMP 报文 */
+            size_t ihl = (size_t)(buf[0] & 0x0f) * 4;
+            if ((size_t)n < ihl) continue;
+            p += ihl;
+            n -= (ssize_t)ihl;
+        }
+        if ((size_t)n < sizeof(struct icmphdr)) continue;
+        const struct icmphdr *h = (const struct icmphdr *)p;
+        if (h->type != ICMP_ECHOREPLY || ntohs(h->un.echo.sequence) != seq) continue;
+        if (raw && ntohs(h->un.echo.id) != ident) continue;
+        return (int64_t)(metrics_now_us() - start);
+    }
+    snprintf(err, err_size, "timeout");
+    return -1;
+}
+
+/* TCP 连接建立耗时: 收到 SYN-ACK 或 RST 都记为应答 */
+static int64_t tcp_connect(const ProbeDest *d, const char *iface, int timeout_ms, char *err,
+                           size_t err_size) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        snprintf(err, err_size, "socket: %s", strerror(errno));
+        return -1;
+    }
+    if (bind_iface(fd, iface, err, err_size) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    int64_t rtt = -1;
+    uint64_t start = metrics_now_us();
+    int soerr = 0;
+    if (connect(fd, (const struct sockaddr *)&d->addr, sizeof(d->addr)) != 0) {
+        soerr = errno;
+        if (soerr == EINPROGRESS) {
+            struct pollfd pfd = {.fd = fd, .events = POLLOUT};
+            int r = poll(&pfd, 1, timeout_ms);
+            socklen_t len = sizeof(soerr);
+            if (r <= 0) {
+                soerr = ETIMEDOUT;
+            } else if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &soerr, &len) != 0) {
+                soerr = errno;
+            }
+        }
+    }
+    if (soerr == 0 || soerr == ECONNREFUSED) {
+        rtt = (int64_t)(metrics_now_us() - start);
+    } else {
+        snprintf(err, err_size, "%s", soerr == ETIMEDOUT ? "timeout" : strerror(soerr));
+    }
+
+    /* 以 RST 关闭，不在本端留下 TIME_WAIT */
+    struct linger lg = {.l_onoff = 1, .l_linger = 0};
+    setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    close(fd);
+    return rtt;
+}
+
+/* 对一个目标执行一轮探测，rtt[i] < 0 表示丢包 */
+static void probe_target(const ProbeDest *d, int index, const WanProbeConfig *cfg, int64_t *rtt,
+                         char *err, size_t err_size) {
+    int fd = -1, raw = 0;
+    if (d->proto == PROBE_ICMP) {
+        fd = open_icmp_socket(&raw);
+        if (fd < 0) {
+            snprintf(err, err_size, "socket: %s", strerror(errno));
+        } else if (bind_iface(fd, cfg->iface, err, err_size) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    uint16_t ident = (uint16_t)((getpid() << 4) ^ index);
+    static uint16_t seq_base;
+    for (int i = 0; i < cfg->count; i++) {
+        rtt[i] = -1;
+        if (d->proto == PROBE_TCP) {
+            rtt[i] = tcp_connect(d, cfg->iface, cfg->timeout_ms, err, err_size);
+        } else if (fd >= 0) {
+            rtt[i] = icmp_echo(fd, raw, d, ident, ++seq_base, cfg->timeout_ms, err, err_size);
+        }
+        /* 同一目标的探测间隔 100ms，避免突发 */
+        if (i + 1 < cfg->count) usleep(100000);
+    }
+    if (fd >= 0) close(fd);
+}
+
+/* 记录一轮结果 (调用方持有锁) */
+static void record_round(ProbeTarget *t, const int64_t *rtt, int n, const char *err) {
+    ProbeRound r = {.time = time(NULL), .sent = (uint16_t)n};
+    uint64_t sum = 0;
+
+    for (int i = 0; i < n; i++) {
+        t->sent++;
+        if (rtt[i] < 0) continue;
+        uint64_t v = (uint64_t)rtt[i];
+        metrics_hist_record(&t->hist, v);
+        if (t->received == 0 || v < t->min_us) t->min_us = v;
+        if (t->have_prev) {
+            double diff = fabs((double)v - (double)t->last_us);
+            t->jitter_us += (diff - t->jitter_us) / 16.0;
+        }
+        t->last_us = v;
+        t->have_prev = 1;
+        t->received++;
+        r.received++;
+        sum += v;
+        if (v > r.rtt_max_us) r.rtt_max_us = (uint32_t)v;
+    }
+    r.rtt_avg_us = r.received ? (uint32_t)(sum / r.received) : 0;
+    r.jitter_us = (uint32_t)t->jitter_us;
+    snprintf(t->last_error, sizeof(t->last_error), "%s", r.received == n ? "" : err);
+
+    t->history[t->history_next] = r;
+    t->history_next = (t->history_next + 1) % WANPROBE_HISTORY;
+    if (t->history_count < WANPROBE_HISTORY) t->history_count++;
+}
+
+/* 最近一轮的汇总发布到遥测缓存 */
+static void publish_summary(void) {
+    int targets, reachable = 0;
+    unsigned sent = 0, received = 0;
+    double rtt = 0, jitter = 0;
+
+    pthread_mutex_lock(&g_wp_lock);
+    targets = g_wp.target_count;
+    for (int i = 0; i < g_wp.target_count; i++) {
+        const ProbeTarget *t = &g_wp.targets[i];
+        if (t->history_count == 0) continue;
+        const ProbeRound *r = &t->history[(t->history_next + WANPROBE_HISTORY - 1) % WANPROBE_HISTORY];
+        sent += r->sent;
+        received += r->received;
+        if (r->received == 0) continue;
+        reachable++;
+        rtt += r->rtt_avg_us;
+        jitter += t->jitter_us;
+    }
+    pthread_mutex_unlock(&g_wp_lock);
+
+    telemetry_update_wan(targets, reachable, reachable ? rtt / reachable / 1000.0 : 0,
+                         reachable ? jitter / reachable / 1000.0 : 0,
+                         sent ? 100.0 * (sent - received) / sent : 0);
+}
+
+/* 可中断的等待: 停用时返回 0，目标列表变化时提前返回 1 */
+static int wp_sleep(int sec, unsigned generation) {
+    for (int i = 0; i < sec * 10; i++) {
+        pthread_mutex_lock(&g_wp_lock);
+        int enabled = g_wp.cfg.enabled;
+        int changed = g_wp.generation != generation;
+        pthread_mutex_unlock(&g_wp_lock);
+        if (!enabled) return 0;
+        if (changed) return 1;
+        usleep(100000);
+    }
+    return 1;
+}
+
+static void *wanprobe_thread(void *arg) {
+    (void)arg;
+    ProbeDest dests[WANPROBE_MAX_TARGETS];
+    int64_t rtt[WANPROBE_MAX_COUNT];
+    char err[64];
+
+    for (;;) {
+        pthread_mutex_lock(&g_wp_lock);
+        if (worker_exit_locked(&g_wp_worker, 0)) {
+            pthread_mutex_unlock(&g_wp_lock);
+            break;
+        }
+        WanProbeConfig cfg = g_wp.cfg;
+        unsigned generation = g_wp.generation;
+        int count = g_wp.target_count;
+        for (int i = 0; i < count; i++) dests[i] = g_wp.targets[i].dest;
+        pthread_mutex_unlock(&g_wp_lock);
+
+        for (int i = 0; i < count; i++) {
+            err[0] = '\0';
+            probe_target(&dests[i], i, &cfg, rtt, err, sizeof(err));
+
+            pthread_mutex_lock(&g_wp_lock);
+            int valid = g_wp.generation == generation;
+            if (valid) record_round(&g_wp.targets[i], rtt, cfg.count, err);
+            pthread_mutex_unlock(&g_wp_lock);
+            if (!valid) break;
+        }
+
+        pthread_mutex_lock(&g_wp_lock);
+        int completed = g_wp.generation == generation && count > 0;
+        if (completed) {
+            g_wp.rounds++;
+            g_wp.last_round = time(NULL);
+        }
+        pthread_mutex_unlock(&g_wp_lock);
+        if (completed) publish_summary();
+
+        wp_sleep(cfg.interval_sec, generation);
+    }
+    return NULL;
+}
+
+/* ==================== API ==================== */
+
+int wanprobe_init(void) {
+    pthread_mutex_lock(&g_wp_lock);
+    load_config(&g_wp.cfg);
+    load_targets_locked(0);
+    worker_start_locked(&g_wp_worker);
+    pthread_mutex_unlock(&g_wp_lock);
+    return 0;
+}
+
+static double us_to_ms(double us) { return us / 1000.0; }
+
+static void add_target_json(JsonBuilder *j, const ProbeTarget *t) {
+    char host[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &t->dest.addr.sin_addr, host, sizeof(host));
+
+    json_arr_obj_open(j);
+    json_add_str(j, "target", t->dest.spec);
+    json_add_str(j, "proto", t->dest.proto == PROBE_TCP ? "tcp" : "icmp");
+    json_add_str(j, "host", host);
+    if (t->dest.proto == PROBE_TCP) json_add_int(j, "port", ntohs(t->dest.addr.sin_port));
+    json_add_long(j, "sent", (long long)t->sent);
+    json_add_long(j, "received", (long long)t->received);
+    json_add_double(j, "loss_pct", t->sent ? 100.0 * (double)(t->sent - t->received) / (double)t->sent : 0);
+    json_add_double(j, "jitter_ms", us_to_ms(t->jitter_us));
+    json_add_str(j, "last_error", t->last_error);
+
+    json_key_obj_open(j, "rtt_ms");
+    if (t->received) {
+        json_add_double(j, "last", us_to_ms((double)t->last_us));
+        json_add_double(j, "min", us_to_ms((double)t->min_us));
+        json_add_double(j, "avg", us_to_ms((double)t->hist.sum / (double)t->hist.count));
+        json_add_double(j, "p50", us_to_ms((double)metrics_hist_percentile(&t->hist, 0.50)));
+        json_add_double(j, "p90", us_to_ms((double)metrics_hist_percentile(&t->hist, 0.90)));
+        json_add_double(j, "p99", us_to_ms((double)metrics_hist_percentile(&t->hist, 0.99)));
+        json_add_double(j, "max", us_to_ms((double)t->hist.max));
+    }
+    json_obj_close(j);
+
+    /* 逐轮历史，从旧到新 */
+    json_arr_open(j, "history");
+    for (int k = 0; k < t->history_count; k++) {
+        int idx = (t->history_next - t->history_count + k + WANPROBE_HISTORY) % WANPROBE_HISTORY;
+        const ProbeRound *r = &t->history[idx];
+        json_arr_obj_open(j);
+        json_add_long(j, "time", (long long)r->time);
+        json_add_int(j, "sent", r->sent);
+        json_add_int(j, "received", r->received);
+        json_add_double(j, "rtt_avg_ms", us_to_ms(r->rtt_avg_us));
+        json_add_double(j, "rtt_max_ms", us_to_ms(r->rtt_max_us));
+        json_add_double(j, "jitter_ms", us_to_ms(r->jitter_us));
+        json_obj_close(j);
+    }
+    json_arr_close(j);
+    json_obj_close(j);
+}
+
+void handle_wanprobe_status(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_GET(c, hm);
+
+    pthread_mutex_lock(&g_wp_lock);
+    JsonBuilder *j = json_new();
+    json_obj_open(j);
+
+    json_key_obj_open(j, "config");
+    json_add_bool(j, "enabled", g_wp.cfg.enabled);
+    json_add_int(j, "interval_sec", g_wp.cfg.interval_sec);
+    json_add_int(j, "count", g_wp.cfg.count);
+    json_add_int(j, "timeout_ms", g_wp.cfg.timeout_ms);
+    json_add_str(j, "iface", g_wp.cfg.iface);
+    json_obj_close(j);
+
+    json_key_obj_open(j, "state");
+    json_add_bool(j, "running", g_wp_worker.running);
+    json_add_long(j, "rounds", (long long)g_wp.rounds);
+    json_add_long(j, "last_round", (long long)g_wp.last_round);
+    json_obj_close(j);
+
+    json_arr_open(j, "targets");
+    for (int i = 0; i < g_wp.target_count; i++) add_target_json(j, &g_wp.targets[i]);
+    json_arr_close(j);
+
+    json_obj_close(j);
+    pthread_mutex_unlock(&g_wp_lock);
+
+    HTTP_OK_FREE(c, json_finish(j));
+}
+
+/* 解析 targets 数组，同时生成逗号分隔的配置字符串；返回错误信息，成功返回NULL */
+static const char *parse_targets_json(struct mg_str body, ProbeDest *dests, int *count, char *list,
+                                      size_t list_size) {
+    int len;
+    int ofs = mg_json_get(body, "$.targets", &len);
+    struct mg_str arr = mg_str_n(body.buf + ofs, (size_t)len);
+    size_t pos = 0;
+    struct mg_str key, val;
+    char spec[64];
+
+    if (arr.buf[0] != '[') return "targets 必须为数组";
+    *count = 0;
+    list[0] = '\0';
+    while ((pos = mg_json_next(arr, pos, &key, &val)) > 0) {
+        if (*count >= WANPROBE_MAX_TARGETS) return "目标数量过多";
+        if (val.len < 2 || val.len - 2 >= sizeof(spec) || val.buf[0] != '"') return "targets 格式错误";
+        snprintf(spec, sizeof(spec), "%.*s", (int)val.len - 2, val.buf + 1);
+        if (parse_target(spec, &dests[*count]) != 0) return "无效目标 (icmp:IPv4 或 tcp:IPv4:端口)";
+        for (int k = 0; k < *count; k++) {
+            if (strcmp(dests[k].spec, spec) == 0) return "目标重复";
+        }
+        snprintf(list + strlen(list), list_size - strlen(list), "%s%s", *count ? "," : "", spec);
+        (*count)++;
+    }
+    return NULL;
+}
+
+void handle_wanprobe_config(struct mg_connection *c, struct mg_http_message *hm) {
+    HTTP_CHECK_POST(c, hm);
+
+    pthread_mutex_lock(&g_wp_lock);
+    WanProbeConfig cfg = g_wp.cfg;
+    pthread_mutex_unlock(&g_wp_lock);
+
+    bool b;
+    bool reset = false;
+    if (mg_json_get_bool(hm->body, "$.enabled", &b)) cfg.enabled = b;
+    mg_json_get_bool(hm->body, "$.reset", &reset);
+    cfg.interval_sec = (int)mg_json_get_long(hm->body, "$.interval_sec", cfg.interval_sec);
+    cfg.count = (int)mg_json_get_long(hm->body, "$.count", cfg.count);
+    cfg.timeout_ms = (int)mg_json_get_long(hm->body, "$.timeout_ms", cfg.timeout_ms);
+
+    char iface[64];
+    if (http_json_get_str(hm->body, "$.iface", iface, sizeof(iface))) {
+        if (strlen(iface) >= sizeof(cfg.iface) || !valid_ifname(iface)) {
+            HTTP_ERROR(c, 400, "接口名无效");
+            return;
+        }
+        strcpy(cfg.iface, iface);
+    }
+
+    ProbeDest dests[WANPROBE_MAX_TARGETS];
+    int count = -1;
+    int len;
+    if (mg_json_get(hm->body, "$.targets", &len) >= 0) {
+        const char *msg = parse_targets_json(hm->body, dests, &count, cfg.targets, sizeof(cfg.targets));
+        if (msg) {
+            HTTP_ERROR(c, 400, msg);
+            return;
+        }
+    }
+
+    if (cfg.interval_sec < 1 || cfg.interval_sec > 3600 || cfg.count < 1 ||
+        cfg.count > WANPROBE_MAX_COUNT || cfg.timeout_ms < 100 || cfg.timeout_ms > 10000) {
+        HTTP_ERROR(c, 400, "参数无效");
+        return;
+    }
+
+    pthread_mutex_lock(&g_wp_lock);
+    int changed = count >= 0 && strcmp(cfg.targets, g_wp.cfg.targets) != 0;
+    g_wp.cfg = cfg;
+    if (changed || reset) {
+        if (count >= 0)
+            set_targets_locked(dests, count, reset);
+        else
+            load_targets_locked(1);
+        if (reset) {
+            g_wp.rounds = 0;
+            g_wp.last_round = 0;
+        }
+    }
+    save_config(&cfg);
+    worker_start_locked(&g_wp_worker);
+    pthread_mutex_unlock(&g_wp_lock);
+
+    HTTP_SUCCESS(c, "配置已保存");
+}
@@ -0,0 +1,27 @@
+/**
+ * @file worker.c
+ * @brief 按配置启停的后台线程
+ */
+
+#include "worker.h"
+#include "log.h"
+#include <pthread.h>
+
+int worker_start_locked(Worker *w) {
+    if (w->running || !w->wanted()) return 0;
+
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, w->fn, NULL) != 0) {
+        LOG_E("%s: 创建后台线程失败", w->name);
+        return -1;
+    }
+    pthread_detach(tid);
+    w->running = 1;
+    return 0;
+}
+
+int worker_exit_locked(Worker *w, int force) {
+    if (!force && w->wanted()) return 0;
+    w->running = 0;
+    return 1;
+}